@@ -0,0 +1,181 @@
+// Агрегатор распределённого поиска: рассылает запросы шардам (search_service --shard I/N),
+// собирает статистику слов, ранжирует по общей статистике и сливает выдачу (SearchAggregator).
+// Без --queries запросы читаются из стандартного ввода по одному в строке, выдача печатается.
+// С --queries N запросы генерируются по корпусу шардов (тот же --seed), печатается сводка в JSON:
+// задержка, неполные результаты, таймауты и дублирующие запросы.
+//
+// Сборка из каталога search-server (только Linux):
+//
+//  g++ -std=c++17 -O2 aggregator/aggregator.cpp $(ls *.cpp | grep -v '^main.cpp$') -o search_aggregator -ltbb -lpthread
+//
+// Пример: два шарда, у второго две реплики
+//
+//  ./search_service --port 7071 --documents 100000 --shard 0/2 &
+//  ./search_service --port 7072 --documents 100000 --shard 1/2 &
+//  ./search_service --port 7073 --documents 100000 --shard 1/2 &
+//  ./search_aggregator --shard :7071 --shard :7072,:7073 --timeout 100 --hedge 10 --queries 10000
+
+#include "../search_aggregator.h"
+#include "../corpus_generator.h"
+#include "../latency_histogram.h"
+
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    using Clock = chrono::steady_clock;
+
+    struct AggregatorConfig {
+        vector<vector<ServiceAddress>> shards;
+        SearchAggregatorOptions options;
+        size_t query_count = 0; // 0 - запросы из стандартного ввода
+        uint32_t seed = 42;
+    };
+
+    void PrintUsage() {
+        cerr << "Usage: search_aggregator --shard ADDRESS[,ADDRESS...] [--shard ...] [--timeout MS] [--hedge MS]"s
+            << " [--queries N] [--seed N]"s << endl
+            << "ADDRESS: host:port, :port or unix:path; addresses of one --shard are its replicas"s << endl;
+    }
+
+    AggregatorConfig ParseArguments(int argc, char* argv[]) {
+        AggregatorConfig config;
+        for (int i = 1; i < argc; ++i) {
+            const string_view argument = argv[i];
+            if (i + 1 >= argc) {
+                throw invalid_argument("missing value for "s + string(argument));
+            }
+            const string value = argv[++i];
+            if (argument == "--shard"sv) {
+                vector<ServiceAddress> replicas;
+                string_view addresses = value;
+                while (!addresses.empty()) {
+                    const size_t comma = addresses.find(',');
+                    replicas.push_back(ParseServiceAddress(addresses.substr(0, comma)));
+                    addresses.remove_prefix(comma == string_view::npos ? addresses.size() : comma + 1);
+                }
+                config.shards.push_back(move(replicas));
+            }
+            else if (argument == "--timeout"sv) {
+                config.options.shard_timeout = chrono::milliseconds(stoi(value));
+            }
+            else if (argument == "--hedge"sv) {
+                config.options.hedge_delay = chrono::milliseconds(stoi(value));
+            }
+            else if (argument == "--queries"sv) {
+                config.query_count = stoul(value);
+            }
+            else if (argument == "--seed"sv) {
+                config.seed = static_cast<uint32_t>(stoul(value));
+            }
+            else {
+                throw invalid_argument("unknown argument "s + string(argument));
+            }
+        }
+        if (config.shards.empty()) {
+            throw invalid_argument("at least one --shard is required"s);
+        }
+        if (config.options.shard_timeout.count() <= 0 || config.options.hedge_delay.count() < 0) {
+            throw invalid_argument("timeout must be positive and hedge delay must not be negative"s);
+        }
+        return config;
+    }
+
+    void RunInteractive(SearchAggregator& aggregator) {
+        for (string query; getline(cin, query);) {
+            try {
+                const AggregatedResult result = aggregator.FindTopDocuments(query);
+                cout << "Result for \""s << query << "\""s;
+                if (result.IsPartial()) {
+                    cout << " (partial: "s << result.answered_shards << " of "s << result.shard_count << " shards)"s;
+                }
+                cout << ':' << endl;
+                for (const Document& document : result.documents) {
+                    cout << document << endl;
+                }
+            }
+            catch (const invalid_argument& e) {
+                cout << "Error in query \""s << query << "\": "s << e.what() << endl;
+            }
+        }
+    }
+
+    void RunQueries(SearchAggregator& aggregator, const AggregatorConfig& config) {
+        // Запросы генерируются так же, как в нагрузочных программах для этого корпуса
+        CorpusConfig corpus_config;
+        corpus_config.seed = config.seed;
+        CorpusGenerator corpus(corpus_config);
+        QueryLogConfig log_config;
+        log_config.seed = config.seed + 1;
+        QueryLogGenerator query_log(corpus, log_config);
+
+        LatencyHistogram latencies;
+        uint64_t errors = 0;
+        string query;
+        const auto start = Clock::now();
+        for (size_t i = 0; i < config.query_count; ++i) {
+            query_log.NextQuery(query);
+            const auto query_start = Clock::now();
+            try {
+                aggregator.FindTopDocuments(query);
+            }
+            catch (const invalid_argument&) {
+                ++errors;
+            }
+            latencies.Record(Clock::now() - query_start);
+        }
+        const double seconds = chrono::duration<double>(Clock::now() - start).count();
+
+        const SearchAggregator::Stats stats = aggregator.GetStats();
+        cout << "{\n"s;
+        cout << "  \"config\": {\"shards\": "s << config.shards.size()
+            << ", \"timeout_ms\": "s << config.options.shard_timeout.count()
+            << ", \"hedge_ms\": "s << config.options.hedge_delay.count() << "},\n"s;
+        cout << "  \"queries\": "s << stats.queries << ",\n"s;
+        cout << "  \"queries_per_second\": "s << (seconds > 0 ? stats.queries / seconds : 0.0) << ",\n"s;
+        cout << "  \"errors\": "s << errors << ",\n"s;
+        cout << "  \"partial_results\": "s << stats.partial_results << ",\n"s;
+        cout << "  \"shard_timeouts\": "s << stats.shard_timeouts << ",\n"s;
+        cout << "  \"shard_errors\": "s << stats.shard_errors << ",\n"s;
+        cout << "  \"hedged_requests\": "s << stats.hedged_requests << ",\n"s;
+        cout << "  \"hedge_wins\": "s << stats.hedge_wins << ",\n"s;
+        cout << "  \"latency_ns\": {\"p50\": "s << latencies.GetPercentile(50).count()
+            << ", \"p99\": "s << latencies.GetPercentile(99).count()
+            << ", \"p999\": "s << latencies.GetPercentile(99.9).count()
+            << ", \"max\": "s << latencies.GetMax().count() << "}\n"s;
+        cout << "}\n"s;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    AggregatorConfig config;
+    try {
+        config = ParseArguments(argc, argv);
+    }
+    catch (const exception& e) {
+        cerr << e.what() << endl;
+        PrintUsage();
+        return 1;
+    }
+
+    try {
+        SearchAggregator aggregator(config.shards, config.options);
+        if (config.query_count == 0) {
+            RunInteractive(aggregator);
+        }
+        else {
+            RunQueries(aggregator, config);
+        }
+    }
+    catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include "allocation_counter.h"
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+
+using namespace std;
+
+namespace {
+    thread_local size_t thread_allocation_count = 0;
+    thread_local size_t thread_allocated_bytes = 0;
+}
+
+void* AllocationCounter::Allocate(size_t size) noexcept {
+    ++thread_allocation_count;
+    thread_allocated_bytes += size;
+    // malloc(0) может вернуть nullptr, а operator new обязан вернуть уникальный указатель
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void AllocationCounter::Deallocate(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+AllocationCounter::AllocationCounter()
+    : start_count_(thread_allocation_count)
+    , start_bytes_(thread_allocated_bytes) {
+}
+
+size_t AllocationCounter::GetAllocationCount() const {
+    return thread_allocation_count - start_count_;
+}
+
+size_t AllocationCounter::GetAllocatedBytes() const {
+    return thread_allocated_bytes - start_bytes_;
+}
+
+size_t AllocationCounter::GetThreadAllocationCount() {
+    return thread_allocation_count;
+}
+
+size_t AllocationCounter::GetThreadAllocatedBytes() {
+    return thread_allocated_bytes;
+}
+
+//---------------- Учёт по операциям ----------------
+
+namespace {
+    // Запись идёт один раз на операцию, поэтому общие атомарные счётчики не мешают
+    struct OperationAllocations {
+        atomic<uint64_t> calls{ 0 };
+        atomic<uint64_t> allocations{ 0 };
+        atomic<uint64_t> bytes{ 0 };
+    };
+
+    atomic<bool> allocation_metrics_enabled{ false };
+    array<OperationAllocations, LATENCY_OPERATION_COUNT> operation_allocations;
+}
+
+void AllocationMetrics::SetEnabled(bool enabled) {
+    allocation_metrics_enabled.store(enabled, memory_order_relaxed);
+}
+
+bool AllocationMetrics::IsEnabled() {
+    return allocation_metrics_enabled.load(memory_order_relaxed);
+}
+
+void AllocationMetrics::Record(LatencyOperation operation, size_t allocations, size_t bytes) {
+    OperationAllocations& totals = operation_allocations[static_cast<size_t>(operation)];
+    totals.calls.fetch_add(1, memory_order_relaxed);
+    totals.allocations.fetch_add(allocations, memory_order_relaxed);
+    totals.bytes.fetch_add(bytes, memory_order_relaxed);
+}
+
+AllocationStats AllocationMetrics::GetSnapshot(LatencyOperation operation) {
+    const OperationAllocations& totals = operation_allocations[static_cast<size_t>(operation)];
+    AllocationStats stats;
+    stats.calls = totals.calls.load(memory_order_relaxed);
+    stats.allocations = totals.allocations.load(memory_order_relaxed);
+    stats.bytes = totals.bytes.load(memory_order_relaxed);
+    return stats;
+}
+
+void AllocationMetrics::Reset() {
+    for (OperationAllocations& totals : operation_allocations) {
+        totals.calls.store(0, memory_order_relaxed);
+        totals.allocations.store(0, memory_order_relaxed);
+        totals.bytes.store(0, memory_order_relaxed);
+    }
+}
+
+void AllocationMetrics::PrintSummary(ostream& out) {
+    out << left << setw(24) << "operation"sv << right
+        << setw(12) << "calls"sv << setw(16) << "allocs/call"sv << setw(16) << "bytes/call"sv << endl;
+    for (size_t index = 0; index < LATENCY_OPERATION_COUNT; ++index) {
+        const auto operation = static_cast<LatencyOperation>(index);
+        const AllocationStats stats = GetSnapshot(operation);
+        out << left << setw(24) << GetLatencyOperationName(operation) << right << setw(12) << stats.calls
+            << fixed << setprecision(1)
+            << setw(16) << (stats.calls > 0 ? static_cast<double>(stats.allocations) / stats.calls : 0.0)
+            << setw(16) << (stats.calls > 0 ? static_cast<double>(stats.bytes) / stats.calls : 0.0) << endl;
+        out.unsetf(ios_base::floatfield);
+    }
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+#include "latency_histogram.h"
+
+// Счётчик выделений динамической памяти в текущем потоке.
+// Счётчики ведёт замена глобальных operator new/delete из allocation_hooks.h: каждый вызов operator new
+// увеличивает счётчики выделений и запрошенных байт потока (обращения к thread_local переменным).
+// Замена подключается только в программы, которым нужен учёт (тесты, бенчмарк); без неё счётчики
+// и AllocationMetrics остаются нулевыми, а выделения идут через стандартный operator new.
+//
+// Пример использования:
+//
+//  AllocationCounter counter;
+//  search_server.FindTopDocuments(context, query);
+//  assert(counter.GetAllocationCount() == 0);
+class AllocationCounter {
+public:
+    AllocationCounter();
+
+    // Кол-во выделений памяти и запрошенных байт в текущем потоке с момента создания счётчика
+    size_t GetAllocationCount() const;
+    size_t GetAllocatedBytes() const;
+
+    // Кол-во выделений памяти и запрошенных байт в текущем потоке с момента его запуска
+    static size_t GetThreadAllocationCount();
+    static size_t GetThreadAllocatedBytes();
+
+    // Выделение и освобождение памяти с учётом в счётчиках потока, вызываются заменой operator new/delete
+    static void* Allocate(size_t size) noexcept;
+    static void Deallocate(void* ptr) noexcept;
+
+private:
+    size_t start_count_;
+    size_t start_bytes_;
+};
+
+// Выделения памяти операции: кол-во вызовов операции, выделений и байт за все вызовы
+struct AllocationStats {
+    uint64_t calls = 0;
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+};
+
+// Учёт выделений памяти по операциям сервера (те же операции, что в LatencyMetrics).
+// Выделения относятся ко всем активным областям операций потока: вложенная операция
+// учитывается и в объемлющей. Выделения в рабочих потоках параллельных алгоритмов
+// не учитываются, поскольку счётчики ведутся по потокам.
+// Учёт выключен по умолчанию; выключенная область не читает счётчики
+class AllocationMetrics {
+public:
+    static void SetEnabled(bool enabled);
+    static bool IsEnabled();
+
+    static void Record(LatencyOperation operation, size_t allocations, size_t bytes);
+
+    static AllocationStats GetSnapshot(LatencyOperation operation);
+    static void Reset();
+    // Таблица: операция, кол-во вызовов, выделений и байт в среднем на вызов
+    static void PrintSummary(std::ostream& out);
+};
+
+// Учёт выделений от создания до конца блока с записью в AllocationMetrics
+class ScopedAllocationCounter {
+public:
+    explicit ScopedAllocationCounter(LatencyOperation operation)
+        : operation_(operation)
+        , enabled_(AllocationMetrics::IsEnabled()) {
+        if (enabled_) {
+            start_count_ = AllocationCounter::GetThreadAllocationCount();
+            start_bytes_ = AllocationCounter::GetThreadAllocatedBytes();
+        }
+    }
+
+    ScopedAllocationCounter(const ScopedAllocationCounter&) = delete;
+    ScopedAllocationCounter& operator=(const ScopedAllocationCounter&) = delete;
+
+    ~ScopedAllocationCounter() {
+        if (enabled_) {
+            AllocationMetrics::Record(operation_, AllocationCounter::GetThreadAllocationCount() - start_count_,
+                AllocationCounter::GetThreadAllocatedBytes() - start_bytes_);
+        }
+    }
+
+private:
+    LatencyOperation operation_;
+    bool enabled_;
+    size_t start_count_ = 0;
+    size_t start_bytes_ = 0;
+};
+
+#define ALLOCATION_CONCAT_INTERNAL(X, Y) X##Y
+#define ALLOCATION_CONCAT(X, Y) ALLOCATION_CONCAT_INTERNAL(X, Y)
+
+/**
+ * Макрос учитывает выделения памяти до конца текущего блока в статистике операции.
+ *
+ * Пример использования:
+ *
+ *  AllocationMetrics::SetEnabled(true);
+ *  ...
+ *  void AddDocument(...) {
+ *      ALLOCATION_SCOPE(LatencyOperation::ADD_DOCUMENT);
+ *      ...
+ *  }
+ *
+ *  AllocationMetrics::PrintSummary(std::cout);
+ */
+#define ALLOCATION_SCOPE(operation) ScopedAllocationCounter ALLOCATION_CONCAT(allocationScope, __LINE__)(operation)
@@ -0,0 +1,54 @@
+#pragma once
+
+// Замена глобальных operator new/delete для AllocationCounter.
+// Заменяющие функции должны быть определены в программе один раз, поэтому файл подключается
+// ровно в одном .cpp программы, которой нужен учёт выделений (main.cpp, benchmark/benchmark.cpp).
+// Библиотечные файлы его не подключают: сервис, агрегатор, генератор нагрузки и встраивающие
+// сервер программы работают со стандартным распределителем памяти.
+
+#include "allocation_counter.h"
+
+#include <new>
+
+void* operator new(size_t size) {
+    if (void* ptr = AllocationCounter::Allocate(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return AllocationCounter::Allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return AllocationCounter::Allocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    AllocationCounter::Deallocate(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    AllocationCounter::Deallocate(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    AllocationCounter::Deallocate(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    AllocationCounter::Deallocate(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    AllocationCounter::Deallocate(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    AllocationCounter::Deallocate(ptr);
+}
@@ -0,0 +1,210 @@
+#include "async_query_processor.h"
+
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+namespace {
+    bool IsSameFilter(const optional<DocumentFilter>& lhs, const optional<DocumentFilter>& rhs) {
+        if (!lhs || !rhs) {
+            return !lhs && !rhs;
+        }
+        return lhs->statuses == rhs->statuses && lhs->rating_range == rhs->rating_range && lhs->document_ids == rhs->document_ids;
+    }
+}
+
+AsyncQueryProcessor::AsyncQueryProcessor(const SearchServer& search_server, const AsyncQueryOptions& options)
+    : search_server_(search_server)
+    , options_(options) {
+    if (options_.queue_capacity == 0 || options_.max_batch_size == 0) {
+        throw invalid_argument("queue capacity and batch size must be positive");
+    }
+    if (options_.worker_count == 0) {
+        options_.worker_count = max(1u, thread::hardware_concurrency());
+    }
+    workers_.reserve(options_.worker_count);
+    for (size_t i = 0; i < options_.worker_count; ++i) {
+        workers_.emplace_back([this]() {
+            RunWorker();
+        });
+    }
+}
+
+AsyncQueryProcessor::~AsyncQueryProcessor() {
+    {
+        lock_guard guard(mutex_);
+        stopping_ = true;
+    }
+    not_empty_.notify_all();
+    not_full_.notify_all();
+    for (thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+void AsyncQueryProcessor::CheckCompletion(const Completion& completion) {
+    // Задача без функции завершения отвечает через promise, которого у неё нет
+    if (!completion) {
+        throw invalid_argument("completion must not be empty");
+    }
+}
+
+future<vector<Document>> AsyncQueryProcessor::SubmitQuery(string raw_query) {
+    Task task{ move(raw_query), nullopt, promise<vector<Document>>(), nullptr, {} };
+    future<vector<Document>> result = task.promise->get_future();
+    Enqueue(task, true);
+    return result;
+}
+
+future<vector<Document>> AsyncQueryProcessor::SubmitQuery(string raw_query, DocumentFilter filter) {
+    Task task{ move(raw_query), move(filter), promise<vector<Document>>(), nullptr, {} };
+    future<vector<Document>> result = task.promise->get_future();
+    Enqueue(task, true);
+    return result;
+}
+
+void AsyncQueryProcessor::SubmitQuery(string raw_query, optional<DocumentFilter> filter, Completion completion) {
+    CheckCompletion(completion);
+    Task task{ move(raw_query), move(filter), nullopt, move(completion), {} };
+    Enqueue(task, true);
+}
+
+optional<future<vector<Document>>> AsyncQueryProcessor::TrySubmitQuery(string raw_query, optional<DocumentFilter> filter) {
+    Task task{ move(raw_query), move(filter), promise<vector<Document>>(), nullptr, {} };
+    future<vector<Document>> result = task.promise->get_future();
+    if (!Enqueue(task, false)) {
+        return nullopt;
+    }
+    return result;
+}
+
+bool AsyncQueryProcessor::TrySubmitQuery(string raw_query, optional<DocumentFilter> filter, Completion completion) {
+    CheckCompletion(completion);
+    Task task{ move(raw_query), move(filter), nullopt, move(completion), {} };
+    return Enqueue(task, false);
+}
+
+size_t AsyncQueryProcessor::GetQueueSize() const {
+    lock_guard guard(mutex_);
+    return queue_.size();
+}
+
+AsyncQueryProcessor::Stats AsyncQueryProcessor::GetStats() const {
+    Stats stats;
+    stats.submitted = submitted_.load(memory_order_relaxed);
+    stats.rejected = rejected_.load(memory_order_relaxed);
+    stats.completed = completed_.load(memory_order_relaxed);
+    stats.batches = batches_.load(memory_order_relaxed);
+    stats.deduplicated = deduplicated_.load(memory_order_relaxed);
+    stats.completion_errors = completion_errors_.load(memory_order_relaxed);
+    return stats;
+}
+
+bool AsyncQueryProcessor::Enqueue(Task& task, bool wait) {
+    {
+        unique_lock lock(mutex_);
+        if (stopping_) {
+            throw logic_error("query processor is stopping");
+        }
+        if (queue_.size() >= options_.queue_capacity) {
+            if (!wait) {
+                rejected_.fetch_add(1, memory_order_relaxed);
+                return false;
+            }
+            not_full_.wait(lock, [this]() {
+                return queue_.size() < options_.queue_capacity || stopping_;
+            });
+            if (stopping_) {
+                throw logic_error("query processor is stopping");
+            }
+        }
+        task.submit_time = RequestStatistics::Clock::now();
+        queue_.push_back(move(task));
+        submitted_.fetch_add(1, memory_order_relaxed);
+    }
+    not_empty_.notify_one();
+    return true;
+}
+
+void AsyncQueryProcessor::RunWorker() {
+    SearchServer::QueryContext context;
+    vector<Task> batch;
+    batch.reserve(options_.max_batch_size);
+    while (true) {
+        {
+            unique_lock lock(mutex_);
+            not_empty_.wait(lock, [this]() {
+                return !queue_.empty() || stopping_;
+            });
+            // При остановке очередь дорабатывается до конца
+            if (queue_.empty()) {
+                return;
+            }
+            while (!queue_.empty() && batch.size() < options_.max_batch_size) {
+                batch.push_back(move(queue_.front()));
+                queue_.pop_front();
+            }
+        }
+        not_full_.notify_all();
+        batches_.fetch_add(1, memory_order_relaxed);
+        ProcessBatch(batch, context);
+        batch.clear();
+    }
+}
+
+void AsyncQueryProcessor::ProcessBatch(vector<Task>& batch, SearchServer::QueryContext& context) {
+    // Результаты запросов пачки по порядку; одинаковый запрос берёт результат первого такого же
+    vector<vector<Document>> results(batch.size());
+    vector<exception_ptr> errors(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+        size_t same = 0;
+        while (same < i && (batch[same].raw_query != batch[i].raw_query || !IsSameFilter(batch[same].filter, batch[i].filter))) {
+            ++same;
+        }
+        if (same < i) {
+            results[i] = results[same];
+            errors[i] = errors[same];
+            deduplicated_.fetch_add(1, memory_order_relaxed);
+            continue;
+        }
+        try {
+            if (batch[i].filter) {
+                const DocumentBitmap documents = search_server_.CompileFilter(*batch[i].filter);
+                results[i] = search_server_.FindTopDocuments(context, batch[i].raw_query, cref(documents));
+            }
+            else {
+                results[i] = search_server_.FindTopDocuments(context, batch[i].raw_query);
+            }
+        }
+        catch (...) {
+            errors[i] = current_exception();
+        }
+    }
+    for (size_t i = 0; i < batch.size(); ++i) {
+        Complete(batch[i], move(results[i]), errors[i]);
+    }
+}
+
+void AsyncQueryProcessor::Complete(Task& task, vector<Document> documents, exception_ptr error) {
+    if (options_.statistics != nullptr) {
+        const auto finish = RequestStatistics::Clock::now();
+        options_.statistics->Record(documents.size(), finish - task.submit_time, finish);
+    }
+    completed_.fetch_add(1, memory_order_relaxed);
+    if (task.completion) {
+        // Исключение из рабочего потока завершило бы процесс, а остальные запросы пачки остались бы без ответа
+        try {
+            task.completion(move(documents), error);
+        }
+        catch (...) {
+            completion_errors_.fetch_add(1, memory_order_relaxed);
+        }
+    }
+    else if (error) {
+        task.promise->set_exception(error);
+    }
+    else {
+        task.promise->set_value(move(documents));
+    }
+}
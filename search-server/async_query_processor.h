@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "search_server.h"
+#include "document_filter.h"
+#include "request_statistics.h"
+
+struct AsyncQueryOptions {
+    size_t worker_count = 0;        // 0 - по кол-ву аппаратных потоков
+    size_t queue_capacity = 1024;   // запросов в очереди, при заполнении SubmitQuery ждёт, TrySubmitQuery отказывает
+    size_t max_batch_size = 16;     // запросов, забираемых рабочим потоком из очереди за раз
+    RequestStatistics* statistics = nullptr; // время от постановки в очередь до результата и кол-во документов
+};
+
+// Асинхронная обработка запросов к SearchServer: запрос ставится в ограниченную очередь,
+// результат возвращается через future или передаётся в функцию завершения.
+// Рабочий поток забирает из очереди пачку запросов под одной блокировкой, одинаковые запросы
+// пачки (текст и фильтр) выполняются один раз. У каждого рабочего потока свой QueryContext.
+// Сервер не должен изменяться, пока существует обработчик. Деструктор дожидается обработки очереди
+class AsyncQueryProcessor {
+public:
+    // Результат запроса или исключение разбора запроса (тогда documents пуст)
+    using Completion = std::function<void(std::vector<Document> documents, std::exception_ptr error)>;
+
+    explicit AsyncQueryProcessor(const SearchServer& search_server, const AsyncQueryOptions& options = AsyncQueryOptions());
+    ~AsyncQueryProcessor();
+
+    AsyncQueryProcessor(const AsyncQueryProcessor&) = delete;
+    AsyncQueryProcessor& operator=(const AsyncQueryProcessor&) = delete;
+
+    // Запрос без фильтра ищет документы со статусом ACTUAL, как FindTopDocuments(raw_query).
+    // Если очередь заполнена, ждёт освобождения места
+    std::future<std::vector<Document>> SubmitQuery(std::string raw_query);
+    std::future<std::vector<Document>> SubmitQuery(std::string raw_query, DocumentFilter filter);
+    // Функция завершения вызывается в рабочем потоке. Её исключение перехватывается и учитывается
+    // в Stats::completion_errors, остальные запросы пачки завершаются как обычно.
+    // Пустая функция завершения - исключение invalid_argument, запрос не ставится
+    void SubmitQuery(std::string raw_query, std::optional<DocumentFilter> filter, Completion completion);
+
+    // Не ждут: при заполненной очереди возвращают nullopt (false) и запрос не ставится
+    std::optional<std::future<std::vector<Document>>> TrySubmitQuery(std::string raw_query,
+        std::optional<DocumentFilter> filter = std::nullopt);
+    bool TrySubmitQuery(std::string raw_query, std::optional<DocumentFilter> filter, Completion completion);
+
+    size_t GetQueueSize() const;
+
+    struct Stats {
+        uint64_t submitted = 0;
+        uint64_t rejected = 0;   // отказы TrySubmitQuery
+        uint64_t completed = 0;
+        uint64_t batches = 0;
+        uint64_t deduplicated = 0; // запросы, результат которых взят у одинакового запроса пачки
+        uint64_t completion_errors = 0; // исключения функций завершения
+    };
+    Stats GetStats() const;
+
+private:
+    struct Task {
+        std::string raw_query;
+        std::optional<DocumentFilter> filter;
+        std::optional<std::promise<std::vector<Document>>> promise;
+        Completion completion;
+        RequestStatistics::Clock::time_point submit_time;
+    };
+
+    const SearchServer& search_server_;
+    AsyncQueryOptions options_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::deque<Task> queue_;
+    bool stopping_ = false;
+    std::vector<std::thread> workers_;
+
+    std::atomic<uint64_t> submitted_{ 0 };
+    std::atomic<uint64_t> rejected_{ 0 };
+    std::atomic<uint64_t> completed_{ 0 };
+    std::atomic<uint64_t> batches_{ 0 };
+    std::atomic<uint64_t> deduplicated_{ 0 };
+    std::atomic<uint64_t> completion_errors_{ 0 };
+
+    static void CheckCompletion(const Completion& completion);
+    // Ставит задачу в очередь, при wait = false не ждёт места в очереди
+    bool Enqueue(Task& task, bool wait);
+    void RunWorker();
+    void ProcessBatch(std::vector<Task>& batch, SearchServer::QueryContext& context);
+    void Complete(Task& task, std::vector<Document> documents, std::exception_ptr error);
+};
@@ -0,0 +1,471 @@
+// Воспроизводимый бенчмарк поискового сервера: добавление, удаление, поиск, матчинг,
+// ProcessQueries и RemoveDuplicates для последовательной и параллельной политик.
+// Данные генерируются из фиксированного seed, каждый замер повторяется после прогрева,
+// для каждой операции выводятся пропускная способность и перцентили задержки.
+// Результат - JSON (в stdout или в файл --output), пригодный для сравнения запусков.
+//
+// Сборка из каталога search-server:
+//
+//  g++ -std=c++17 -O2 benchmark/benchmark.cpp $(ls *.cpp | grep -v '^main.cpp$') -o search_benchmark -ltbb -lpthread
+//
+// Пример запуска:
+//
+//  ./search_benchmark --seed 42 --repetitions 5 --output before.json
+//
+// С --corpus zipf документы и запросы берутся из генератора с распределением слов по Ципфу,
+// логнормальной длиной документов, стоп-словами и повторяющимися запросами - ближе к реальной нагрузке.
+// С --perf on для каждой операции выводятся средние аппаратные счётчики (perf_counters.h);
+// недоступные счётчики (не Linux, контейнер) выводятся как null.
+// Выделения памяти на операцию (allocation_counter.h, замена operator new из allocation_hooks.h)
+// выводятся всегда; для параллельной политики учитываются только выделения вызывающего потока
+
+#include "../search_server.h"
+#include "../process_queries.h"
+#include "../remove_duplicates.h"
+#include "../latency_histogram.h"
+#include "../test_data_generator.h"
+#include "../corpus_generator.h"
+#include "../perf_counters.h"
+#include "../allocation_hooks.h"
+
+#include <chrono>
+#include <cstdint>
+#include <execution>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    struct BenchmarkConfig {
+        uint32_t seed = 42;
+        int warmup = 1;
+        int repetitions = 5;
+        int dictionary_size = 1'000;
+        int max_word_length = 10;
+        int document_count = 10'000;
+        int document_word_count = 70;
+        int query_count = 100;
+        int query_word_count = 70;
+        int remove_count = 1'000;        // удаляемых документов за повторение
+        int match_document_count = 1'000; // документов для матчинга за повторение
+        int match_query_word_count = 500;
+        string corpus = "uniform"s;       // uniform - равновероятные слова, zipf - CorpusGenerator
+        bool perf = false;                // замер аппаратных счётчиков
+        string output;
+    };
+
+    // Данные бенчмарка, одинаковые для одинакового seed
+    struct Dataset {
+        string stop_words;
+        vector<string> documents;
+        vector<string> queries;
+        string match_query;
+    };
+
+    Dataset GenerateUniformDataset(const BenchmarkConfig& config) {
+        mt19937 generator(config.seed);
+        Dataset dataset;
+        const vector<string> dictionary = GenerateDictionary(generator, config.dictionary_size, config.max_word_length);
+        dataset.stop_words = dictionary[0];
+        dataset.documents = GenerateQueries(generator, dictionary, config.document_count, config.document_word_count);
+        dataset.queries = GenerateQueries(generator, dictionary, config.query_count, config.query_word_count);
+        dataset.match_query = GenerateQuery(generator, dictionary, config.match_query_word_count, 0.1);
+        return dataset;
+    }
+
+    Dataset GenerateZipfDataset(const BenchmarkConfig& config) {
+        CorpusConfig corpus_config;
+        corpus_config.seed = config.seed;
+        CorpusGenerator corpus(corpus_config);
+        QueryLogConfig query_log_config;
+        query_log_config.seed = config.seed + 1;
+        QueryLogGenerator query_log(corpus, query_log_config);
+
+        Dataset dataset;
+        dataset.stop_words = corpus.GetStopWords();
+        dataset.documents.resize(config.document_count);
+        for (string& document : dataset.documents) {
+            corpus.NextDocument(document);
+        }
+        dataset.queries.resize(config.query_count);
+        for (string& query : dataset.queries) {
+            query_log.NextQuery(query);
+        }
+        dataset.match_query = corpus.NextDocument();
+        return dataset;
+    }
+
+    Dataset GenerateDataset(const BenchmarkConfig& config) {
+        return config.corpus == "zipf"sv ? GenerateZipfDataset(config) : GenerateUniformDataset(config);
+    }
+
+    SearchServer BuildServer(const Dataset& dataset) {
+        SearchServer search_server(dataset.stop_words);
+        for (size_t i = 0; i < dataset.documents.size(); ++i) {
+            search_server.AddDocument(static_cast<int>(i), dataset.documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+        }
+        return search_server;
+    }
+
+    // Замер отдельных операций одного повторения
+    class Recorder {
+    public:
+        using Clock = chrono::steady_clock;
+
+        explicit Recorder(bool perf)
+            : perf_(perf) {
+        }
+
+        // Счётчики читаются вне замера времени, чтобы их чтение не попадало в задержку
+        template <typename Operation>
+        auto Measure(Operation operation) {
+            const PerfSample perf_start = ReadCounters();
+            const AllocationCounter allocation_counter;
+            const auto start = Clock::now();
+            if constexpr (is_void_v<decltype(operation())>) {
+                operation();
+                Add(Clock::now() - start, allocation_counter, perf_start);
+            }
+            else {
+                auto result = operation();
+                Add(Clock::now() - start, allocation_counter, perf_start);
+                return result;
+            }
+        }
+
+        uint64_t GetOperationCount() const {
+            return latencies_.GetCount();
+        }
+
+        chrono::nanoseconds GetTotalTime() const {
+            return total_time_;
+        }
+
+        const LatencyHistogram& GetLatencies() const {
+            return latencies_;
+        }
+
+        const PerfSample& GetCounters() const {
+            return counters_;
+        }
+
+        uint64_t GetAllocationCount() const {
+            return allocation_count_;
+        }
+
+        uint64_t GetAllocatedBytes() const {
+            return allocated_bytes_;
+        }
+
+    private:
+        bool perf_;
+        LatencyHistogram latencies_;
+        chrono::nanoseconds total_time_{ 0 };
+        PerfSample counters_;
+        bool has_counters_ = false;
+        uint64_t allocation_count_ = 0;
+        uint64_t allocated_bytes_ = 0;
+
+        PerfSample ReadCounters() const {
+            return perf_ ? PerfCounters::ForCurrentThread().Read() : PerfSample();
+        }
+
+        void Add(chrono::nanoseconds latency, const AllocationCounter& allocation_counter, const PerfSample& perf_start) {
+            allocation_count_ += allocation_counter.GetAllocationCount();
+            allocated_bytes_ += allocation_counter.GetAllocatedBytes();
+            if (perf_) {
+                const PerfSample delta = ReadCounters() - perf_start;
+                if (has_counters_) {
+                    counters_ += delta;
+                }
+                else {
+                    counters_ = delta;
+                    has_counters_ = true;
+                }
+            }
+            latencies_.Record(latency);
+            total_time_ += latency;
+        }
+    };
+
+    struct BenchmarkResult {
+        string name;
+        string policy;
+        int repetitions = 0;
+        uint64_t operations = 0;
+        chrono::nanoseconds total_time{ 0 };
+        LatencyHistogram latencies;
+        PerfSample counters; // сумма по всем операциям, счётчики потока, выполнявшего замер
+        uint64_t allocation_count = 0;
+        uint64_t allocated_bytes = 0;
+        double checksum = 0.0; // одинаков для одинаковых данных, защищает от удаления работы оптимизатором
+    };
+
+    // run_repetition(recorder) выполняет одно повторение: подготовка вне Measure не учитывается в замере.
+    // Возвращает контрольную сумму повторения
+    template <typename Repetition>
+    BenchmarkResult RunBenchmark(string name, string policy, const BenchmarkConfig& config, Repetition run_repetition) {
+        for (int i = 0; i < config.warmup; ++i) {
+            Recorder recorder(config.perf);
+            run_repetition(recorder);
+        }
+
+        BenchmarkResult result;
+        result.name = move(name);
+        result.policy = move(policy);
+        result.repetitions = config.repetitions;
+        for (int i = 0; i < config.repetitions; ++i) {
+            Recorder recorder(config.perf);
+            result.checksum = run_repetition(recorder);
+            result.operations += recorder.GetOperationCount();
+            result.total_time += recorder.GetTotalTime();
+            result.latencies.Merge(recorder.GetLatencies());
+            result.allocation_count += recorder.GetAllocationCount();
+            result.allocated_bytes += recorder.GetAllocatedBytes();
+            if (i == 0) {
+                result.counters = recorder.GetCounters();
+            }
+            else {
+                result.counters += recorder.GetCounters();
+            }
+        }
+        cerr << result.name << " ("s << result.policy << "): "s << result.operations << " ops, p50 "s
+            << result.latencies.GetPercentile(50).count() << " ns, p99 "s << result.latencies.GetPercentile(99).count() << " ns, "s
+            << (result.operations > 0 ? result.allocation_count / result.operations : 0) << " allocs/op"s << endl;
+        return result;
+    }
+
+    template <typename ExecutionPolicy>
+    BenchmarkResult BenchmarkRemoveDocument(string policy_name, ExecutionPolicy policy, const BenchmarkConfig& config, const Dataset& dataset) {
+        return RunBenchmark("remove_document"s, move(policy_name), config, [&](Recorder& recorder) {
+            SearchServer search_server = BuildServer(dataset);
+            for (int id = 0; id < config.remove_count && id < config.document_count; ++id) {
+                recorder.Measure([&]() {
+                    search_server.RemoveDocument(policy, id);
+                });
+            }
+            return static_cast<double>(search_server.GetDocumentCount());
+        });
+    }
+
+    template <typename ExecutionPolicy>
+    BenchmarkResult BenchmarkFindTopDocuments(string policy_name, ExecutionPolicy policy, const BenchmarkConfig& config,
+        const Dataset& dataset, const SearchServer& search_server) {
+        return RunBenchmark("find_top_documents"s, move(policy_name), config, [&](Recorder& recorder) {
+            double total_relevance = 0.0;
+            for (const string& query : dataset.queries) {
+                for (const Document& document : recorder.Measure([&]() { return search_server.FindTopDocuments(policy, query); })) {
+                    total_relevance += document.relevance;
+                }
+            }
+            return total_relevance;
+        });
+    }
+
+    template <typename ExecutionPolicy>
+    BenchmarkResult BenchmarkMatchDocument(string policy_name, ExecutionPolicy policy, const BenchmarkConfig& config,
+        const Dataset& dataset, const SearchServer& search_server) {
+        return RunBenchmark("match_document"s, move(policy_name), config, [&](Recorder& recorder) {
+            size_t word_count = 0;
+            for (int id = 0; id < config.match_document_count && id < config.document_count; ++id) {
+                const auto [words, status] = recorder.Measure([&]() { return search_server.MatchDocument(policy, dataset.match_query, id); });
+                word_count += words.size();
+            }
+            return static_cast<double>(word_count);
+        });
+    }
+
+    vector<BenchmarkResult> RunBenchmarks(const BenchmarkConfig& config) {
+        const Dataset dataset = GenerateDataset(config);
+        vector<BenchmarkResult> results;
+
+        results.push_back(RunBenchmark("add_document"s, "seq"s, config, [&](Recorder& recorder) {
+            SearchServer search_server(dataset.stop_words);
+            for (size_t i = 0; i < dataset.documents.size(); ++i) {
+                recorder.Measure([&]() {
+                    search_server.AddDocument(static_cast<int>(i), dataset.documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+                });
+            }
+            return static_cast<double>(search_server.GetDocumentCount());
+        }));
+
+        results.push_back(BenchmarkRemoveDocument("seq"s, execution::seq, config, dataset));
+        results.push_back(BenchmarkRemoveDocument("par"s, execution::par, config, dataset));
+
+        const SearchServer search_server = BuildServer(dataset);
+        results.push_back(BenchmarkFindTopDocuments("seq"s, execution::seq, config, dataset, search_server));
+        results.push_back(BenchmarkFindTopDocuments("par"s, execution::par, config, dataset, search_server));
+        results.push_back(BenchmarkMatchDocument("seq"s, execution::seq, config, dataset, search_server));
+        results.push_back(BenchmarkMatchDocument("par"s, execution::par, config, dataset, search_server));
+
+        // Одна операция - обработка всего набора запросов
+        results.push_back(RunBenchmark("process_queries"s, "par"s, config, [&](Recorder& recorder) {
+            double total_relevance = 0.0;
+            for (const auto& documents : recorder.Measure([&]() { return ProcessQueries(search_server, dataset.queries); })) {
+                for (const Document& document : documents) {
+                    total_relevance += document.relevance;
+                }
+            }
+            return total_relevance;
+        }));
+
+        // Каждый десятый документ добавляется ещё раз под новым id.
+        // RemoveDuplicates сообщает об удалённых документах в cout, этот вывод подавляется
+        results.push_back(RunBenchmark("remove_duplicates"s, "seq"s, config, [&](Recorder& recorder) {
+            SearchServer duplicates_server = BuildServer(dataset);
+            for (int id = 0; id < config.document_count; id += 10) {
+                duplicates_server.AddDocument(config.document_count + id, dataset.documents[id], DocumentStatus::ACTUAL, { 1 });
+            }
+            ostringstream discarded;
+            streambuf* const cout_buffer = cout.rdbuf(discarded.rdbuf());
+            recorder.Measure([&]() {
+                RemoveDuplicates(duplicates_server);
+            });
+            cout.rdbuf(cout_buffer);
+            return static_cast<double>(duplicates_server.GetDocumentCount());
+        }));
+
+        return results;
+    }
+
+    // Средние значения счётчиков на операцию, null - счётчик недоступен
+    void PrintCounters(ostream& out, const PerfSample& counters, uint64_t operations) {
+        out << '{';
+        for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+            const PerfEvent event = static_cast<PerfEvent>(i);
+            out << (i > 0 ? ", "s : ""s) << '"' << GetPerfEventName(event) << "\": "s;
+            if (counters.IsAvailable(event) && operations > 0) {
+                out << counters.Get(event) / operations;
+            }
+            else {
+                out << "null"s;
+            }
+        }
+        out << '}';
+    }
+
+    void PrintJson(ostream& out, const BenchmarkConfig& config, const vector<BenchmarkResult>& results) {
+        out << "{\n"s;
+        out << "  \"config\": {\"seed\": "s << config.seed
+            << ", \"warmup\": "s << config.warmup
+            << ", \"repetitions\": "s << config.repetitions
+            << ", \"corpus\": \""s << config.corpus << '"'
+            << ", \"perf\": "s << (config.perf ? "true"s : "false"s)
+            << ", \"dictionary_size\": "s << config.dictionary_size
+            << ", \"document_count\": "s << config.document_count
+            << ", \"document_word_count\": "s << config.document_word_count
+            << ", \"query_count\": "s << config.query_count
+            << ", \"query_word_count\": "s << config.query_word_count << "},\n"s;
+        out << "  \"results\": [\n"s;
+        for (size_t i = 0; i < results.size(); ++i) {
+            const BenchmarkResult& result = results[i];
+            const double seconds = chrono::duration<double>(result.total_time).count();
+            out << "    {\"name\": \""s << result.name << "\", \"policy\": \""s << result.policy << '"'
+                << ", \"repetitions\": "s << result.repetitions
+                << ", \"operations\": "s << result.operations
+                << ", \"total_seconds\": "s << fixed << setprecision(6) << seconds
+                << ", \"throughput_ops_per_second\": "s << setprecision(2) << (seconds > 0 ? result.operations / seconds : 0.0)
+                << ", \"latency_ns\": {\"p50\": "s << result.latencies.GetPercentile(50).count()
+                << ", \"p90\": "s << result.latencies.GetPercentile(90).count()
+                << ", \"p99\": "s << result.latencies.GetPercentile(99).count()
+                << ", \"p999\": "s << result.latencies.GetPercentile(99.9).count()
+                << ", \"max\": "s << result.latencies.GetMax().count() << '}'
+                << ", \"checksum\": "s << setprecision(6) << result.checksum;
+            out.unsetf(ios_base::floatfield);
+            out << ", \"allocations_per_op\": {\"count\": "s << (result.operations > 0 ? result.allocation_count / result.operations : 0)
+                << ", \"bytes\": "s << (result.operations > 0 ? result.allocated_bytes / result.operations : 0) << '}';
+            if (config.perf) {
+                out << ", \"counters_per_op\": "s;
+                PrintCounters(out, result.counters, result.operations);
+            }
+            out << '}' << (i + 1 < results.size() ? ",\n"s : "\n"s);
+        }
+        out << "  ]\n}\n"s;
+    }
+
+    void PrintUsage() {
+        cerr << "Usage: search_benchmark [--seed N] [--warmup N] [--repetitions N] [--documents N] [--queries N] [--corpus uniform|zipf] [--perf on|off] [--output FILE]"s << endl;
+    }
+
+    BenchmarkConfig ParseArguments(int argc, char* argv[]) {
+        BenchmarkConfig config;
+        for (int i = 1; i < argc; ++i) {
+            const string_view argument = argv[i];
+            if (i + 1 >= argc) {
+                throw invalid_argument("missing value for "s + string(argument));
+            }
+            const string value = argv[++i];
+            if (argument == "--seed"sv) {
+                config.seed = static_cast<uint32_t>(stoul(value));
+            }
+            else if (argument == "--warmup"sv) {
+                config.warmup = stoi(value);
+            }
+            else if (argument == "--repetitions"sv) {
+                config.repetitions = stoi(value);
+            }
+            else if (argument == "--documents"sv) {
+                config.document_count = stoi(value);
+            }
+            else if (argument == "--queries"sv) {
+                config.query_count = stoi(value);
+            }
+            else if (argument == "--corpus"sv) {
+                if (value != "uniform"sv && value != "zipf"sv) {
+                    throw invalid_argument("unknown corpus "s + value);
+                }
+                config.corpus = value;
+            }
+            else if (argument == "--perf"sv) {
+                if (value != "on"sv && value != "off"sv) {
+                    throw invalid_argument("--perf expects on or off"s);
+                }
+                config.perf = value == "on"sv;
+            }
+            else if (argument == "--output"sv) {
+                config.output = value;
+            }
+            else {
+                throw invalid_argument("unknown argument "s + string(argument));
+            }
+        }
+        if (config.warmup < 0 || config.repetitions <= 0 || config.document_count <= 0 || config.query_count <= 0) {
+            throw invalid_argument("counts must be positive"s);
+        }
+        return config;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    BenchmarkConfig config;
+    try {
+        config = ParseArguments(argc, argv);
+    }
+    catch (const exception& e) {
+        cerr << e.what() << endl;
+        PrintUsage();
+        return 1;
+    }
+
+    if (config.perf && !PerfCounters::ForCurrentThread().Read().IsAnyAvailable()) {
+        cerr << "Hardware counters are unavailable, counters will be reported as null"s << endl;
+    }
+    const vector<BenchmarkResult> results = RunBenchmarks(config);
+
+    if (config.output.empty()) {
+        PrintJson(cout, config, results);
+    }
+    else {
+        ofstream out(config.output);
+        PrintJson(out, config, results);
+    }
+    return 0;
+}
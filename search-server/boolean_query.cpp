@@ -0,0 +1,207 @@
+#include "boolean_query.h"
+
+#include <stdexcept>
+
+#include "string_processing.h"
+
+using namespace std;
+
+namespace {
+    struct Token {
+        enum class Kind {
+            WORD,
+            AND,
+            OR,
+            NOT,
+            MINUS,
+            LEFT_PARENTHESIS,
+            RIGHT_PARENTHESIS,
+        };
+
+        Kind kind;
+        string_view text;
+    };
+
+    // Скобки и минус могут быть приклеены к словам: "-(cat", "(dog", "mouse))".
+    // Фразы в логическом запросе не поддерживаются: слово с кавычкой искалось бы буквально
+    vector<Token> SplitIntoTokens(string_view text) {
+        vector<Token> tokens;
+        for (string_view chunk : WordTokenizer(text)) {
+            if (chunk.find('"') != string_view::npos) {
+                throw invalid_argument("phrases are not supported in boolean queries");
+            }
+            while (!chunk.empty()) {
+                if (chunk[0] == '(') {
+                    tokens.push_back({ Token::Kind::LEFT_PARENTHESIS, chunk.substr(0, 1) });
+                    chunk.remove_prefix(1);
+                }
+                else if (chunk.size() > 1 && chunk[0] == '-' && chunk[1] == '(') {
+                    tokens.push_back({ Token::Kind::MINUS, chunk.substr(0, 1) });
+                    chunk.remove_prefix(1);
+                }
+                else {
+                    break;
+                }
+            }
+
+            size_t closing_count = 0;
+            while (!chunk.empty() && chunk.back() == ')') {
+                chunk.remove_suffix(1);
+                ++closing_count;
+            }
+
+            if (chunk == "AND") {
+                tokens.push_back({ Token::Kind::AND, chunk });
+            }
+            else if (chunk == "OR") {
+                tokens.push_back({ Token::Kind::OR, chunk });
+            }
+            else if (chunk == "NOT") {
+                tokens.push_back({ Token::Kind::NOT, chunk });
+            }
+            else if (!chunk.empty() && chunk[0] == '-') {
+                if (chunk.size() == 1) throw invalid_argument("lonely minus");
+                if (chunk[1] == '-') throw invalid_argument("too many minuses");
+                tokens.push_back({ Token::Kind::MINUS, chunk.substr(0, 1) });
+                tokens.push_back({ Token::Kind::WORD, chunk.substr(1) });
+            }
+            else if (!chunk.empty()) {
+                tokens.push_back({ Token::Kind::WORD, chunk });
+            }
+
+            for (size_t i = 0; i < closing_count; ++i) {
+                tokens.push_back({ Token::Kind::RIGHT_PARENTHESIS, ")"sv });
+            }
+        }
+        return tokens;
+    }
+
+    // Разбор методом рекурсивного спуска
+    class BooleanQueryParser {
+    public:
+        explicit BooleanQueryParser(vector<Token> tokens)
+            : tokens_(move(tokens)) {
+        }
+
+        QueryNode Parse() {
+            QueryNode root = ParseGroup();
+            if (position_ != tokens_.size()) {
+                throw invalid_argument("unbalanced parentheses");
+            }
+            return root;
+        }
+
+    private:
+        vector<Token> tokens_;
+        size_t position_ = 0;
+
+        bool Accept(Token::Kind kind) {
+            if (position_ < tokens_.size() && tokens_[position_].kind == kind) {
+                ++position_;
+                return true;
+            }
+            return false;
+        }
+
+        QueryNode ParseGroup() {
+            QueryNode positive{ QueryNode::Type::OR, {}, {} };
+            vector<QueryNode> negative;
+            while (position_ < tokens_.size() && tokens_[position_].kind != Token::Kind::RIGHT_PARENTHESIS) {
+                QueryNode clause = ParseClause();
+                if (clause.type == QueryNode::Type::NOT) {
+                    negative.push_back(move(clause));
+                }
+                else {
+                    positive.children.push_back(move(clause));
+                }
+            }
+
+            if (positive.children.empty() && !negative.empty()) {
+                if (negative.size() == 1) {
+                    return move(negative.front());
+                }
+                // Группа из одних минус-частей: -a -b означает NOT (a OR b).
+                // На верхнем уровне она ничего не находит, как и обычный запрос из одних минус слов
+                QueryNode excluded{ QueryNode::Type::OR, {}, {} };
+                for (QueryNode& node : negative) {
+                    excluded.children.push_back(move(node.children.front()));
+                }
+                QueryNode result{ QueryNode::Type::NOT, {}, {} };
+                result.children.push_back(move(excluded));
+                return result;
+            }
+            if (positive.children.size() == 1) {
+                positive = QueryNode(move(positive.children.front()));
+            }
+            if (negative.empty()) {
+                return positive;
+            }
+
+            QueryNode result{ QueryNode::Type::AND, {}, {} };
+            result.children.push_back(move(positive));
+            for (QueryNode& node : negative) {
+                result.children.push_back(move(node));
+            }
+            return result;
+        }
+
+        QueryNode ParseClause() {
+            QueryNode node = ParseAnd();
+            if (position_ == tokens_.size() || tokens_[position_].kind != Token::Kind::OR) {
+                return node;
+            }
+            QueryNode result{ QueryNode::Type::OR, {}, {} };
+            result.children.push_back(move(node));
+            while (Accept(Token::Kind::OR)) {
+                result.children.push_back(ParseAnd());
+            }
+            return result;
+        }
+
+        QueryNode ParseAnd() {
+            QueryNode node = ParseUnary();
+            if (position_ == tokens_.size() || tokens_[position_].kind != Token::Kind::AND) {
+                return node;
+            }
+            QueryNode result{ QueryNode::Type::AND, {}, {} };
+            result.children.push_back(move(node));
+            while (Accept(Token::Kind::AND)) {
+                result.children.push_back(ParseUnary());
+            }
+            return result;
+        }
+
+        QueryNode ParseUnary() {
+            if (position_ == tokens_.size()) {
+                throw invalid_argument("operand expected");
+            }
+            const Token& token = tokens_[position_++];
+            switch (token.kind) {
+            case Token::Kind::NOT:
+            case Token::Kind::MINUS: {
+                QueryNode result{ QueryNode::Type::NOT, {}, {} };
+                result.children.push_back(ParseUnary());
+                return result;
+            }
+            case Token::Kind::LEFT_PARENTHESIS: {
+                if (position_ < tokens_.size() && tokens_[position_].kind == Token::Kind::RIGHT_PARENTHESIS) {
+                    throw invalid_argument("operand expected");
+                }
+                QueryNode result = ParseGroup();
+                if (!Accept(Token::Kind::RIGHT_PARENTHESIS)) {
+                    throw invalid_argument("unbalanced parentheses");
+                }
+                return result;
+            }
+            case Token::Kind::WORD:
+                return { QueryNode::Type::TERM, token.text, {} };
+            default:
+                throw invalid_argument("operand expected");
+            }
+        }
+    };
+}
+
+QueryNode ParseBooleanQuery(string_view text) {
+    return BooleanQueryParser(SplitIntoTokens(text)).Parse();
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+// Узел дерева логического запроса
+struct QueryNode {
+    enum class Type {
+        TERM, // слово
+        AND,  // документ содержит все дочерние узлы
+        OR,   // документ содержит хотя бы один дочерний узел
+        NOT,  // документ не содержит дочерний узел (имеет смысл только внутри AND)
+    };
+
+    Type type = Type::OR;
+    std::string_view word; // только для TERM
+    std::vector<QueryNode> children;
+};
+
+// Разбор логического запроса в дерево.
+// Грамматика (операторы пишутся заглавными буквами):
+//   group   := clause { clause }          - перечисление: плюс-части объединяются по OR,
+//                                           минус-части исключаются из результата
+//   clause  := and_expr { OR and_expr }
+//   and_expr:= unary { AND unary }
+//   unary   := NOT unary | -unary | word | ( group )
+// Обычный запрос "cat dog -mouse" является частным случаем: (cat OR dog) AND NOT mouse.
+// Фразы в кавычках не поддерживаются. Ошибки синтаксиса приводят к исключению invalid_argument
+QueryNode ParseBooleanQuery(std::string_view text);
@@ -40,6 +40,13 @@ public:
         return { key, bucket };
     }
 
+    // Удаляет ключ, не создавая его. Возвращает кол-во удалённых элементов
+    size_t Erase(const Key& key) {
+        auto& bucket = buckets_[static_cast<uint64_t>(key) % buckets_.size()];
+        std::lock_guard guard(bucket.mutex);
+        return bucket.map.erase(key);
+    }
+
     std::map<Key, Value> BuildOrdinaryMap() {
         std::map<Key, Value> result;
         for (auto& [mutex, map] : buckets_) {
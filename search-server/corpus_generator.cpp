@@ -0,0 +1,160 @@
+#include "corpus_generator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+//---------------------------- Распределение Ципфа ----------------------------
+
+namespace {
+    // log(1 + x) / x с устойчивым вычислением около нуля
+    double Helper1(double x) {
+        if (abs(x) > 1e-8) {
+            return log1p(x) / x;
+        }
+        return 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+    }
+
+    // (exp(x) - 1) / x с устойчивым вычислением около нуля
+    double Helper2(double x) {
+        if (abs(x) > 1e-8) {
+            return expm1(x) / x;
+        }
+        return 1.0 + x * 0.5 * (1.0 + x * (1.0 / 3.0) * (1.0 + 0.25 * x));
+    }
+}
+
+ZipfDistribution::ZipfDistribution(uint64_t n, double exponent)
+    : n_(n)
+    , exponent_(exponent) {
+    if (n == 0 || exponent <= 0.0) {
+        throw invalid_argument("zipf distribution requires positive size and exponent");
+    }
+    h_integral_x1_ = HIntegral(1.5) - 1.0;
+    h_integral_n_ = HIntegral(static_cast<double>(n) + 0.5);
+    s_ = 2.0 - HIntegralInverse(HIntegral(2.5) - H(2.0));
+}
+
+double ZipfDistribution::H(double x) const {
+    return exp(-exponent_ * log(x));
+}
+
+double ZipfDistribution::HIntegral(double x) const {
+    const double log_x = log(x);
+    return Helper2((1.0 - exponent_) * log_x) * log_x;
+}
+
+double ZipfDistribution::HIntegralInverse(double x) const {
+    double t = x * (1.0 - exponent_);
+    if (t < -1.0) {
+        t = -1.0;
+    }
+    return exp(Helper1(t) * x);
+}
+
+//---------------------------- Корпус ----------------------------
+
+CorpusGenerator::CorpusGenerator(const CorpusConfig& config)
+    : config_(config)
+    , generator_(config.seed)
+    , content_words_(config.vocabulary_size - min<uint64_t>(config.stop_word_count, config.vocabulary_size - 1), config.zipf_exponent)
+    , stop_words_(max(config.stop_word_count, 1), config.zipf_exponent)
+    , document_length_(config.document_length_mu, config.document_length_sigma) {
+    if (config.stop_word_count < 0 || config.stop_word_ratio < 0.0 || config.stop_word_ratio > 1.0) {
+        throw invalid_argument("invalid stop word configuration");
+    }
+    if (config.min_document_length <= 0 || config.min_document_length > config.max_document_length) {
+        throw invalid_argument("invalid document length range");
+    }
+}
+
+string CorpusGenerator::GetStopWords() const {
+    string stop_words;
+    for (int rank = 1; rank <= config_.stop_word_count; ++rank) {
+        if (!stop_words.empty()) {
+            stop_words.push_back(' ');
+        }
+        AppendWord(rank, stop_words);
+    }
+    return stop_words;
+}
+
+void CorpusGenerator::NextDocument(string& text) {
+    const double length = clamp(document_length_(generator_),
+        static_cast<double>(config_.min_document_length), static_cast<double>(config_.max_document_length));
+    const int word_count = static_cast<int>(length);
+
+    text.clear();
+    for (int i = 0; i < word_count; ++i) {
+        if (i > 0) {
+            text.push_back(' ');
+        }
+        AppendNextWord(generator_, config_.stop_word_ratio, text);
+    }
+}
+
+string CorpusGenerator::NextDocument() {
+    string text;
+    NextDocument(text);
+    return text;
+}
+
+void CorpusGenerator::AppendWord(uint64_t rank, string& text) {
+    // Биективная запись ранга в 26-ричной системе: a, b, ..., z, aa, ab, ...
+    char letters[16];
+    int length = 0;
+    for (uint64_t value = rank; value > 0; value = (value - 1) / 26) {
+        letters[length++] = static_cast<char>('a' + (value - 1) % 26);
+    }
+    text.append(make_reverse_iterator(letters + length), make_reverse_iterator(letters));
+}
+
+void CorpusGenerator::AppendNextWord(mt19937_64& generator, double stop_word_ratio, string& text) const {
+    if (config_.stop_word_count > 0 && uniform_real_distribution<double>(0.0, 1.0)(generator) < stop_word_ratio) {
+        AppendWord(stop_words_(generator), text);
+    }
+    else {
+        // Обычные слова идут в словаре после стоп-слов
+        AppendWord(config_.stop_word_count + content_words_(generator), text);
+    }
+}
+
+//---------------------------- Журнал запросов ----------------------------
+
+QueryLogGenerator::QueryLogGenerator(const CorpusGenerator& corpus, const QueryLogConfig& config)
+    : corpus_(corpus)
+    , config_(config)
+    , generator_(config.seed)
+    , popularity_(config.distinct_query_count, config.query_popularity_exponent) {
+    if (config.max_query_word_count <= 0 || config.query_length_p <= 0.0 || config.query_length_p > 1.0) {
+        throw invalid_argument("invalid query length configuration");
+    }
+}
+
+void QueryLogGenerator::NextQuery(string& text) {
+    GetQuery(popularity_(generator_), text);
+}
+
+string QueryLogGenerator::NextQuery() {
+    string text;
+    NextQuery(text);
+    return text;
+}
+
+void QueryLogGenerator::GetQuery(uint64_t query_id, string& text) const {
+    // Генератор запроса определяется только seed журнала и номером запроса
+    mt19937_64 generator(config_.seed ^ (query_id * 0x9E3779B97F4A7C15ull));
+    const int word_count = min(config_.max_query_word_count, 1 + geometric_distribution<int>(config_.query_length_p)(generator));
+
+    text.clear();
+    for (int i = 0; i < word_count; ++i) {
+        if (i > 0) {
+            text.push_back(' ');
+        }
+        if (uniform_real_distribution<double>(0.0, 1.0)(generator) < config_.minus_word_prob) {
+            text.push_back('-');
+        }
+        corpus_.AppendNextWord(generator, config_.stop_word_ratio, text);
+    }
+}
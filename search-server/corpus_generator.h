@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "document.h"
+
+// Распределение Ципфа на рангах [1, n]: P(k) ~ 1 / k^exponent.
+// Выборка методом rejection-inversion (Hormann, Derflinger): O(1) на значение без таблиц,
+// поэтому подходит для словарей из миллионов слов
+class ZipfDistribution {
+public:
+    ZipfDistribution(uint64_t n, double exponent);
+
+    template <typename Generator>
+    uint64_t operator()(Generator& generator) const {
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        while (true) {
+            const double u = h_integral_n_ + uniform(generator) * (h_integral_x1_ - h_integral_n_);
+            const double x = HIntegralInverse(u);
+            double k = std::floor(x + 0.5);
+            if (k < 1.0) {
+                k = 1.0;
+            }
+            else if (k > static_cast<double>(n_)) {
+                k = static_cast<double>(n_);
+            }
+            if (k - x <= s_ || u >= HIntegral(k + 0.5) - H(k)) {
+                return static_cast<uint64_t>(k);
+            }
+        }
+    }
+
+    uint64_t GetSize() const {
+        return n_;
+    }
+
+private:
+    uint64_t n_;
+    double exponent_;
+    double h_integral_x1_;
+    double h_integral_n_;
+    double s_;
+
+    double H(double x) const;
+    double HIntegral(double x) const;
+    double HIntegralInverse(double x) const;
+};
+
+// Параметры синтетического корпуса
+struct CorpusConfig {
+    uint32_t seed = 42;
+    uint64_t vocabulary_size = 100'000;
+    double zipf_exponent = 1.0;          // у текстов на естественном языке около 1
+    // Длина документа в словах - логнормальное распределение (медиана exp(mu)), ограниченное [min, max]
+    double document_length_mu = 4.5;
+    double document_length_sigma = 0.8;
+    int min_document_length = 5;
+    int max_document_length = 2'000;
+    // Стоп-слова - самые частые слова словаря, stop_word_ratio - доля стоп-слов среди слов документа
+    int stop_word_count = 50;
+    double stop_word_ratio = 0.3;
+};
+
+// Потоковый генератор документов: словарь не хранится, слово ранга k вычисляется по k
+// (частые слова короче, как в естественном языке), документ пишется в переиспользуемый буфер.
+// Поэтому корпус любого размера можно сразу добавлять в сервер, не держа его тексты в памяти
+class CorpusGenerator {
+public:
+    explicit CorpusGenerator(const CorpusConfig& config);
+
+    // Стоп-слова через пробел, для конструктора сервера
+    std::string GetStopWords() const;
+
+    // Текст следующего документа записывается в text (память строки переиспользуется)
+    void NextDocument(std::string& text);
+    std::string NextDocument();
+
+    // Добавляет в сервер document_count документов с id от first_id, рейтинги случайные
+    template <typename Server>
+    void AddDocuments(Server& server, int first_id, int document_count);
+
+    // Слово ранга rank (с 1). Разные ранги дают разные слова
+    static void AppendWord(uint64_t rank, std::string& text);
+
+    const CorpusConfig& GetConfig() const {
+        return config_;
+    }
+
+private:
+    CorpusConfig config_;
+    std::mt19937_64 generator_;
+    ZipfDistribution content_words_; // слова после стоп-слов
+    ZipfDistribution stop_words_;
+    std::lognormal_distribution<double> document_length_;
+
+    friend class QueryLogGenerator;
+    // Следующее слово текста с учётом доли стоп-слов
+    void AppendNextWord(std::mt19937_64& generator, double stop_word_ratio, std::string& text) const;
+};
+
+template <typename Server>
+void CorpusGenerator::AddDocuments(Server& server, int first_id, int document_count) {
+    std::string text;
+    std::uniform_int_distribution<int> rating(-10, 10);
+    for (int i = 0; i < document_count; ++i) {
+        NextDocument(text);
+        server.AddDocument(first_id + i, text, DocumentStatus::ACTUAL, { rating(generator_), rating(generator_) });
+    }
+}
+
+// Параметры журнала запросов
+struct QueryLogConfig {
+    uint32_t seed = 7;
+    uint64_t distinct_query_count = 10'000;
+    double query_popularity_exponent = 1.0; // повторяемость запросов: частота i-го по популярности запроса ~ 1 / i^exponent
+    int max_query_word_count = 8;
+    double query_length_p = 0.4;            // кол-во слов - геометрическое распределение (короткие запросы чаще)
+    double minus_word_prob = 0.05;
+    double stop_word_ratio = 0.05;          // в запросах стоп-слов меньше, чем в документах
+};
+
+// Журнал запросов: популярность запросов распределена по Ципфу, поэтому запросы повторяются.
+// Текст запроса вычисляется по его номеру (тот же номер - тот же текст), набор запросов не хранится
+class QueryLogGenerator {
+public:
+    QueryLogGenerator(const CorpusGenerator& corpus, const QueryLogConfig& config);
+
+    void NextQuery(std::string& text);
+    std::string NextQuery();
+
+    // Текст запроса с номером query_id (от 1 до distinct_query_count)
+    void GetQuery(uint64_t query_id, std::string& text) const;
+
+private:
+    const CorpusGenerator& corpus_;
+    QueryLogConfig config_;
+    std::mt19937_64 generator_;
+    ZipfDistribution popularity_;
+};
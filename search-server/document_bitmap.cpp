@@ -0,0 +1,241 @@
+#include "document_bitmap.h"
+
+#include <algorithm>
+#include <iterator>
+
+using namespace std;
+
+namespace {
+    int CountBits(uint64_t word) {
+        int count = 0;
+        for (; word != 0; word &= word - 1) {
+            ++count;
+        }
+        return count;
+    }
+}
+
+//---------------------------- Контейнер ----------------------------
+
+bool DocumentBitmap::Container::Contains(uint16_t value) const {
+    if (IsBitmap()) {
+        return (bitmap[value >> 6] >> (value & 63)) & 1;
+    }
+    return binary_search(array.begin(), array.end(), value);
+}
+
+void DocumentBitmap::Container::Normalize() {
+    if (IsBitmap() && size <= ARRAY_MAX_SIZE) {
+        array.clear();
+        array.reserve(size);
+        for (size_t i = 0; i < bitmap.size(); ++i) {
+            for (uint64_t word = bitmap[i]; word != 0; word &= word - 1) {
+                array.push_back(static_cast<uint16_t>(i * 64 + CountTrailingZeros(word)));
+            }
+        }
+        bitmap.clear();
+        bitmap.shrink_to_fit();
+    }
+    else if (!IsBitmap() && size > ARRAY_MAX_SIZE) {
+        bitmap.assign(BITMAP_WORD_COUNT, 0);
+        for (const uint16_t value : array) {
+            bitmap[value >> 6] |= uint64_t(1) << (value & 63);
+        }
+        array.clear();
+        array.shrink_to_fit();
+    }
+}
+
+DocumentBitmap::Container DocumentBitmap::Container::Intersect(const Container& lhs, const Container& rhs) {
+    Container result;
+    result.key = lhs.key;
+    if (lhs.IsBitmap() && rhs.IsBitmap()) {
+        result.bitmap.resize(BITMAP_WORD_COUNT);
+        for (size_t i = 0; i < BITMAP_WORD_COUNT; ++i) {
+            result.bitmap[i] = lhs.bitmap[i] & rhs.bitmap[i];
+            result.size += CountBits(result.bitmap[i]);
+        }
+    }
+    else if (lhs.IsBitmap() || rhs.IsBitmap()) {
+        // Элементы массива проверяются по битовой карте
+        const Container& sparse = lhs.IsBitmap() ? rhs : lhs;
+        const Container& dense = lhs.IsBitmap() ? lhs : rhs;
+        copy_if(sparse.array.begin(), sparse.array.end(), back_inserter(result.array),
+            [&dense](uint16_t value) {
+                return dense.Contains(value);
+            });
+        result.size = result.array.size();
+    }
+    else {
+        set_intersection(lhs.array.begin(), lhs.array.end(), rhs.array.begin(), rhs.array.end(), back_inserter(result.array));
+        result.size = result.array.size();
+    }
+    result.Normalize();
+    return result;
+}
+
+DocumentBitmap::Container DocumentBitmap::Container::Unite(const Container& lhs, const Container& rhs) {
+    Container result;
+    result.key = lhs.key;
+    if (lhs.IsBitmap() || rhs.IsBitmap()) {
+        result.bitmap.assign(BITMAP_WORD_COUNT, 0);
+        for (const Container* container : { &lhs, &rhs }) {
+            if (container->IsBitmap()) {
+                for (size_t i = 0; i < BITMAP_WORD_COUNT; ++i) {
+                    result.bitmap[i] |= container->bitmap[i];
+                }
+            }
+            else {
+                for (const uint16_t value : container->array) {
+                    result.bitmap[value >> 6] |= uint64_t(1) << (value & 63);
+                }
+            }
+        }
+        for (const uint64_t word : result.bitmap) {
+            result.size += CountBits(word);
+        }
+    }
+    else {
+        set_union(lhs.array.begin(), lhs.array.end(), rhs.array.begin(), rhs.array.end(), back_inserter(result.array));
+        result.size = result.array.size();
+    }
+    result.Normalize();
+    return result;
+}
+
+//---------------------------- Множество ----------------------------
+
+vector<DocumentBitmap::Container>::iterator DocumentBitmap::FindContainer(uint16_t key) {
+    return lower_bound(containers_.begin(), containers_.end(), key,
+        [](const Container& container, uint16_t key) {
+            return container.key < key;
+        });
+}
+
+vector<DocumentBitmap::Container>::const_iterator DocumentBitmap::FindContainer(uint16_t key) const {
+    return lower_bound(containers_.begin(), containers_.end(), key,
+        [](const Container& container, uint16_t key) {
+            return container.key < key;
+        });
+}
+
+void DocumentBitmap::Add(int document_id) {
+    const auto key = static_cast<uint16_t>(static_cast<uint32_t>(document_id) >> 16);
+    const auto value = static_cast<uint16_t>(document_id & 0xFFFF);
+
+    auto container_it = FindContainer(key);
+    if (container_it == containers_.end() || container_it->key != key) {
+        container_it = containers_.insert(container_it, Container());
+        container_it->key = key;
+    }
+    Container& container = *container_it;
+    if (container.IsBitmap()) {
+        uint64_t& word = container.bitmap[value >> 6];
+        const uint64_t bit = uint64_t(1) << (value & 63);
+        if ((word & bit) == 0) {
+            word |= bit;
+            ++container.size;
+        }
+        return;
+    }
+    const auto value_it = lower_bound(container.array.begin(), container.array.end(), value);
+    if (value_it == container.array.end() || *value_it != value) {
+        container.array.insert(value_it, value);
+        ++container.size;
+        container.Normalize();
+    }
+}
+
+void DocumentBitmap::Remove(int document_id) {
+    const auto key = static_cast<uint16_t>(static_cast<uint32_t>(document_id) >> 16);
+    const auto value = static_cast<uint16_t>(document_id & 0xFFFF);
+
+    const auto container_it = FindContainer(key);
+    if (container_it == containers_.end() || container_it->key != key || !container_it->Contains(value)) {
+        return;
+    }
+    Container& container = *container_it;
+    if (container.IsBitmap()) {
+        container.bitmap[value >> 6] &= ~(uint64_t(1) << (value & 63));
+    }
+    else {
+        container.array.erase(lower_bound(container.array.begin(), container.array.end(), value));
+    }
+    --container.size;
+    container.Normalize();
+    if (container.size == 0) {
+        containers_.erase(container_it);
+    }
+}
+
+bool DocumentBitmap::Contains(int document_id) const {
+    const auto key = static_cast<uint16_t>(static_cast<uint32_t>(document_id) >> 16);
+    const auto container_it = FindContainer(key);
+    return container_it != containers_.end() && container_it->key == key
+        && container_it->Contains(static_cast<uint16_t>(document_id & 0xFFFF));
+}
+
+size_t DocumentBitmap::GetSize() const {
+    size_t size = 0;
+    for (const Container& container : containers_) {
+        size += container.size;
+    }
+    return size;
+}
+
+bool DocumentBitmap::IsEmpty() const {
+    return containers_.empty();
+}
+
+size_t DocumentBitmap::GetMemory() const {
+    size_t memory = containers_.capacity() * sizeof(Container);
+    for (const Container& container : containers_) {
+        memory += container.array.capacity() * sizeof(uint16_t) + container.bitmap.capacity() * sizeof(uint64_t);
+    }
+    return memory;
+}
+
+DocumentBitmap& DocumentBitmap::operator&=(const DocumentBitmap& other) {
+    vector<Container> result;
+    auto lhs_it = containers_.begin();
+    auto rhs_it = other.containers_.begin();
+    while (lhs_it != containers_.end() && rhs_it != other.containers_.end()) {
+        if (lhs_it->key < rhs_it->key) {
+            ++lhs_it;
+        }
+        else if (rhs_it->key < lhs_it->key) {
+            ++rhs_it;
+        }
+        else {
+            Container container = Container::Intersect(*lhs_it, *rhs_it);
+            if (container.size > 0) {
+                result.push_back(move(container));
+            }
+            ++lhs_it;
+            ++rhs_it;
+        }
+    }
+    containers_ = move(result);
+    return *this;
+}
+
+DocumentBitmap& DocumentBitmap::operator|=(const DocumentBitmap& other) {
+    vector<Container> result;
+    auto lhs_it = containers_.begin();
+    auto rhs_it = other.containers_.begin();
+    while (lhs_it != containers_.end() || rhs_it != other.containers_.end()) {
+        if (rhs_it == other.containers_.end() || (lhs_it != containers_.end() && lhs_it->key < rhs_it->key)) {
+            result.push_back(move(*lhs_it++));
+        }
+        else if (lhs_it == containers_.end() || rhs_it->key < lhs_it->key) {
+            result.push_back(*rhs_it++);
+        }
+        else {
+            result.push_back(Container::Unite(*lhs_it, *rhs_it));
+            ++lhs_it;
+            ++rhs_it;
+        }
+    }
+    containers_ = move(result);
+    return *this;
+}
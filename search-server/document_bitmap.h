@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Сжатое множество id документов в духе Roaring bitmap.
+// Id делится на старшие и младшие 16 бит: для каждого значения старших бит хранится контейнер
+// младших. Разреженный контейнер (до ARRAY_MAX_SIZE элементов) - упорядоченный массив,
+// плотный - битовая карта на 65536 бит. Тип контейнера меняется при пересечении порога
+class DocumentBitmap {
+public:
+    void Add(int document_id);
+    void Remove(int document_id);
+    bool Contains(int document_id) const;
+
+    size_t GetSize() const;
+    bool IsEmpty() const;
+    // Память, занимаемая контейнерами, в байтах
+    size_t GetMemory() const;
+
+    DocumentBitmap& operator&=(const DocumentBitmap& other);
+    DocumentBitmap& operator|=(const DocumentBitmap& other);
+
+    // Вызывает callback для каждого id по возрастанию
+    template <typename Callback>
+    void ForEach(Callback callback) const;
+
+private:
+    static const size_t ARRAY_MAX_SIZE = 4096;
+    static const size_t BITMAP_WORD_COUNT = 65536 / 64;
+
+    struct Container {
+        std::uint16_t key = 0;                // старшие 16 бит id
+        size_t size = 0;                      // кол-во элементов
+        std::vector<std::uint16_t> array;     // упорядоченные младшие 16 бит, если контейнер разреженный
+        std::vector<std::uint64_t> bitmap;    // битовая карта, если контейнер плотный
+
+        bool IsBitmap() const {
+            return !bitmap.empty();
+        }
+
+        bool Contains(std::uint16_t value) const;
+        // Приводит контейнер к типу, соответствующему кол-ву элементов
+        void Normalize();
+
+        static Container Intersect(const Container& lhs, const Container& rhs);
+        static Container Unite(const Container& lhs, const Container& rhs);
+    };
+
+    std::vector<Container> containers_; // упорядочены по key, пустых контейнеров нет
+
+    std::vector<Container>::iterator FindContainer(std::uint16_t key);
+    std::vector<Container>::const_iterator FindContainer(std::uint16_t key) const;
+
+    static int CountTrailingZeros(std::uint64_t word) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, word);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctzll(word);
+#endif
+    }
+};
+
+template <typename Callback>
+void DocumentBitmap::ForEach(Callback callback) const {
+    for (const Container& container : containers_) {
+        const int high = static_cast<int>(container.key) << 16;
+        if (container.IsBitmap()) {
+            for (size_t i = 0; i < container.bitmap.size(); ++i) {
+                for (std::uint64_t word = container.bitmap[i]; word != 0; word &= word - 1) {
+                    callback(high | static_cast<int>(i * 64 + CountTrailingZeros(word)));
+                }
+            }
+        }
+        else {
+            for (const std::uint16_t value : container.array) {
+                callback(high | value);
+            }
+        }
+    }
+}
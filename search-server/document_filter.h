@@ -0,0 +1,16 @@
+#pragma once
+
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "document.h"
+
+// Декларативный фильтр документов для FindTopDocuments. Условия объединяются по И,
+// незаданное условие пропускает все документы. Сервер компилирует фильтр в DocumentBitmap
+// по поддерживаемым индексам статусов и рейтингов, после чего вхождения слов проверяются по битовой карте
+struct DocumentFilter {
+    std::vector<DocumentStatus> statuses;             // документ имеет один из статусов, пусто - любой статус
+    std::optional<std::pair<int, int>> rating_range;  // рейтинг в диапазоне [first, second]
+    std::optional<std::vector<int>> document_ids;     // id документа из списка
+};
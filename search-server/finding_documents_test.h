@@ -3,6 +3,7 @@
 #include "search_server.h"
 
 #include "log_duration.h"
+#include "test_data_generator.h"
 
 #include <execution>
 #include <iostream>
@@ -12,51 +13,8 @@
 
 using namespace std;
 
-string GenerateWord(mt19937& generator, int max_length) {
-    const int length = uniform_int_distribution(1, max_length)(generator);
-    string word;
-    word.reserve(length);
-    for (int i = 0; i < length; ++i) {
-        word.push_back(uniform_int_distribution((short)'a', (short)'z')(generator));
-    }
-    return word;
-}
-
-vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length) {
-    vector<string> words;
-    words.reserve(word_count);
-    for (int i = 0; i < word_count; ++i) {
-        words.push_back(GenerateWord(generator, max_length));
-    }
-    words.erase(unique(words.begin(), words.end()), words.end());
-    return words;
-}
-
-string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int word_count, double minus_prob = 0) {
-    string query;
-    for (int i = 0; i < word_count; ++i) {
-        if (!query.empty()) {
-            query.push_back(' ');
-        }
-        if (uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
-            query.push_back('-');
-        }
-        query += dictionary[uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
-    }
-    return query;
-}
-
-vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count) {
-    vector<string> queries;
-    queries.reserve(query_count);
-    for (int i = 0; i < query_count; ++i) {
-        queries.push_back(GenerateQuery(generator, dictionary, max_word_count));
-    }
-    return queries;
-}
-
-template <typename ExecutionPolicy>
-void Test(string_view mark, const SearchServer& search_server, const vector<string>& queries, ExecutionPolicy&& policy) {
+template <typename Server, typename ExecutionPolicy>
+void Test(string_view mark, const Server& search_server, const vector<string>& queries, ExecutionPolicy&& policy) {
     LOG_DURATION(mark);
     double total_relevance = 0;
     for (const string_view query : queries) {
@@ -84,4 +42,14 @@ void TestFindingDocuments() {
 
     TEST(seq);
     TEST(par);
-}
\ No newline at end of file
+
+    // BM25 на том же корпусе и тех же запросах
+    Bm25SearchServer bm25_search_server(dictionary[0]);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        bm25_search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+    }
+    Test("bm25 seq"sv, bm25_search_server, queries, execution::seq);
+    Test("bm25 par"sv, bm25_search_server, queries, execution::par);
+}
+
+#undef TEST
\ No newline at end of file
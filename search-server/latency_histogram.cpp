@@ -0,0 +1,239 @@
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+using namespace std;
+
+//---------------------------- Гистограмма ----------------------------
+
+LatencyHistogram::LatencyHistogram()
+    : counts_(BIN_COUNT) {
+}
+
+void LatencyHistogram::Record(chrono::nanoseconds latency) {
+    RecordValue(static_cast<uint64_t>(max<chrono::nanoseconds::rep>(0, latency.count())));
+}
+
+void LatencyHistogram::RecordValue(uint64_t value, uint64_t count) {
+    counts_[GetBin(value)] += count;
+    count_ += count;
+    max_ = max(max_, min(value, MAX_VALUE));
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+    for (size_t bin = 0; bin < BIN_COUNT; ++bin) {
+        counts_[bin] += other.counts_[bin];
+    }
+    count_ += other.count_;
+    max_ = max(max_, other.max_);
+}
+
+void LatencyHistogram::Reset() {
+    fill(counts_.begin(), counts_.end(), 0);
+    count_ = 0;
+    max_ = 0;
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+    return count_;
+}
+
+chrono::nanoseconds LatencyHistogram::GetMax() const {
+    return chrono::nanoseconds(max_);
+}
+
+chrono::nanoseconds LatencyHistogram::GetPercentile(double percentile) const {
+    if (count_ == 0) {
+        return chrono::nanoseconds(0);
+    }
+    const uint64_t rank = max<uint64_t>(1, static_cast<uint64_t>(ceil(count_ * clamp(percentile, 0.0, 100.0) / 100.0)));
+    uint64_t count = 0;
+    for (size_t bin = 0; bin < BIN_COUNT; ++bin) {
+        count += counts_[bin];
+        if (count >= rank) {
+            return chrono::nanoseconds(min(GetBinUpperBound(bin), max_));
+        }
+    }
+    return chrono::nanoseconds(max_);
+}
+
+uint64_t LatencyHistogram::GetBinUpperBound(size_t bin) {
+    if (bin < 2 * SUB_BIN_COUNT) {
+        return bin;
+    }
+    const uint64_t shift = bin / SUB_BIN_COUNT - 1;
+    const uint64_t low = (bin % SUB_BIN_COUNT + SUB_BIN_COUNT) << shift;
+    return low + (uint64_t(1) << shift) - 1;
+}
+
+//---------------------------- Сбор по операциям ----------------------------
+
+namespace {
+    // Гистограммы одного потока. Пишет только поток-владелец, читают снимки
+    struct ThreadHistograms {
+        array<array<atomic<uint64_t>, LatencyHistogram::BIN_COUNT>, LATENCY_OPERATION_COUNT> counts;
+        array<atomic<uint64_t>, LATENCY_OPERATION_COUNT> max_values;
+
+        ThreadHistograms() {
+            for (auto& operation_counts : counts) {
+                for (auto& count : operation_counts) {
+                    count.store(0, memory_order_relaxed);
+                }
+            }
+            for (auto& max_value : max_values) {
+                max_value.store(0, memory_order_relaxed);
+            }
+        }
+
+        // Добавляет счётчики операции в гистограмму histogram. Интервал хранит только верхнюю границу,
+        // значения ограничиваются максимумом потока, чтобы максимум снимка был точным
+        void AddTo(LatencyOperation operation, LatencyHistogram& histogram) const {
+            const size_t index = static_cast<size_t>(operation);
+            const uint64_t max_value = max_values[index].load(memory_order_relaxed);
+            for (size_t bin = 0; bin < LatencyHistogram::BIN_COUNT; ++bin) {
+                const uint64_t count = counts[index][bin].load(memory_order_relaxed);
+                if (count > 0) {
+                    histogram.RecordValue(min(LatencyHistogram::GetBinUpperBound(bin), max_value), count);
+                }
+            }
+        }
+
+        void Reset() {
+            for (auto& operation_counts : counts) {
+                for (auto& count : operation_counts) {
+                    count.store(0, memory_order_relaxed);
+                }
+            }
+            for (auto& max_value : max_values) {
+                max_value.store(0, memory_order_relaxed);
+            }
+        }
+    };
+
+    struct Registry {
+        mutex registry_mutex;
+        vector<ThreadHistograms*> threads;
+        // Гистограммы завершившихся потоков
+        array<LatencyHistogram, LATENCY_OPERATION_COUNT> retired;
+    };
+
+    Registry& GetRegistry() {
+        static Registry registry;
+        return registry;
+    }
+
+    atomic<bool> latency_metrics_enabled{ false };
+
+    // Владеет гистограммами потока, при завершении потока переносит их в общие
+    struct ThreadHistogramsHolder {
+        unique_ptr<ThreadHistograms> histograms;
+
+        ~ThreadHistogramsHolder() {
+            if (!histograms) {
+                return;
+            }
+            Registry& registry = GetRegistry();
+            lock_guard guard(registry.registry_mutex);
+            for (size_t index = 0; index < LATENCY_OPERATION_COUNT; ++index) {
+                histograms->AddTo(static_cast<LatencyOperation>(index), registry.retired[index]);
+            }
+            registry.threads.erase(find(registry.threads.begin(), registry.threads.end(), histograms.get()));
+        }
+    };
+
+    ThreadHistograms& GetThreadHistograms() {
+        thread_local ThreadHistogramsHolder holder;
+        if (!holder.histograms) {
+            holder.histograms = make_unique<ThreadHistograms>();
+            Registry& registry = GetRegistry();
+            lock_guard guard(registry.registry_mutex);
+            registry.threads.push_back(holder.histograms.get());
+        }
+        return *holder.histograms;
+    }
+}
+
+string_view GetLatencyOperationName(LatencyOperation operation) {
+    switch (operation) {
+    case LatencyOperation::ADD_DOCUMENT:
+        return "add_document"sv;
+    case LatencyOperation::REMOVE_DOCUMENT:
+        return "remove_document"sv;
+    case LatencyOperation::PARSE_QUERY:
+        return "parse_query"sv;
+    case LatencyOperation::FIND_ALL_DOCUMENTS:
+        return "find_all_documents"sv;
+    case LatencyOperation::SELECT_TOP_DOCUMENTS:
+        return "select_top_documents"sv;
+    case LatencyOperation::MATCH_DOCUMENT:
+        return "match_document"sv;
+    }
+    throw invalid_argument("unknown latency operation");
+}
+
+void LatencyMetrics::SetEnabled(bool enabled) {
+    latency_metrics_enabled.store(enabled, memory_order_relaxed);
+}
+
+bool LatencyMetrics::IsEnabled() {
+    return latency_metrics_enabled.load(memory_order_relaxed);
+}
+
+void LatencyMetrics::Record(LatencyOperation operation, chrono::nanoseconds latency) {
+    const size_t index = static_cast<size_t>(operation);
+    const uint64_t value = min(LatencyHistogram::MAX_VALUE, static_cast<uint64_t>(max<chrono::nanoseconds::rep>(0, latency.count())));
+
+    ThreadHistograms& histograms = GetThreadHistograms();
+    // Пишет только текущий поток, поэтому достаточно загрузки и записи без атомарного инкремента
+    atomic<uint64_t>& count = histograms.counts[index][LatencyHistogram::GetBin(value)];
+    count.store(count.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic<uint64_t>& max_value = histograms.max_values[index];
+    if (value > max_value.load(memory_order_relaxed)) {
+        max_value.store(value, memory_order_relaxed);
+    }
+}
+
+LatencyHistogram LatencyMetrics::GetSnapshot(LatencyOperation operation) {
+    Registry& registry = GetRegistry();
+    lock_guard guard(registry.registry_mutex);
+
+    LatencyHistogram result = registry.retired[static_cast<size_t>(operation)];
+    for (const ThreadHistograms* histograms : registry.threads) {
+        histograms->AddTo(operation, result);
+    }
+    return result;
+}
+
+void LatencyMetrics::Reset() {
+    Registry& registry = GetRegistry();
+    lock_guard guard(registry.registry_mutex);
+    for (LatencyHistogram& histogram : registry.retired) {
+        histogram.Reset();
+    }
+    for (ThreadHistograms* histograms : registry.threads) {
+        histograms->Reset();
+    }
+}
+
+void LatencyMetrics::PrintSummary(ostream& out) {
+    out << left << setw(24) << "operation"sv << right
+        << setw(12) << "count"sv << setw(12) << "p50"sv << setw(12) << "p99"sv
+        << setw(12) << "p999"sv << setw(12) << "max"sv << " (ns)"sv << endl;
+    for (size_t index = 0; index < LATENCY_OPERATION_COUNT; ++index) {
+        const auto operation = static_cast<LatencyOperation>(index);
+        const LatencyHistogram histogram = GetSnapshot(operation);
+        out << left << setw(24) << GetLatencyOperationName(operation) << right
+            << setw(12) << histogram.GetCount()
+            << setw(12) << histogram.GetPercentile(50).count()
+            << setw(12) << histogram.GetPercentile(99).count()
+            << setw(12) << histogram.GetPercentile(99.9).count()
+            << setw(12) << histogram.GetMax().count() << endl;
+    }
+}
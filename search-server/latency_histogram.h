@@ -0,0 +1,148 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Гистограмма задержек в наносекундах в духе HdrHistogram: значения до 64 нс хранятся точно,
+// дальше каждая степень двойки делится на SUB_BIN_COUNT равных интервалов,
+// поэтому относительная погрешность перцентиля не больше 1 / SUB_BIN_COUNT (около 3%).
+// Гистограммы одинакового размера складываются (Merge), что позволяет вести их по потокам
+class LatencyHistogram {
+public:
+    static const int SUB_BIN_BITS = 5;
+    static const uint64_t SUB_BIN_COUNT = uint64_t(1) << SUB_BIN_BITS;
+    // Значения больше MAX_VALUE (около 18 минут) учитываются как MAX_VALUE
+    static const int MAX_VALUE_BITS = 40;
+    static const uint64_t MAX_VALUE = (uint64_t(1) << MAX_VALUE_BITS) - 1;
+    static const size_t BIN_COUNT = (MAX_VALUE_BITS - SUB_BIN_BITS + 1) * SUB_BIN_COUNT;
+
+    LatencyHistogram();
+
+    void Record(std::chrono::nanoseconds latency);
+    // Добавляет count значений value (в наносекундах)
+    void RecordValue(uint64_t value, uint64_t count = 1);
+    void Merge(const LatencyHistogram& other);
+    void Reset();
+
+    uint64_t GetCount() const;
+    std::chrono::nanoseconds GetMax() const;
+    // Значение, не меньше которого percentile процентов записанных значений (percentile от 0 до 100).
+    // Возвращается верхняя граница интервала, но не больше максимального значения
+    std::chrono::nanoseconds GetPercentile(double percentile) const;
+
+    static size_t GetBin(uint64_t value) {
+        if (value < 2 * SUB_BIN_COUNT) {
+            return static_cast<size_t>(value);
+        }
+        if (value > MAX_VALUE) {
+            value = MAX_VALUE;
+        }
+        const int shift = GetHighestBit(value) - SUB_BIN_BITS;
+        return static_cast<size_t>(shift * SUB_BIN_COUNT + (value >> shift));
+    }
+
+    static uint64_t GetBinUpperBound(size_t bin);
+
+private:
+    std::vector<uint64_t> counts_;
+    uint64_t count_ = 0;
+    uint64_t max_ = 0;
+
+    static int GetHighestBit(uint64_t value) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return static_cast<int>(index);
+#else
+        return 63 - __builtin_clzll(value);
+#endif
+    }
+};
+
+// Операции поискового сервера, задержки которых собираются в LatencyMetrics
+enum class LatencyOperation {
+    ADD_DOCUMENT,
+    REMOVE_DOCUMENT,
+    PARSE_QUERY,
+    FIND_ALL_DOCUMENTS,
+    SELECT_TOP_DOCUMENTS,
+    MATCH_DOCUMENT,
+};
+
+const size_t LATENCY_OPERATION_COUNT = 6;
+
+std::string_view GetLatencyOperationName(LatencyOperation operation);
+
+// Сбор задержек операций. У каждого потока свои гистограммы, запись в них не требует блокировок:
+// поток только увеличивает счётчик интервала (атомарная переменная без lock-префикса, пишет только владелец).
+// Снимок складывает гистограммы всех потоков; гистограммы завершившихся потоков
+// добавляются к общей при завершении потока. Мьютекс берётся при первой записи потока и при чтении
+class LatencyMetrics {
+public:
+    // Сбор выключен по умолчанию, как и AllocationMetrics. Выключенный таймер не читает часы
+    static void SetEnabled(bool enabled);
+    static bool IsEnabled();
+
+    static void Record(LatencyOperation operation, std::chrono::nanoseconds latency);
+
+    static LatencyHistogram GetSnapshot(LatencyOperation operation);
+    // Обнуление статистики. Записи, идущие одновременно со сбросом, могут частично сохраниться
+    static void Reset();
+    // Таблица: операция, кол-во, p50, p99, p999, максимум (в наносекундах)
+    static void PrintSummary(std::ostream& out);
+};
+
+// Замер времени от создания до конца блока с записью в LatencyMetrics
+class ScopedLatencyTimer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit ScopedLatencyTimer(LatencyOperation operation)
+        : operation_(operation)
+        , enabled_(LatencyMetrics::IsEnabled()) {
+        if (enabled_) {
+            start_time_ = Clock::now();
+        }
+    }
+
+    ScopedLatencyTimer(const ScopedLatencyTimer&) = delete;
+    ScopedLatencyTimer& operator=(const ScopedLatencyTimer&) = delete;
+
+    ~ScopedLatencyTimer() {
+        if (enabled_) {
+            LatencyMetrics::Record(operation_, Clock::now() - start_time_);
+        }
+    }
+
+private:
+    LatencyOperation operation_;
+    bool enabled_;
+    Clock::time_point start_time_;
+};
+
+#define LATENCY_CONCAT_INTERNAL(X, Y) X##Y
+#define LATENCY_CONCAT(X, Y) LATENCY_CONCAT_INTERNAL(X, Y)
+
+/**
+ * Макрос замеряет время до конца текущего блока и добавляет его в гистограмму операции.
+ *
+ * Пример использования:
+ *
+ *  LatencyMetrics::SetEnabled(true);
+ *  ...
+ *  void AddDocument(...) {
+ *      LATENCY_TIMER(LatencyOperation::ADD_DOCUMENT);
+ *      ...
+ *  }
+ *
+ *  LatencyMetrics::PrintSummary(std::cout);
+ */
+#define LATENCY_TIMER(operation) ScopedLatencyTimer LATENCY_CONCAT(latencyTimer, __LINE__)(operation)
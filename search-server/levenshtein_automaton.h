@@ -0,0 +1,59 @@
+#pragma once
+
+#include <algorithm>
+#include <string_view>
+#include <vector>
+
+// Автомат, принимающий слова на расстоянии Левенштейна не больше max_distance от заданного слова.
+// Состояние - строка таблицы динамического программирования: state[i] - расстояние между прочитанным
+// префиксом и первыми i символами слова. Значения ограничены сверху max_distance + 1, поэтому
+// множество состояний конечно, а автомат детерминированный.
+// Автомат читает слово посимвольно, что позволяет обходить словарь как дерево префиксов
+// и отбрасывать целые поддеревья, как только состояние перестаёт быть "живым"
+class LevenshteinAutomaton {
+public:
+    using State = std::vector<int>;
+
+    LevenshteinAutomaton(std::string_view word, int max_distance)
+        : word_(word)
+        , max_distance_(max_distance) {
+    }
+
+    // Состояние до чтения первого символа: расстояние до префикса длины i равно i
+    State Start() const {
+        State state(word_.size() + 1);
+        for (size_t i = 0; i < state.size(); ++i) {
+            state[i] = std::min(static_cast<int>(i), max_distance_ + 1);
+        }
+        return state;
+    }
+
+    // Переход по символу c, результат записывается в next
+    void Step(const State& state, char c, State& next) const {
+        next.resize(state.size());
+        next[0] = std::min(state[0] + 1, max_distance_ + 1);
+        for (size_t i = 1; i < state.size(); ++i) {
+            const int replace_cost = state[i - 1] + (word_[i - 1] == c ? 0 : 1);
+            next[i] = std::min({ replace_cost, state[i] + 1, next[i - 1] + 1, max_distance_ + 1 });
+        }
+    }
+
+    // Прочитанное слово принимается автоматом
+    bool IsMatch(const State& state) const {
+        return state.back() <= max_distance_;
+    }
+
+    // Расстояние от прочитанного слова до заданного (имеет смысл, если IsMatch)
+    int GetDistance(const State& state) const {
+        return state.back();
+    }
+
+    // Существует продолжение прочитанного префикса, которое будет принято
+    bool CanMatch(const State& state) const {
+        return *std::min_element(state.begin(), state.end()) <= max_distance_;
+    }
+
+private:
+    std::string_view word_;
+    int max_distance_;
+};
@@ -0,0 +1,346 @@
+// Генератор нагрузки с открытым циклом: журнал запросов воспроизводится против SearchServer
+// в том же процессе с заданной частотой поступления (QPS), независимо от того, успевает ли сервер.
+// Время поступления каждого запроса назначается заранее, задержка считается от назначенного
+// времени, а не от фактического начала обработки. Поэтому очередь, накопившаяся при перегрузке,
+// попадает в перцентили (поправка на coordinated omission), в отличие от замкнутого цикла ProcessQueries.
+// Параллельно может идти поток записи: добавление новых и удаление старых документов.
+// Чтение и запись разделяет shared_mutex, как во встраивающем сервер приложении.
+//
+// Сборка из каталога search-server:
+//
+//  g++ -std=c++17 -O2 loadgen/loadgen.cpp $(ls *.cpp | grep -v '^main.cpp$') -o search_loadgen -ltbb -lpthread
+//
+// Пример запуска (журнал - файл с запросом в каждой строке, без --log запросы генерируются):
+//
+//  ./search_loadgen --qps 2000 --duration 30 --threads 8 --write-qps 100 --log queries.txt --output load.json
+
+#include "../search_server.h"
+#include "../latency_histogram.h"
+#include "../corpus_generator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    using Clock = chrono::steady_clock;
+
+    struct LoadConfig {
+        uint32_t seed = 42;
+        double qps = 1'000.0;
+        double duration = 10.0;          // секунд
+        int threads = max(1, static_cast<int>(thread::hardware_concurrency()));
+        double write_qps = 0.0;          // добавлений (и удалений) документов в секунду
+        string arrival = "poisson"s;     // poisson - экспоненциальные интервалы, uniform - равные
+        int document_count = 50'000;
+        string log;                      // файл журнала запросов, пусто - QueryLogGenerator
+        string output;
+    };
+
+    // Запрос с назначенным временем поступления относительно начала прогона
+    struct Request {
+        chrono::nanoseconds arrival;
+        const string* query;
+    };
+
+    vector<chrono::nanoseconds> ScheduleArrivals(mt19937_64& generator, double rate, double duration, string_view arrival) {
+        vector<chrono::nanoseconds> arrivals;
+        if (rate <= 0.0) {
+            return arrivals;
+        }
+        exponential_distribution<double> interval(rate);
+        double time = 0.0;
+        for (size_t i = 0;; ++i) {
+            time = arrival == "poisson"sv ? time + interval(generator) : i / rate;
+            if (time >= duration) {
+                break;
+            }
+            arrivals.push_back(chrono::duration_cast<chrono::nanoseconds>(chrono::duration<double>(time)));
+        }
+        return arrivals;
+    }
+
+    vector<string> LoadQueries(const LoadConfig& config, const CorpusGenerator& corpus, size_t count) {
+        vector<string> queries;
+        if (!config.log.empty()) {
+            ifstream in(config.log);
+            if (!in) {
+                throw invalid_argument("cannot open query log "s + config.log);
+            }
+            for (string line; getline(in, line);) {
+                if (!line.empty()) {
+                    queries.push_back(move(line));
+                }
+            }
+            if (queries.empty()) {
+                throw invalid_argument("query log is empty"s);
+            }
+            return queries;
+        }
+        QueryLogConfig log_config;
+        log_config.seed = config.seed + 1;
+        QueryLogGenerator query_log(corpus, log_config);
+        queries.resize(max<size_t>(count, 1));
+        for (string& query : queries) {
+            query_log.NextQuery(query);
+        }
+        return queries;
+    }
+
+    // Задержки одного потока: от назначенного времени (с учётом очереди) и собственно обработки
+    struct WorkerStats {
+        LatencyHistogram latencies;
+        LatencyHistogram service_times;
+        uint64_t late_starts = 0; // запросы, начатые позже назначенного более чем на LATE_THRESHOLD
+        uint64_t errors = 0;
+    };
+
+    const chrono::milliseconds LATE_THRESHOLD(1);
+
+    void MergeStats(WorkerStats& result, const WorkerStats& stats) {
+        result.latencies.Merge(stats.latencies);
+        result.service_times.Merge(stats.service_times);
+        result.late_starts += stats.late_starts;
+        result.errors += stats.errors;
+    }
+
+    // Ждёт назначенного времени и выполняет операцию, задержка отсчитывается от назначенного времени
+    template <typename Operation>
+    void Execute(Clock::time_point scheduled, WorkerStats& stats, Operation operation) {
+        this_thread::sleep_until(scheduled);
+        const auto start = Clock::now();
+        try {
+            operation();
+        }
+        catch (const exception&) {
+            ++stats.errors;
+        }
+        const auto finish = Clock::now();
+        stats.latencies.Record(finish - scheduled);
+        stats.service_times.Record(finish - start);
+        if (start - scheduled > LATE_THRESHOLD) {
+            ++stats.late_starts;
+        }
+    }
+
+    struct LoadResult {
+        uint64_t reads = 0;
+        uint64_t writes = 0;
+        chrono::nanoseconds elapsed{ 0 };
+        WorkerStats read_stats;
+        WorkerStats write_stats;
+    };
+
+    LoadResult RunLoad(const LoadConfig& config) {
+        CorpusConfig corpus_config;
+        corpus_config.seed = config.seed;
+        CorpusGenerator corpus(corpus_config);
+
+        cerr << "Indexing "s << config.document_count << " documents..."s << endl;
+        SearchServer search_server(corpus.GetStopWords());
+        corpus.AddDocuments(search_server, 0, config.document_count);
+
+        mt19937_64 generator(config.seed);
+        const vector<chrono::nanoseconds> read_arrivals = ScheduleArrivals(generator, config.qps, config.duration, config.arrival);
+        const vector<chrono::nanoseconds> write_arrivals = ScheduleArrivals(generator, config.write_qps, config.duration, config.arrival);
+        const vector<string> queries = LoadQueries(config, corpus, read_arrivals.size());
+
+        // Запросы журнала воспроизводятся по кругу, если журнал короче прогона
+        vector<Request> requests(read_arrivals.size());
+        for (size_t i = 0; i < requests.size(); ++i) {
+            requests[i] = { read_arrivals[i], &queries[i % queries.size()] };
+        }
+        // Тексты документов для записи готовятся заранее, чтобы генерация не попадала в замер
+        vector<string> new_documents(write_arrivals.size());
+        for (string& document : new_documents) {
+            corpus.NextDocument(document);
+        }
+
+        shared_mutex server_mutex;
+        atomic<size_t> next_request = 0;
+        vector<WorkerStats> worker_stats(config.threads);
+        WorkerStats writer_stats;
+
+        cerr << "Replaying "s << requests.size() << " queries and "s << write_arrivals.size() << " writes over "s
+            << config.duration << " s..."s << endl;
+        const auto start = Clock::now();
+
+        // Потоки не ждут ответа перед отправкой следующего запроса: запрос берёт любой свободный поток,
+        // а при перегрузке запросы копятся и их задержка растёт
+        vector<thread> workers;
+        for (int thread_index = 0; thread_index < config.threads; ++thread_index) {
+            workers.emplace_back([&, thread_index]() {
+                WorkerStats& stats = worker_stats[thread_index];
+                for (size_t i = next_request++; i < requests.size(); i = next_request++) {
+                    Execute(start + requests[i].arrival, stats, [&]() {
+                        shared_lock lock(server_mutex);
+                        search_server.FindTopDocuments(*requests[i].query);
+                    });
+                }
+            });
+        }
+        thread writer([&]() {
+            // Добавляется новый документ и удаляется самый старый, размер индекса не меняется
+            int next_id = config.document_count;
+            int oldest_id = 0;
+            for (size_t i = 0; i < write_arrivals.size(); ++i) {
+                Execute(start + write_arrivals[i], writer_stats, [&]() {
+                    unique_lock lock(server_mutex);
+                    search_server.AddDocument(next_id++, new_documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+                    search_server.RemoveDocument(oldest_id++);
+                });
+            }
+        });
+        for (thread& worker : workers) {
+            worker.join();
+        }
+        writer.join();
+
+        LoadResult result;
+        result.elapsed = Clock::now() - start;
+        result.reads = requests.size();
+        result.writes = write_arrivals.size();
+        for (const WorkerStats& stats : worker_stats) {
+            MergeStats(result.read_stats, stats);
+        }
+        result.write_stats = move(writer_stats);
+        return result;
+    }
+
+    void PrintLatencies(ostream& out, const LatencyHistogram& latencies) {
+        out << "{\"p50\": "s << latencies.GetPercentile(50).count()
+            << ", \"p90\": "s << latencies.GetPercentile(90).count()
+            << ", \"p99\": "s << latencies.GetPercentile(99).count()
+            << ", \"p999\": "s << latencies.GetPercentile(99.9).count()
+            << ", \"max\": "s << latencies.GetMax().count() << '}';
+    }
+
+    void PrintStats(ostream& out, string_view name, uint64_t count, double seconds, const WorkerStats& stats) {
+        out << "  \""s << name << "\": {\"operations\": "s << count
+            << ", \"achieved_ops_per_second\": "s << fixed << setprecision(2) << (seconds > 0 ? count / seconds : 0.0)
+            << ", \"late_starts\": "s << stats.late_starts
+            << ", \"errors\": "s << stats.errors
+            << ", \"latency_ns\": "s;
+        out.unsetf(ios_base::floatfield);
+        PrintLatencies(out, stats.latencies);
+        out << ", \"service_time_ns\": "s;
+        PrintLatencies(out, stats.service_times);
+        out << '}';
+    }
+
+    void PrintJson(ostream& out, const LoadConfig& config, const LoadResult& result) {
+        const double seconds = chrono::duration<double>(result.elapsed).count();
+        out << "{\n"s;
+        out << "  \"config\": {\"seed\": "s << config.seed
+            << ", \"qps\": "s << config.qps
+            << ", \"duration\": "s << config.duration
+            << ", \"threads\": "s << config.threads
+            << ", \"write_qps\": "s << config.write_qps
+            << ", \"arrival\": \""s << config.arrival << '"'
+            << ", \"document_count\": "s << config.document_count
+            << ", \"log\": \""s << config.log << "\"},\n"s;
+        out << "  \"elapsed_seconds\": "s << fixed << setprecision(3) << seconds << ",\n"s;
+        out.unsetf(ios_base::floatfield);
+        PrintStats(out, "reads"sv, result.reads, seconds, result.read_stats);
+        out << ",\n"s;
+        PrintStats(out, "writes"sv, result.writes, seconds, result.write_stats);
+        out << "\n}\n"s;
+    }
+
+    void PrintUsage() {
+        cerr << "Usage: search_loadgen [--seed N] [--qps N] [--duration SECONDS] [--threads N] [--write-qps N]"s
+            << " [--arrival poisson|uniform] [--documents N] [--log FILE] [--output FILE]"s << endl;
+    }
+
+    LoadConfig ParseArguments(int argc, char* argv[]) {
+        LoadConfig config;
+        for (int i = 1; i < argc; ++i) {
+            const string_view argument = argv[i];
+            if (i + 1 >= argc) {
+                throw invalid_argument("missing value for "s + string(argument));
+            }
+            const string value = argv[++i];
+            if (argument == "--seed"sv) {
+                config.seed = static_cast<uint32_t>(stoul(value));
+            }
+            else if (argument == "--qps"sv) {
+                config.qps = stod(value);
+            }
+            else if (argument == "--duration"sv) {
+                config.duration = stod(value);
+            }
+            else if (argument == "--threads"sv) {
+                config.threads = stoi(value);
+            }
+            else if (argument == "--write-qps"sv) {
+                config.write_qps = stod(value);
+            }
+            else if (argument == "--arrival"sv) {
+                if (value != "poisson"sv && value != "uniform"sv) {
+                    throw invalid_argument("unknown arrival process "s + value);
+                }
+                config.arrival = value;
+            }
+            else if (argument == "--documents"sv) {
+                config.document_count = stoi(value);
+            }
+            else if (argument == "--log"sv) {
+                config.log = value;
+            }
+            else if (argument == "--output"sv) {
+                config.output = value;
+            }
+            else {
+                throw invalid_argument("unknown argument "s + string(argument));
+            }
+        }
+        if (config.qps <= 0 || config.duration <= 0 || config.threads <= 0 || config.write_qps < 0 || config.document_count <= 0) {
+            throw invalid_argument("rates, duration and counts must be positive"s);
+        }
+        return config;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    LoadConfig config;
+    try {
+        config = ParseArguments(argc, argv);
+    }
+    catch (const exception& e) {
+        cerr << e.what() << endl;
+        PrintUsage();
+        return 1;
+    }
+
+    LoadResult result;
+    try {
+        result = RunLoad(config);
+    }
+    catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    if (config.output.empty()) {
+        PrintJson(cout, config, result);
+    }
+    else {
+        ofstream out(config.output);
+        PrintJson(out, config, result);
+    }
+    return 0;
+}
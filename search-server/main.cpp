@@ -3,6 +3,7 @@
 #include "request_queue.h"
 #include "remove_duplicates.h"
 #include "process_queries.h"
+#include "allocation_hooks.h"
 
 #include <random>
 
@@ -18,11 +19,11 @@ int main() {
 
     #ifdef TESTS
     TestSearchServer();
-    //     ,     
+    // Если вы видите эту строку, значит все тесты прошли успешно
     cout << "Search server testing finished"s << endl << endl;
     #endif // DEBUG    
     
-    //---------------- -----------------------------     
+    //----------------Произвольные тесты-----------------------------     
     {
         //FindingDocumentsTest();
         
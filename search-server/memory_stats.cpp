@@ -0,0 +1,14 @@
+#include "memory_stats.h"
+
+using namespace std;
+
+ostream& operator<<(ostream& out, const MemoryStats& stats) {
+    out << "dictionary: "s << stats.dictionary
+        << ", postings: "s << stats.postings
+        << ", document metadata: "s << stats.document_metadata
+        << ", forward index: "s << stats.forward_index
+        << ", filter indexes: "s << stats.filter_indexes
+        << ", stop words: "s << stats.stop_words
+        << ", total: "s << stats.GetTotal();
+    return out;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+// Память индекса поискового сервера по структурам, в байтах.
+// Учитываются узлы деревьев, строки вне буфера короткой строки и ёмкость векторов;
+// служебные данные распределителя памяти не учитываются
+struct MemoryStats {
+    size_t dictionary = 0;         // словарь: узлы слов и строки слов
+    size_t postings = 0;           // списки вхождений вместе с позициями слов
+    size_t document_metadata = 0;  // рейтинг, статус и длина документов, список id
+    size_t forward_index = 0;      // слова и частоты слов каждого документа
+    size_t filter_indexes = 0;     // битовые карты статусов и рейтингов для фильтров
+    size_t stop_words = 0;
+
+    size_t GetTotal() const {
+        return dictionary + postings + document_metadata + forward_index + filter_indexes + stop_words;
+    }
+};
+
+std::ostream& operator<<(std::ostream& out, const MemoryStats& stats);
+
+// Служебная часть узла std::map и std::set: цвет и три указателя
+const size_t TREE_NODE_OVERHEAD = 4 * sizeof(void*);
+
+template <typename Value>
+constexpr size_t GetTreeNodeMemory() {
+    return TREE_NODE_OVERHEAD + sizeof(Value);
+}
+
+// Память строки вне объекта: короткие строки хранятся в самом объекте
+inline size_t GetStringHeapMemory(const std::string& text) {
+    const char* data = text.data();
+    const char* object = reinterpret_cast<const char*>(&text);
+    if (data >= object && data < object + sizeof(text)) {
+        return 0;
+    }
+    return text.capacity() + 1;
+}
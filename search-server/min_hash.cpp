@@ -0,0 +1,217 @@
+#include "min_hash.h"
+
+#include <algorithm>
+#include <cmath>
+#include <execution>
+#include <functional>
+#include <limits>
+#include <random>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+    // Перемешивание битов (финализатор splitmix64), из одного хэша слова получаем семейство хэш-функций
+    uint64_t Mix(uint64_t value) {
+        value += 0x9e3779b97f4a7c15ULL;
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+        return value ^ (value >> 31);
+    }
+
+    // Зерна хэш-функций фиксированы, чтобы сигнатуры были воспроизводимы между запусками
+    const MinHashSignature& GetSeeds() {
+        static const MinHashSignature seeds = [] {
+            mt19937_64 generator(20220801);
+            MinHashSignature result;
+            for (uint64_t& seed : result) {
+                seed = generator();
+            }
+            return result;
+        }();
+        return seeds;
+    }
+}
+
+MinHashIndex::MinHashIndex(double threshold)
+    : threshold_(threshold) {
+    if (threshold <= 0.0 || threshold > 1.0) {
+        throw invalid_argument("threshold must be in (0, 1]");
+    }
+
+    // Ищем разбиение с порогом LSH не выше заданного: лишних кандидатов отсеет проверка по Жаккару,
+    // а пропущенные пары уже не найти
+    band_count_ = MIN_HASH_SIGNATURE_SIZE;
+    rows_in_band_ = 1;
+    for (size_t bands = 1; bands <= MIN_HASH_SIGNATURE_SIZE; ++bands) {
+        if (MIN_HASH_SIGNATURE_SIZE % bands != 0) {
+            continue;
+        }
+        const size_t rows = MIN_HASH_SIGNATURE_SIZE / bands;
+        const double lsh_threshold = pow(1.0 / bands, 1.0 / rows);
+        if (lsh_threshold <= threshold) {
+            band_count_ = bands;
+            rows_in_band_ = rows;
+            break;
+        }
+    }
+    bands_.resize(band_count_);
+}
+
+void MinHashIndex::Update(const SearchServer& search_server) {
+    // Удалённые из поисковой системы документы
+    vector<int> removed_ids;
+    auto server_it = search_server.begin();
+    for (const auto& [document_id, _] : documents_) {
+        while (server_it != search_server.end() && *server_it < document_id) {
+            ++server_it;
+        }
+        if (server_it == search_server.end() || *server_it != document_id) {
+            removed_ids.push_back(document_id);
+        }
+    }
+    for (const int document_id : removed_ids) {
+        RemoveDocument(document_id);
+    }
+
+    // Новые документы, для которых ещё нет сигнатуры, и документы, заменённые под тем же id
+    vector<int> added_ids;
+    vector<uint64_t> added_versions;
+    for (const int document_id : search_server) {
+        const uint64_t version = search_server.GetDocumentVersion(document_id);
+        const auto document_it = documents_.find(document_id);
+        if (document_it != documents_.end() && document_it->second.version == version) {
+            continue;
+        }
+        if (document_it != documents_.end()) {
+            RemoveDocument(document_id);
+        }
+        added_ids.push_back(document_id);
+        added_versions.push_back(version);
+    }
+
+    vector<MinHashSignature> added_signatures(added_ids.size());
+    transform(
+        execution::par,
+        added_ids.begin(), added_ids.end(),
+        added_signatures.begin(),
+        [&search_server](int document_id) {
+            return ComputeSignature(search_server.GetWordFrequencies(document_id));
+        }
+    );
+
+    for (size_t i = 0; i < added_ids.size(); ++i) {
+        documents_.emplace(added_ids[i], IndexedDocument{ added_signatures[i], added_versions[i] });
+        InsertIntoBands(added_ids[i], added_signatures[i]);
+    }
+}
+
+void MinHashIndex::AddDocument(int document_id, const map<string, double>& word_freqs, uint64_t version) {
+    if (documents_.count(document_id)) {
+        RemoveDocument(document_id);
+    }
+    const auto [it, _] = documents_.emplace(document_id, IndexedDocument{ ComputeSignature(word_freqs), version });
+    InsertIntoBands(document_id, it->second.signature);
+}
+
+void MinHashIndex::RemoveDocument(int document_id) {
+    const auto document_it = documents_.find(document_id);
+    if (document_it == documents_.end()) {
+        return;
+    }
+
+    for (size_t band = 0; band < band_count_; ++band) {
+        auto bucket_it = bands_[band].find(ComputeBandHash(document_it->second.signature, band));
+        if (bucket_it == bands_[band].end()) {
+            continue;
+        }
+        vector<int>& bucket = bucket_it->second;
+        bucket.erase(remove(bucket.begin(), bucket.end(), document_id), bucket.end());
+        if (bucket.empty()) {
+            bands_[band].erase(bucket_it);
+        }
+    }
+    documents_.erase(document_it);
+}
+
+vector<pair<int, int>> MinHashIndex::FindCandidatePairs() const {
+    vector<pair<int, int>> result;
+    for (const auto& band : bands_) {
+        for (const auto& [_, bucket] : band) {
+            for (size_t i = 0; i < bucket.size(); ++i) {
+                for (size_t j = i + 1; j < bucket.size(); ++j) {
+                    result.push_back(minmax(bucket[i], bucket[j]));
+                }
+            }
+        }
+    }
+    // Одна и та же пара могла совпасть в нескольких полосах
+    sort(result.begin(), result.end());
+    result.erase(unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+double MinHashIndex::GetThreshold() const {
+    return threshold_;
+}
+
+size_t MinHashIndex::GetBandCount() const {
+    return band_count_;
+}
+
+size_t MinHashIndex::GetDocumentCount() const {
+    return documents_.size();
+}
+
+MinHashSignature MinHashIndex::ComputeSignature(const map<string, double>& word_freqs) {
+    const MinHashSignature& seeds = GetSeeds();
+
+    MinHashSignature signature;
+    signature.fill(numeric_limits<uint64_t>::max());
+    for (const auto& [word, _] : word_freqs) {
+        const uint64_t word_hash = hash<string>{}(word);
+        for (size_t i = 0; i < MIN_HASH_SIGNATURE_SIZE; ++i) {
+            signature[i] = min(signature[i], Mix(word_hash ^ seeds[i]));
+        }
+    }
+    return signature;
+}
+
+uint64_t MinHashIndex::ComputeBandHash(const MinHashSignature& signature, size_t band) const {
+    uint64_t result = band;
+    for (size_t row = band * rows_in_band_; row < (band + 1) * rows_in_band_; ++row) {
+        result = Mix(result ^ signature[row]);
+    }
+    return result;
+}
+
+void MinHashIndex::InsertIntoBands(int document_id, const MinHashSignature& signature) {
+    for (size_t band = 0; band < band_count_; ++band) {
+        bands_[band][ComputeBandHash(signature, band)].push_back(document_id);
+    }
+}
+
+double ComputeJaccardSimilarity(const map<string, double>& lhs, const map<string, double>& rhs) {
+    if (lhs.empty() && rhs.empty()) {
+        return 1.0;
+    }
+
+    // Слова в частотном словаре документа отсортированы, поэтому пересечение считаем слиянием
+    size_t intersection = 0;
+    auto lhs_it = lhs.begin();
+    auto rhs_it = rhs.begin();
+    while (lhs_it != lhs.end() && rhs_it != rhs.end()) {
+        if (lhs_it->first < rhs_it->first) {
+            ++lhs_it;
+        }
+        else if (rhs_it->first < lhs_it->first) {
+            ++rhs_it;
+        }
+        else {
+            ++intersection;
+            ++lhs_it;
+            ++rhs_it;
+        }
+    }
+    return static_cast<double>(intersection) / (lhs.size() + rhs.size() - intersection);
+}
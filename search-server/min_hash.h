@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "search_server.h"
+
+// Длина MinHash сигнатуры документа (кол-во независимых хэш-функций)
+const size_t MIN_HASH_SIGNATURE_SIZE = 128;
+
+using MinHashSignature = std::array<uint64_t, MIN_HASH_SIGNATURE_SIZE>;
+
+// Индекс MinHash сигнатур документов с LSH разбиением сигнатур на полосы (bands).
+// Документы, у которых совпала хотя бы одна полоса, становятся кандидатами в почти-дубликаты,
+// что позволяет не сравнивать все пары документов между собой.
+// Сигнатуры хранятся между вызовами и пересчитываются только для новых и изменённых документов:
+// AddDocument и RemoveDocument меняют индекс по одному документу, Update сверяет его с сервером.
+class MinHashIndex {
+public:
+    // Кол-во полос и строк в полосе подбирается так, чтобы порог срабатывания LSH (1/b)^(1/r)
+    // был как можно ближе к заданному порогу сходства Жаккара
+    explicit MinHashIndex(double threshold);
+
+    // Синхронизирует индекс с поисковой системой: считает сигнатуры добавленных документов
+    // (параллельно) и забывает удалённые. Документ, удалённый и добавленный заново под тем же id,
+    // распознаётся по номеру добавления (SearchServer::GetDocumentVersion): вызов сверяет id и номера
+    // всех документов, но слова читает только у новых и изменённых
+    void Update(const SearchServer& search_server);
+
+    // version - номер добавления документа на сервере; 0 - неизвестен, Update пересчитает сигнатуру
+    void AddDocument(int document_id, const std::map<std::string, double>& word_freqs, uint64_t version = 0);
+    void RemoveDocument(int document_id);
+
+    // Пары документов (first < second), совпавшие хотя бы в одной полосе
+    std::vector<std::pair<int, int>> FindCandidatePairs() const;
+
+    double GetThreshold() const;
+    size_t GetBandCount() const;
+    size_t GetDocumentCount() const;
+
+    static MinHashSignature ComputeSignature(const std::map<std::string, double>& word_freqs);
+
+private:
+    struct IndexedDocument {
+        MinHashSignature signature;
+        uint64_t version;
+    };
+
+    double threshold_;
+    size_t band_count_;
+    size_t rows_in_band_;
+
+    std::map<int, IndexedDocument> documents_; // [document_id, сигнатура и номер добавления]
+    // Для каждой полосы: [хэш полосы, документы с таким хэшем]
+    std::vector<std::unordered_map<uint64_t, std::vector<int>>> bands_;
+
+    uint64_t ComputeBandHash(const MinHashSignature& signature, size_t band) const;
+    void InsertIntoBands(int document_id, const MinHashSignature& signature);
+};
+
+// Сходство Жаккара двух документов по множествам их слов
+double ComputeJaccardSimilarity(const std::map<std::string, double>& lhs, const std::map<std::string, double>& rhs);
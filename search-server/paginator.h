@@ -1,8 +1,14 @@
 #pragma once
 
 #include <iostream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
-//    IteratorRange    
+// Один объект типа IteratorRange представляет собой одну страницу
 template <typename Iterator>
 class IteratorRange {
 public:
@@ -32,13 +38,13 @@ std::ostream& operator<<(std::ostream& out, const IteratorRange<Iterator> page)
     return out;
 }
 
-//     
+// Класс для вывода результатов страницами
 template <typename Iterator>
 class Paginator {
 public:
-    //   explicit
-    //      Document  
-    //     page_size -      IteratorRange
+    // делать ли explicit
+    // Конструктор разделяет изначальный вектор типа Document на части
+    // каждая часть состоит из page_size кол-ва и представляет собой объект типа IteratorRange
     Paginator(Iterator begin, Iterator end, size_t page_size) {
         for (size_t left = distance(begin, end); left > 0;) {
             const size_t current_page_size = std::min(page_size, left);
@@ -63,3 +69,76 @@ template <typename Container>
 auto Paginate(const Container& c, size_t page_size) {
     return Paginator(std::begin(c), std::end(c), page_size);
 }
+
+// Ленивый вывод результатов страницами: очередная страница запрашивается у источника только при переходе к ней.
+// Источник - функция от курсора (std::nullopt для первой страницы), возвращающая страницу
+// с полями documents и next_cursor (см. SearchPage)
+template <typename PageSource>
+class LazyPaginator {
+public:
+    using Page = std::invoke_result_t<PageSource&, std::nullopt_t>;
+
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = IteratorRange<typename std::vector<typename decltype(Page::documents)::value_type>::const_iterator>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        // Итератор конца
+        Iterator() = default;
+
+        explicit Iterator(PageSource* source)
+            : source_(source),
+            page_((*source)(std::nullopt)) {
+            if (page_.documents.empty()) {
+                source_ = nullptr;
+            }
+        }
+
+        value_type operator*() const {
+            return { page_.documents.begin(), page_.documents.end() };
+        }
+
+        Iterator& operator++() {
+            if (!page_.next_cursor) {
+                source_ = nullptr;
+                return *this;
+            }
+            page_ = (*source_)(page_.next_cursor);
+            if (page_.documents.empty()) {
+                source_ = nullptr;
+            }
+            return *this;
+        }
+
+        // Сравнение имеет смысл только с итератором конца
+        bool operator==(const Iterator& other) const { return source_ == other.source_; }
+
+        bool operator!=(const Iterator& other) const { return !(*this == other); }
+
+    private:
+        PageSource* source_ = nullptr;
+        Page page_;
+    };
+
+    explicit LazyPaginator(PageSource source)
+        : source_(std::move(source)) {
+    }
+
+    Iterator begin() { return Iterator(&source_); }
+
+    Iterator end() { return Iterator(); }
+
+private:
+    PageSource source_;
+};
+
+// Постраничный обход результатов поиска по курсору (FindDocumentsPage), страницы вычисляются по мере обхода
+template <typename Server>
+auto PaginateSearch(const Server& server, std::string raw_query, size_t page_size) {
+    return LazyPaginator([&server, raw_query = std::move(raw_query), page_size](const auto& cursor) {
+        return server.FindDocumentsPage(raw_query, page_size, cursor);
+    });
+}
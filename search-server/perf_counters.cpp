@@ -0,0 +1,198 @@
+#include "perf_counters.h"
+
+#include <iomanip>
+#include <mutex>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+    const string_view PERF_EVENT_NAMES[PERF_EVENT_COUNT] = {
+        "cycles"sv,
+        "instructions"sv,
+        "llc_misses"sv,
+        "branch_misses"sv,
+        "dtlb_misses"sv,
+    };
+
+#ifdef __linux__
+    int OpenCounter(uint32_t type, uint64_t config) {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        // Только пользовательский код: так счётчики доступны при perf_event_paranoid = 2
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        // Текущий поток на любом процессоре
+        const long descriptor = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        return static_cast<int>(descriptor);
+    }
+
+    uint64_t CacheMissConfig(uint64_t cache) {
+        return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+#endif
+}
+
+string_view GetPerfEventName(PerfEvent event) {
+    return PERF_EVENT_NAMES[static_cast<size_t>(event)];
+}
+
+//---------------------------- Показания ----------------------------
+
+bool PerfSample::IsAnyAvailable() const {
+    for (const bool is_available : available) {
+        if (is_available) {
+            return true;
+        }
+    }
+    return false;
+}
+
+PerfSample& PerfSample::operator+=(const PerfSample& other) {
+    for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+        available[i] = available[i] && other.available[i];
+        values[i] = available[i] ? values[i] + other.values[i] : 0;
+    }
+    return *this;
+}
+
+PerfSample operator-(const PerfSample& end, const PerfSample& start) {
+    PerfSample result;
+    for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+        result.available[i] = end.available[i] && start.available[i];
+        // Масштабированные показания могут немного убывать при мультиплексировании
+        result.values[i] = result.available[i] && end.values[i] > start.values[i] ? end.values[i] - start.values[i] : 0;
+    }
+    return result;
+}
+
+//---------------------------- Счётчики потока ----------------------------
+
+PerfCounters::PerfCounters() {
+    descriptors_.fill(-1);
+#ifdef __linux__
+    descriptors_[static_cast<size_t>(PerfEvent::CYCLES)] = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    descriptors_[static_cast<size_t>(PerfEvent::INSTRUCTIONS)] = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    descriptors_[static_cast<size_t>(PerfEvent::LLC_MISSES)] = OpenCounter(PERF_TYPE_HW_CACHE, CacheMissConfig(PERF_COUNT_HW_CACHE_LL));
+    descriptors_[static_cast<size_t>(PerfEvent::BRANCH_MISSES)] = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    descriptors_[static_cast<size_t>(PerfEvent::DTLB_MISSES)] = OpenCounter(PERF_TYPE_HW_CACHE, CacheMissConfig(PERF_COUNT_HW_CACHE_DTLB));
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+    for (const int descriptor : descriptors_) {
+        if (descriptor >= 0) {
+            close(descriptor);
+        }
+    }
+#endif
+}
+
+const PerfCounters& PerfCounters::ForCurrentThread() {
+    static thread_local const PerfCounters counters;
+    return counters;
+}
+
+PerfSample PerfCounters::Read() const {
+    PerfSample sample;
+#ifdef __linux__
+    for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+        if (descriptors_[i] < 0) {
+            continue;
+        }
+        // value, time_enabled, time_running
+        uint64_t data[3];
+        if (read(descriptors_[i], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data))) {
+            continue;
+        }
+        sample.available[i] = true;
+        if (data[2] == 0) {
+            sample.values[i] = 0;
+        }
+        else if (data[2] == data[1]) {
+            sample.values[i] = data[0];
+        }
+        else {
+            sample.values[i] = static_cast<uint64_t>(static_cast<double>(data[0]) * data[1] / data[2]);
+        }
+    }
+#endif
+    return sample;
+}
+
+//---------------------------- Агрегирование ----------------------------
+
+namespace {
+    mutex& GetMetricsMutex() {
+        static mutex metrics_mutex;
+        return metrics_mutex;
+    }
+
+    map<string, PerfMetrics::Totals, less<>>& GetMetrics() {
+        static map<string, PerfMetrics::Totals, less<>> metrics;
+        return metrics;
+    }
+}
+
+void PerfMetrics::Add(string_view operation, const PerfSample& delta) {
+    lock_guard guard(GetMetricsMutex());
+    auto& metrics = GetMetrics();
+    auto it = metrics.find(operation);
+    if (it == metrics.end()) {
+        it = metrics.emplace(string(operation), Totals{ 0, delta }).first;
+    }
+    else {
+        it->second.sum += delta;
+    }
+    ++it->second.calls;
+}
+
+map<string, PerfMetrics::Totals, less<>> PerfMetrics::GetSnapshot() {
+    lock_guard guard(GetMetricsMutex());
+    return GetMetrics();
+}
+
+void PerfMetrics::Reset() {
+    lock_guard guard(GetMetricsMutex());
+    GetMetrics().clear();
+}
+
+void PerfMetrics::PrintSummary(ostream& out) {
+    out << left << setw(24) << "operation"s << right << setw(10) << "calls"s;
+    for (const string_view name : PERF_EVENT_NAMES) {
+        out << setw(16) << name;
+    }
+    out << setw(8) << "ipc"s << '\n';
+
+    for (const auto& [operation, totals] : GetSnapshot()) {
+        out << left << setw(24) << operation << right << setw(10) << totals.calls;
+        for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+            if (totals.sum.available[i]) {
+                out << setw(16) << totals.sum.values[i] / totals.calls;
+            }
+            else {
+                out << setw(16) << "n/a"s;
+            }
+        }
+        const PerfSample& sum = totals.sum;
+        if (sum.IsAvailable(PerfEvent::CYCLES) && sum.IsAvailable(PerfEvent::INSTRUCTIONS) && sum.Get(PerfEvent::CYCLES) > 0) {
+            out << setw(8) << fixed << setprecision(2)
+                << static_cast<double>(sum.Get(PerfEvent::INSTRUCTIONS)) / sum.Get(PerfEvent::CYCLES);
+            out.unsetf(ios_base::floatfield);
+        }
+        else {
+            out << setw(8) << "n/a"s;
+        }
+        out << '\n';
+    }
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+#include <string_view>
+
+// Аппаратные счётчики процессора, собираемые через perf_event_open (только Linux)
+enum class PerfEvent {
+    CYCLES,
+    INSTRUCTIONS,
+    LLC_MISSES,    // промахи последнего уровня кэша при чтении
+    BRANCH_MISSES,
+    DTLB_MISSES,   // промахи TLB данных при чтении
+};
+
+const size_t PERF_EVENT_COUNT = 5;
+
+std::string_view GetPerfEventName(PerfEvent event);
+
+// Значения счётчиков. Счётчик, который не удалось открыть, помечен недоступным и равен нулю
+struct PerfSample {
+    std::array<uint64_t, PERF_EVENT_COUNT> values{};
+    std::array<bool, PERF_EVENT_COUNT> available{};
+
+    uint64_t Get(PerfEvent event) const {
+        return values[static_cast<size_t>(event)];
+    }
+
+    bool IsAvailable(PerfEvent event) const {
+        return available[static_cast<size_t>(event)];
+    }
+
+    bool IsAnyAvailable() const;
+
+    // Сумма выборок, доступны счётчики, доступные в обеих
+    PerfSample& operator+=(const PerfSample& other);
+};
+
+// Разность показаний (конец минус начало)
+PerfSample operator-(const PerfSample& end, const PerfSample& start);
+
+// Счётчики текущего потока. Открываются при первом обращении потока и работают постоянно,
+// замер - разность двух показаний, поэтому замеры могут быть вложенными.
+// Если perf_event_open недоступен (не Linux, контейнер без CAP_PERFMON, perf_event_paranoid),
+// счётчики помечаются недоступными, а показания равны нулю.
+// При мультиплексировании счётчиков ядром значения масштабируются по времени работы счётчика
+class PerfCounters {
+public:
+    static const PerfCounters& ForCurrentThread();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+    ~PerfCounters();
+
+    bool IsAvailable(PerfEvent event) const {
+        return descriptors_[static_cast<size_t>(event)] >= 0;
+    }
+
+    PerfSample Read() const;
+
+private:
+    std::array<int, PERF_EVENT_COUNT> descriptors_;
+
+    PerfCounters();
+};
+
+// Суммы счётчиков по типам операций. Добавление берёт мьютекс, поэтому подходит для замера
+// операций целиком (запрос, добавление документа), а не внутренних циклов
+class PerfMetrics {
+public:
+    struct Totals {
+        uint64_t calls = 0;
+        PerfSample sum;
+    };
+
+    static void Add(std::string_view operation, const PerfSample& delta);
+    static std::map<std::string, Totals, std::less<>> GetSnapshot();
+    static void Reset();
+    // Таблица: операция, кол-во вызовов, среднее каждого счётчика на вызов (n/a - недоступен), IPC
+    static void PrintSummary(std::ostream& out);
+};
+
+// Замер счётчиков от создания до конца блока с добавлением в PerfMetrics
+class ScopedPerfCounters {
+public:
+    explicit ScopedPerfCounters(std::string_view operation)
+        : operation_(operation)
+        , counters_(PerfCounters::ForCurrentThread())
+        , start_(counters_.Read()) {
+    }
+
+    ScopedPerfCounters(const ScopedPerfCounters&) = delete;
+    ScopedPerfCounters& operator=(const ScopedPerfCounters&) = delete;
+
+    ~ScopedPerfCounters() {
+        PerfMetrics::Add(operation_, counters_.Read() - start_);
+    }
+
+private:
+    std::string_view operation_;
+    const PerfCounters& counters_;
+    PerfSample start_;
+};
+
+#define PERF_CONCAT_INTERNAL(X, Y) X##Y
+#define PERF_CONCAT(X, Y) PERF_CONCAT_INTERNAL(X, Y)
+
+/**
+ * Макрос замеряет аппаратные счётчики до конца текущего блока, аналогично LOG_DURATION,
+ * и добавляет их к сумме операции в PerfMetrics. Имя операции должно жить до конца блока.
+ *
+ * Пример использования:
+ *
+ *  for (const string& query : queries) {
+ *      PERF_COUNTERS("find_top_documents"sv);
+ *      search_server.FindTopDocuments(query);
+ *  }
+ *  PerfMetrics::PrintSummary(cerr);
+ */
+#define PERF_COUNTERS(operation) ScopedPerfCounters PERF_CONCAT(perfGuard, __LINE__)(operation)
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Вхождение слова в документ
+struct Posting {
+    int document_id;
+    int document_length; // кол-во слов документа без стоп-слов, занимает выравнивание перед term_freq
+    double term_freq;    // доля слова среди слов документа
+};
+
+// Список документов, содержащих слово, упорядоченный по id документа.
+// Хранится непрерывным вектором: обход не прыгает по узлам дерева,
+// а пересечение списков может использовать галопирующий поиск.
+// Если документы добавляются с позициями слова, позиции хранятся отдельно от вхождений
+// в сжатом виде (разности соседних позиций в формате varint) и читаются только по запросу
+class PostingList {
+public:
+    using const_iterator = std::vector<Posting>::const_iterator;
+
+    // Документы обычно добавляются по возрастанию id, в этом случае вставка - это push_back
+    void Insert(const Posting& posting) {
+        if (postings_.empty() || postings_.back().document_id < posting.document_id) {
+            postings_.push_back(posting);
+            return;
+        }
+        const auto it = LowerBound(posting.document_id);
+        if (it != postings_.end() && it->document_id == posting.document_id) {
+            *it = posting;
+        }
+        else {
+            postings_.insert(it, posting);
+        }
+    }
+
+    // Вставка вхождения вместе с возрастающими позициями слова в документе
+    void Insert(const Posting& posting, const std::vector<int>& positions) {
+        Erase(posting.document_id);
+        const auto it = LowerBound(posting.document_id);
+        const size_t index = it - postings_.begin();
+        postings_.insert(it, posting);
+
+        std::vector<std::uint8_t> encoded;
+        int previous = 0;
+        for (const int position : positions) {
+            // Разности позиций обычно малы и занимают один байт
+            auto delta = static_cast<std::uint32_t>(position - previous);
+            previous = position;
+            while (delta >= 0x80) {
+                encoded.push_back(static_cast<std::uint8_t>(delta | 0x80));
+                delta >>= 7;
+            }
+            encoded.push_back(static_cast<std::uint8_t>(delta));
+        }
+
+        const std::uint32_t offset = index < position_offsets_.size()
+            ? position_offsets_[index]
+            : static_cast<std::uint32_t>(positions_.size());
+        positions_.insert(positions_.begin() + offset, encoded.begin(), encoded.end());
+        position_offsets_.insert(position_offsets_.begin() + index, offset);
+        for (size_t i = index + 1; i < position_offsets_.size(); ++i) {
+            position_offsets_[i] += static_cast<std::uint32_t>(encoded.size());
+        }
+    }
+
+    void Erase(int document_id) {
+        const auto it = LowerBound(document_id);
+        if (it == postings_.end() || it->document_id != document_id) {
+            return;
+        }
+        const size_t index = it - postings_.begin();
+        postings_.erase(it);
+
+        if (index < position_offsets_.size()) {
+            const std::uint32_t begin = position_offsets_[index];
+            const std::uint32_t length = GetPositionsEnd(index) - begin;
+            positions_.erase(positions_.begin() + begin, positions_.begin() + begin + length);
+            position_offsets_.erase(position_offsets_.begin() + index);
+            for (size_t i = index; i < position_offsets_.size(); ++i) {
+                position_offsets_[i] -= length;
+            }
+        }
+    }
+
+    // Хранятся ли позиции для всех вхождений списка
+    bool HasPositions() const {
+        return position_offsets_.size() == postings_.size();
+    }
+
+    // Распаковывает позиции слова для вхождения posting в positions
+    void DecodePositions(const_iterator posting, std::vector<int>& positions) const {
+        positions.clear();
+        const size_t index = posting - postings_.begin();
+        const std::uint8_t* data = positions_.data();
+        int position = 0;
+        for (std::uint32_t i = position_offsets_[index], end = GetPositionsEnd(index); i < end; ) {
+            std::uint32_t delta = 0;
+            for (int shift = 0; ; shift += 7) {
+                const std::uint8_t byte = data[i++];
+                delta |= static_cast<std::uint32_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0) {
+                    break;
+                }
+            }
+            position += static_cast<int>(delta);
+            positions.push_back(position);
+        }
+    }
+
+    // Память, занимаемая позициями, в байтах
+    size_t GetPositionsMemory() const {
+        return positions_.capacity() * sizeof(std::uint8_t) + position_offsets_.capacity() * sizeof(std::uint32_t);
+    }
+
+    // Память списка вместе с позициями, в байтах
+    size_t GetMemory() const {
+        return postings_.capacity() * sizeof(Posting) + GetPositionsMemory();
+    }
+
+    // Освобождает ёмкость, оставшуюся после удаления вхождений
+    void ShrinkToFit() {
+        postings_.shrink_to_fit();
+        positions_.shrink_to_fit();
+        position_offsets_.shrink_to_fit();
+    }
+
+    // Указатель на вхождение документа или nullptr
+    const Posting* Find(int document_id) const {
+        const auto it = LowerBound(document_id);
+        return it != postings_.end() && it->document_id == document_id ? &*it : nullptr;
+    }
+
+    // Первое вхождение с id не меньше document_id
+    const_iterator LowerBound(int document_id) const {
+        return std::lower_bound(postings_.begin(), postings_.end(), document_id,
+            [](const Posting& posting, int id) {
+                return posting.document_id < id;
+            });
+    }
+
+    const_iterator begin() const { return postings_.begin(); }
+
+    const_iterator end() const { return postings_.end(); }
+
+    size_t size() const { return postings_.size(); }
+
+    bool empty() const { return postings_.empty(); }
+
+private:
+    std::vector<Posting> postings_;
+    std::vector<std::uint8_t> positions_;           // сжатые позиции всех вхождений подряд
+    std::vector<std::uint32_t> position_offsets_;   // начало позиций каждого вхождения в positions_
+
+    std::uint32_t GetPositionsEnd(size_t index) const {
+        return index + 1 < position_offsets_.size()
+            ? position_offsets_[index + 1]
+            : static_cast<std::uint32_t>(positions_.size());
+    }
+
+    std::vector<Posting>::iterator LowerBound(int document_id) {
+        return std::lower_bound(postings_.begin(), postings_.end(), document_id,
+            [](const Posting& posting, int id) {
+                return posting.document_id < id;
+            });
+    }
+};
+
+// Галопирующий (экспоненциальный) поиск первого вхождения с id не меньше document_id.
+// Шаг удваивается, пока не перешагнём искомый id, затем бинарный поиск в последнем интервале.
+// При пересечении списков курсор сдвигается на небольшое расстояние, поэтому поиск
+// стоит O(log d), где d - расстояние до результата, а не O(log n)
+inline PostingList::const_iterator GallopLowerBound(PostingList::const_iterator first, PostingList::const_iterator last, int document_id) {
+    if (first == last || first->document_id >= document_id) {
+        return first;
+    }
+    // Инвариант: first->document_id < document_id
+    size_t step = 1;
+    while (step < static_cast<size_t>(last - first) && first[step].document_id < document_id) {
+        first += step;
+        step *= 2;
+    }
+    const auto bound = first + std::min(step, static_cast<size_t>(last - first));
+    return std::lower_bound(first + 1, bound, document_id,
+        [](const Posting& posting, int id) {
+            return posting.document_id < id;
+        });
+}
@@ -12,7 +12,32 @@ vector<vector<Document>> ProcessQueries(
         queries.end(),
         result.begin(),
         [&search_server](const string& query) {
-            return move(search_server.FindTopDocuments(execution::par, query));
+            // Буферы запроса свои у каждого рабочего потока и переиспользуются между запросами
+            thread_local SearchServer::QueryContext context;
+            return search_server.FindTopDocuments(context, query);
+        }
+    );
+
+    return result;
+}
+
+vector<vector<Document>> ProcessQueries(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries,
+    RequestStatistics& statistics) {
+
+    vector<std::vector<Document>> result(queries.size());
+    transform(execution::par,
+        queries.begin(),
+        queries.end(),
+        result.begin(),
+        [&search_server, &statistics](const string& query) {
+            thread_local SearchServer::QueryContext context;
+            const auto start = RequestStatistics::Clock::now();
+            const vector<Document>& documents = search_server.FindTopDocuments(context, query);
+            const auto finish = RequestStatistics::Clock::now();
+            statistics.Record(documents.size(), finish - start, finish);
+            return documents;
         }
     );
 
@@ -37,7 +62,7 @@ std::vector<Document> ProcessQueriesJoined(
         it_to_paste = copy(execution::par, single_query_result.begin(), single_query_result.end(), it_to_paste);
     }
 
-    //       ProcessQueries_result     
+    // Последовательный перебор всех векторов в векторе ProcessQueries_result и добавление в результирующий вектор
     /*vector<Document> result;
     for (vector<Document> vec : ProcessQueries_result) {
         for (Document doc : vec) {
@@ -3,14 +3,22 @@
 #include <execution>
 
 #include "search_server.h"
+#include "request_statistics.h"
 
-//        
-//  vector<Document>      ( FindTopDocuments)
+// Функция распараллеливает обработку нескольких запросов к поисковой системе
+// возвращает vector<Document> для каждого из входных запросов (результат FindTopDocuments)
 std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server,
     const std::vector<std::string>& queries);
 
-//   ProcessQueries,       
+// Аналогична функции ProcessQueries, время выполнения и кол-во результатов каждого запроса
+// записываются в statistics из рабочих потоков
+std::vector<std::vector<Document>> ProcessQueries(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries,
+    RequestStatistics& statistics);
+
+// Аналогична функции ProcessQueries, но возвращает набор документов в плоском виде
 std::vector<Document> ProcessQueriesJoined(
     const SearchServer& search_server,
     const std::vector<std::string>& queries);
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include "query_profile.h"
+
+#include <algorithm>
+
+using namespace std;
+
+void QueryProfiler::AddPlusWord(string_view word, double weight, size_t posting_count, size_t accepted_count) {
+    lock_guard guard(mutex_);
+    profile_.plus_word_postings.push_back({ string(word), weight, posting_count, accepted_count });
+    profile_.postings_visited += posting_count;
+    profile_.predicate_calls += posting_count;
+    AddThreadWork(posting_count);
+}
+
+void QueryProfiler::AddPhrase(size_t document_count) {
+    lock_guard guard(mutex_);
+    profile_.predicate_calls += document_count;
+}
+
+void QueryProfiler::AddMinusWord(string_view word, size_t posting_count, size_t removed_count) {
+    lock_guard guard(mutex_);
+    profile_.minus_word_postings.push_back({ string(word), 1.0, posting_count, removed_count });
+    profile_.postings_visited += posting_count;
+    profile_.removed_by_minus_words += removed_count;
+    AddThreadWork(posting_count);
+}
+
+void QueryProfiler::SetCandidateCount(size_t candidate_count) {
+    lock_guard guard(mutex_);
+    profile_.candidate_count = candidate_count;
+}
+
+void QueryProfiler::SetCandidateCountAfterMinusWords(size_t candidate_count) {
+    lock_guard guard(mutex_);
+    profile_.candidate_count = candidate_count + profile_.removed_by_minus_words;
+}
+
+void QueryProfiler::AddThreadWork(size_t postings_visited) {
+    const thread::id thread_id = this_thread::get_id();
+    auto thread_it = find_if(profile_.threads.begin(), profile_.threads.end(),
+        [thread_id](const QueryProfile::ThreadWork& work) {
+            return work.thread_id == thread_id;
+        });
+    if (thread_it == profile_.threads.end()) {
+        profile_.threads.push_back({ thread_id, 0, 0 });
+        thread_it = prev(profile_.threads.end());
+    }
+    ++thread_it->word_count;
+    thread_it->postings_visited += postings_visited;
+}
+
+ostream& operator<<(ostream& out, const QueryProfile& profile) {
+    auto print_words = [&out](const vector<string>& words) {
+        for (const string& word : words) {
+            out << ' ' << word;
+        }
+        out << '\n';
+    };
+    out << "plus words:"s;
+    print_words(profile.plus_words);
+    out << "minus words:"s;
+    print_words(profile.minus_words);
+
+    for (const auto& word : profile.plus_word_postings) {
+        out << "  + "s << word.word << " (weight "s << word.weight << "): "s
+            << word.posting_count << " postings, "s << word.accepted_count << " accepted\n"s;
+    }
+    for (const auto& word : profile.minus_word_postings) {
+        out << "  - "s << word.word << ": "s << word.posting_count << " postings, "s << word.accepted_count << " removed\n"s;
+    }
+
+    out << "postings visited: "s << profile.postings_visited
+        << ", predicate calls: "s << profile.predicate_calls
+        << ", candidates: "s << profile.candidate_count
+        << ", removed by minus words: "s << profile.removed_by_minus_words
+        << ", results: "s << profile.result_count << '\n';
+    out << "time (ns): parse "s << profile.parse_time.count()
+        << ", scoring "s << profile.scoring_time.count()
+        << ", minus words "s << profile.minus_words_time.count()
+        << ", collect "s << profile.collect_time.count()
+        << ", select "s << profile.select_time.count() << '\n';
+    for (const auto& work : profile.threads) {
+        out << "  thread "s << work.thread_id << ": "s << work.word_count << " words, "s
+            << work.postings_visited << " postings\n"s;
+    }
+    return out;
+}
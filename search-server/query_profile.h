@@ -0,0 +1,113 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Профиль выполнения запроса (EXPLAIN): что было разобрано, сколько работы сделано на каждом этапе и сколько это заняло
+struct QueryProfile {
+    // Слово запроса и его список документов
+    struct WordProfile {
+        std::string word;
+        double weight = 1.0;         // множитель релевантности (меньше 1 у похожих слов нечёткого поиска)
+        size_t posting_count = 0;    // длина списка документов слова
+        size_t accepted_count = 0;   // для плюс слов - вхождения, прошедшие предикат; для минус слов - вычеркнутые документы
+    };
+
+    // Работа одного потока при параллельном поиске
+    struct ThreadWork {
+        std::thread::id thread_id;
+        size_t word_count = 0;
+        size_t postings_visited = 0;
+    };
+
+    std::vector<std::string> plus_words;
+    std::vector<std::string> minus_words;
+    std::vector<WordProfile> plus_word_postings;   // в порядке обработки
+    std::vector<WordProfile> minus_word_postings;
+
+    size_t postings_visited = 0;
+    size_t predicate_calls = 0;
+    size_t candidate_count = 0;          // документы, набравшие релевантность
+    size_t removed_by_minus_words = 0;
+    size_t result_count = 0;
+
+    std::chrono::nanoseconds parse_time{ 0 };
+    std::chrono::nanoseconds scoring_time{ 0 };      // накопление релевантности по плюс словам и фразам
+    std::chrono::nanoseconds minus_words_time{ 0 };
+    std::chrono::nanoseconds collect_time{ 0 };      // сборка кандидатов в результат
+    std::chrono::nanoseconds select_time{ 0 };       // выбор лучших документов
+
+    std::vector<ThreadWork> threads; // только для параллельного поиска
+};
+
+std::ostream& operator<<(std::ostream& out, const QueryProfile& profile);
+
+// Профилировщики передаются в поиск параметром шаблона. NullQueryProfiler ничего не делает,
+// его вызовы встраиваются и исчезают, поэтому поиск без профиля не платит за профилирование.
+// Счётчики, нужные только профилю, оптимизатор при этом тоже удаляет
+struct NullQueryProfiler {
+    template <typename Words>
+    void SetQuery(const Words& plus_words, const Words& minus_words) {
+    }
+    void StartPhase() {
+    }
+    void EndPhase(std::chrono::nanoseconds QueryProfile::* phase) {
+    }
+    void AddPlusWord(std::string_view word, double weight, size_t posting_count, size_t accepted_count) {
+    }
+    void AddPhrase(size_t document_count) {
+    }
+    void AddMinusWord(std::string_view word, size_t posting_count, size_t removed_count) {
+    }
+    void SetCandidateCount(size_t candidate_count) {
+    }
+    void SetCandidateCountAfterMinusWords(size_t candidate_count) {
+    }
+};
+
+// Профилировщик, заполняющий QueryProfile. Методы добавления слов можно вызывать из разных потоков,
+// этапы отмечаются из потока, выполняющего запрос
+class QueryProfiler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit QueryProfiler(QueryProfile& profile)
+        : profile_(profile) {
+    }
+
+    template <typename Words>
+    void SetQuery(const Words& plus_words, const Words& minus_words) {
+        profile_.plus_words.assign(plus_words.begin(), plus_words.end());
+        profile_.minus_words.assign(minus_words.begin(), minus_words.end());
+    }
+
+    void StartPhase() {
+        phase_start_ = Clock::now();
+    }
+
+    void EndPhase(std::chrono::nanoseconds QueryProfile::* phase) {
+        profile_.*phase += Clock::now() - phase_start_;
+    }
+
+    void AddPlusWord(std::string_view word, double weight, size_t posting_count, size_t accepted_count);
+    // Фраза: документы, найденные по позициям, проверяются предикатом
+    void AddPhrase(size_t document_count);
+    void AddMinusWord(std::string_view word, size_t posting_count, size_t removed_count);
+    void SetCandidateCount(size_t candidate_count);
+    // Кол-во кандидатов, оставшихся после минус слов (когда минус слова применяются до подсчёта кандидатов)
+    void SetCandidateCountAfterMinusWords(size_t candidate_count);
+
+private:
+    QueryProfile& profile_;
+    Clock::time_point phase_start_;
+    std::mutex mutex_;
+
+    // Учёт работы текущего потока, вызывается под mutex_
+    void AddThreadWork(size_t postings_visited);
+};
@@ -1,6 +1,7 @@
 #pragma once
 #include "search_server.h"
 #include "log_duration.h"
+#include "test_data_generator.h"
 
 #include <iostream>
 #include <random>
@@ -10,48 +11,6 @@
 
 using namespace std;
 
-string GenerateWord(mt19937& generator, int max_length) {
-    const int length = uniform_int_distribution(1, max_length)(generator);
-    string word;
-    word.reserve(length);
-    for (int i = 0; i < length; ++i) {
-        word.push_back(uniform_int_distribution((short)'a', (short)'z')(generator));
-    }
-    return word;
-}
-
-vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length) {
-    vector<string> words;
-    words.reserve(word_count);
-    for (int i = 0; i < word_count; ++i) {
-        words.push_back(GenerateWord(generator, max_length));
-    }
-    sort(words.begin(), words.end());
-    words.erase(unique(words.begin(), words.end()), words.end());
-    return words;
-}
-
-string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int max_word_count) {
-    const int word_count = uniform_int_distribution(1, max_word_count)(generator);
-    string query;
-    for (int i = 0; i < word_count; ++i) {
-        if (!query.empty()) {
-            query.push_back(' ');
-        }
-        query += dictionary[uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
-    }
-    return query;
-}
-
-vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count) {
-    vector<string> queries;
-    queries.reserve(query_count);
-    for (int i = 0; i < query_count; ++i) {
-        queries.push_back(GenerateQuery(generator, dictionary, max_word_count));
-    }
-    return queries;
-}
-
 template <typename ExecutionPolicy>
 void Test(string_view mark, SearchServer search_server, ExecutionPolicy&& policy) {
     LOG_DURATION(mark);
@@ -68,7 +27,7 @@ void TestRemovingDocumentsWithPolicy() {
     mt19937 generator;
     
     const auto dictionary = GenerateDictionary(generator, 10'000, 25);
-    const auto documents = GenerateQueries(generator, dictionary, 10'000, 100);
+    const auto documents = GenerateRandomLengthQueries(generator, dictionary, 10'000, 100);
 
     {
         SearchServer search_server(dictionary[0]);
@@ -87,3 +46,5 @@ void TestRemovingDocumentsWithPolicy() {
         TEST(par);
     }
 }
+
+#undef TEST
\ No newline at end of file
@@ -6,7 +6,7 @@ void RemoveDuplicates(SearchServer& search_server) {
 	vector<int> ids_to_delete;
 	set<set<string>> words_to_document;
 
-	//  id    
+	// Находим id документов которые необходмо удалить
 	for (const int document_id : search_server) {
 		map<string, double> words_freq = search_server.GetWordFrequencies(document_id);
 		set<string> words_in_document;
@@ -14,18 +14,71 @@ void RemoveDuplicates(SearchServer& search_server) {
 			words_in_document.insert(words);
 		}
 
-		//        ,    id  
+		// Если уже документ с таким наобором слов есть, то добавляем его id к удалению
 		if (words_to_document.count(words_in_document)) {
 			ids_to_delete.push_back(document_id);
 		}
-		else { //    ,        words_to_document
+		else { // Если документа не было, до добавляем этот набор слов в контейнер words_to_document
 			words_to_document.insert(words_in_document);
 		}
 	}
 
-	//     
+	// Удаляем ранее найденные дупликаты документов
 	for (const int id : ids_to_delete) {
 		search_server.RemoveDocument(id);
 		cout << "Found duplicate document id " << id << endl;
 	}	
-}
\ No newline at end of file
+}
+
+vector<pair<int, int>> FindNearDuplicates(const SearchServer& search_server, double threshold) {
+	MinHashIndex index(threshold);
+	return FindNearDuplicates(search_server, index);
+}
+
+vector<pair<int, int>> FindNearDuplicates(const SearchServer& search_server, MinHashIndex& index) {
+	index.Update(search_server);
+
+	const vector<pair<int, int>> candidates = index.FindCandidatePairs();
+
+	// Точная проверка кандидатов по сходству Жаккара
+	vector<char> is_duplicate(candidates.size());
+	transform(
+		execution::par,
+		candidates.begin(), candidates.end(),
+		is_duplicate.begin(),
+		[&search_server, threshold = index.GetThreshold()](const pair<int, int>& candidate) {
+			return ComputeJaccardSimilarity(
+				search_server.GetWordFrequencies(candidate.first),
+				search_server.GetWordFrequencies(candidate.second)) >= threshold;
+		}
+	);
+
+	vector<pair<int, int>> result;
+	for (size_t i = 0; i < candidates.size(); ++i) {
+		if (is_duplicate[i]) {
+			result.push_back(candidates[i]);
+		}
+	}
+	return result;
+}
+
+void RemoveNearDuplicates(SearchServer& search_server, double threshold) {
+	MinHashIndex index(threshold);
+	RemoveNearDuplicates(search_server, index);
+}
+
+void RemoveNearDuplicates(SearchServer& search_server, MinHashIndex& index) {
+	// Пары отсортированы по первому id, поэтому документ удаляется только если его "оригинал" сам остался
+	set<int> ids_to_delete;
+	for (const auto& [original_id, duplicate_id] : FindNearDuplicates(search_server, index)) {
+		if (ids_to_delete.count(original_id) == 0) {
+			ids_to_delete.insert(duplicate_id);
+		}
+	}
+
+	for (const int id : ids_to_delete) {
+		search_server.RemoveDocument(id);
+		index.RemoveDocument(id);
+		cout << "Found near duplicate document id " << id << endl;
+	}
+}
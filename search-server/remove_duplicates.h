@@ -1,7 +1,20 @@
 #pragma once
 
 #include "search_server.h"
+#include "min_hash.h"
 
 #include <iostream>
+#include <utility>
+#include <vector>
 
-void RemoveDuplicates(SearchServer& search_server);
\ No newline at end of file
+void RemoveDuplicates(SearchServer& search_server);
+
+// Поиск почти-дубликатов: пары документов (first < second), сходство Жаккара множеств слов
+// которых не меньше threshold. Кандидаты отбираются через MinHash/LSH и проверяются точно
+std::vector<std::pair<int, int>> FindNearDuplicates(const SearchServer& search_server, double threshold);
+// Инкрементальная версия: сигнатуры сохраняются в index и пересчитываются только для новых документов
+std::vector<std::pair<int, int>> FindNearDuplicates(const SearchServer& search_server, MinHashIndex& index);
+
+// Удаляет почти-дубликаты, из каждой пары остаётся документ с меньшим id
+void RemoveNearDuplicates(SearchServer& search_server, double threshold);
+void RemoveNearDuplicates(SearchServer& search_server, MinHashIndex& index);
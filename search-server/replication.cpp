@@ -0,0 +1,313 @@
+#include "replication.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <iterator>
+#include <utility>
+
+using namespace std;
+
+//---------------------------- Журнал ----------------------------
+
+namespace {
+    // Оценка сверху размера записи в ответе FETCH_LOG и FETCH_SNAPSHOT: кадр запроса с заголовками
+    size_t GetEncodedRecordSize(const Request& mutation) {
+        return 32 + mutation.ratings.size() * sizeof(int32_t) + mutation.text.size();
+    }
+}
+
+ReplicationLog::ReplicationLog(size_t max_record_count)
+    : max_record_count_(max_record_count) {
+    if (max_record_count == 0) {
+        throw invalid_argument("replication log must keep at least one record");
+    }
+}
+
+uint64_t ReplicationLog::Append(Request mutation) {
+    if (mutation.type != RequestType::ADD_DOCUMENT && mutation.type != RequestType::REMOVE_DOCUMENT) {
+        throw invalid_argument("only document additions and removals are replicated");
+    }
+    lock_guard guard(mutex_);
+    mutation.request_id = 0;
+    if (mutation.type == RequestType::ADD_DOCUMENT) {
+        documents_[mutation.document_id] = mutation;
+    }
+    else {
+        documents_.erase(mutation.document_id);
+    }
+    records_.push_back(move(mutation));
+    if (records_.size() > max_record_count_) {
+        records_.pop_front();
+    }
+    return ++last_sequence_;
+}
+
+uint64_t ReplicationLog::GetLastSequence() const {
+    lock_guard guard(mutex_);
+    return last_sequence_;
+}
+
+optional<uint64_t> ReplicationLog::Read(uint64_t sequence, size_t max_count, vector<Request>& mutations, size_t max_bytes) const {
+    lock_guard guard(mutex_);
+    const uint64_t first_sequence = last_sequence_ - records_.size() + 1;
+    if (sequence + 1 < first_sequence || sequence > last_sequence_) {
+        return nullopt;
+    }
+    const size_t first = static_cast<size_t>(sequence + 1 - first_sequence);
+    const size_t count = min(max_count, records_.size() - first);
+    size_t bytes = 0;
+    for (size_t i = first; i < first + count; ++i) {
+        bytes += GetEncodedRecordSize(records_[i]);
+        if (i > first && bytes > max_bytes) {
+            break;
+        }
+        mutations.push_back(records_[i]);
+    }
+    return last_sequence_;
+}
+
+ReplicationSnapshot ReplicationLog::GetSnapshot(int after_document_id, size_t max_count, size_t max_bytes) const {
+    lock_guard guard(mutex_);
+    ReplicationSnapshot snapshot;
+    snapshot.sequence = last_sequence_;
+    size_t bytes = 0;
+    for (auto it = documents_.upper_bound(after_document_id); it != documents_.end() && snapshot.documents.size() < max_count; ++it) {
+        bytes += GetEncodedRecordSize(it->second);
+        if (!snapshot.documents.empty() && bytes > max_bytes) {
+            break;
+        }
+        snapshot.documents.push_back(it->second);
+    }
+    return snapshot;
+}
+
+void ReplicationLog::Reset(const ReplicationSnapshot& snapshot) {
+    lock_guard guard(mutex_);
+    records_.clear();
+    last_sequence_ = snapshot.sequence;
+    documents_.clear();
+    for (const Request& addition : snapshot.documents) {
+        documents_[addition.document_id] = addition;
+    }
+}
+
+//---------------------------- Реплика ----------------------------
+
+SearchReplica::SearchReplica(SearchServer& search_server, shared_mutex& server_mutex, const SearchReplicaOptions& options)
+    : search_server_(search_server)
+    , server_mutex_(server_mutex)
+    , options_(options)
+    , caught_up_time_(Clock::now()) {
+    if (options_.batch_size == 0) {
+        throw invalid_argument("replication batch size must be positive");
+    }
+}
+
+SearchReplica::~SearchReplica() {
+    Stop();
+}
+
+void SearchReplica::Start() {
+    if (thread_.joinable()) {
+        throw logic_error("replica is already started");
+    }
+    {
+        lock_guard guard(mutex_);
+        stopping_ = false;
+    }
+    thread_ = thread([this]() {
+        Run();
+    });
+}
+
+void SearchReplica::Stop() {
+    {
+        lock_guard guard(mutex_);
+        stopping_ = true;
+    }
+    stop_requested_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+uint64_t SearchReplica::GetAppliedSequence() const {
+    lock_guard guard(mutex_);
+    return applied_sequence_;
+}
+
+bool SearchReplica::WaitForSequence(uint64_t sequence, chrono::milliseconds timeout) const {
+    unique_lock lock(mutex_);
+    return applied_changed_.wait_for(lock, timeout, [this, sequence]() {
+        return bootstrapped_ && applied_sequence_ >= sequence;
+    });
+}
+
+SearchReplica::Lag SearchReplica::GetLag() const {
+    lock_guard guard(mutex_);
+    Lag lag;
+    if (!bootstrapped_ || applied_sequence_ < primary_sequence_) {
+        lag.records = primary_sequence_ - applied_sequence_;
+        lag.time = Clock::now() - caught_up_time_;
+    }
+    return lag;
+}
+
+SearchReplica::Stats SearchReplica::GetStats() const {
+    lock_guard guard(mutex_);
+    return stats_;
+}
+
+bool SearchReplica::Sleep(chrono::milliseconds duration) {
+    unique_lock lock(mutex_);
+    return !stop_requested_.wait_for(lock, duration, [this]() {
+        return stopping_;
+    });
+}
+
+void SearchReplica::Run() {
+    // После ошибки соединения пауза больше, чем при отсутствии новых записей
+    const chrono::milliseconds RECONNECT_DELAY(100);
+    optional<SearchClient> client;
+    while (true) {
+        uint64_t applied_sequence;
+        bool bootstrapped;
+        {
+            lock_guard guard(mutex_);
+            if (stopping_) {
+                return;
+            }
+            applied_sequence = applied_sequence_;
+            bootstrapped = bootstrapped_;
+        }
+        try {
+            if (!client) {
+                client = SearchClient::Connect(options_.primary);
+                client->SetReceiveTimeout(chrono::seconds(10));
+                client->SetMaxFrameSize(options_.max_frame_size);
+            }
+            if (!bootstrapped) {
+                LoadSnapshot(*client);
+                continue;
+            }
+            Request request;
+            request.type = RequestType::FETCH_LOG;
+            request.sequence = applied_sequence;
+            request.max_count = options_.batch_size;
+            client->Send(move(request));
+            const Response response = client->Receive();
+            if (response.status == ResponseStatus::ERROR) {
+                // Нужные записи вытеснены из журнала первичного сервера
+                LoadSnapshot(*client);
+                continue;
+            }
+            {
+                lock_guard guard(mutex_);
+                primary_sequence_ = max(primary_sequence_, response.sequence);
+            }
+            Apply(response.mutations, applied_sequence + 1);
+            if (response.mutations.empty() && !Sleep(options_.poll_interval)) {
+                return;
+            }
+        }
+        catch (const exception&) {
+            client.reset();
+            {
+                lock_guard guard(mutex_);
+                ++stats_.errors;
+            }
+            if (!Sleep(RECONNECT_DELAY)) {
+                return;
+            }
+        }
+    }
+}
+
+void SearchReplica::LoadSnapshot(SearchClient& client) {
+    ReplicationSnapshot snapshot;
+    for (int after_document_id = -1;;) {
+        Request request;
+        request.type = RequestType::FETCH_SNAPSHOT;
+        request.document_id = after_document_id;
+        request.max_count = options_.batch_size;
+        client.Send(move(request));
+        Response response = client.Receive();
+        if (response.status == ResponseStatus::ERROR) {
+            throw runtime_error(response.error);
+        }
+        // Журнал воспроизводится с номера первой страницы
+        if (after_document_id == -1) {
+            snapshot.sequence = response.sequence;
+        }
+        // Страница может быть короче batch_size из-за ограничения размера ответа, поэтому снимок
+        // заканчивается пустой страницей
+        if (response.mutations.empty()) {
+            break;
+        }
+        after_document_id = response.mutations.back().document_id;
+        move(response.mutations.begin(), response.mutations.end(), back_inserter(snapshot.documents));
+    }
+    {
+        unique_lock lock(server_mutex_);
+        const vector<int> document_ids(search_server_.begin(), search_server_.end());
+        for (const int document_id : document_ids) {
+            search_server_.RemoveDocument(document_id);
+        }
+        for (const Request& addition : snapshot.documents) {
+            ApplyMutation(addition);
+        }
+        if (options_.replication_log != nullptr) {
+            options_.replication_log->Reset(snapshot);
+        }
+    }
+    {
+        lock_guard guard(mutex_);
+        applied_sequence_ = snapshot.sequence;
+        primary_sequence_ = max(primary_sequence_, snapshot.sequence);
+        bootstrapped_ = true;
+        ++stats_.snapshots;
+        if (applied_sequence_ >= primary_sequence_) {
+            caught_up_time_ = Clock::now();
+        }
+    }
+    applied_changed_.notify_all();
+}
+
+void SearchReplica::Apply(const vector<Request>& mutations, uint64_t first_sequence) {
+    if (!mutations.empty()) {
+        unique_lock lock(server_mutex_);
+        for (const Request& mutation : mutations) {
+            ApplyMutation(mutation);
+            if (options_.replication_log != nullptr) {
+                options_.replication_log->Append(mutation);
+            }
+        }
+    }
+    {
+        lock_guard guard(mutex_);
+        applied_sequence_ = first_sequence + mutations.size() - 1;
+        stats_.applied_records += mutations.size();
+        if (applied_sequence_ >= primary_sequence_) {
+            caught_up_time_ = Clock::now();
+        }
+    }
+    applied_changed_.notify_all();
+}
+
+void SearchReplica::ApplyMutation(const Request& mutation) {
+    // Запись, которую не удалось применить, означает расхождение с первичным сервером; она пропускается
+    // и учитывается в ошибках, а номер записи всё равно считается применённым, чтобы не остановить репликацию
+    try {
+        if (mutation.type == RequestType::ADD_DOCUMENT) {
+            search_server_.RemoveDocument(mutation.document_id);
+            search_server_.AddDocument(mutation.document_id, mutation.text, mutation.status, mutation.ratings);
+        }
+        else if (mutation.type == RequestType::REMOVE_DOCUMENT) {
+            search_server_.RemoveDocument(mutation.document_id);
+        }
+    }
+    catch (const invalid_argument&) {
+        lock_guard guard(mutex_);
+        ++stats_.errors;
+    }
+}
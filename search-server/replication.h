@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include "search_server.h"
+#include "search_protocol.h"
+#include "search_client.h"
+
+// Снимок документов сервера (или его страница): добавления документов по возрастанию id
+// и номер последней записи журнала, вошедшей в снимок
+struct ReplicationSnapshot {
+    uint64_t sequence = 0;
+    std::vector<Request> documents;
+};
+
+// Журнал изменений для репликации: запросы ADD_DOCUMENT и REMOVE_DOCUMENT с номерами по порядку (с 1).
+// Хранятся последние max_record_count записей; для снимка журнал ведёт добавления живых документов,
+// то есть хранит тексты документов. Потокобезопасен
+class ReplicationLog {
+public:
+    explicit ReplicationLog(size_t max_record_count = 1'000'000);
+
+    // Добавляет запись, возвращает её номер. Записи добавляются в порядке применения к серверу
+    uint64_t Append(Request mutation);
+    uint64_t GetLastSequence() const;
+    // Дописывает в mutations не больше max_count записей с номерами после sequence и возвращает
+    // номер последней записи журнала. Если нужные записи уже вытеснены - nullopt.
+    // Записи дописываются, пока их размер в ответе не превысит max_bytes, но хотя бы одна:
+    // пачка больших документов не должна выходить за предельный размер кадра
+    std::optional<uint64_t> Read(uint64_t sequence, size_t max_count, std::vector<Request>& mutations,
+        size_t max_bytes = std::numeric_limits<size_t>::max()) const;
+    // Страница снимка: не больше max_count документов с id больше after_document_id, размер - как у Read
+    ReplicationSnapshot GetSnapshot(int after_document_id = -1, size_t max_count = std::numeric_limits<size_t>::max(),
+        size_t max_bytes = std::numeric_limits<size_t>::max()) const;
+    // Журнал продолжает снимок: следующая запись получит номер snapshot.sequence + 1
+    void Reset(const ReplicationSnapshot& snapshot);
+
+private:
+    mutable std::mutex mutex_;
+    size_t max_record_count_;
+    std::deque<Request> records_;
+    uint64_t last_sequence_ = 0;
+    std::map<int, Request> documents_; // [document_id, добавление документа]
+};
+
+struct SearchReplicaOptions {
+    ServiceAddress primary;
+    uint32_t batch_size = 1'000;                  // записей журнала за запрос
+    uint32_t max_frame_size = MAX_FRAME_SIZE;     // как у SearchServiceOptions первичного сервера
+    std::chrono::milliseconds poll_interval{ 2 }; // пауза, когда новых записей нет
+    // Журнал реплики с теми же номерами записей: к ней могут подключаться свои реплики,
+    // и после переключения (SearchService::SetReadOnly(false)) она продолжает журнал первичного
+    ReplicationLog* replication_log = nullptr;
+};
+
+// Реплика поискового сервера: поток забирает у первичного сервера журнал изменений пачками
+// и применяет записи по порядку под исключительной блокировкой server_mutex. Ту же блокировку
+// передают SearchService реплики (SearchServiceOptions::server_mutex), который обслуживает чтение.
+// Реплика начинает со снимка первичного сервера; снимок загружается заново, если нужные записи
+// уже вытеснены из журнала первичного. Снимок читается страницами, каждая на своём номере записи,
+// поэтому после снимка журнал воспроизводится с номера первой страницы. Добавление применяется
+// как замена документа, удаление отсутствующего документа ничего не делает - повторно применённые
+// записи приводят к тому же состоянию, что и на первичном сервере. Разрыв соединения - повторное подключение
+class SearchReplica {
+public:
+    SearchReplica(SearchServer& search_server, std::shared_mutex& server_mutex, const SearchReplicaOptions& options);
+    ~SearchReplica();
+
+    SearchReplica(const SearchReplica&) = delete;
+    SearchReplica& operator=(const SearchReplica&) = delete;
+
+    void Start();
+    void Stop();
+
+    uint64_t GetAppliedSequence() const;
+    // Ждёт применения записи sequence не дольше timeout
+    bool WaitForSequence(uint64_t sequence, std::chrono::milliseconds timeout) const;
+
+    // Отставание от первичного сервера: записи, известные реплике, но ещё не применённые,
+    // и время с момента, когда реплика последний раз применила все известные записи
+    struct Lag {
+        uint64_t records = 0;
+        std::chrono::nanoseconds time{ 0 };
+    };
+    Lag GetLag() const;
+
+    struct Stats {
+        uint64_t applied_records = 0;
+        uint64_t snapshots = 0;
+        uint64_t errors = 0; // ошибки соединения и записи, которые не удалось применить
+    };
+    Stats GetStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    SearchServer& search_server_;
+    std::shared_mutex& server_mutex_;
+    SearchReplicaOptions options_;
+
+    std::thread thread_;
+    mutable std::mutex mutex_;
+    mutable std::condition_variable applied_changed_;
+    std::condition_variable stop_requested_;
+    bool stopping_ = false;
+    uint64_t applied_sequence_ = 0;
+    uint64_t primary_sequence_ = 0;
+    bool bootstrapped_ = false;
+    Clock::time_point caught_up_time_;
+    Stats stats_;
+
+    void Run();
+    void LoadSnapshot(SearchClient& client);
+    void Apply(const std::vector<Request>& mutations, uint64_t first_sequence);
+    void ApplyMutation(const Request& mutation);
+    // Пауза, прерываемая Stop. Возвращает false при остановке
+    bool Sleep(std::chrono::milliseconds duration);
+};
@@ -2,19 +2,20 @@
 
 #include "search_server.h"
 
-//  
+// Очередь запросов: однопоточная, время считается в запросах (один запрос - одна минута).
+// Статистика в реальном времени с записью из нескольких потоков - RequestStatistics (request_statistics.h)
 class RequestQueue {
 public:
     explicit RequestQueue(const SearchServer& search_server)
         : search_server_(search_server) {
     }
-    // ""    ,     
+    // "обёртки" для всех методов поиска, чтобы сохранять результаты для статистики
     template <typename DocumentPredicate>
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate);
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentStatus status);
     std::vector<Document> AddFindRequest(const std::string& raw_query);
 
-    //  -    
+    // Возвращает кол-во пустых звпросов за сутки
     int GetNoResultRequests() const;
 private:
     struct QueryResult {
@@ -28,14 +29,14 @@ private:
     int time_ = 0;
     int num_of_empty_requests_ = 0;
 
-    //         
-    //      
+    // Функция добавляет в очередь результат запроса и время добавления
+    // и производит необходимые операции со временем
     void AddinResult(int results_num);
 };
 
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
-    //   ,       
+    // После поступления запроса, добавляем в очередь результат и время поступления
     std::vector<Document> result = search_server_.FindTopDocuments(raw_query, document_predicate);
     AddinResult(result.size());
 
@@ -0,0 +1,184 @@
+#include "request_statistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+using namespace std;
+
+namespace {
+    atomic<uint64_t> next_statistics_id{ 0 };
+}
+
+//---------------------------- Сводка ----------------------------
+
+uint64_t RequestStatistics::Snapshot::GetRequestCount() const {
+    return request_count_;
+}
+
+uint64_t RequestStatistics::Snapshot::GetEmptyResultCount() const {
+    return empty_result_count_;
+}
+
+double RequestStatistics::Snapshot::GetQueriesPerSecond() const {
+    return request_count_ / covered_seconds_;
+}
+
+chrono::microseconds RequestStatistics::Snapshot::GetLatencyPercentile(double percentile) const {
+    if (request_count_ == 0) {
+        return chrono::microseconds(0);
+    }
+    const uint64_t rank = max<uint64_t>(1, static_cast<uint64_t>(ceil(request_count_ * clamp(percentile, 0.0, 100.0) / 100.0)));
+    uint64_t count = 0;
+    for (size_t bin = 0; bin < LATENCY_BIN_COUNT; ++bin) {
+        count += latency_bins_[bin];
+        if (count >= rank) {
+            return chrono::microseconds(GetLatencyBinUpperBound(bin));
+        }
+    }
+    return chrono::microseconds(GetLatencyBinUpperBound(LATENCY_BIN_COUNT - 1));
+}
+
+//---------------------------- Статистика ----------------------------
+
+RequestStatistics::ThreadRing::ThreadRing(size_t bucket_count)
+    : buckets(new Bucket[bucket_count]) {
+    for (size_t i = 0; i < bucket_count; ++i) {
+        for (auto& bin : buckets[i].latency_bins) {
+            bin.store(0, memory_order_relaxed);
+        }
+    }
+}
+
+RequestStatistics::RequestStatistics(chrono::seconds window)
+    : id_(next_statistics_id.fetch_add(1))
+    , window_seconds_(window.count())
+    // Лишняя корзина - текущая, ещё не закончившаяся секунда
+    , bucket_count_(static_cast<size_t>(window.count()) + 1) {
+    if (window.count() <= 0) {
+        throw invalid_argument("statistics window must be positive");
+    }
+}
+
+void RequestStatistics::Record(size_t result_count, chrono::nanoseconds latency) {
+    Record(result_count, latency, Clock::now());
+}
+
+void RequestStatistics::Record(size_t result_count, chrono::nanoseconds latency, Clock::time_point now) {
+    const int64_t second = ToSecond(now);
+    Bucket& bucket = GetThreadRing().buckets[static_cast<size_t>(second) % bucket_count_];
+
+    if (bucket.second.load(memory_order_relaxed) != second) {
+        // Корзина осталась от прошлого круга: помечаем её недействительной на время обнуления
+        bucket.second.store(-1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        bucket.request_count.store(0, memory_order_relaxed);
+        bucket.empty_result_count.store(0, memory_order_relaxed);
+        for (auto& bin : bucket.latency_bins) {
+            bin.store(0, memory_order_relaxed);
+        }
+        bucket.second.store(second, memory_order_release);
+    }
+
+    bucket.request_count.fetch_add(1, memory_order_relaxed);
+    if (result_count == 0) {
+        bucket.empty_result_count.fetch_add(1, memory_order_relaxed);
+    }
+    bucket.latency_bins[GetLatencyBin(latency)].fetch_add(1, memory_order_relaxed);
+}
+
+RequestStatistics::Snapshot RequestStatistics::GetSnapshot() const {
+    return GetSnapshot(Clock::now());
+}
+
+RequestStatistics::Snapshot RequestStatistics::GetSnapshot(Clock::time_point now) const {
+    Snapshot snapshot;
+    const int64_t current_second = ToSecond(now);
+    // В сводку входят window_seconds_ полных секунд и корзина текущей, ещё не закончившейся секунды
+    const chrono::duration<double> current_second_elapsed = now.time_since_epoch() - chrono::seconds(current_second);
+    snapshot.covered_seconds_ = static_cast<double>(window_seconds_) + current_second_elapsed.count();
+
+    lock_guard guard(rings_mutex_);
+    for (const auto& ring : rings_) {
+        for (size_t i = 0; i < bucket_count_; ++i) {
+            const Bucket& bucket = ring->buckets[i];
+            const int64_t second = bucket.second.load(memory_order_acquire);
+            if (second < 0 || second > current_second || current_second - second > window_seconds_) {
+                continue;
+            }
+
+            const uint64_t request_count = bucket.request_count.load(memory_order_relaxed);
+            const uint64_t empty_result_count = bucket.empty_result_count.load(memory_order_relaxed);
+            array<uint64_t, LATENCY_BIN_COUNT> latency_bins;
+            for (size_t bin = 0; bin < LATENCY_BIN_COUNT; ++bin) {
+                latency_bins[bin] = bucket.latency_bins[bin].load(memory_order_relaxed);
+            }
+            // Корзину начали обнулять во время чтения - её данные уже вне окна
+            atomic_thread_fence(memory_order_acquire);
+            if (bucket.second.load(memory_order_relaxed) != second) {
+                continue;
+            }
+
+            snapshot.request_count_ += request_count;
+            snapshot.empty_result_count_ += empty_result_count;
+            for (size_t bin = 0; bin < LATENCY_BIN_COUNT; ++bin) {
+                snapshot.latency_bins_[bin] += latency_bins[bin];
+            }
+        }
+    }
+    return snapshot;
+}
+
+RequestStatistics::ThreadRing& RequestStatistics::GetThreadRing() {
+    // Кольца потока по id объекта статистики. Id не переиспользуются, поэтому записи уничтоженных
+    // объектов никогда не совпадут. Такие записи удаляются при регистрации нового кольца:
+    // кэш долгоживущего потока не растёт от короткоживущих объектов статистики
+    struct CachedRing {
+        uint64_t statistics_id;
+        ThreadRing* ring;
+        weak_ptr<ThreadRing> owner;
+    };
+    thread_local vector<CachedRing> thread_rings;
+    for (const CachedRing& cached : thread_rings) {
+        if (cached.statistics_id == id_) {
+            return *cached.ring;
+        }
+    }
+
+    thread_rings.erase(remove_if(thread_rings.begin(), thread_rings.end(),
+        [](const CachedRing& cached) {
+            return cached.owner.expired();
+        }), thread_rings.end());
+    lock_guard guard(rings_mutex_);
+    rings_.push_back(make_shared<ThreadRing>(bucket_count_));
+    thread_rings.push_back({ id_, rings_.back().get(), rings_.back() });
+    return *rings_.back();
+}
+
+int64_t RequestStatistics::ToSecond(Clock::time_point time) {
+    return chrono::duration_cast<chrono::seconds>(time.time_since_epoch()).count();
+}
+
+size_t RequestStatistics::GetLatencyBin(chrono::nanoseconds latency) {
+    const uint64_t microseconds = static_cast<uint64_t>(max<int64_t>(0, chrono::duration_cast<chrono::microseconds>(latency).count()));
+    if (microseconds < 4) {
+        return static_cast<size_t>(microseconds);
+    }
+    // Номер старшего бита и два следующих за ним бита
+    int exponent = 0;
+    while ((microseconds >> (exponent + 1)) != 0) {
+        ++exponent;
+    }
+    const size_t sub_bin = static_cast<size_t>((microseconds >> (exponent - 2)) & 3);
+    return min(LATENCY_BIN_COUNT - 1, static_cast<size_t>(exponent - 1) * 4 + sub_bin);
+}
+
+uint64_t RequestStatistics::GetLatencyBinUpperBound(size_t bin) {
+    if (bin < 4) {
+        return bin;
+    }
+    const size_t exponent = bin / 4 + 1;
+    const uint64_t sub_bin = bin % 4;
+    const uint64_t width = uint64_t(1) << (exponent - 2);
+    return (4 + sub_bin) * width + width - 1;
+}
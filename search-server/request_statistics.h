@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+// Статистика запросов в скользящем окне реального времени, пригодная для записи из многих потоков.
+// Окно делится на секундные корзины. У каждого потока своё кольцо корзин, поэтому запись
+// не требует блокировок и сводится к нескольким атомарным инкрементам в корзине текущей секунды.
+// Устаревшая корзина обнуляется при первой записи в новую секунду, читатель пропускает корзины
+// вне окна и корзины, обнулённые во время чтения.
+// Мьютекс берётся только при первой записи потока (регистрация кольца) и при чтении статистики
+class RequestStatistics {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Задержки хранятся в логарифмических интервалах по 4 на каждую степень двойки (микросекунды),
+    // относительная погрешность перцентиля не больше 25%
+    static const size_t LATENCY_BIN_COUNT = 128;
+
+    // Сводка за окно: window полных секунд и прошедшая часть текущей секунды
+    class Snapshot {
+    public:
+        uint64_t GetRequestCount() const;
+        uint64_t GetEmptyResultCount() const;
+        double GetQueriesPerSecond() const;
+        // Верхняя граница интервала, в который попадает перцентиль (percentile от 0 до 100)
+        std::chrono::microseconds GetLatencyPercentile(double percentile) const;
+
+    private:
+        friend class RequestStatistics;
+
+        uint64_t request_count_ = 0;
+        uint64_t empty_result_count_ = 0;
+        double covered_seconds_ = 0.0; // длительность, за которую собраны корзины
+        std::array<uint64_t, LATENCY_BIN_COUNT> latency_bins_{};
+    };
+
+    explicit RequestStatistics(std::chrono::seconds window = std::chrono::seconds(60));
+
+    RequestStatistics(const RequestStatistics&) = delete;
+    RequestStatistics& operator=(const RequestStatistics&) = delete;
+
+    // Запись запроса: кол-во найденных документов и время выполнения. O(1), без блокировок
+    void Record(size_t result_count, std::chrono::nanoseconds latency);
+    void Record(size_t result_count, std::chrono::nanoseconds latency, Clock::time_point now);
+
+    Snapshot GetSnapshot() const;
+    Snapshot GetSnapshot(Clock::time_point now) const;
+
+private:
+    struct Bucket {
+        std::atomic<int64_t> second{ -1 }; // номер секунды, к которой относится корзина
+        std::atomic<uint32_t> request_count{ 0 };
+        std::atomic<uint32_t> empty_result_count{ 0 };
+        std::array<std::atomic<uint32_t>, LATENCY_BIN_COUNT> latency_bins;
+    };
+
+    // Кольцо корзин одного потока, пишет в него только этот поток
+    struct ThreadRing {
+        explicit ThreadRing(size_t bucket_count);
+
+        std::unique_ptr<Bucket[]> buckets;
+    };
+
+    const uint64_t id_; // уникален среди всех объектов статистики, ключ кэша колец потока
+    const int64_t window_seconds_;
+    const size_t bucket_count_;
+
+    mutable std::mutex rings_mutex_;
+    // shared_ptr - чтобы кэш колец потока видел (через weak_ptr), что объект статистики уничтожен
+    std::vector<std::shared_ptr<ThreadRing>> rings_;
+
+    ThreadRing& GetThreadRing();
+
+    static int64_t ToSecond(Clock::time_point time);
+    static size_t GetLatencyBin(std::chrono::nanoseconds latency);
+    static uint64_t GetLatencyBinUpperBound(size_t bin);
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <string>
+
+#include "posting_list.h"
+
+// Статистика коллекции документов, от которой зависит вес слова запроса
+struct CollectionStatistics {
+    int document_count = 0;
+    double average_document_length = 0.0; // среднее кол-во слов документа без стоп-слов
+};
+
+// Статистика слов запроса для согласованного ранжирования коллекции, разбитой на несколько серверов (шардов).
+// Шард отдаёт свою статистику (GetTermStatistics), суммы по всем шардам передаются обратно в поиск,
+// поэтому idf слова и средняя длина документа у всех шардов одинаковы и их релевантности сравнимы
+struct TermStatistics {
+    CollectionStatistics collection;
+    std::map<std::string, size_t, std::less<>> document_freqs; // [word, кол-во документов со словом]
+
+    TermStatistics& operator+=(const TermStatistics& other) {
+        const int document_count = collection.document_count + other.collection.document_count;
+        if (document_count > 0) {
+            collection.average_document_length = (collection.average_document_length * collection.document_count
+                + other.collection.average_document_length * other.collection.document_count) / document_count;
+        }
+        collection.document_count = document_count;
+        for (const auto& [word, document_freq] : other.document_freqs) {
+            document_freqs[word] += document_freq;
+        }
+        return *this;
+    }
+};
+
+// Политики ранжирования задаются параметром шаблона BasicSearchServer.
+// Для каждого слова запроса один раз создаётся WordScorer, затем он вызывается для каждого вхождения слова:
+// вызов не виртуальный и встраивается во внутренний цикл поиска.
+// Индекс от политики не зависит: во вхождении хранятся доля слова в документе и длина документа.
+// weight - множитель релевантности слова (например, штраф за опечатку в нечётком поиске)
+
+// TF-IDF: term_freq * log(N / df)
+struct TfIdfScoring {
+    class WordScorer {
+    public:
+        WordScorer() = default;
+
+        WordScorer(const CollectionStatistics& statistics, size_t document_freq, double weight = 1.0)
+            : inverse_document_freq_(std::log(statistics.document_count * 1.0 / document_freq) * weight) {
+        }
+
+        double operator()(const Posting& posting) const {
+            return posting.term_freq * inverse_document_freq_;
+        }
+
+    private:
+        double inverse_document_freq_ = 0.0;
+    };
+};
+
+// Okapi BM25: idf * f * (k1 + 1) / (f + k1 * (1 - b + b * |D| / avgdl)),
+// где f - кол-во вхождений слова в документ, |D| - длина документа.
+// Нормировка по длине документа сводится к a + c * |D|, коэффициенты считаются один раз на слово запроса
+struct Bm25Scoring {
+    static constexpr double K1 = 1.2;
+    static constexpr double B = 0.75;
+
+    class WordScorer {
+    public:
+        WordScorer() = default;
+
+        WordScorer(const CollectionStatistics& statistics, size_t document_freq, double weight = 1.0)
+            : word_weight_(ComputeInverseDocumentFreq(statistics.document_count, document_freq) * (K1 + 1.0) * weight)
+            , length_norm_base_(K1 * (1.0 - B))
+            , length_norm_per_word_(K1 * B / statistics.average_document_length) {
+        }
+
+        double operator()(const Posting& posting) const {
+            const double word_count = posting.term_freq * posting.document_length;
+            return word_weight_ * word_count / (word_count + length_norm_base_ + length_norm_per_word_ * posting.document_length);
+        }
+
+    private:
+        double word_weight_ = 0.0;
+        double length_norm_base_ = 0.0;
+        double length_norm_per_word_ = 0.0;
+
+        // Вариант idf, не становящийся отрицательным для слов, которые есть в большинстве документов
+        static double ComputeInverseDocumentFreq(int document_count, size_t document_freq) {
+            const double freq = static_cast<double>(document_freq);
+            return std::log(1.0 + (document_count - freq + 0.5) / (freq + 0.5));
+        }
+    };
+};
@@ -0,0 +1,241 @@
+#include "search_aggregator.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#ifdef __linux__
+#include <poll.h>
+#include <cerrno>
+#endif
+
+using namespace std;
+
+SearchAggregator::SearchAggregator(vector<vector<ServiceAddress>> shards, const SearchAggregatorOptions& options)
+    : options_(options) {
+    if (shards.empty()) {
+        throw invalid_argument("aggregator needs at least one shard");
+    }
+    for (vector<ServiceAddress>& replicas : shards) {
+        if (replicas.empty()) {
+            throw invalid_argument("shard without replicas");
+        }
+        Shard shard;
+        shard.idle_clients.resize(replicas.size());
+        shard.replicas = move(replicas);
+        shards_.push_back(move(shard));
+    }
+}
+
+SearchAggregator::Stats SearchAggregator::GetStats() const {
+    return stats_;
+}
+
+SearchClient SearchAggregator::AcquireClient(size_t shard_index, size_t replica_index) {
+    vector<SearchClient>& idle = shards_[shard_index].idle_clients[replica_index];
+    if (!idle.empty()) {
+        SearchClient client = move(idle.back());
+        idle.pop_back();
+        return client;
+    }
+    return SearchClient::StartConnect(shards_[shard_index].replicas[replica_index]);
+}
+
+#ifdef __linux__
+
+vector<optional<Response>> SearchAggregator::Scatter(const vector<optional<Request>>& requests) {
+    using Clock = chrono::steady_clock;
+
+    // Запрос, ожидающий ответа: основной или дублирующий
+    struct Attempt {
+        size_t shard_index;
+        size_t replica_index;
+        bool is_hedge;
+        SearchClient client;
+    };
+
+    vector<optional<Response>> responses(shards_.size());
+    vector<Attempt> attempts;
+    vector<size_t> primary_replicas(shards_.size());
+    vector<bool> hedged(shards_.size(), false);
+    vector<bool> failed(shards_.size(), false); // основной запрос завершился ошибкой соединения
+
+    // Подключение и отправка не ждут сервер: их завершает цикл ожидания ответов
+    auto send = [&](size_t shard_index, size_t replica_index, bool is_hedge) {
+        try {
+            SearchClient client = AcquireClient(shard_index, replica_index);
+            client.Send(*requests[shard_index]);
+            client.TryFlush();
+            attempts.push_back({ shard_index, replica_index, is_hedge, move(client) });
+            return true;
+        }
+        catch (const runtime_error&) {
+            ++stats_.shard_errors;
+            return false;
+        }
+    };
+
+    const auto start = Clock::now();
+    const auto deadline = start + options_.shard_timeout;
+    const auto hedge_time = start + options_.hedge_delay;
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        if (!requests[i]) {
+            continue;
+        }
+        Shard& shard = shards_[i];
+        primary_replicas[i] = shard.next_replica++ % shard.replicas.size();
+        failed[i] = !send(i, primary_replicas[i], false);
+    }
+
+    auto is_waiting = [&](size_t shard_index) {
+        return requests[shard_index] && !responses[shard_index];
+    };
+
+    vector<pollfd> descriptors;
+    while (true) {
+        // Отказавший шард сразу получает дублирующий запрос, остальные - по истечении hedge_delay
+        const auto now = Clock::now();
+        const bool hedge_enabled = options_.hedge_delay.count() > 0;
+        bool hedge_pending = false;
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            if (!is_waiting(i) || hedged[i]) {
+                continue;
+            }
+            if (failed[i] || (hedge_enabled && now >= hedge_time)) {
+                hedged[i] = true;
+                const size_t replica_index = (primary_replicas[i] + 1) % shards_[i].replicas.size();
+                ++stats_.hedged_requests;
+                send(i, replica_index, true);
+            }
+            else if (hedge_enabled) {
+                hedge_pending = true;
+            }
+        }
+
+        // Запросы шардов, уже получивших ответ, не нужны: их соединения закрываются
+        attempts.erase(remove_if(attempts.begin(), attempts.end(),
+            [&](const Attempt& attempt) {
+                return !is_waiting(attempt.shard_index);
+            }), attempts.end());
+        if (attempts.empty() || now >= deadline) {
+            break;
+        }
+
+        const auto wakeup = hedge_pending ? min(deadline, hedge_time) : deadline;
+        const auto wait = chrono::ceil<chrono::milliseconds>(wakeup - now);
+        descriptors.clear();
+        for (const Attempt& attempt : attempts) {
+            const bool is_sending = attempt.client.IsConnecting() || attempt.client.HasUnsentRequests();
+            descriptors.push_back({ attempt.client.GetSocket(), static_cast<short>(is_sending ? POLLIN | POLLOUT : POLLIN), 0 });
+        }
+        const int ready = poll(descriptors.data(), descriptors.size(), static_cast<int>(max<chrono::milliseconds::rep>(wait.count(), 0)));
+        if (ready <= 0) {
+            continue;
+        }
+
+        vector<Attempt> remaining;
+        for (size_t i = 0; i < attempts.size(); ++i) {
+            Attempt& attempt = attempts[i];
+            if (descriptors[i].revents == 0 || !is_waiting(attempt.shard_index)) {
+                remaining.push_back(move(attempt));
+                continue;
+            }
+            try {
+                optional<Response> response = attempt.client.TryReceive();
+                if (!response) {
+                    remaining.push_back(move(attempt));
+                    continue;
+                }
+                responses[attempt.shard_index] = move(response);
+                if (attempt.is_hedge) {
+                    ++stats_.hedge_wins;
+                }
+                shards_[attempt.shard_index].idle_clients[attempt.replica_index].push_back(move(attempt.client));
+            }
+            catch (const runtime_error&) {
+                ++stats_.shard_errors;
+                failed[attempt.shard_index] = failed[attempt.shard_index] || !attempt.is_hedge;
+            }
+            catch (const invalid_argument&) {
+                ++stats_.shard_errors;
+                failed[attempt.shard_index] = failed[attempt.shard_index] || !attempt.is_hedge;
+            }
+        }
+        attempts = move(remaining);
+    }
+
+    // Шард, которому не удалось отправить ни один запрос, уже учтён в ошибках
+    vector<bool> timed_out(shards_.size(), false);
+    for (const Attempt& attempt : attempts) {
+        timed_out[attempt.shard_index] = is_waiting(attempt.shard_index);
+    }
+    stats_.shard_timeouts += count(timed_out.begin(), timed_out.end(), true);
+    return responses;
+}
+
+#else
+
+vector<optional<Response>> SearchAggregator::Scatter(const vector<optional<Request>>&) {
+    throw runtime_error("search aggregator is supported only on Linux");
+}
+
+#endif
+
+namespace {
+    // Ответ шарда с ошибкой означает некорректный запрос, остальные шарды ответили бы так же
+    void CheckResponses(const vector<optional<Response>>& responses) {
+        for (const optional<Response>& response : responses) {
+            if (response && response->status == ResponseStatus::ERROR) {
+                throw invalid_argument(response->error);
+            }
+        }
+    }
+}
+
+AggregatedResult SearchAggregator::FindTopDocuments(string_view raw_query, DocumentStatus status) {
+    ++stats_.queries;
+    AggregatedResult result;
+    result.shard_count = shards_.size();
+
+    // Этап 1: статистика слов запроса со всех шардов
+    Request statistics_request;
+    statistics_request.type = RequestType::GET_TERM_STATISTICS;
+    statistics_request.text = string(raw_query);
+    const vector<optional<Response>> statistics_responses = Scatter(vector<optional<Request>>(shards_.size(), statistics_request));
+    CheckResponses(statistics_responses);
+
+    Request search_request;
+    search_request.type = RequestType::FIND_TOP_DOCUMENTS_WITH_STATISTICS;
+    search_request.text = string(raw_query);
+    search_request.status = status;
+    for (const optional<Response>& response : statistics_responses) {
+        if (response) {
+            search_request.term_statistics += response->term_statistics;
+        }
+    }
+
+    // Этап 2: поиск по общей статистике на шардах, ответивших на первом этапе
+    vector<optional<Request>> search_requests(shards_.size());
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        if (statistics_responses[i]) {
+            search_requests[i] = search_request;
+        }
+    }
+    const vector<optional<Response>> search_responses = Scatter(search_requests);
+    CheckResponses(search_responses);
+
+    for (const optional<Response>& response : search_responses) {
+        if (response) {
+            ++result.answered_shards;
+            result.documents.insert(result.documents.end(), response->documents.begin(), response->documents.end());
+        }
+    }
+    sort(result.documents.begin(), result.documents.end(), SearchServer::IsRankedBefore);
+    if (result.documents.size() > static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT)) {
+        result.documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    }
+    if (result.IsPartial()) {
+        ++stats_.partial_results;
+    }
+    return result;
+}
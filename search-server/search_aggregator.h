@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "search_client.h"
+
+struct SearchAggregatorOptions {
+    // Ожидание ответов шардов на каждом из двух этапов поиска
+    std::chrono::milliseconds shard_timeout{ 200 };
+    // Шарду, не ответившему за это время, отправляется дублирующий запрос, 0 - без дублирования
+    std::chrono::milliseconds hedge_delay{ 20 };
+};
+
+struct AggregatedResult {
+    std::vector<Document> documents;
+    size_t shard_count = 0;
+    size_t answered_shards = 0; // шарды, ответившие на оба этапа
+
+    // Часть шардов не ответила вовремя, выдача собрана по остальным
+    bool IsPartial() const {
+        return answered_shards < shard_count;
+    }
+};
+
+// Распределённый поиск по коллекции, разбитой на шарды - отдельные процессы SearchService.
+// Поиск в два этапа: сначала шарды возвращают статистику слов запроса (GetTermStatistics), суммы
+// рассылаются обратно вместе с запросом, и каждый шард ранжирует по общим idf и средней длине документа.
+// Поэтому релевантности разных шардов сравнимы, а слитая выдача совпадает с выдачей одного сервера
+// со всеми документами (режим QueryMode::ANY_WORD).
+// Шард, не ответивший за shard_timeout, пропускается, результат помечается неполным. Запрос шарду,
+// не ответившему за hedge_delay, дублируется на следующую реплику (или по новому соединению той же),
+// берётся первый ответ - это срезает хвост задержки от медленных шардов.
+// Подключение и отправка запросов не блокируют: недоступный шард не задерживает рассылку остальным,
+// а шард, отказавший в соединении, сразу получает дублирующий запрос.
+// Соединения переиспользуются; соединение с неполученным ответом закрывается.
+// Объект не потокобезопасен: для параллельных запросов нужен агрегатор на поток
+class SearchAggregator {
+public:
+    // shards[i] - реплики i-го шарда. Основной запрос получают реплики по очереди
+    SearchAggregator(std::vector<std::vector<ServiceAddress>> shards, const SearchAggregatorOptions& options = SearchAggregatorOptions());
+
+    // Некорректный запрос (ответ шарда с ошибкой) - исключение invalid_argument
+    AggregatedResult FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL);
+
+    struct Stats {
+        uint64_t queries = 0;
+        uint64_t partial_results = 0;
+        uint64_t shard_timeouts = 0;
+        uint64_t shard_errors = 0;    // ошибки соединения
+        uint64_t hedged_requests = 0;
+        uint64_t hedge_wins = 0;      // дублирующий запрос ответил первым
+    };
+    Stats GetStats() const;
+
+private:
+    struct Shard {
+        std::vector<ServiceAddress> replicas;
+        std::vector<std::vector<SearchClient>> idle_clients; // свободные соединения реплик
+        size_t next_replica = 0;
+    };
+
+    std::vector<Shard> shards_;
+    SearchAggregatorOptions options_;
+    Stats stats_;
+
+    SearchClient AcquireClient(size_t shard_index, size_t replica_index);
+    // Рассылает запросы шардам (nullopt - шард пропускается) и ждёт ответов до таймаута.
+    // Для шарда без ответа - nullopt
+    std::vector<std::optional<Response>> Scatter(const std::vector<std::optional<Request>>& requests);
+};
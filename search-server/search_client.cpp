@@ -0,0 +1,464 @@
+#include "search_client.h"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+using namespace std;
+
+ServiceAddress ParseServiceAddress(string_view address) {
+    ServiceAddress result;
+    if (address.substr(0, 5) == "unix:"sv) {
+        result.unix_path = string(address.substr(5));
+        if (result.unix_path.empty()) {
+            throw invalid_argument("empty unix socket path");
+        }
+        return result;
+    }
+    const size_t colon = address.rfind(':');
+    if (colon == string_view::npos) {
+        throw invalid_argument("address must be host:port or unix:path, got "s + string(address));
+    }
+    if (colon > 0) {
+        result.host = string(address.substr(0, colon));
+    }
+    const string port(address.substr(colon + 1));
+    size_t parsed = 0;
+    int value = -1;
+    try {
+        value = stoi(port, &parsed);
+    }
+    catch (const exception&) {
+    }
+    if (parsed != port.size() || value <= 0 || value > 65535) {
+        throw invalid_argument("invalid port in "s + string(address));
+    }
+    result.port = static_cast<uint16_t>(value);
+    return result;
+}
+
+#ifdef __linux__
+
+namespace {
+    [[noreturn]] void ThrowSystemError(const string& what) {
+        throw runtime_error(what + ": "s + strerror(errno));
+    }
+
+    sockaddr_in MakeTcpAddress(const string& host, uint16_t port) {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        if (inet_pton(AF_INET, host == "localhost"s ? "127.0.0.1" : host.c_str(), &address.sin_addr) != 1) {
+            throw invalid_argument("invalid IPv4 address "s + host);
+        }
+        return address;
+    }
+
+    sockaddr_un MakeUnixAddress(const string& path) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) {
+            throw invalid_argument("unix socket path is too long");
+        }
+        memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        return address;
+    }
+
+    void SetBlocking(int socket_fd) {
+        const int flags = fcntl(socket_fd, F_GETFL);
+        if (flags < 0 || fcntl(socket_fd, F_SETFL, flags & ~O_NONBLOCK) != 0) {
+            ThrowSystemError("fcntl"s);
+        }
+    }
+
+    // Сокет, подключённый к address. Без wait подключение не ждёт ответа сервера:
+    // connecting = true, если оно ещё идёт (сокет остаётся неблокирующим до его завершения)
+    int OpenSocket(const sockaddr* address, socklen_t length, bool wait, bool& connecting) {
+        const int socket_fd = socket(address->sa_family, SOCK_STREAM | SOCK_CLOEXEC | (wait ? 0 : SOCK_NONBLOCK), 0);
+        if (socket_fd < 0) {
+            ThrowSystemError("socket"s);
+        }
+        connecting = false;
+        try {
+            if (connect(socket_fd, address, length) == 0) {
+                if (!wait) {
+                    SetBlocking(socket_fd);
+                }
+            }
+            else if (!wait && errno == EINPROGRESS) {
+                connecting = true;
+            }
+            else {
+                ThrowSystemError("connect"s);
+            }
+        }
+        catch (...) {
+            close(socket_fd);
+            throw;
+        }
+        if (address->sa_family == AF_INET) {
+            // Запросы конвейера отправляются пачкой, алгоритм Нейгла только задерживал бы одиночные запросы
+            const int enable = 1;
+            setsockopt(socket_fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        }
+        return socket_fd;
+    }
+}
+
+SearchClient SearchClient::ConnectTcp(const string& host, uint16_t port) {
+    const sockaddr_in address = MakeTcpAddress(host, port);
+    bool connecting = false;
+    return SearchClient(OpenSocket(reinterpret_cast<const sockaddr*>(&address), sizeof(address), true, connecting));
+}
+
+SearchClient SearchClient::ConnectUnix(const string& path) {
+    const sockaddr_un address = MakeUnixAddress(path);
+    bool connecting = false;
+    return SearchClient(OpenSocket(reinterpret_cast<const sockaddr*>(&address), sizeof(address), true, connecting));
+}
+
+SearchClient SearchClient::StartConnect(const ServiceAddress& address) {
+    int socket_fd = -1;
+    bool connecting = false;
+    if (!address.unix_path.empty()) {
+        const sockaddr_un unix_address = MakeUnixAddress(address.unix_path);
+        socket_fd = OpenSocket(reinterpret_cast<const sockaddr*>(&unix_address), sizeof(unix_address), false, connecting);
+    }
+    else {
+        const sockaddr_in tcp_address = MakeTcpAddress(address.host, address.port);
+        socket_fd = OpenSocket(reinterpret_cast<const sockaddr*>(&tcp_address), sizeof(tcp_address), false, connecting);
+    }
+    SearchClient client(socket_fd);
+    client.connecting_ = connecting;
+    return client;
+}
+
+bool SearchClient::FinishConnect() {
+    if (!connecting_) {
+        return true;
+    }
+    pollfd descriptor{ socket_, POLLOUT, 0 };
+    const int ready = poll(&descriptor, 1, 0);
+    if (ready < 0 && errno != EINTR) {
+        ThrowSystemError("poll"s);
+    }
+    if (ready <= 0) {
+        return false;
+    }
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (getsockopt(socket_, SOL_SOCKET, SO_ERROR, &error, &length) != 0) {
+        ThrowSystemError("getsockopt"s);
+    }
+    if (error != 0) {
+        errno = error;
+        ThrowSystemError("connect"s);
+    }
+    SetBlocking(socket_);
+    connecting_ = false;
+    return true;
+}
+
+SearchClient::~SearchClient() {
+    if (socket_ >= 0) {
+        close(socket_);
+    }
+}
+
+void SearchClient::Flush() {
+    while (!FinishConnect()) {
+        pollfd descriptor{ socket_, POLLOUT, 0 };
+        poll(&descriptor, 1, -1);
+    }
+    size_t offset = 0;
+    while (offset < output_.size()) {
+        const ssize_t written = send(socket_, output_.data() + offset, output_.size() - offset, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError("send"s);
+        }
+        offset += static_cast<size_t>(written);
+    }
+    output_.clear();
+}
+
+Response SearchClient::Receive() {
+    if (pending_.empty()) {
+        throw logic_error("no pending requests");
+    }
+    Flush();
+    while (true) {
+        if (optional<Response> response = ExtractResponse()) {
+            return move(*response);
+        }
+        if (receive_timeout_.count() > 0) {
+            pollfd descriptor{ socket_, POLLIN, 0 };
+            const int ready = poll(&descriptor, 1, static_cast<int>(receive_timeout_.count()));
+            if (ready == 0) {
+                throw runtime_error("receive timeout");
+            }
+            if (ready < 0 && errno != EINTR) {
+                ThrowSystemError("poll"s);
+            }
+            if (ready < 0) {
+                continue;
+            }
+        }
+        char buffer[64 * 1024];
+        const ssize_t received = recv(socket_, buffer, sizeof(buffer), 0);
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError("recv"s);
+        }
+        if (received == 0) {
+            throw runtime_error("connection closed by server");
+        }
+        input_.append(buffer, static_cast<size_t>(received));
+    }
+}
+
+bool SearchClient::TryFlush() {
+    if (!FinishConnect()) {
+        return false;
+    }
+    size_t offset = 0;
+    while (offset < output_.size()) {
+        const ssize_t written = send(socket_, output_.data() + offset, output_.size() - offset, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            ThrowSystemError("send"s);
+        }
+        offset += static_cast<size_t>(written);
+    }
+    output_.erase(0, offset);
+    return output_.empty();
+}
+
+optional<Response> SearchClient::TryReceive() {
+    if (pending_.empty()) {
+        throw logic_error("no pending requests");
+    }
+    if (!FinishConnect()) {
+        return nullopt;
+    }
+    TryFlush();
+    while (true) {
+        if (optional<Response> response = ExtractResponse()) {
+            return response;
+        }
+        char buffer[64 * 1024];
+        const ssize_t received = recv(socket_, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return nullopt;
+            }
+            ThrowSystemError("recv"s);
+        }
+        if (received == 0) {
+            throw runtime_error("connection closed by server");
+        }
+        input_.append(buffer, static_cast<size_t>(received));
+    }
+}
+
+#else
+
+SearchClient SearchClient::ConnectTcp(const string&, uint16_t) {
+    throw runtime_error("search client is supported only on Linux");
+}
+
+SearchClient SearchClient::ConnectUnix(const string&) {
+    throw runtime_error("search client is supported only on Linux");
+}
+
+SearchClient SearchClient::StartConnect(const ServiceAddress&) {
+    throw runtime_error("search client is supported only on Linux");
+}
+
+bool SearchClient::FinishConnect() {
+    return true;
+}
+
+SearchClient::~SearchClient() {
+}
+
+void SearchClient::Flush() {
+}
+
+bool SearchClient::TryFlush() {
+    return true;
+}
+
+Response SearchClient::Receive() {
+    throw runtime_error("search client is supported only on Linux");
+}
+
+optional<Response> SearchClient::TryReceive() {
+    throw runtime_error("search client is supported only on Linux");
+}
+
+#endif
+
+SearchClient::SearchClient(int socket)
+    : socket_(socket) {
+}
+
+SearchClient SearchClient::Connect(const ServiceAddress& address) {
+    return address.unix_path.empty() ? ConnectTcp(address.host, address.port) : ConnectUnix(address.unix_path);
+}
+
+SearchClient::SearchClient(SearchClient&& other) noexcept
+    : socket_(exchange(other.socket_, -1))
+    , next_request_id_(other.next_request_id_)
+    , output_(move(other.output_))
+    , input_(move(other.input_))
+    , pending_(move(other.pending_))
+    , receive_timeout_(other.receive_timeout_)
+    , max_frame_size_(other.max_frame_size_)
+    , connecting_(other.connecting_) {
+}
+
+SearchClient& SearchClient::operator=(SearchClient&& other) noexcept {
+    if (this != &other) {
+        SearchClient moved(move(other));
+        swap(socket_, moved.socket_);
+        swap(next_request_id_, moved.next_request_id_);
+        swap(output_, moved.output_);
+        swap(input_, moved.input_);
+        swap(pending_, moved.pending_);
+        swap(receive_timeout_, moved.receive_timeout_);
+        swap(max_frame_size_, moved.max_frame_size_);
+        swap(connecting_, moved.connecting_);
+    }
+    return *this;
+}
+
+uint32_t SearchClient::Send(Request request) {
+    request.request_id = next_request_id_++;
+    EncodeRequest(request, output_);
+    pending_.push_back(request.type);
+    return request.request_id;
+}
+
+size_t SearchClient::GetPendingCount() const {
+    return pending_.size();
+}
+
+int SearchClient::GetSocket() const {
+    return socket_;
+}
+
+bool SearchClient::IsConnecting() const {
+    return connecting_;
+}
+
+bool SearchClient::HasUnsentRequests() const {
+    return !output_.empty();
+}
+
+optional<Response> SearchClient::ExtractResponse() {
+    string_view payload;
+    const size_t frame_size = ExtractFrame(input_, payload, max_frame_size_);
+    if (frame_size == 0) {
+        return nullopt;
+    }
+    Response response = DecodeResponse(payload, pending_.front());
+    pending_.pop_front();
+    input_.erase(0, frame_size);
+    return response;
+}
+
+void SearchClient::SetReceiveTimeout(chrono::milliseconds timeout) {
+    receive_timeout_ = timeout;
+}
+
+void SearchClient::SetMaxFrameSize(uint32_t max_frame_size) {
+    max_frame_size_ = max_frame_size;
+}
+
+Response SearchClient::Call(Request request) {
+    if (!pending_.empty()) {
+        throw logic_error("synchronous call with pending pipelined requests");
+    }
+    Send(move(request));
+    Response response = Receive();
+    if (response.status == ResponseStatus::ERROR) {
+        throw invalid_argument(response.error);
+    }
+    return response;
+}
+
+void SearchClient::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    Request request;
+    request.type = RequestType::ADD_DOCUMENT;
+    request.document_id = document_id;
+    request.status = status;
+    request.ratings = ratings;
+    request.text = string(document);
+    Call(move(request));
+}
+
+void SearchClient::RemoveDocument(int document_id) {
+    Request request;
+    request.type = RequestType::REMOVE_DOCUMENT;
+    request.document_id = document_id;
+    Call(move(request));
+}
+
+vector<Document> SearchClient::FindTopDocuments(string_view raw_query, QueryMode mode, DocumentStatus status) {
+    Request request;
+    request.type = RequestType::FIND_TOP_DOCUMENTS;
+    request.text = string(raw_query);
+    request.mode = mode;
+    request.status = status;
+    return Call(move(request)).documents;
+}
+
+tuple<vector<string>, DocumentStatus> SearchClient::MatchDocument(string_view raw_query, int document_id) {
+    Request request;
+    request.type = RequestType::MATCH_DOCUMENT;
+    request.text = string(raw_query);
+    request.document_id = document_id;
+    Response response = Call(move(request));
+    return { move(response.words), response.document_status };
+}
+
+TermStatistics SearchClient::GetTermStatistics(string_view raw_query) {
+    Request request;
+    request.type = RequestType::GET_TERM_STATISTICS;
+    request.text = string(raw_query);
+    return move(Call(move(request)).term_statistics);
+}
+
+vector<Document> SearchClient::FindTopDocuments(string_view raw_query, const TermStatistics& statistics, DocumentStatus status) {
+    Request request;
+    request.type = RequestType::FIND_TOP_DOCUMENTS_WITH_STATISTICS;
+    request.text = string(raw_query);
+    request.status = status;
+    request.term_statistics = statistics;
+    return Call(move(request)).documents;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "search_protocol.h"
+
+// Адрес сетевого поискового сервера: TCP-порт или Unix-сокет, если задан unix_path
+struct ServiceAddress {
+    std::string host = "127.0.0.1";
+    uint16_t port = 0;
+    std::string unix_path;
+};
+
+// Разбор адреса: "host:port", ":port" или "unix:path"
+ServiceAddress ParseServiceAddress(std::string_view address);
+
+// Клиент сетевого поискового сервера (SearchService) с блокирующим сокетом, только Linux.
+// Синхронные методы отправляют запрос и ждут ответ; ответ с ошибкой - исключение invalid_argument
+// с текстом ошибки сервера. Для конвейера запросы отправляются Send, а ответы читаются Receive
+// в порядке отправки. Ошибки соединения - исключение runtime_error.
+// Без ожидания работают StartConnect, TryFlush и TryReceive: вместе с poll по GetSocket они позволяют
+// подключаться и обмениваться данными с несколькими серверами в одном потоке
+class SearchClient {
+public:
+    static SearchClient ConnectTcp(const std::string& host, uint16_t port);
+    static SearchClient ConnectUnix(const std::string& path);
+    static SearchClient Connect(const ServiceAddress& address);
+    // Начинает подключение без ожидания. Пока IsConnecting, сокет ждёт готовности к записи (POLLOUT);
+    // подключение завершают FinishConnect, TryFlush или TryReceive, блокирующие методы его дожидаются
+    static SearchClient StartConnect(const ServiceAddress& address);
+    // Без ожидания: false - подключение ещё идёт, отказ в подключении - исключение runtime_error
+    bool FinishConnect();
+    bool IsConnecting() const;
+
+    SearchClient(SearchClient&& other) noexcept;
+    SearchClient& operator=(SearchClient&& other) noexcept;
+    SearchClient(const SearchClient&) = delete;
+    SearchClient& operator=(const SearchClient&) = delete;
+    ~SearchClient();
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void RemoveDocument(int document_id);
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, QueryMode mode = QueryMode::ANY_WORD,
+        DocumentStatus status = DocumentStatus::ACTUAL);
+    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id);
+    TermStatistics GetTermStatistics(std::string_view raw_query);
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, const TermStatistics& statistics,
+        DocumentStatus status = DocumentStatus::ACTUAL);
+
+    // Ставит запрос в буфер отправки, назначает и возвращает id запроса
+    uint32_t Send(Request request);
+    // Отправляет накопленные запросы
+    void Flush();
+    // Без ожидания: отправляет, сколько принимает сокет; true - все запросы отправлены
+    bool TryFlush();
+    bool HasUnsentRequests() const;
+    // Ответ на самый ранний неотвеченный запрос (перед ожиданием отправляет буфер)
+    Response Receive();
+    size_t GetPendingCount() const;
+    // Без ожидания: дописывает запросы, читает пришедшие данные и возвращает ответ, если он получен полностью.
+    // Вместе с GetSocket позволяет ждать ответов нескольких соединений одним poll
+    std::optional<Response> TryReceive();
+    int GetSocket() const;
+
+    // Ожидание ответа дольше timeout - исключение runtime_error, 0 - без ограничения
+    void SetReceiveTimeout(std::chrono::milliseconds timeout);
+    // Ответ больше max_frame_size - исключение invalid_argument; должен совпадать с SearchServiceOptions сервера
+    void SetMaxFrameSize(uint32_t max_frame_size);
+
+private:
+    int socket_;
+    uint32_t next_request_id_ = 1;
+    std::string output_;
+    std::string input_;
+    std::deque<RequestType> pending_; // типы неотвеченных запросов по порядку
+    std::chrono::milliseconds receive_timeout_{ 0 };
+    uint32_t max_frame_size_ = MAX_FRAME_SIZE;
+    bool connecting_ = false;
+
+    explicit SearchClient(int socket);
+    Response Call(Request request);
+    // Ответ из начала буфера приёма, если он пришёл полностью
+    std::optional<Response> ExtractResponse();
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <optional>
+#include <vector>
+
+#include "document.h"
+
+// Курсор постраничного поиска: позиция последнего документа страницы в порядке выдачи
+// (релевантность, округлённая до RELEVANCE_PRECISION, по убыванию, затем рейтинг по убыванию, затем id по возрастанию).
+// Для вызывающего кода курсор непрозрачен: он получается из SearchPage и передаётся в следующий запрос
+struct SearchCursor {
+    double relevance = 0.0;
+    int rating = 0;
+    int document_id = 0;
+};
+
+// Страница результатов поиска. next_cursor пуст, если страница последняя
+struct SearchPage {
+    std::vector<Document> documents;
+    std::optional<SearchCursor> next_cursor;
+};
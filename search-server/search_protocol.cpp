@@ -0,0 +1,346 @@
+#include "search_protocol.h"
+
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+//---------------------------- Запись и чтение полей ----------------------------
+
+void ByteWriter::WriteUint8(uint8_t value) {
+    out_.push_back(static_cast<char>(value));
+}
+
+void ByteWriter::WriteUint32(uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out_.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+void ByteWriter::WriteUint64(uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out_.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+void ByteWriter::WriteInt32(int32_t value) {
+    WriteUint32(static_cast<uint32_t>(value));
+}
+
+void ByteWriter::WriteDouble(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    WriteUint64(bits);
+}
+
+void ByteWriter::WriteString(string_view value) {
+    WriteUint32(static_cast<uint32_t>(value.size()));
+    out_.append(value);
+}
+
+string_view ByteReader::Take(size_t size) {
+    if (data_.size() < size) {
+        throw invalid_argument("truncated message");
+    }
+    const string_view result = data_.substr(0, size);
+    data_.remove_prefix(size);
+    return result;
+}
+
+uint8_t ByteReader::ReadUint8() {
+    return static_cast<uint8_t>(Take(1)[0]);
+}
+
+uint32_t ByteReader::ReadUint32() {
+    const string_view bytes = Take(4);
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(static_cast<uint8_t>(bytes[i])) << (8 * i);
+    }
+    return value;
+}
+
+uint64_t ByteReader::ReadUint64() {
+    const string_view bytes = Take(8);
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(bytes[i])) << (8 * i);
+    }
+    return value;
+}
+
+int32_t ByteReader::ReadInt32() {
+    return static_cast<int32_t>(ReadUint32());
+}
+
+double ByteReader::ReadDouble() {
+    const uint64_t bits = ReadUint64();
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+string_view ByteReader::ReadString() {
+    return Take(ReadUint32());
+}
+
+//---------------------------- Кадры ----------------------------
+
+size_t ExtractFrame(string_view buffer, string_view& payload, uint32_t max_frame_size) {
+    if (buffer.size() < 4) {
+        return 0;
+    }
+    const uint32_t payload_size = ByteReader(buffer.substr(0, 4)).ReadUint32();
+    if (payload_size > max_frame_size) {
+        throw invalid_argument("frame is too large");
+    }
+    if (buffer.size() - 4 < payload_size) {
+        return 0;
+    }
+    payload = buffer.substr(4, payload_size);
+    return 4 + static_cast<size_t>(payload_size);
+}
+
+namespace {
+    DocumentStatus ReadStatus(ByteReader& reader) {
+        const uint8_t status = reader.ReadUint8();
+        if (status > static_cast<uint8_t>(DocumentStatus::REMOVED)) {
+            throw invalid_argument("invalid document status");
+        }
+        return static_cast<DocumentStatus>(status);
+    }
+
+    QueryMode ReadMode(ByteReader& reader) {
+        const uint8_t mode = reader.ReadUint8();
+        if (mode > static_cast<uint8_t>(QueryMode::FUZZY)) {
+            throw invalid_argument("invalid query mode");
+        }
+        return static_cast<QueryMode>(mode);
+    }
+
+    void WriteTermStatistics(ByteWriter& writer, const TermStatistics& statistics) {
+        writer.WriteInt32(statistics.collection.document_count);
+        writer.WriteDouble(statistics.collection.average_document_length);
+        writer.WriteUint32(static_cast<uint32_t>(statistics.document_freqs.size()));
+        for (const auto& [word, document_freq] : statistics.document_freqs) {
+            writer.WriteString(word);
+            writer.WriteUint64(document_freq);
+        }
+    }
+
+    TermStatistics ReadTermStatistics(ByteReader& reader) {
+        TermStatistics statistics;
+        statistics.collection.document_count = reader.ReadInt32();
+        statistics.collection.average_document_length = reader.ReadDouble();
+        const uint32_t count = reader.ReadUint32();
+        for (uint32_t i = 0; i < count; ++i) {
+            string word(reader.ReadString());
+            statistics.document_freqs[move(word)] = reader.ReadUint64();
+        }
+        return statistics;
+    }
+}
+
+//---------------------------- Запросы ----------------------------
+
+void EncodeRequest(const Request& request, string& out) {
+    WriteFrame(out, [&request](ByteWriter& writer) {
+        writer.WriteUint8(static_cast<uint8_t>(request.type));
+        writer.WriteUint32(request.request_id);
+        switch (request.type) {
+        case RequestType::ADD_DOCUMENT:
+            writer.WriteInt32(request.document_id);
+            writer.WriteUint8(static_cast<uint8_t>(request.status));
+            writer.WriteUint32(static_cast<uint32_t>(request.ratings.size()));
+            for (const int rating : request.ratings) {
+                writer.WriteInt32(rating);
+            }
+            writer.WriteString(request.text);
+            break;
+        case RequestType::REMOVE_DOCUMENT:
+            writer.WriteInt32(request.document_id);
+            break;
+        case RequestType::FIND_TOP_DOCUMENTS:
+            writer.WriteString(request.text);
+            writer.WriteUint8(static_cast<uint8_t>(request.mode));
+            writer.WriteUint8(static_cast<uint8_t>(request.status));
+            break;
+        case RequestType::MATCH_DOCUMENT:
+            writer.WriteString(request.text);
+            writer.WriteInt32(request.document_id);
+            break;
+        case RequestType::GET_TERM_STATISTICS:
+            writer.WriteString(request.text);
+            break;
+        case RequestType::FIND_TOP_DOCUMENTS_WITH_STATISTICS:
+            writer.WriteString(request.text);
+            writer.WriteUint8(static_cast<uint8_t>(request.status));
+            WriteTermStatistics(writer, request.term_statistics);
+            break;
+        case RequestType::FETCH_LOG:
+            writer.WriteUint64(request.sequence);
+            writer.WriteUint32(request.max_count);
+            break;
+        case RequestType::FETCH_SNAPSHOT:
+            writer.WriteInt32(request.document_id);
+            writer.WriteUint32(request.max_count);
+            break;
+        }
+    });
+}
+
+Request DecodeRequest(string_view payload) {
+    ByteReader reader(payload);
+    Request request;
+    request.type = static_cast<RequestType>(reader.ReadUint8());
+    request.request_id = reader.ReadUint32();
+    switch (request.type) {
+    case RequestType::ADD_DOCUMENT: {
+        request.document_id = reader.ReadInt32();
+        request.status = ReadStatus(reader);
+        const uint32_t rating_count = reader.ReadUint32();
+        // Кол-во рейтингов проверяется по размеру данных до выделения памяти
+        if (rating_count > payload.size() / 4) {
+            throw invalid_argument("truncated message");
+        }
+        request.ratings.resize(rating_count);
+        for (int& rating : request.ratings) {
+            rating = reader.ReadInt32();
+        }
+        request.text = string(reader.ReadString());
+        break;
+    }
+    case RequestType::REMOVE_DOCUMENT:
+        request.document_id = reader.ReadInt32();
+        break;
+    case RequestType::FIND_TOP_DOCUMENTS:
+        request.text = string(reader.ReadString());
+        request.mode = ReadMode(reader);
+        request.status = ReadStatus(reader);
+        break;
+    case RequestType::MATCH_DOCUMENT:
+        request.text = string(reader.ReadString());
+        request.document_id = reader.ReadInt32();
+        break;
+    case RequestType::GET_TERM_STATISTICS:
+        request.text = string(reader.ReadString());
+        break;
+    case RequestType::FIND_TOP_DOCUMENTS_WITH_STATISTICS:
+        request.text = string(reader.ReadString());
+        request.status = ReadStatus(reader);
+        request.term_statistics = ReadTermStatistics(reader);
+        break;
+    case RequestType::FETCH_LOG:
+        request.sequence = reader.ReadUint64();
+        request.max_count = reader.ReadUint32();
+        break;
+    case RequestType::FETCH_SNAPSHOT:
+        request.document_id = reader.ReadInt32();
+        request.max_count = reader.ReadUint32();
+        break;
+    default:
+        throw invalid_argument("unknown request type");
+    }
+    if (!reader.IsAtEnd()) {
+        throw invalid_argument("unexpected data after request");
+    }
+    return request;
+}
+
+//---------------------------- Ответы ----------------------------
+
+void EncodeResponse(const Response& response, RequestType type, string& out) {
+    WriteFrame(out, [&response, type](ByteWriter& writer) {
+        writer.WriteUint8(static_cast<uint8_t>(response.status));
+        writer.WriteUint32(response.request_id);
+        if (response.status == ResponseStatus::ERROR) {
+            writer.WriteString(response.error);
+            return;
+        }
+        if (type == RequestType::FIND_TOP_DOCUMENTS || type == RequestType::FIND_TOP_DOCUMENTS_WITH_STATISTICS) {
+            writer.WriteUint32(static_cast<uint32_t>(response.documents.size()));
+            for (const Document& document : response.documents) {
+                writer.WriteInt32(document.id);
+                writer.WriteDouble(document.relevance);
+                writer.WriteInt32(document.rating);
+            }
+        }
+        else if (type == RequestType::MATCH_DOCUMENT) {
+            writer.WriteUint32(static_cast<uint32_t>(response.words.size()));
+            for (const string& word : response.words) {
+                writer.WriteString(word);
+            }
+            writer.WriteUint8(static_cast<uint8_t>(response.document_status));
+        }
+        else if (type == RequestType::GET_TERM_STATISTICS) {
+            WriteTermStatistics(writer, response.term_statistics);
+        }
+        else if (type == RequestType::FETCH_LOG || type == RequestType::FETCH_SNAPSHOT) {
+            // Запись журнала - кадр запроса: длина и нагрузка, как у строки
+            writer.WriteUint64(response.sequence);
+            writer.WriteUint32(static_cast<uint32_t>(response.mutations.size()));
+            string encoded;
+            for (const Request& mutation : response.mutations) {
+                encoded.clear();
+                EncodeRequest(mutation, encoded);
+                writer.WriteString(string_view(encoded).substr(4));
+            }
+        }
+    });
+}
+
+Response DecodeResponse(string_view payload, RequestType type) {
+    ByteReader reader(payload);
+    Response response;
+    const uint8_t status = reader.ReadUint8();
+    if (status > static_cast<uint8_t>(ResponseStatus::ERROR)) {
+        throw invalid_argument("invalid response status");
+    }
+    response.status = static_cast<ResponseStatus>(status);
+    response.request_id = reader.ReadUint32();
+    if (response.status == ResponseStatus::ERROR) {
+        response.error = string(reader.ReadString());
+    }
+    else if (type == RequestType::FIND_TOP_DOCUMENTS || type == RequestType::FIND_TOP_DOCUMENTS_WITH_STATISTICS) {
+        const uint32_t count = reader.ReadUint32();
+        if (count > payload.size() / 16) {
+            throw invalid_argument("truncated message");
+        }
+        response.documents.reserve(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            const int id = reader.ReadInt32();
+            const double relevance = reader.ReadDouble();
+            const int rating = reader.ReadInt32();
+            response.documents.emplace_back(id, relevance, rating);
+        }
+    }
+    else if (type == RequestType::MATCH_DOCUMENT) {
+        const uint32_t count = reader.ReadUint32();
+        if (count > payload.size() / 4) {
+            throw invalid_argument("truncated message");
+        }
+        response.words.reserve(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            response.words.emplace_back(reader.ReadString());
+        }
+        response.document_status = ReadStatus(reader);
+    }
+    else if (type == RequestType::GET_TERM_STATISTICS) {
+        response.term_statistics = ReadTermStatistics(reader);
+    }
+    else if (type == RequestType::FETCH_LOG || type == RequestType::FETCH_SNAPSHOT) {
+        response.sequence = reader.ReadUint64();
+        const uint32_t count = reader.ReadUint32();
+        if (count > payload.size() / 4) {
+            throw invalid_argument("truncated message");
+        }
+        response.mutations.reserve(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            response.mutations.push_back(DecodeRequest(reader.ReadString()));
+        }
+    }
+    if (!reader.IsAtEnd()) {
+        throw invalid_argument("unexpected data after response");
+    }
+    return response;
+}
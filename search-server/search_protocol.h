@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+// Двоичный протокол сетевого доступа к поисковому серверу.
+// Кадр: длина полезной нагрузки (uint32) и нагрузка. Числа - little-endian, строка - длина (uint32) и байты.
+// Запрос: тип (uint8), id запроса (uint32), поля типа. Ответ: статус (uint8), id запроса, поля.
+// Клиент может отправлять запросы, не дожидаясь ответов (конвейер); ответы одного соединения
+// приходят в порядке запросов и содержат id запроса
+enum class RequestType : uint8_t {
+    ADD_DOCUMENT = 1,       // id документа, статус, рейтинги, текст
+    REMOVE_DOCUMENT = 2,    // id документа
+    FIND_TOP_DOCUMENTS = 3, // запрос, режим, статус
+    MATCH_DOCUMENT = 4,     // запрос, id документа
+    // Распределённый поиск (SearchAggregator): статистика слов запроса на шарде
+    // и поиск по статистике всех шардов
+    GET_TERM_STATISTICS = 5,               // запрос
+    FIND_TOP_DOCUMENTS_WITH_STATISTICS = 6, // запрос, статус, статистика слов
+    // Репликация (SearchReplica): записи журнала изменений после заданного номера
+    // и снимок документов первичного сервера
+    FETCH_LOG = 7,      // номер последней полученной записи, наибольшее кол-во записей
+    FETCH_SNAPSHOT = 8, // страница снимка: документы с id больше заданного, наибольшее кол-во документов
+};
+
+enum class ResponseStatus : uint8_t {
+    OK = 0,
+    ERROR = 1, // текст ошибки
+};
+
+// Максимальный размер кадра по умолчанию
+const uint32_t MAX_FRAME_SIZE = 16 * 1024 * 1024;
+
+struct Request {
+    RequestType type = RequestType::FIND_TOP_DOCUMENTS;
+    uint32_t request_id = 0;
+    int document_id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    QueryMode mode = QueryMode::ANY_WORD;
+    std::vector<int> ratings;
+    std::string text; // текст документа или запроса
+    TermStatistics term_statistics; // FIND_TOP_DOCUMENTS_WITH_STATISTICS
+    uint64_t sequence = 0;          // FETCH_LOG
+    uint32_t max_count = 0;         // FETCH_LOG, FETCH_SNAPSHOT (id документа - граница страницы)
+};
+
+struct Response {
+    ResponseStatus status = ResponseStatus::OK;
+    uint32_t request_id = 0;
+    std::string error;
+    std::vector<Document> documents;        // FIND_TOP_DOCUMENTS, FIND_TOP_DOCUMENTS_WITH_STATISTICS
+    std::vector<std::string> words;         // MATCH_DOCUMENT
+    DocumentStatus document_status = DocumentStatus::ACTUAL; // MATCH_DOCUMENT
+    TermStatistics term_statistics;         // GET_TERM_STATISTICS
+    // FETCH_LOG: номер последней записи журнала и записи (запросы ADD_DOCUMENT и REMOVE_DOCUMENT) по порядку.
+    // FETCH_SNAPSHOT: номер записи, на которой сделана страница снимка, и добавления документов страницы
+    uint64_t sequence = 0;
+    std::vector<Request> mutations;
+};
+
+// Запись полей в little-endian
+class ByteWriter {
+public:
+    explicit ByteWriter(std::string& out)
+        : out_(out) {
+    }
+
+    void WriteUint8(uint8_t value);
+    void WriteUint32(uint32_t value);
+    void WriteUint64(uint64_t value);
+    void WriteInt32(int32_t value);
+    void WriteDouble(double value);
+    void WriteString(std::string_view value);
+
+private:
+    std::string& out_;
+};
+
+// Чтение полей; выход за границу данных - исключение invalid_argument
+class ByteReader {
+public:
+    explicit ByteReader(std::string_view data)
+        : data_(data) {
+    }
+
+    uint8_t ReadUint8();
+    uint32_t ReadUint32();
+    uint64_t ReadUint64();
+    int32_t ReadInt32();
+    double ReadDouble();
+    std::string_view ReadString();
+
+    bool IsAtEnd() const {
+        return data_.empty();
+    }
+
+private:
+    std::string_view data_;
+
+    std::string_view Take(size_t size);
+};
+
+// Дописывает в out кадр с нагрузкой, записанной функцией write_payload(ByteWriter&)
+template <typename WritePayload>
+void WriteFrame(std::string& out, WritePayload write_payload) {
+    const size_t frame_start = out.size();
+    out.append(4, '\0');
+    ByteWriter writer(out);
+    write_payload(writer);
+    const auto payload_size = static_cast<uint32_t>(out.size() - frame_start - 4);
+    for (int i = 0; i < 4; ++i) {
+        out[frame_start + i] = static_cast<char>((payload_size >> (8 * i)) & 0xFF);
+    }
+}
+
+// Выделяет из начала buffer полный кадр: нагрузка записывается в payload, возвращается длина кадра.
+// Если кадр пришёл не полностью, возвращает 0. Кадр больше max_frame_size - исключение invalid_argument
+size_t ExtractFrame(std::string_view buffer, std::string_view& payload, uint32_t max_frame_size = MAX_FRAME_SIZE);
+
+void EncodeRequest(const Request& request, std::string& out);
+Request DecodeRequest(std::string_view payload);
+
+void EncodeResponse(const Response& response, RequestType type, std::string& out);
+// Тип запроса нужен для разбора полей ответа
+Response DecodeResponse(std::string_view payload, RequestType type);
@@ -2,84 +2,205 @@
 
 using namespace std;
 
-//----------------------------   ----------------------------
-
-void SearchServer::SetStopWords(const string_view text) {
-    for (const string_view stop_word : SplitIntoWords(text)) {
-        if (NoSpecSymbols(stop_word)) {
-            stop_words_.insert(string(stop_word));
+namespace {
+    // Сопоставление слова с шаблоном, в котором '*' - любая (в том числе пустая) последовательность символов
+    bool MatchesWildcard(string_view word, string_view pattern) {
+        size_t word_pos = 0;
+        size_t pattern_pos = 0;
+        size_t star_pos = string_view::npos;
+        size_t star_word_pos = 0;
+        while (word_pos < word.size()) {
+            if (pattern_pos < pattern.size() && pattern[pattern_pos] == '*') {
+                star_pos = pattern_pos++;
+                star_word_pos = word_pos;
+            }
+            else if (pattern_pos < pattern.size() && pattern[pattern_pos] == word[word_pos]) {
+                ++pattern_pos;
+                ++word_pos;
+            }
+            else if (star_pos != string_view::npos) {
+                // Последняя звёздочка поглощает ещё один символ
+                pattern_pos = star_pos + 1;
+                word_pos = ++star_word_pos;
+            }
+            else {
+                return false;
+            }
+        }
+        while (pattern_pos < pattern.size() && pattern[pattern_pos] == '*') {
+            ++pattern_pos;
         }
+        return pattern_pos == pattern.size();
     }
 }
 
-//   string -    
-SearchServer::SearchServer(string stop_words) 
-    : SearchServer(string_view(stop_words)) {    
+//---------------------------- Публичные методы ----------------------------
+
+template <typename ScoringPolicy>
+void BasicSearchServer<ScoringPolicy>::SetStopWords(const string_view text) {
+    // Проверка на спецсимволы выполняется при разбиении на слова
+    for (const string_view stop_word : WordTokenizer(text)) {
+        AddStopWord(string(stop_word));
+    }
 }
 
-//   string_view -    
-SearchServer::SearchServer(string_view stop_words) {
+//Конструктор от аргумента string - строка со стоп словами
+template <typename ScoringPolicy>
+BasicSearchServer<ScoringPolicy>::BasicSearchServer(string stop_words) 
+    : BasicSearchServer(string_view(stop_words)) {    
+}
+
+//Конструктор от аргумента string_view - строка со стоп словами
+template <typename ScoringPolicy>
+BasicSearchServer<ScoringPolicy>::BasicSearchServer(string_view stop_words) {
     SetStopWords(stop_words);
 }
  
+template <typename ScoringPolicy>
+void BasicSearchServer<ScoringPolicy>::EnablePositionalIndex() {
+    if (!documents_.empty()) {
+        throw logic_error("positional index must be enabled before adding documents");
+    }
+    positional_index_ = true;
+}
+
+template <typename ScoringPolicy>
+bool BasicSearchServer<ScoringPolicy>::HasPositionalIndex() const {
+    return positional_index_;
+}
+
+template <typename ScoringPolicy>
+size_t BasicSearchServer<ScoringPolicy>::GetPositionalIndexMemory() const {
+    size_t memory = 0;
+    for (const auto& [word, posting_list] : word_to_document_freqs_) {
+        memory += posting_list.GetPositionsMemory();
+    }
+    return memory;
+}
+
 // Adding new document to search server
-void SearchServer::AddDocument(int document_id, const string& document, DocumentStatus status, const vector<int>& ratings) {
+template <typename ScoringPolicy>
+void BasicSearchServer<ScoringPolicy>::AddDocument(int document_id, const string& document, DocumentStatus status, const vector<int>& ratings) {
+    LATENCY_TIMER(LatencyOperation::ADD_DOCUMENT);
+    ALLOCATION_SCOPE(LatencyOperation::ADD_DOCUMENT);
     // Check if document with document_id already exist or document_id < 0
     if ((documents_.count(document_id)) || (document_id < 0)) {
         throw invalid_argument("document_id already exist or below zero"); // error: this document_id already exist or below zero
     }
-    vector<string_view> words = SplitIntoWordsNoStop(document);
-
-    const double inv_word_count = 1.0 / words.size();
-
+    // Сначала считаем вхождения слов: если в документе есть спецсимволы,
+    // исключение будет выброшено до изменения индекса
     map<string, double> word_freqs_in_doc;
-    for (const string_view word : words) {
-        //    
-        if (NoSpecSymbols(word)) {
-            word_to_document_freqs_[string(word)][document_id] += inv_word_count;
-            word_freqs_in_doc[string(word)] += inv_word_count;
+    // Позиции считаются по всем словам документа, включая стоп-слова, чтобы фраза "cat and dog"
+    // не находилась в тексте "cat dog"
+    map<string_view, vector<int>> word_positions;
+    int word_count = 0;
+    int position = 0;
+    for (const string_view word : WordTokenizer(document)) {
+        if (!IsStopWord(word)) {
+            word_freqs_in_doc[string(word)] += 1.0;
+            ++word_count;
+            if (positional_index_) {
+                word_positions[word].push_back(position);
+            }
+        }
+        ++position;
+    }
+
+    const double inv_word_count = 1.0 / word_count;
+    // Прямой индекс документа: отсортированные ссылки на слова словаря word_to_document_freqs_
+    vector<string_view> words;
+    words.reserve(word_freqs_in_doc.size());
+    for (auto& [word, freq] : word_freqs_in_doc) {
+        freq *= inv_word_count;
+        const auto [word_it, is_new_word] = word_to_document_freqs_.try_emplace(word);
+        if (is_new_word) {
+            memory_stats_.dictionary += GetTreeNodeMemory<pair<const string, PostingList>>() + GetStringHeapMemory(word_it->first);
+        }
+        const size_t posting_memory = word_it->second.GetMemory();
+        if (positional_index_) {
+            word_it->second.Insert({ document_id, word_count, freq }, word_positions.at(word));
+        }
+        else {
+            word_it->second.Insert({ document_id, word_count, freq });
         }
+        memory_stats_.postings -= posting_memory;
+        memory_stats_.postings += word_it->second.GetMemory();
+        words.push_back(word_it->first);
     }
 
-    documents_.emplace(document_id,
+    const DocumentData& document_data = documents_.emplace(document_id,
         DocumentData{
             ComputeAverageRating(ratings),
             status,
-            word_freqs_in_doc
-        });
+            word_freqs_in_doc,
+            move(words),
+            word_count,
+            ++last_document_version_
+        }).first->second;
+    total_document_length_ += word_count;
+    const size_t filter_memory = GetFilterIndexMemory(status, document_data.rating);
+    status_to_documents_[status].Add(document_id);
+    rating_to_documents_[document_data.rating].Add(document_id);
 
     document_ids_.insert(document_id);
+
+    memory_stats_.filter_indexes -= filter_memory;
+    memory_stats_.filter_indexes += GetFilterIndexMemory(status, document_data.rating);
+    memory_stats_.document_metadata += GetTreeNodeMemory<pair<const int, DocumentData>>() + GetTreeNodeMemory<int>();
+    memory_stats_.forward_index += GetForwardIndexMemory(document_data);
+    EnforceMemoryBudget();
 }
 
-//    
-void SearchServer::RemoveDocument(int document_id) {
+// Однопоточная версия удаления документа
+template <typename ScoringPolicy>
+void BasicSearchServer<ScoringPolicy>::RemoveDocument(int document_id) {
     RemoveDocument(std::execution::seq, document_id);
 }
 
-//    
-void SearchServer::RemoveDocument(std::execution::sequenced_policy, int document_id) {
-    //             
+// Однопоточная версия удаления документа
+template <typename ScoringPolicy>
+void BasicSearchServer<ScoringPolicy>::RemoveDocument(std::execution::sequenced_policy, int document_id) {
+    LATENCY_TIMER(LatencyOperation::REMOVE_DOCUMENT);
+    ALLOCATION_SCOPE(LatencyOperation::REMOVE_DOCUMENT);
+    if (documents_.count(document_id) == 0) {
+        return;
+    }
+    // Зная количество слов в документе удаляем из следующих контейнеров данные об этом документе
     // word_to_document_freqs_
     for_each(
         execution::seq,
         documents_[document_id].word_freqs_.begin(),
         documents_[document_id].word_freqs_.end(),
         [this, document_id](const pair<string, double>& word) { // first - word, second - word's freq
-            word_to_document_freqs_[word.first].erase(document_id);
+            word_to_document_freqs_[word.first].Erase(document_id);
         }
     );
 
     // document_ids_
     document_ids_.erase(document_id);
+    if (const auto document_it = documents_.find(document_id); document_it != documents_.end()) {
+        total_document_length_ -= document_it->second.length;
+        RemoveFromFilterIndexes(document_id, document_it->second);
+        // Ёмкость списков вхождений при удалении не меняется, её освобождает Compact
+        const size_t document_memory = GetTreeNodeMemory<pair<const int, DocumentData>>() + GetTreeNodeMemory<int>();
+        const size_t forward_index_memory = GetForwardIndexMemory(document_it->second);
+        memory_stats_.document_metadata -= document_memory;
+        memory_stats_.forward_index -= forward_index_memory;
+        removed_memory_ += document_memory + forward_index_memory;
+    }
 
     // documents_
     documents_.erase(document_id);
+    EnforceMemoryBudget();
 }
 
-//    
-void SearchServer::RemoveDocument(std::execution::parallel_policy, int document_id) {    
+// Многопоточная версия удаления документа
+template <typename ScoringPolicy>
+void BasicSearchServer<ScoringPolicy>::RemoveDocument(std::execution::parallel_policy, int document_id) {
+    LATENCY_TIMER(LatencyOperation::REMOVE_DOCUMENT);
+    ALLOCATION_SCOPE(LatencyOperation::REMOVE_DOCUMENT);
 
-    //             
+    // Зная количество слов в документе удаляем из следующих контейнеров данные об этом документе
     // word_to_document_freqs_       
     map<string, double>& words_in_doc = documents_.at(document_id).word_freqs_;
     vector<const string*> words_to_erase(words_in_doc.size());
@@ -99,39 +220,142 @@ void SearchServer::RemoveDocument(std::execution::parallel_policy, int document_
         words_to_erase.begin(),
         words_to_erase.end(),
         [&, document_id](const auto& word) {
-            word_to_document_freqs_[*word].erase(document_id);
+            word_to_document_freqs_[*word].Erase(document_id);
         }
     );
 
     // document_ids_
     document_ids_.erase(document_id);
+    if (const auto document_it = documents_.find(document_id); document_it != documents_.end()) {
+        total_document_length_ -= document_it->second.length;
+        RemoveFromFilterIndexes(document_id, document_it->second);
+        // Ёмкость списков вхождений при удалении не меняется, её освобождает Compact
+        const size_t document_memory = GetTreeNodeMemory<pair<const int, DocumentData>>() + GetTreeNodeMemory<int>();
+        const size_t forward_index_memory = GetForwardIndexMemory(document_it->second);
+        memory_stats_.document_metadata -= document_memory;
+        memory_stats_.forward_index -= forward_index_memory;
+        removed_memory_ += document_memory + forward_index_memory;
+    }
 
     // documents_
     documents_.erase(document_id);
+    EnforceMemoryBudget();
 }
 
 // Find documents with certain status
-vector<Document> SearchServer::FindTopDocuments(const string_view raw_query, DocumentStatus status) const {
+template <typename ScoringPolicy>
+vector<Document> BasicSearchServer<ScoringPolicy>::FindTopDocuments(const string_view raw_query, DocumentStatus status) const {
     return FindTopDocuments(
         raw_query,
-        [status](int document_id, DocumentStatus document_status, int rating) {
-            return document_status == status;
-        }
+        cref(GetStatusDocuments(status))
     );
 }
 
 // Find documents with status = ACTUAL
-vector<Document> SearchServer::FindTopDocuments(const string_view raw_query) const {
+template <typename ScoringPolicy>
+vector<Document> BasicSearchServer<ScoringPolicy>::FindTopDocuments(const string_view raw_query) const {
     return FindTopDocuments(
         raw_query,
-        [](int document_id, DocumentStatus status, int rating) {
-            return status == DocumentStatus::ACTUAL;
-        }
+        cref(GetStatusDocuments(DocumentStatus::ACTUAL))
     );
 }
 
-//       Id 
-const map<string, double>& SearchServer::GetWordFrequencies(int document_id) const {
+// Find documents with certain status
+template <typename ScoringPolicy>
+const vector<Document>& BasicSearchServer<ScoringPolicy>::FindTopDocuments(QueryContext& context, const string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(
+        context,
+        raw_query,
+        cref(GetStatusDocuments(status))
+    );
+}
+
+// Find documents with status = ACTUAL
+template <typename ScoringPolicy>
+const vector<Document>& BasicSearchServer<ScoringPolicy>::FindTopDocuments(QueryContext& context, const string_view raw_query) const {
+    return FindTopDocuments(context, raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename ScoringPolicy>
+const vector<Document>& BasicSearchServer<ScoringPolicy>::FindTopDocuments(QueryContext& context, const string_view raw_query, DocumentStatus status,
+    const TermStatistics& statistics) const {
+    return FindTopDocuments(context, raw_query, cref(GetStatusDocuments(status)), statistics);
+}
+
+template <typename ScoringPolicy>
+TermStatistics BasicSearchServer<ScoringPolicy>::GetTermStatistics(const string_view raw_query) const {
+    const Query query = ParseQuery(raw_query);
+    TermStatistics statistics;
+    statistics.collection = GetCollectionStatistics();
+    auto add_word = [this, &statistics](string_view word) {
+        const auto word_it = word_to_document_freqs_.find(word);
+        if (word_it != word_to_document_freqs_.end() && !word_it->second.empty()) {
+            statistics.document_freqs.emplace(word, word_it->second.size());
+        }
+    };
+    for (const string_view word : query.plus_words) {
+        add_word(word);
+    }
+    for (const auto& [word, _] : query.weighted_words) {
+        add_word(word);
+    }
+    for (const Phrase& phrase : query.phrases) {
+        for (const string_view word : phrase.words) {
+            add_word(word);
+        }
+    }
+    return statistics;
+}
+
+template <typename ScoringPolicy>
+vector<Document> BasicSearchServer<ScoringPolicy>::FindTopDocuments(const string_view raw_query, const DocumentFilter& filter) const {
+    const DocumentBitmap documents = CompileFilter(filter);
+    return FindTopDocuments(raw_query, cref(documents));
+}
+
+template <typename ScoringPolicy>
+SearchPage BasicSearchServer<ScoringPolicy>::FindDocumentsPage(const string_view raw_query, size_t page_size, const optional<SearchCursor>& after) const {
+    return FindDocumentsPage(execution::seq, raw_query, QueryMode::ANY_WORD, page_size, after);
+}
+
+template <typename ScoringPolicy>
+DocumentBitmap BasicSearchServer<ScoringPolicy>::CompileFilter(const DocumentFilter& filter) const {
+    DocumentBitmap result;
+    if (filter.statuses.empty()) {
+        for (const auto& [status, documents] : status_to_documents_) {
+            result |= documents;
+        }
+    }
+    for (const DocumentStatus status : filter.statuses) {
+        result |= GetStatusDocuments(status);
+    }
+
+    if (filter.rating_range) {
+        DocumentBitmap rating_documents;
+        const auto [min_rating, max_rating] = *filter.rating_range;
+        for (auto rating_it = rating_to_documents_.lower_bound(min_rating);
+            rating_it != rating_to_documents_.end() && rating_it->first <= max_rating;
+            ++rating_it) {
+            rating_documents |= rating_it->second;
+        }
+        result &= rating_documents;
+    }
+
+    if (filter.document_ids) {
+        DocumentBitmap id_documents;
+        for (const int document_id : *filter.document_ids) {
+            if (document_id >= 0) {
+                id_documents.Add(document_id);
+            }
+        }
+        result &= id_documents;
+    }
+    return result;
+}
+
+// Получение слов и их частоты по Id документа
+template <typename ScoringPolicy>
+const map<string, double>& BasicSearchServer<ScoringPolicy>::GetWordFrequencies(int document_id) const {
     static map<string, double> result;
 
     auto find_freq_result = documents_.find(document_id);
@@ -142,135 +366,577 @@ const map<string, double>& SearchServer::GetWordFrequencies(int document_id) con
     return result;
 }
 
-int SearchServer::GetDocumentCount() const {
-    return documents_.size();
+template <typename ScoringPolicy>
+uint64_t BasicSearchServer<ScoringPolicy>::GetDocumentVersion(int document_id) const {
+    const auto document_it = documents_.find(document_id);
+    return document_it != documents_.end() ? document_it->second.version : 0;
 }
 
-std::set<int>::const_iterator SearchServer::begin() const {
-    return document_ids_.begin();
+template <typename ScoringPolicy>
+int BasicSearchServer<ScoringPolicy>::GetDocumentCount() const {
+    return documents_.size();
 }
 
-std::set<int>::const_iterator SearchServer::end() const {
-    return document_ids_.end();
+template <typename ScoringPolicy>
+const MemoryStats& BasicSearchServer<ScoringPolicy>::GetMemoryStats() const {
+    return memory_stats_;
 }
 
-//   
-MatchedWords SearchServer::MatchDocument(const string& raw_query, int document_id) const {
-    //       document_id
-    return MatchDocument(execution::seq, raw_query, document_id);
+template <typename ScoringPolicy>
+void BasicSearchServer<ScoringPolicy>::SetMemoryBudget(size_t bytes) {
+    memory_budget_ = bytes;
+    compacted_memory_ = 0;
+    EnforceMemoryBudget();
 }
 
-//   
-MatchedWords SearchServer::MatchDocument(execution::sequenced_policy, const string_view raw_query, int document_id) const {
-    
-    const Query query = ParseQuery(raw_query);
-    const DocumentStatus status = documents_.at(document_id).status;
-    //    vector<string> matched_words,      docuemnt_id
-    //    
-    vector<string> matched_words;
-    for (const string_view& word : query.plus_words) {
-        if (word_to_document_freqs_.count(string(word)) == 0) {
-            continue;
+template <typename ScoringPolicy>
+void BasicSearchServer<ScoringPolicy>::Compact() {
+    // Прямой индекс ссылается только на слова, встречающиеся в документах, поэтому слова
+    // с пустыми списками можно удалить из словаря
+    for (auto word_it = word_to_document_freqs_.begin(); word_it != word_to_document_freqs_.end();) {
+        memory_stats_.postings -= word_it->second.GetMemory();
+        if (word_it->second.empty()) {
+            memory_stats_.dictionary -= GetTreeNodeMemory<pair<const string, PostingList>>() + GetStringHeapMemory(word_it->first);
+            word_it = word_to_document_freqs_.erase(word_it);
         }
-        if (word_to_document_freqs_.at(string(word)).count(document_id)) {
-            matched_words.push_back(string(word));
-        }
-    }
-    for (const string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(string(word)) == 0) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(string(word)).count(document_id)) {
-            matched_words.clear();
-            break;
+        else {
+            word_it->second.ShrinkToFit();
+            memory_stats_.postings += word_it->second.GetMemory();
+            ++word_it;
         }
     }
+    compacted_memory_ = memory_stats_.GetTotal();
+    removed_memory_ = 0;
+}
 
-    if (matched_words.empty()) {
-        return { {}, status };
-    }
+template <typename ScoringPolicy>
+std::set<int>::const_iterator BasicSearchServer<ScoringPolicy>::begin() const {
+    return document_ids_.begin();
+}
 
-    vector<string_view> matched_words_view;
+template <typename ScoringPolicy>
+std::set<int>::const_iterator BasicSearchServer<ScoringPolicy>::end() const {
+    return document_ids_.end();
+}
 
-    for (auto& word : matched_words) {
-        auto it = word_to_document_freqs_.find(string(word));
-        matched_words_view.push_back(it->first);
-    }
+// Однопоточная версия функции
+template <typename ScoringPolicy>
+MatchedWords BasicSearchServer<ScoringPolicy>::MatchDocument(const string& raw_query, int document_id) const {
+    // Проверяем что данный документ существует по document_id
+    return MatchDocument(execution::seq, raw_query, document_id);
+}
 
-    return { matched_words_view, status }; // Succesfull     
+// Однопоточная версия функции
+template <typename ScoringPolicy>
+MatchedWords BasicSearchServer<ScoringPolicy>::MatchDocument(execution::sequenced_policy, const string_view raw_query, int document_id) const {
+    LATENCY_TIMER(LatencyOperation::MATCH_DOCUMENT);
+    ALLOCATION_SCOPE(LatencyOperation::MATCH_DOCUMENT);
+    const DocumentData& document_data = GetDocumentData(document_id);
+    return MatchQuery(ParseQuery(raw_query), document_id, document_data);
 }
 
-//   
-MatchedWords SearchServer::MatchDocument(execution::parallel_policy, const string_view raw_query, int document_id) const {
-    //       document_id
-    if (document_ids_.count(document_id) == 0) {
-        throw std::out_of_range("no document with this id");
-    }
+// Многопоточная версия функции
+template <typename ScoringPolicy>
+MatchedWords BasicSearchServer<ScoringPolicy>::MatchDocument(execution::parallel_policy, const string_view raw_query, int document_id) const {
+    LATENCY_TIMER(LatencyOperation::MATCH_DOCUMENT);
+    ALLOCATION_SCOPE(LatencyOperation::MATCH_DOCUMENT);
+    // Проверяем что данный документ существует по document_id
+    const DocumentData& document_data = GetDocumentData(document_id);
 
     const Query query = ParseQuery(raw_query);
-    const DocumentStatus status = documents_.at(document_id).status;
+    const vector<string_view>& document_words = document_data.words;
 
-    //    vector<string> matched_words,      docuemnt_id    
+    // Кортеж состоит из vector<string_view> matched_words, совпадающие слова в документе с docuemnt_id и статуса данного документа
     
-    //                ,
-    //            
+    // Проверяем вначале если если есть совпадение с минус словами и если есть то возвращаем пустой вектор,
+    // так как искать совпадение по плюс словам в таком случае не надо
     if (any_of(
         execution::par,
         query.minus_words.begin(),
         query.minus_words.end(),
-        [&, document_id](const string_view minus_word) {
-            auto it = word_to_document_freqs_.find(string(minus_word));
-            return it != word_to_document_freqs_.end() && it->second.count(document_id);
+        [&document_words](const string_view minus_word) {
+            return binary_search(document_words.begin(), document_words.end(), minus_word);
         }
     )) {
-        return { {}, status };
+        return { vector<string_view>{}, document_data.status };
     }
        
-    //       ,         
+    // Если совпадений по минус словам не было, ищем плюс слова в прямом индексе документа.
+    // Возвращаются ссылки на слова словаря, а не на строку запроса
     vector<string_view> matched_words(query.plus_words.size());
-
-    auto words_end = copy_if(
+    transform(
         execution::par,
         query.plus_words.begin(),
         query.plus_words.end(),
         matched_words.begin(),
-        [&, document_id](const string_view plus_word) {
-            auto it = word_to_document_freqs_.find(string(plus_word));
-            return it != word_to_document_freqs_.end() && it->second.count(document_id);
+        [&document_words](const string_view plus_word) {
+            const auto it = lower_bound(document_words.begin(), document_words.end(), plus_word);
+            return it != document_words.end() && *it == plus_word ? *it : string_view();
         }
     );
-    
-    sort(execution::par, matched_words.begin(), words_end);
-    words_end = unique(matched_words.begin(), words_end);
-    matched_words.erase(words_end, matched_words.end());
+    // Плюс слова запроса отсортированы и уникальны, порядок сохраняется
+    matched_words.erase(remove(matched_words.begin(), matched_words.end(), string_view()), matched_words.end());
+    AddMatchedPhraseWords(query, document_id, document_data, matched_words);
+
+    return { matched_words, document_data.status }; // Succesfull   
+}
 
-    vector<string_view> matched_words_view;
+//---------------------------- Приватные методы ----------------------------
 
-    for (auto& word : matched_words) {
-        auto it = word_to_document_freqs_.find(string(word));
-        matched_words_view.push_back(it->first);
+template <typename ScoringPolicy>
+const typename BasicSearchServer<ScoringPolicy>::DocumentData& BasicSearchServer<ScoringPolicy>::GetDocumentData(int document_id) const {
+    const auto document_it = documents_.find(document_id);
+    if (document_it == documents_.end()) {
+        throw std::out_of_range("no document with this id");
     }
+    return document_it->second;
+}
 
-    return { matched_words_view, status }; // Succesfull   
+template <typename ScoringPolicy>
+MatchedWords BasicSearchServer<ScoringPolicy>::MatchQuery(const Query& query, int document_id, const DocumentData& document_data) const {
+    const vector<string_view>& document_words = document_data.words;
+
+    // Слова запроса и прямой индекс документа отсортированы, поэтому совпадения ищем слиянием
+    auto contains_any = [&document_words](const vector<string_view>& query_words) {
+        auto document_it = document_words.begin();
+        for (const string_view word : query_words) {
+            document_it = lower_bound(document_it, document_words.end(), word);
+            if (document_it == document_words.end()) {
+                return false;
+            }
+            if (*document_it == word) {
+                return true;
+            }
+        }
+        return false;
+    };
+    if (contains_any(query.minus_words)) {
+        return { vector<string_view>{}, document_data.status };
+    }
+
+    vector<string_view> matched_words;
+    auto document_it = document_words.begin();
+    for (const string_view word : query.plus_words) {
+        document_it = lower_bound(document_it, document_words.end(), word);
+        if (document_it == document_words.end()) {
+            break;
+        }
+        if (*document_it == word) {
+            matched_words.push_back(*document_it);
+        }
+    }
+    AddMatchedPhraseWords(query, document_id, document_data, matched_words);
+
+    return { matched_words, document_data.status };
 }
 
-//----------------------------   ----------------------------
+template <typename ScoringPolicy>
+void BasicSearchServer<ScoringPolicy>::AddMatchedPhraseWords(const Query& query, int document_id, const DocumentData& document_data,
+    vector<string_view>& matched_words) const {
+    if (query.phrases.empty()) {
+        return;
+    }
+    const vector<string_view>& document_words = document_data.words;
+    for (const Phrase& phrase : query.phrases) {
+        if (!MatchesPhrase(phrase, document_id)) {
+            continue;
+        }
+        // Ссылки на слова словаря, а не на строку запроса
+        for (const string_view word : phrase.words) {
+            matched_words.push_back(*lower_bound(document_words.begin(), document_words.end(), word));
+        }
+    }
+    sort(matched_words.begin(), matched_words.end());
+    matched_words.erase(unique(matched_words.begin(), matched_words.end()), matched_words.end());
+}
 
-bool SearchServer::IsStopWord(const string_view word) const {
-    return stop_words_.count(string(word)) > 0;
+template <typename ScoringPolicy>
+bool BasicSearchServer<ScoringPolicy>::MatchPhrasePositions(const Phrase& phrase, const vector<const PostingList*>& lists,
+    const vector<PostingList::const_iterator>& postings) {
+    // Возможные начала фразы - позиции первого слова, для каждого следующего слова
+    // остаются только те начала, для которых слово стоит на своём смещении
+    vector<int> starts;
+    vector<int> positions;
+    lists[0]->DecodePositions(postings[0], starts);
+    for (size_t i = 1; i < lists.size() && !starts.empty(); ++i) {
+        lists[i]->DecodePositions(postings[i], positions);
+        auto position_it = positions.begin();
+        const int offset = phrase.offsets[i];
+        starts.erase(remove_if(starts.begin(), starts.end(),
+            [&position_it, &positions, offset](int start) {
+                while (position_it != positions.end() && *position_it < start + offset) {
+                    ++position_it;
+                }
+                return position_it == positions.end() || *position_it != start + offset;
+            }), starts.end());
+    }
+    return !starts.empty();
 }
 
-vector<string_view> SearchServer::SplitIntoWordsNoStop(const string_view text) const {
-    vector<string_view> result;
-    for (const string_view word : SplitIntoWords(text)) {        
-        if (!IsStopWord(word)) {
-            result.push_back(word);
-        }        
+template <typename ScoringPolicy>
+bool BasicSearchServer<ScoringPolicy>::MatchesPhrase(const Phrase& phrase, int document_id) const {
+    vector<const PostingList*> lists;
+    vector<PostingList::const_iterator> postings;
+    for (const string_view word : phrase.words) {
+        const auto word_it = word_to_document_freqs_.find(word);
+        if (word_it == word_to_document_freqs_.end()) {
+            return false;
+        }
+        const auto posting_it = word_it->second.LowerBound(document_id);
+        if (posting_it == word_it->second.end() || posting_it->document_id != document_id) {
+            return false;
+        }
+        lists.push_back(&word_it->second);
+        postings.push_back(posting_it);
+    }
+    return MatchPhrasePositions(phrase, lists, postings);
+}
+
+template <typename ScoringPolicy>
+typename BasicSearchServer<ScoringPolicy>::ScoredDocuments BasicSearchServer<ScoringPolicy>::FindPhraseDocuments(const Phrase& phrase, const TermStatistics* statistics) const {
+    vector<const PostingList*> lists;
+    vector<WordScorer> word_scorers;
+    for (const string_view word : phrase.words) {
+        const auto word_it = word_to_document_freqs_.find(word);
+        if (word_it == word_to_document_freqs_.end() || word_it->second.empty()) {
+            return {};
+        }
+        lists.push_back(&word_it->second);
+        word_scorers.push_back(GetWordScorer(word, word_it->second, 1.0, statistics));
+    }
+
+    // Кандидаты берутся из самого короткого списка, в остальных списках курсоры двигаются галопом
+    const PostingList& lead = **min_element(lists.begin(), lists.end(),
+        [](const PostingList* lhs, const PostingList* rhs) {
+            return lhs->size() < rhs->size();
+        });
+    vector<PostingList::const_iterator> postings;
+    for (const PostingList* posting_list : lists) {
+        postings.push_back(posting_list->begin());
+    }
+
+    ScoredDocuments result;
+    for (const Posting& posting : lead) {
+        const int document_id = posting.document_id;
+        bool in_all_lists = true;
+        for (size_t i = 0; i < lists.size() && in_all_lists; ++i) {
+            postings[i] = GallopLowerBound(postings[i], lists[i]->end(), document_id);
+            if (postings[i] == lists[i]->end()) {
+                return result;
+            }
+            in_all_lists = postings[i]->document_id == document_id;
+        }
+        if (!in_all_lists || !MatchPhrasePositions(phrase, lists, postings)) {
+            continue;
+        }
+        double relevance = 0.0;
+        for (size_t i = 0; i < lists.size(); ++i) {
+            relevance += word_scorers[i](*postings[i]);
+        }
+        result.push_back({ document_id, relevance });
+    }
+    return result;
+}
+
+template <typename ScoringPolicy>
+optional<typename BasicSearchServer<ScoringPolicy>::QueryPlanNode> BasicSearchServer<ScoringPolicy>::BuildQueryPlan(const QueryNode& node) const {
+    QueryPlanNode plan;
+    plan.type = node.type;
+
+    switch (node.type) {
+    case QueryNode::Type::TERM: {
+        if (node.word.find('*') != string_view::npos) {
+            // Шаблон - объединение слов, в которые он раскрывается
+            vector<string_view> words;
+            ExpandWildcard(node.word, words);
+            QueryNode expansion{ QueryNode::Type::OR, {}, {} };
+            for (const string_view word : words) {
+                expansion.children.push_back({ QueryNode::Type::TERM, word, {} });
+            }
+            optional<QueryPlanNode> expansion_plan = BuildQueryPlan(expansion);
+            return expansion_plan ? move(*expansion_plan) : plan;
+        }
+        if (IsStopWord(node.word)) {
+            return nullopt;
+        }
+        const auto word_it = word_to_document_freqs_.find(node.word);
+        if (word_it != word_to_document_freqs_.end() && !word_it->second.empty()) {
+            plan.postings = &word_it->second;
+            plan.scorer = GetWordScorer(word_it->second);
+            plan.cost = word_it->second.size();
+        }
+        return plan;
+    }
+    case QueryNode::Type::NOT: {
+        // Двойное отрицание - сам операнд
+        const QueryNode* operand = &node;
+        bool is_negated = false;
+        while (operand->type == QueryNode::Type::NOT) {
+            is_negated = !is_negated;
+            operand = &operand->children.front();
+        }
+        if (!is_negated) {
+            return BuildQueryPlan(*operand);
+        }
+        // Отрицание само по себе документов не находит, оно только сужает AND
+        plan.type = QueryNode::Type::OR;
+        return plan;
+    }
+    case QueryNode::Type::OR: {
+        bool has_children = false;
+        for (const QueryNode& child : node.children) {
+            optional<QueryPlanNode> child_plan = BuildQueryPlan(child);
+            if (!child_plan) {
+                continue;
+            }
+            has_children = true;
+            // Слова, которых нет в документах, и повторы слов ничего не добавляют к объединению
+            if (child_plan->cost == 0) {
+                continue;
+            }
+            if (child_plan->type == QueryNode::Type::TERM && any_of(plan.children.begin(), plan.children.end(),
+                [&child_plan](const QueryPlanNode& other) {
+                    return other.postings == child_plan->postings;
+                })) {
+                continue;
+            }
+            plan.cost += child_plan->cost;
+            plan.children.push_back(move(*child_plan));
+        }
+        if (!has_children) {
+            return nullopt;
+        }
+        if (plan.children.size() == 1) {
+            return move(plan.children.front());
+        }
+        break;
+    }
+    case QueryNode::Type::AND: {
+        for (const QueryNode& child : node.children) {
+            // NOT NOT x - обязательная часть x, а не исключение
+            const QueryNode* operand = &child;
+            bool is_excluded = false;
+            while (operand->type == QueryNode::Type::NOT) {
+                is_excluded = !is_excluded;
+                operand = &operand->children.front();
+            }
+            optional<QueryPlanNode> child_plan = BuildQueryPlan(*operand);
+            if (!child_plan) {
+                continue;
+            }
+            if (is_excluded) {
+                if (child_plan->cost > 0) {
+                    plan.excluded.push_back(move(*child_plan));
+                }
+            }
+            else {
+                plan.children.push_back(move(*child_plan));
+            }
+        }
+        if (plan.children.empty()) {
+            if (plan.excluded.empty()) {
+                return nullopt;
+            }
+            plan.type = QueryNode::Type::OR;
+            plan.excluded.clear();
+            return plan;
+        }
+        if (plan.children.size() == 1 && plan.excluded.empty()) {
+            return move(plan.children.front());
+        }
+        break;
+    }
+    }
+
+    // Дешёвые части вперёд: у AND самая дешёвая часть ограничивает результат и ведёт перебор,
+    // проверки остальных частей прекращаются на первой неудаче
+    auto by_cost = [](const QueryPlanNode& lhs, const QueryPlanNode& rhs) {
+        return lhs.cost < rhs.cost;
+    };
+    sort(plan.children.begin(), plan.children.end(), by_cost);
+    sort(plan.excluded.begin(), plan.excluded.end(), by_cost);
+
+    if (plan.type == QueryNode::Type::AND) {
+        plan.cost = plan.children.front().cost;
+
+        // term-at-a-time читает все списки целиком, document-at-a-time делает по бинарному поиску
+        // в каждой из остальных частей для каждого кандидата ведущей части
+        size_t full_cost = 0;
+        size_t max_cost = 0;
+        for (const QueryPlanNode& child : plan.children) {
+            full_cost += child.cost;
+            max_cost = max(max_cost, child.cost);
+        }
+        const double probe_cost = log2(max_cost + 2.0);
+        const size_t probe_count = plan.children.size() - 1 + plan.excluded.size();
+        plan.document_at_a_time = plan.cost * probe_count * probe_cost < full_cost;
+    }
+    return plan;
+}
+
+template <typename ScoringPolicy>
+bool BasicSearchServer<ScoringPolicy>::ProbeQueryPlan(const QueryPlanNode& node, int document_id, double& relevance) {
+    switch (node.type) {
+    case QueryNode::Type::TERM: {
+        const Posting* posting = node.postings != nullptr ? node.postings->Find(document_id) : nullptr;
+        if (posting == nullptr) {
+            return false;
+        }
+        relevance += node.scorer(*posting);
+        return true;
+    }
+    case QueryNode::Type::OR: {
+        bool is_matched = false;
+        for (const QueryPlanNode& child : node.children) {
+            is_matched = ProbeQueryPlan(child, document_id, relevance) || is_matched;
+        }
+        return is_matched;
+    }
+    case QueryNode::Type::AND: {
+        double and_relevance = 0.0;
+        for (const QueryPlanNode& child : node.children) {
+            if (!ProbeQueryPlan(child, document_id, and_relevance)) {
+                return false;
+            }
+        }
+        for (const QueryPlanNode& excluded : node.excluded) {
+            double unused = 0.0;
+            if (ProbeQueryPlan(excluded, document_id, unused)) {
+                return false;
+            }
+        }
+        relevance += and_relevance;
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+template <typename ScoringPolicy>
+typename BasicSearchServer<ScoringPolicy>::ScoredDocuments BasicSearchServer<ScoringPolicy>::UniteScoredDocuments(const ScoredDocuments& lhs, const ScoredDocuments& rhs) {
+    ScoredDocuments result;
+    result.reserve(lhs.size() + rhs.size());
+    auto lhs_it = lhs.begin();
+    auto rhs_it = rhs.begin();
+    while (lhs_it != lhs.end() || rhs_it != rhs.end()) {
+        if (rhs_it == rhs.end() || (lhs_it != lhs.end() && lhs_it->first < rhs_it->first)) {
+            result.push_back(*lhs_it++);
+        }
+        else if (lhs_it == lhs.end() || rhs_it->first < lhs_it->first) {
+            result.push_back(*rhs_it++);
+        }
+        else {
+            result.push_back({ lhs_it->first, lhs_it->second + rhs_it->second });
+            ++lhs_it;
+            ++rhs_it;
+        }
     }
     return result;
 }
 
-int SearchServer::ComputeAverageRating(const vector<int>& ratings) {
+template <typename ScoringPolicy>
+typename BasicSearchServer<ScoringPolicy>::ScoredDocuments BasicSearchServer<ScoringPolicy>::IntersectScoredDocuments(const ScoredDocuments& lhs, const ScoredDocuments& rhs) {
+    ScoredDocuments result;
+    auto lhs_it = lhs.begin();
+    auto rhs_it = rhs.begin();
+    while (lhs_it != lhs.end() && rhs_it != rhs.end()) {
+        if (lhs_it->first < rhs_it->first) {
+            ++lhs_it;
+        }
+        else if (rhs_it->first < lhs_it->first) {
+            ++rhs_it;
+        }
+        else {
+            result.push_back({ lhs_it->first, lhs_it->second + rhs_it->second });
+            ++lhs_it;
+            ++rhs_it;
+        }
+    }
+    return result;
+}
+
+template <typename ScoringPolicy>
+void BasicSearchServer<ScoringPolicy>::SubtractScoredDocuments(ScoredDocuments& documents, const ScoredDocuments& excluded) {
+    auto excluded_it = excluded.begin();
+    documents.erase(remove_if(documents.begin(), documents.end(),
+        [&excluded_it, &excluded](const pair<int, double>& document) {
+            while (excluded_it != excluded.end() && excluded_it->first < document.first) {
+                ++excluded_it;
+            }
+            return excluded_it != excluded.end() && excluded_it->first == document.first;
+        }), documents.end());
+}
+
+template <typename ScoringPolicy>
+const DocumentBitmap& BasicSearchServer<ScoringPolicy>::GetStatusDocuments(DocumentStatus status) const {
+    static const DocumentBitmap empty_documents;
+    const auto status_it = status_to_documents_.find(status);
+    return status_it != status_to_documents_.end() ? status_it->second : empty_documents;
+}
+
+template <typename ScoringPolicy>
+void BasicSearchServer<ScoringPolicy>::RemoveFromFilterIndexes(int document_id, const DocumentData& document_data) {
+    memory_stats_.filter_indexes -= GetFilterIndexMemory(document_data.status, document_data.rating);
+    if (const auto status_it = status_to_documents_.find(document_data.status); status_it != status_to_documents_.end()) {
+        status_it->second.Remove(document_id);
+    }
+    if (const auto rating_it = rating_to_documents_.find(document_data.rating); rating_it != rating_to_documents_.end()) {
+        rating_it->second.Remove(document_id);
+        if (rating_it->second.IsEmpty()) {
+            rating_to_documents_.erase(rating_it);
+        }
+    }
+    memory_stats_.filter_indexes += GetFilterIndexMemory(document_data.status, document_data.rating);
+}
+
+template <typename ScoringPolicy>
+size_t BasicSearchServer<ScoringPolicy>::GetFilterIndexMemory(DocumentStatus status, int rating) const {
+    size_t memory = 0;
+    if (const auto status_it = status_to_documents_.find(status); status_it != status_to_documents_.end()) {
+        memory += GetTreeNodeMemory<pair<const DocumentStatus, DocumentBitmap>>() + status_it->second.GetMemory();
+    }
+    if (const auto rating_it = rating_to_documents_.find(rating); rating_it != rating_to_documents_.end()) {
+        memory += GetTreeNodeMemory<pair<const int, DocumentBitmap>>() + rating_it->second.GetMemory();
+    }
+    return memory;
+}
+
+template <typename ScoringPolicy>
+size_t BasicSearchServer<ScoringPolicy>::GetForwardIndexMemory(const DocumentData& document_data) {
+    size_t memory = document_data.words.capacity() * sizeof(string_view);
+    for (const auto& [word, freq] : document_data.word_freqs_) {
+        memory += GetTreeNodeMemory<pair<const string, double>>() + GetStringHeapMemory(word);
+    }
+    return memory;
+}
+
+template <typename ScoringPolicy>
+void BasicSearchServer<ScoringPolicy>::AddStopWord(string stop_word) {
+    const auto [stop_word_it, is_new_word] = stop_words_.insert(move(stop_word));
+    if (is_new_word) {
+        memory_stats_.stop_words += GetTreeNodeMemory<string>() + GetStringHeapMemory(*stop_word_it);
+    }
+}
+
+template <typename ScoringPolicy>
+void BasicSearchServer<ScoringPolicy>::EnforceMemoryBudget() {
+    const size_t memory = memory_stats_.GetTotal();
+    // Сжатие освобождает память удалённых документов в словаре и списках вхождений,
+    // поэтому повторяется после роста индекса или удалений на 1/8 лимита
+    const size_t threshold = memory_budget_ / 8;
+    if (memory_budget_ > 0 && memory > memory_budget_ && (memory >= compacted_memory_ + threshold || removed_memory_ >= threshold)) {
+        Compact();
+    }
+}
+
+template <typename ScoringPolicy>
+bool BasicSearchServer<ScoringPolicy>::IsStopWord(const string_view word) const {
+    return stop_words_.count(word) > 0;
+}
+
+template <typename ScoringPolicy>
+int BasicSearchServer<ScoringPolicy>::ComputeAverageRating(const vector<int>& ratings) {
     if (ratings.empty()) {
         return 0;
     }
@@ -281,10 +947,11 @@ int SearchServer::ComputeAverageRating(const vector<int>& ratings) {
     return rating_sum / static_cast<int>(ratings.size());
 }
 
-//      (  "-")      
-SearchServer::QueryWord SearchServer::ParseQueryWord(string_view text) const {
+// Определяет является ли слово стоп словом(со знаком "-") или находится в вписке стоп слов
+template <typename ScoringPolicy>
+typename BasicSearchServer<ScoringPolicy>::QueryWord BasicSearchServer<ScoringPolicy>::ParseQueryWord(string_view text) const {
     bool is_minus = false;
-    // Word shouldn't be empty
+    // Word shouldn't be empty, WordTokenizer doesn't produce empty words
     if (text[0] == '-') {
         is_minus = true;
         text.remove_prefix(1);
@@ -296,15 +963,81 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(string_view text) const {
     };
 }
 
-//         (    "-")
-SearchServer::Query SearchServer::ParseQuery(string_view text) const {
-    Query query;    
+// Разбивает входной текст на плюс слова и минус слова(перед которыми есть знак "-")
+template <typename ScoringPolicy>
+typename BasicSearchServer<ScoringPolicy>::Query BasicSearchServer<ScoringPolicy>::ParseQuery(string_view text) const {
+    Query query;
+    ParseQuery(text, query);
+    return query;
+}
+
+template <typename ScoringPolicy>
+void BasicSearchServer<ScoringPolicy>::ParseQuery(string_view text, Query& query) const {
+    LATENCY_TIMER(LatencyOperation::PARSE_QUERY);
+    ALLOCATION_SCOPE(LatencyOperation::PARSE_QUERY);
+    query.plus_words.clear();
+    query.minus_words.clear();
+    query.phrases.clear();
+    query.has_wildcards = false;
+    query.weighted_words.clear();
+
+    // Фраза в кавычках: "funny pet"
+    bool in_phrase = false;
+    int phrase_position = 0;
+    Phrase phrase;
+
+    // Спецсимволы проверяются при разбиении на слова
+    for (string_view word : WordTokenizer(text)) {
+        if (!in_phrase && word[0] == '"') {
+            in_phrase = true;
+            phrase_position = 0;
+            phrase.words.clear();
+            phrase.offsets.clear();
+            word.remove_prefix(1);
+        }
+        else if (!in_phrase && word.size() >= 2 && word[0] == '-' && word[1] == '"') {
+            throw invalid_argument("minus phrases are not supported");
+        }
+        if (in_phrase) {
+            const bool is_phrase_end = !word.empty() && word.back() == '"';
+            if (is_phrase_end) {
+                word.remove_suffix(1);
+            }
+            if (!word.empty()) {
+                if (!IsStopWord(word)) {
+                    phrase.words.push_back(word);
+                    phrase.offsets.push_back(phrase_position);
+                }
+                ++phrase_position;
+            }
+            if (is_phrase_end) {
+                in_phrase = false;
+                if (phrase.words.size() == 1) {
+                    query.plus_words.push_back(phrase.words.front());
+                }
+                else if (phrase.words.size() > 1) {
+                    if (!positional_index_) {
+                        throw invalid_argument("phrase queries require positional index");
+                    }
+                    // Смещения отсчитываются от первого не стоп-слова
+                    const int first_offset = phrase.offsets.front();
+                    for (int& offset : phrase.offsets) {
+                        offset -= first_offset;
+                    }
+                    query.phrases.push_back(phrase);
+                }
+            }
+            continue;
+        }
 
-    for (string_view word : SplitIntoWords(text)) {
         QueryWord query_word = ParseQueryWord(word);
-        //    
-        if (NoSpecSymbols(word) && NoWrongMinuses(word)) {
-            if (!query_word.is_stop && !query_word.is_minus) {
+        // Проверяем слово на валидность
+        if (NoWrongMinuses(word)) {
+            if (query_word.data.find('*') != string_view::npos) {
+                query.has_wildcards = true;
+                ExpandWildcard(query_word.data, query_word.is_minus ? query.minus_words : query.plus_words);
+            }
+            else if (!query_word.is_stop && !query_word.is_minus) {
                 query.plus_words.push_back(word);
             }
             else {
@@ -315,20 +1048,213 @@ SearchServer::Query SearchServer::ParseQuery(string_view text) const {
         }
     }
 
+    if (in_phrase) {
+        throw invalid_argument("unbalanced quotes");
+    }
+
     sort(query.plus_words.begin(), query.plus_words.end());
     auto plus_words_end = unique(query.plus_words.begin(), query.plus_words.end());
     query.plus_words.resize(distance(query.plus_words.begin(), plus_words_end));
 
-    return query;
+    // Минус слова тоже сортируем: матчинг сливает их с прямым индексом документа
+    sort(query.minus_words.begin(), query.minus_words.end());
+    auto minus_words_end = unique(query.minus_words.begin(), query.minus_words.end());
+    query.minus_words.resize(distance(query.minus_words.begin(), minus_words_end));
 }
 
-// Existence required
-double SearchServer::ComputeWordInverseDocumentFreq(const string& word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+template <typename ScoringPolicy>
+void BasicSearchServer<ScoringPolicy>::AddFuzzyWords(Query& query) const {
+    const size_t MIN_ONE_EDIT_LENGTH = 3;
+    const size_t MIN_TWO_EDITS_LENGTH = 6;
+
+    vector<pair<int, const pair<const string, PostingList>*>> words; // [расстояние, слово словаря]
+    string prefix;
+    for (const string_view word : query.plus_words) {
+        if (word.size() < MIN_ONE_EDIT_LENGTH) {
+            continue;
+        }
+        const LevenshteinAutomaton automaton(word, word.size() < MIN_TWO_EDITS_LENGTH ? 1 : 2);
+        words.clear();
+        prefix.clear();
+        CollectFuzzyWords(automaton, prefix, automaton.Start(), words);
+
+        // Ближайшие слова, при равном расстоянии - более частые
+        sort(words.begin(), words.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.first < rhs.first
+                || (lhs.first == rhs.first && lhs.second->second.size() > rhs.second->second.size());
+        });
+        if (words.size() > static_cast<size_t>(MAX_FUZZY_EXPANSIONS)) {
+            words.resize(MAX_FUZZY_EXPANSIONS);
+        }
+        for (const auto& [distance, dictionary_word] : words) {
+            // Плюс слова запроса (в том числе само слово) уже учитываются с полным весом
+            if (!binary_search(query.plus_words.begin(), query.plus_words.end(), dictionary_word->first)) {
+                query.weighted_words.push_back({ dictionary_word->first, pow(FUZZY_DISTANCE_PENALTY, distance) });
+            }
+        }
+    }
+
+    // Слово, похожее на несколько слов запроса, учитывается один раз с наибольшим весом
+    sort(query.weighted_words.begin(), query.weighted_words.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first < rhs.first || (lhs.first == rhs.first && lhs.second > rhs.second);
+    });
+    query.weighted_words.erase(unique(query.weighted_words.begin(), query.weighted_words.end(),
+        [](const auto& lhs, const auto& rhs) {
+            return lhs.first == rhs.first;
+        }), query.weighted_words.end());
 }
 
-//      
-bool SearchServer::NoSpecSymbols(const string_view word) {    
+template <typename ScoringPolicy>
+void BasicSearchServer<ScoringPolicy>::CollectFuzzyWords(const LevenshteinAutomaton& automaton, string& prefix, const LevenshteinAutomaton::State& state,
+    vector<pair<int, const pair<const string, PostingList>*>>& words) const {
+    auto word_it = word_to_document_freqs_.lower_bound(prefix);
+    if (word_it != word_to_document_freqs_.end() && word_it->first == prefix) {
+        if (automaton.IsMatch(state) && !word_it->second.empty()) {
+            words.push_back({ automaton.GetDistance(state), &*word_it });
+        }
+        ++word_it;
+    }
+
+    // Дети префикса - различные символы, стоящие после него в словах диапазона.
+    // Каждый ребёнок находится одним lower_bound, поддеревья с "мёртвым" состоянием пропускаются целиком
+    LevenshteinAutomaton::State next_state;
+    while (word_it != word_to_document_freqs_.end() && word_it->first.compare(0, prefix.size(), prefix) == 0) {
+        const char c = word_it->first[prefix.size()];
+        automaton.Step(state, c, next_state);
+        if (automaton.CanMatch(next_state)) {
+            prefix.push_back(c);
+            CollectFuzzyWords(automaton, prefix, next_state, words);
+            prefix.pop_back();
+        }
+        if (static_cast<unsigned char>(c) == numeric_limits<unsigned char>::max()) {
+            break;
+        }
+        prefix.push_back(static_cast<char>(c + 1));
+        word_it = word_to_document_freqs_.lower_bound(prefix);
+        prefix.pop_back();
+    }
+}
+
+template <typename ScoringPolicy>
+void BasicSearchServer<ScoringPolicy>::ExpandWildcard(string_view pattern, vector<string_view>& words) const {
+    const string_view prefix = pattern.substr(0, pattern.find('*'));
+    if (prefix.empty()) {
+        throw invalid_argument("wildcard without prefix");
+    }
+
+    // Словарь упорядочен, поэтому слова с префиксом лежат одним диапазоном
+    vector<pair<size_t, string_view>> candidates; // [кол-во документов, слово]
+    for (auto word_it = word_to_document_freqs_.lower_bound(prefix);
+        word_it != word_to_document_freqs_.end() && word_it->first.compare(0, prefix.size(), prefix) == 0;
+        ++word_it) {
+        if (!word_it->second.empty() && MatchesWildcard(word_it->first, pattern)) {
+            candidates.push_back({ word_it->second.size(), word_it->first });
+        }
+    }
+
+    if (candidates.size() > static_cast<size_t>(MAX_WILDCARD_EXPANSIONS)) {
+        nth_element(candidates.begin(), candidates.begin() + MAX_WILDCARD_EXPANSIONS, candidates.end(),
+            [](const auto& lhs, const auto& rhs) {
+                return lhs.first > rhs.first;
+            });
+        candidates.resize(MAX_WILDCARD_EXPANSIONS);
+    }
+    for (const auto& [_, word] : candidates) {
+        words.push_back(word);
+    }
+}
+
+template <typename ScoringPolicy>
+CollectionStatistics BasicSearchServer<ScoringPolicy>::GetCollectionStatistics() const {
+    CollectionStatistics statistics;
+    statistics.document_count = GetDocumentCount();
+    if (statistics.document_count > 0) {
+        statistics.average_document_length = static_cast<double>(total_document_length_) / statistics.document_count;
+    }
+    return statistics;
+}
+
+template <typename ScoringPolicy>
+typename BasicSearchServer<ScoringPolicy>::WordScorer BasicSearchServer<ScoringPolicy>::GetWordScorer(const PostingList& postings, double weight) const {
+    return WordScorer(GetCollectionStatistics(), postings.size(), weight);
+}
+
+template <typename ScoringPolicy>
+typename BasicSearchServer<ScoringPolicy>::WordScorer BasicSearchServer<ScoringPolicy>::GetWordScorer(string_view word, const PostingList& postings,
+    double weight, const TermStatistics* statistics) const {
+    if (statistics == nullptr) {
+        return GetWordScorer(postings, weight);
+    }
+    const auto freq_it = statistics->document_freqs.find(word);
+    const size_t document_freq = freq_it != statistics->document_freqs.end() ? freq_it->second : postings.size();
+    return WordScorer(statistics->collection, document_freq, weight);
+}
+
+template <typename ScoringPolicy>
+bool BasicSearchServer<ScoringPolicy>::IsRankedBefore(const Document& lhs, const Document& rhs) {
+    if (std::fabs(lhs.relevance - rhs.relevance) < RELEVANCE_PRECISION) {
+        if (lhs.rating != rhs.rating) {
+            return lhs.rating > rhs.rating;
+        }
+        return lhs.id < rhs.id;
+    }
+    else {
+        return lhs.relevance > rhs.relevance;
+    }
+}
+
+template <typename ScoringPolicy>
+void BasicSearchServer<ScoringPolicy>::SelectTopDocuments(vector<Document>& documents) {
+    LATENCY_TIMER(LatencyOperation::SELECT_TOP_DOCUMENTS);
+    ALLOCATION_SCOPE(LatencyOperation::SELECT_TOP_DOCUMENTS);
+    // Полная сортировка не нужна, достаточно упорядочить первые MAX_RESULT_DOCUMENT_COUNT документов
+    const auto top_end = documents.begin() + min<size_t>(documents.size(), MAX_RESULT_DOCUMENT_COUNT);
+    partial_sort(documents.begin(), top_end, documents.end(), IsRankedBefore);
+    documents.erase(top_end, documents.end());
+}
+
+template <typename ScoringPolicy>
+bool BasicSearchServer<ScoringPolicy>::IsPageRankedBefore(const Document& lhs, const Document& rhs) {
+    const long long lhs_relevance = std::llround(lhs.relevance / RELEVANCE_PRECISION);
+    const long long rhs_relevance = std::llround(rhs.relevance / RELEVANCE_PRECISION);
+    if (lhs_relevance != rhs_relevance) {
+        return lhs_relevance > rhs_relevance;
+    }
+    if (lhs.rating != rhs.rating) {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.id < rhs.id;
+}
+
+template <typename ScoringPolicy>
+SearchPage BasicSearchServer<ScoringPolicy>::SelectPageDocuments(vector<Document> documents, size_t page_size, const optional<SearchCursor>& after) {
+    LATENCY_TIMER(LatencyOperation::SELECT_TOP_DOCUMENTS);
+    ALLOCATION_SCOPE(LatencyOperation::SELECT_TOP_DOCUMENTS);
+    if (after) {
+        const Document cursor_document(after->document_id, after->relevance, after->rating);
+        documents.erase(remove_if(documents.begin(), documents.end(),
+            [&cursor_document](const Document& document) {
+                return !IsPageRankedBefore(cursor_document, document);
+            }),
+            documents.end());
+    }
+
+    SearchPage page;
+    const bool has_next_page = documents.size() > page_size;
+    const auto page_end = documents.begin() + min(documents.size(), page_size);
+    partial_sort(documents.begin(), page_end, documents.end(), IsPageRankedBefore);
+    documents.erase(page_end, documents.end());
+    if (has_next_page) {
+        const Document& last = documents.back();
+        page.next_cursor = SearchCursor{ last.relevance, last.rating, last.id };
+    }
+    page.documents = move(documents);
+    return page;
+}
+
+// Проверка отдельного слова на наличие спецсимволов
+template <typename ScoringPolicy>
+bool BasicSearchServer<ScoringPolicy>::NoSpecSymbols(const string_view word) {    
     if (!none_of(word.begin(), word.end(), [](char c) {
         return c >= '\0' && c < ' ';
         })) {
@@ -337,17 +1263,21 @@ bool SearchServer::NoSpecSymbols(const string_view word) {
     return true;
 }
 
-//     :
-// -      "" 
-// -         
-bool SearchServer::NoWrongMinuses(const string_view word) {
+// Проверка отдельного слова на :
+// - то что слово не является "одиноким" минусом
+// - то что перед словом не идут подряд несколько минусов
+template <typename ScoringPolicy>
+bool BasicSearchServer<ScoringPolicy>::NoWrongMinuses(const string_view word) {
     if (word == "-") throw invalid_argument("lonely minus");
     if ((word.size() >= 2) && (word[0] == '-') && (word[1] == '-')) throw invalid_argument("too many minuses");
     return true;
 }
 
+template class BasicSearchServer<TfIdfScoring>;
+template class BasicSearchServer<Bm25Scoring>;
+
 //---------------------------------------------------------------------
-//--------------     SearchServer--------------
+//--------------Внешние функции для работы с SearchServer--------------
 void PrintDocument(const Document& document) {
     cout << "{ "s
         << "document_id = "s << document.id << ", "s
@@ -372,35 +1302,35 @@ void AddDocument(SearchServer& search_server, int document_id, const string& doc
         search_server.AddDocument(document_id, document, status, ratings);
     }
     catch (const exception& e) {
-        cout << "   "s << document_id << ": "s << e.what() << endl;
+        cout << "Ошибка добавления документа "s << document_id << ": "s << e.what() << endl;
     }
 }
 
 void FindTopDocuments(const SearchServer& search_server, const string& raw_query) {
     LOG_DURATION_STREAM("Operation time", cout);
-    cout << "   : "s << raw_query << endl;
+    cout << "Результаты поиска по запросу: "s << raw_query << endl;
     try {
         for (const Document& document : search_server.FindTopDocuments(raw_query)) {
             PrintDocument(document);
         }
     }
     catch (const exception& e) {
-        cout << " : "s << e.what() << endl;
+        cout << "Ошибка поиска: "s << e.what() << endl;
     }
 }
 
 void MatchDocuments(const SearchServer& search_server, const string& query) {
     LOG_DURATION_STREAM("Operation time", cout);
     try {
-        cout << "   : "s << query << endl;        
+        cout << "Матчинг документов по запросу: "s << query << endl;        
         
-        for (const int document_id : search_server) {
-            const auto [words, status] = search_server.MatchDocument(query, document_id);
+        for (const auto& [document_id, matched_words] : search_server.MatchDocuments(execution::par, query)) {
+            const auto& [words, status] = matched_words;
             PrintMatchDocumentResult(document_id, words, status);
         }
 
     }
     catch (const exception& e) {
-        cout << "     "s << query << ": "s << e.what() << endl;
+        cout << "Ошибка матчинга документов на запрос "s << query << ": "s << e.what() << endl;
     }
 }
\ No newline at end of file
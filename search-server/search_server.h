@@ -10,47 +10,87 @@
 #include <string>
 #include <deque>
 #include <execution>
+#include <functional>
 #include <string_view>
 #include <limits>
+#include <numeric>
+#include <optional>
+#include <thread>
 #include <type_traits>
 
 #include "string_processing.h"
 #include "document.h"
+#include "document_bitmap.h"
+#include "document_filter.h"
+#include "search_page.h"
+#include "memory_stats.h"
 #include "log_duration.h"
+#include "latency_histogram.h"
+#include "allocation_counter.h"
+#include "query_profile.h"
 #include "concurrent_map.h"
+#include "posting_list.h"
+#include "boolean_query.h"
+#include "levenshtein_automaton.h"
+#include "scoring_policy.h"
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
+// Максимальное кол-во слов, в которые раскрывается шаблон со звёздочкой (ca*)
+const int MAX_WILDCARD_EXPANSIONS = 64;
+// Нечёткий поиск: максимальное кол-во похожих слов для слова запроса и множитель релевантности
+// за каждую правку (релевантность слова на расстоянии d умножается на FUZZY_DISTANCE_PENALTY^d)
+const int MAX_FUZZY_EXPANSIONS = 16;
+const double FUZZY_DISTANCE_PENALTY = 0.5;
 const double RELEVANCE_PRECISION = 1e-6;
 
 using MatchedWords = std::tuple<std::vector<std::string_view>, DocumentStatus>;
+
+// Режим поиска: документ содержит хотя бы одно из плюс слов (ANY_WORD), все плюс слова (ALL_WORDS)
+// или запрос является логическим выражением с операторами AND, OR, NOT и скобками (BOOLEAN, см. boolean_query.h).
+// FUZZY - как ANY_WORD, но к плюс словам добавляются слова словаря, отличающиеся от них на 1-2 правки (опечатки)
+enum class QueryMode {
+    ANY_WORD,
+    ALL_WORDS,
+    BOOLEAN,
+    FUZZY,
+};
 //------------------------------------------------------------------
-//------------------  SearchServer----------------------
-class SearchServer {
+//------------------Начало класса SearchServer----------------------
+// Поисковый сервер с политикой ранжирования ScoringPolicy (см. scoring_policy.h)
+template <typename ScoringPolicy = TfIdfScoring>
+class BasicSearchServer {
 public:    
     void SetStopWords(const std::string_view text);
 
-    //     set     
+    // Шаблонный конкструктор для контейнеров set и вектор   
     template<typename Container>
-    explicit SearchServer(Container input_stop_words);
-    //   string -    
-    explicit SearchServer(std::string stop_words = "");
-    explicit SearchServer(std::string_view stop_words);
+    explicit BasicSearchServer(Container input_stop_words);
+    //Конструктор от аргумента string - строка со стоп словами
+    explicit BasicSearchServer(std::string stop_words = "");
+    explicit BasicSearchServer(std::string_view stop_words);
+
+    // Включает позиционный индекс: для каждого вхождения слова хранятся его позиции в документе,
+    // что позволяет искать фразы в кавычках ("funny pet"). Включается до добавления документов
+    void EnablePositionalIndex();
+    bool HasPositionalIndex() const;
+    // Память, занимаемая позициями слов, в байтах
+    size_t GetPositionalIndexMemory() const;
 
     // Adding new document to search server
     void AddDocument(int document_id, const std::string& document, DocumentStatus status, const std::vector<int>& ratings);
 
-    //     id
+    // Удаление документа с заданным id
     void RemoveDocument(int document_id);    
     void RemoveDocument(std::execution::sequenced_policy, int document_id);
     void RemoveDocument(std::execution::parallel_policy, int document_id);
 
-    //  MAX_RESULT_DOCUMENT_COUNT 
+    // Поиск MAX_RESULT_DOCUMENT_COUNT документов
     template <typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const;
     std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const;
     std::vector<Document> FindTopDocuments(const std::string_view raw_query) const;       
         
-    //  MAX_RESULT_DOCUMENT_COUNT ,     
+    // Поиск MAX_RESULT_DOCUMENT_COUNT документов, с возможностью задания политики исполнения
     template <typename ExecutionPolicy, typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query, DocumentPredicate document_predicate) const;
     template <typename ExecutionPolicy>
@@ -58,16 +98,105 @@ public:
     template <typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query) const;
 
+    // Поиск MAX_RESULT_DOCUMENT_COUNT документов в заданном режиме. В режиме ALL_WORDS списки документов
+    // плюс слов пересекаются от самого короткого к самому длинному, релевантность считается только для пересечения.
+    // В режиме BOOLEAN по дереву запроса строится план выполнения, результат получается за один проход по плану.
+    // В режиме FUZZY похожие слова ищутся обходом словаря автоматом Левенштейна
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query, QueryMode mode, DocumentPredicate document_predicate) const;
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query, QueryMode mode, DocumentStatus status) const;
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query, QueryMode mode) const;
+
+    // Поиск с декларативным фильтром. Фильтр компилируется в битовую карту документов по индексам
+    // статусов и рейтингов, вхождения слов проверяются по ней без обращения к данным документа.
+    // Скомпилированную карту (CompileFilter) можно передавать вместо предиката, в том числе через std::cref
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, const DocumentFilter& filter) const;
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query, const DocumentFilter& filter) const;
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query, QueryMode mode, const DocumentFilter& filter) const;
+    DocumentBitmap CompileFilter(const DocumentFilter& filter) const;
+
+    // Постраничный поиск: page_size документов, следующих в порядке выдачи за курсором after
+    // (без курсора - с начала). Документы на курсоре и до него отбрасываются до упорядочивания,
+    // сортируется только страница, поэтому глубокие страницы не требуют сортировки всей выдачи
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    SearchPage FindDocumentsPage(ExecutionPolicy policy, const std::string_view raw_query, QueryMode mode, size_t page_size,
+        const std::optional<SearchCursor>& after, DocumentPredicate document_predicate) const;
+    template <typename ExecutionPolicy>
+    SearchPage FindDocumentsPage(ExecutionPolicy policy, const std::string_view raw_query, QueryMode mode, size_t page_size,
+        const std::optional<SearchCursor>& after = std::nullopt) const;
+    SearchPage FindDocumentsPage(const std::string_view raw_query, size_t page_size,
+        const std::optional<SearchCursor>& after = std::nullopt) const;
+
+    // Поиск в режиме ANY_WORD с профилем выполнения (EXPLAIN): разобранный запрос, длины списков документов,
+    // кол-во просмотренных вхождений и вызовов предиката, кандидаты, вычеркнутые минус словами документы
+    // и время этапов. При параллельной политике - распределение работы по потокам. Профиль заполняется заново.
+    // Профилирование задаётся параметром шаблона поиска, остальные перегрузки за него не платят
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query, DocumentPredicate document_predicate, QueryProfile& profile) const;
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query, QueryProfile& profile) const;
+
+    // Переиспользуемые буферы запроса: слова запроса, накопитель релевантности и результат.
+    // Контекст заводится на поток, после "прогрева" поиск через контекст не выделяет память
+    class QueryContext;
+
+    // Поиск MAX_RESULT_DOCUMENT_COUNT документов с использованием буферов контекста,
+    // результат хранится в контексте до следующего запроса
+    template <typename DocumentPredicate>
+    const std::vector<Document>& FindTopDocuments(QueryContext& context, const std::string_view raw_query, DocumentPredicate document_predicate) const;
+    const std::vector<Document>& FindTopDocuments(QueryContext& context, const std::string_view raw_query, DocumentStatus status) const;
+    const std::vector<Document>& FindTopDocuments(QueryContext& context, const std::string_view raw_query) const;
+
+    // Статистика слов, по которым этот сервер оценивал бы запрос (QueryMode::ANY_WORD): кол-во и средняя длина
+    // документов, кол-во документов с каждым плюс словом, словом фразы и раскрытием шаблона
+    TermStatistics GetTermStatistics(const std::string_view raw_query) const;
+    // Поиск шарда коллекции: релевантность считается по статистике statistics, сложенной по всем шардам.
+    // Для слова без статистики используется своя частота
+    template <typename DocumentPredicate>
+    const std::vector<Document>& FindTopDocuments(QueryContext& context, const std::string_view raw_query, DocumentPredicate document_predicate,
+        const TermStatistics& statistics) const;
+    const std::vector<Document>& FindTopDocuments(QueryContext& context, const std::string_view raw_query, DocumentStatus status,
+        const TermStatistics& statistics) const;
+    // Порядок выдачи: по убыванию релевантности, при равной релевантности - по убыванию рейтинга, затем по id.
+    // Нужен и при слиянии выдачи нескольких шардов
+    static bool IsRankedBefore(const Document& lhs, const Document& rhs);
+
     MatchedWords MatchDocument(const std::string& raw_query, int document_id) const;
     MatchedWords MatchDocument(std::execution::sequenced_policy, const std::string_view raw_query, int document_id) const;
     MatchedWords MatchDocument(std::execution::parallel_policy, const std::string_view raw_query, int document_id) const;
 
+    // Матчинг запроса с набором документов: запрос разбирается один раз, документы обрабатываются
+    // в соответствии с политикой исполнения. Результат упорядочен по id документа
+    template <typename ExecutionPolicy, typename DocumentIdIterator>
+    std::vector<std::pair<int, MatchedWords>> MatchDocuments(ExecutionPolicy policy, const std::string_view raw_query,
+        DocumentIdIterator first, DocumentIdIterator last) const;
+    // Матчинг запроса со всеми документами
+    template <typename ExecutionPolicy>
+    std::vector<std::pair<int, MatchedWords>> MatchDocuments(ExecutionPolicy policy, const std::string_view raw_query) const;
+
 
-    //       Id 
+    // Получение слов и их частоты по Id документа
     const std::map<std::string, double>& GetWordFrequencies(int document_id) const;
+    // Номер добавления документа: растёт с каждым AddDocument, поэтому документ, удалённый и добавленный
+    // заново под тем же id, получает новый номер. Для отсутствующего документа - 0
+    uint64_t GetDocumentVersion(int document_id) const;
 
     int GetDocumentCount() const;
 
+    // Память индекса по структурам. Ведётся при добавлении и удалении документов, без обхода индекса
+    const MemoryStats& GetMemoryStats() const;
+    // Мягкий лимит памяти индекса в байтах, 0 - без лимита. Если после добавления или удаления документа
+    // лимит превышен, выполняется Compact. Если сжатие не опустило память ниже лимита, следующее
+    // выполняется после роста памяти или удаления документов ещё на 1/8 лимита
+    void SetMemoryBudget(size_t bytes);
+    // Удаляет из словаря слова, не встречающиеся ни в одном документе, и освобождает ёмкость
+    // списков вхождений, оставшуюся после удаления документов
+    void Compact();
+
     std::set<int>::const_iterator begin() const;
     std::set<int>::const_iterator end() const;   
 
@@ -76,12 +205,26 @@ private:
         int rating;
         DocumentStatus status;
         std::map<std::string, double> word_freqs_; // [word, word_freq] in document
+        std::vector<std::string_view> words; // отсортированные слова документа (ссылки на ключи word_to_document_freqs_)
+        int length; // кол-во слов без стоп-слов
+        uint64_t version; // номер добавления, см. GetDocumentVersion
+    };
+
+    // Фраза запроса: слова в порядке следования и их смещения относительно первого слова
+    // (стоп-слова внутри фразы не ищутся, но занимают позицию)
+    struct Phrase {
+        std::vector<std::string_view> words;
+        std::vector<int> offsets;
     };
 
-    //     
+    // Структура для хранения слов запроса
     struct Query {
         std::vector<std::string_view> plus_words;
         std::vector<std::string_view> minus_words;
+        std::vector<Phrase> phrases;
+        bool has_wildcards = false;
+        // Слова с множителем релевантности [word, weight] (похожие слова нечёткого поиска)
+        std::vector<std::pair<std::string_view, double>> weighted_words;
     };
 
     struct QueryWord {
@@ -90,211 +233,898 @@ private:
         bool is_stop;
     };
 
-    std::set<std::string> stop_words_;    
+    std::set<std::string, std::less<>> stop_words_;    
     std::map<int, DocumentData> documents_; // [document_id, DocumentData]
-    std::set<int> document_ids_;//         
+    std::set<int> document_ids_;// Идентификаторы документов в порядке добавления    
+
+    std::map<std::string, PostingList, std::less<>> word_to_document_freqs_; // [word, [document_id, word_freq]]    
+    bool positional_index_ = false;
+    long long total_document_length_ = 0; // для средней длины документа
+    uint64_t last_document_version_ = 0;
+    // Индексы для фильтров, обновляются при добавлении и удалении документов
+    std::map<DocumentStatus, DocumentBitmap> status_to_documents_;
+    std::map<int, DocumentBitmap> rating_to_documents_;
 
-    std::map<std::string, std::map<int, double>> word_to_document_freqs_; // [word, [document_id, word_freq]]    
+    MemoryStats memory_stats_;
+    size_t memory_budget_ = 0;
+    size_t compacted_memory_ = 0; // память сразу после последнего сжатия
+    size_t removed_memory_ = 0;   // память удалённых после последнего сжатия документов
 
-    std::vector<std::string_view> SplitIntoWordsNoStop(const std::string_view text) const;
+    void AddStopWord(std::string stop_word);
+    // Память документа в прямом индексе
+    static size_t GetForwardIndexMemory(const DocumentData& document_data);
+    // Память битовых карт статуса и рейтинга вместе с узлами словарей
+    size_t GetFilterIndexMemory(DocumentStatus status, int rating) const;
+    // Сжатие при превышении лимита памяти
+    void EnforceMemoryBudget();
 
-    //         (    "-") 
+    // Разбивает входной текст на плюс слова и минус слова(перед которыми есть знак "-") 
     Query ParseQuery(std::string_view text) const;
+    // Разбор запроса в уже существующую структуру, память векторов переиспользуется
+    void ParseQuery(std::string_view text, Query& query) const;
     QueryWord ParseQueryWord(std::string_view text) const;
+    // Раскрывает шаблон со звёздочками (ca*, c*t*) в слова словаря, добавляя их в words.
+    // Шаблон должен начинаться с префикса без звёздочек: слова ищутся только в диапазоне словаря
+    // с этим префиксом. Если подходящих слов больше MAX_WILDCARD_EXPANSIONS, остаются самые частые
+    void ExpandWildcard(std::string_view pattern, std::vector<std::string_view>& words) const;
+    // Добавляет в weighted_words запроса слова словаря, похожие на плюс слова. Допустимое кол-во правок
+    // зависит от длины слова: короткие слова (до 3 символов) не расширяются, до 6 символов - 1 правка, иначе 2
+    void AddFuzzyWords(Query& query) const;
+    // Обход словаря как дерева префиксов: поддерево префикса prefix посещается, только если
+    // автомат из состояния state ещё может принять какое-то продолжение. Найденные слова - в words
+    void CollectFuzzyWords(const LevenshteinAutomaton& automaton, std::string& prefix, const LevenshteinAutomaton::State& state,
+        std::vector<std::pair<int, const std::pair<const std::string, PostingList>*>>& words) const;
 
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
-    double ComputeWordInverseDocumentFreq(const std::string& word) const;
+    // Документы с заданным статусом
+    const DocumentBitmap& GetStatusDocuments(DocumentStatus status) const;
+    // Убирает документ из индексов статусов и рейтингов
+    void RemoveFromFilterIndexes(int document_id, const DocumentData& document_data);
+    // Проверка документа предикатом: битовая карта проверяется напрямую,
+    // произвольному предикату передаются статус и рейтинг документа
+    template <typename DocumentPredicate>
+    bool IsDocumentAllowed(const DocumentPredicate& document_predicate, int document_id) const;
+
+    // Данные документа, при отсутствии документа выбрасывает out_of_range
+    const DocumentData& GetDocumentData(int document_id) const;
+    // Матчинг разобранного запроса с прямым индексом документа
+    MatchedWords MatchQuery(const Query& query, int document_id, const DocumentData& document_data) const;
+    // Добавляет в matched_words слова фраз запроса, найденных в документе, и упорядочивает результат
+    void AddMatchedPhraseWords(const Query& query, int document_id, const DocumentData& document_data,
+        std::vector<std::string_view>& matched_words) const;
+
+    using WordScorer = typename ScoringPolicy::WordScorer;
+
+    CollectionStatistics GetCollectionStatistics() const;
+    // Оценка вхождений слова по политике ранжирования. Список документов слова не пуст
+    WordScorer GetWordScorer(const PostingList& postings, double weight = 1.0) const;
+    // То же по внешней статистике (поиск шарда), statistics == nullptr - своя статистика
+    WordScorer GetWordScorer(std::string_view word, const PostingList& postings, double weight, const TermStatistics* statistics) const;
+
+    // Сортирует документы в порядке выдачи и оставляет MAX_RESULT_DOCUMENT_COUNT первых
+    static void SelectTopDocuments(std::vector<Document>& documents);
+    // Оставляет page_size документов, следующих за курсором, и формирует страницу
+    static SearchPage SelectPageDocuments(std::vector<Document> documents, size_t page_size, const std::optional<SearchCursor>& after);
+    // Порядок страниц: как IsRankedBefore, но релевантность округляется до RELEVANCE_PRECISION.
+    // Сравнение с погрешностью не транзитивно (a ~ b, b ~ c, но a > c), и курсор пропускал бы или повторял документы
+    static bool IsPageRankedBefore(const Document& lhs, const Document& rhs);
+
+    // Все подходящие документы запроса в заданном режиме, без упорядочивания
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindMatchedDocuments(ExecutionPolicy policy, const std::string_view raw_query, QueryMode mode, DocumentPredicate document_predicate) const;
 
-    //      document_predicate.  
+    // Находит все подходящие документы соответствующие document_predicate. Последовательная версия,
+    // запрос берётся из контекста, результат записывается в context.result_
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(std::execution::sequenced_policy, const SearchServer::Query& query, DocumentPredicate document_predicate) const;
+    void FindAllDocuments(QueryContext& context, DocumentPredicate document_predicate) const;
+    template <typename DocumentPredicate, typename Profiler>
+    void FindAllDocuments(QueryContext& context, DocumentPredicate document_predicate, Profiler& profiler) const;
     
-    //      document_predicate.  
+    // Находит все подходящие документы соответствующие document_predicate. Параллельная версия
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(std::execution::parallel_policy, const SearchServer::Query& query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindAllDocuments(std::execution::parallel_policy, const Query& query, DocumentPredicate document_predicate) const;
+    template <typename DocumentPredicate, typename Profiler>
+    std::vector<Document> FindAllDocuments(std::execution::parallel_policy, const Query& query, DocumentPredicate document_predicate, Profiler& profiler) const;
+
+    // Находит документы, содержащие все плюс слова запроса. При параллельной политике
+    // самый короткий список документов делится на части, которые пересекаются независимо
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindAllDocumentsWithAllWords(ExecutionPolicy policy, const Query& query, DocumentPredicate document_predicate) const;
+
+    // Узел плана выполнения логического запроса
+    struct QueryPlanNode {
+        QueryNode::Type type = QueryNode::Type::OR;
+        const PostingList* postings = nullptr; // для TERM, nullptr если слово не встречается в документах
+        WordScorer scorer;                     // для TERM
+        std::vector<QueryPlanNode> children;   // плюс-части AND и OR, упорядочены по возрастанию стоимости
+        std::vector<QueryPlanNode> excluded;   // части AND под NOT
+        size_t cost = 0;                       // оценка кол-ва документов узла по длинам списков
+        // Для AND: документы ведущей (самой дешёвой) части проверяются по остальным частям поштучно
+        // (document-at-a-time), иначе все части вычисляются целиком и пересекаются (term-at-a-time)
+        bool document_at_a_time = false;
+    };
+
+    // Документы с релевантностью [document_id, relevance], упорядочены по id
+    using ScoredDocuments = std::vector<std::pair<int, double>>;
+
+    // Строит план выполнения узла. nullopt - узел не влияет на результат (например, состоит из стоп-слов)
+    std::optional<QueryPlanNode> BuildQueryPlan(const QueryNode& node) const;
+
+    // Вычисляет все документы узла плана
+    template <typename ExecutionPolicy>
+    ScoredDocuments EvaluateQueryPlan(ExecutionPolicy policy, const QueryPlanNode& node) const;
 
-    //     :
-    //       
+    // Проверяет, подходит ли документ под узел плана, и добавляет его релевантность по узлу
+    static bool ProbeQueryPlan(const QueryPlanNode& node, int document_id, double& relevance);
+
+    // Объединение и пересечение упорядоченных по id наборов документов, релевантность складывается
+    static ScoredDocuments UniteScoredDocuments(const ScoredDocuments& lhs, const ScoredDocuments& rhs);
+    static ScoredDocuments IntersectScoredDocuments(const ScoredDocuments& lhs, const ScoredDocuments& rhs);
+    // Убирает из documents документы, входящие в excluded
+    static void SubtractScoredDocuments(ScoredDocuments& documents, const ScoredDocuments& excluded);
+
+    // Проверка фразы по позициям слов. postings[i] - вхождение документа в список lists[i] i-го слова фразы
+    static bool MatchPhrasePositions(const Phrase& phrase, const std::vector<const PostingList*>& lists,
+        const std::vector<PostingList::const_iterator>& postings);
+    // Содержит ли документ фразу
+    bool MatchesPhrase(const Phrase& phrase, int document_id) const;
+    // Документы, содержащие фразу, с релевантностью по словам фразы. Списки слов пересекаются,
+    // позиции распаковываются только для документов, в которых есть все слова фразы
+    ScoredDocuments FindPhraseDocuments(const Phrase& phrase, const TermStatistics* statistics = nullptr) const;
+
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindAllDocumentsBoolean(ExecutionPolicy policy, const QueryNode& query, DocumentPredicate document_predicate) const;
+
+    // Пересечение части [first, last) самого короткого списка с остальными списками plus_lists
+    // (отсортированы по длине) галопирующим поиском. Для документов пересечения проверяются
+    // предикат, минус слова и фразы, затем считается релевантность
+    template <typename DocumentPredicate>
+    void IntersectPostingLists(PostingList::const_iterator first, PostingList::const_iterator last,
+        const std::vector<const PostingList*>& plus_lists, const std::vector<WordScorer>& word_scorers,
+        const std::vector<const PostingList*>& minus_lists, const std::vector<Phrase>& phrases,
+        DocumentPredicate document_predicate, std::vector<Document>& matched_documents) const;
+
+    // Проверка валидности отдельного слова на:
+    // отсутствие более чем одного минуса перед словами
     static bool NoWrongMinuses(const std::string_view word);
-    //    (   0  31)
+    // наличие недопустимых символов (с кодами от 0 до 31)
     static bool NoSpecSymbols(const std::string_view word);
-    //       stop_words_
+    // Проверка слово на наличие в контейнере stop_words_
     bool IsStopWord(const std::string_view word) const;
 };
-//------------------  SearchServer-----------------------
+//------------------Конец класса SearchServer-----------------------
 //------------------------------------------------------------------
 
-//     set  vector   
-template<typename Container>
-SearchServer::SearchServer(Container input_stop_words) {
+template <typename ScoringPolicy>
+class BasicSearchServer<ScoringPolicy>::QueryContext {
+private:
+    friend class BasicSearchServer;
+
+    Query query_;
+    std::vector<std::pair<int, double>> document_to_relevance_; // [document_id, relevance]
+    std::vector<Document> result_;
+    const TermStatistics* term_statistics_ = nullptr; // статистика шардов на время поиска
+};
+
+// Шаблонный конструктор для контейнеров set и vector   
+template <typename ScoringPolicy>
+template <typename Container>
+BasicSearchServer<ScoringPolicy>::BasicSearchServer(Container input_stop_words) {
     for (auto& stop_word : input_stop_words) {
         if (NoSpecSymbols(stop_word)) {
-            stop_words_.insert(stop_word);
+            AddStopWord(std::string(stop_word));
         }
     }
 }
 
+template <typename ScoringPolicy>
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const {
-    Query query = ParseQuery(raw_query);
-        
-    std::vector<Document> result = FindAllDocuments(std::execution::seq, query, document_predicate);
-        
-    sort(result.begin(), result.end(),
-        [](const Document& lhs, const Document& rhs) {
-            if (std::fabs(lhs.relevance - rhs.relevance) < RELEVANCE_PRECISION) {
-                return lhs.rating > rhs.rating;
-            }
-            else {
-                return lhs.relevance > rhs.relevance;
-            }
-        });
-    if (result.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        result.resize(MAX_RESULT_DOCUMENT_COUNT);
+std::vector<Document> BasicSearchServer<ScoringPolicy>::FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const {
+    QueryContext context;
+    return FindTopDocuments(context, raw_query, document_predicate);// Successful search
+}
+
+template <typename ScoringPolicy>
+template <typename DocumentPredicate>
+const std::vector<Document>& BasicSearchServer<ScoringPolicy>::FindTopDocuments(QueryContext& context, const std::string_view raw_query, DocumentPredicate document_predicate) const {
+    ParseQuery(raw_query, context.query_);
+
+    FindAllDocuments(context, document_predicate);
+    SelectTopDocuments(context.result_);
+
+    return context.result_;
+}
+
+template <typename ScoringPolicy>
+template <typename DocumentPredicate>
+const std::vector<Document>& BasicSearchServer<ScoringPolicy>::FindTopDocuments(QueryContext& context, const std::string_view raw_query,
+    DocumentPredicate document_predicate, const TermStatistics& statistics) const {
+    context.term_statistics_ = &statistics;
+    try {
+        FindTopDocuments(context, raw_query, document_predicate);
     }
+    catch (...) {
+        context.term_statistics_ = nullptr;
+        throw;
+    }
+    context.term_statistics_ = nullptr;
+    return context.result_;
+}
+
+template <typename ScoringPolicy>
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> BasicSearchServer<ScoringPolicy>::FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query, DocumentPredicate document_predicate) const {
+    // Если задана последовательная политика исполнения, запускаем обычную версию функции
+    if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
+        return FindTopDocuments(raw_query, document_predicate);
+    }
+    else {
+        Query query = ParseQuery(raw_query);
 
-    return result;// Successful search
+        std::vector<Document> result = FindAllDocuments(policy, query, document_predicate);
+        SelectTopDocuments(result);
+
+        return result;// Возвращаем результаты поиска
+    }
 }
 
+template <typename ScoringPolicy>
 template <typename ExecutionPolicy, typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query, DocumentPredicate document_predicate) const {
-    //     ,    
-    Query query = ParseQuery(raw_query);
+std::vector<Document> BasicSearchServer<ScoringPolicy>::FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query, DocumentPredicate document_predicate, QueryProfile& profile) const {
+    profile = QueryProfile();
+    QueryProfiler profiler(profile);
 
-    std::vector<Document> result = FindAllDocuments(policy, query, document_predicate);
+    std::vector<Document> result;
+    if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
+        QueryContext context;
+        profiler.StartPhase();
+        ParseQuery(raw_query, context.query_);
+        profiler.EndPhase(&QueryProfile::parse_time);
+        FindAllDocuments(context, document_predicate, profiler);
+        result = std::move(context.result_);
+    }
+    else {
+        profiler.StartPhase();
+        const Query query = ParseQuery(raw_query);
+        profiler.EndPhase(&QueryProfile::parse_time);
+        result = FindAllDocuments(policy, query, document_predicate, profiler);
+    }
 
-    sort(result.begin(), result.end(),
-        [](const Document& lhs, const Document& rhs) {
-            if (std::fabs(lhs.relevance - rhs.relevance) < RELEVANCE_PRECISION) {
-                return lhs.rating > rhs.rating;
-            }
-            else {
-                return lhs.relevance > rhs.relevance;
-            }
-        });
-    if (result.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        result.resize(MAX_RESULT_DOCUMENT_COUNT);
+    profiler.StartPhase();
+    SelectTopDocuments(result);
+    profiler.EndPhase(&QueryProfile::select_time);
+    profile.result_count = result.size();
+    return result;
+}
+
+template <typename ScoringPolicy>
+template <typename ExecutionPolicy>
+std::vector<Document> BasicSearchServer<ScoringPolicy>::FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query, QueryProfile& profile) const {
+    return FindTopDocuments(policy, raw_query, std::cref(GetStatusDocuments(DocumentStatus::ACTUAL)), profile);
+}
+
+template <typename ScoringPolicy>
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> BasicSearchServer<ScoringPolicy>::FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query, QueryMode mode, DocumentPredicate document_predicate) const {
+    if (mode == QueryMode::ANY_WORD) {
+        return FindTopDocuments(policy, raw_query, document_predicate);
     }
 
-    return result;//   
+    std::vector<Document> result = FindMatchedDocuments(policy, raw_query, mode, document_predicate);
+    SelectTopDocuments(result);
+
+    return result;
+}
+
+template <typename ScoringPolicy>
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> BasicSearchServer<ScoringPolicy>::FindMatchedDocuments(ExecutionPolicy policy, const std::string_view raw_query, QueryMode mode, DocumentPredicate document_predicate) const {
+    std::vector<Document> result;
+    if (mode == QueryMode::ANY_WORD) {
+        if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
+            QueryContext context;
+            ParseQuery(raw_query, context.query_);
+            FindAllDocuments(context, document_predicate);
+            result = std::move(context.result_);
+        }
+        else {
+            result = FindAllDocuments(policy, ParseQuery(raw_query), document_predicate);
+        }
+    }
+    else if (mode == QueryMode::FUZZY) {
+        if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
+            QueryContext context;
+            ParseQuery(raw_query, context.query_);
+            AddFuzzyWords(context.query_);
+            FindAllDocuments(context, document_predicate);
+            result = std::move(context.result_);
+        }
+        else {
+            Query query = ParseQuery(raw_query);
+            AddFuzzyWords(query);
+            result = FindAllDocuments(policy, query, document_predicate);
+        }
+    }
+    else if (mode == QueryMode::ALL_WORDS) {
+        const Query query = ParseQuery(raw_query);
+        if (query.has_wildcards) {
+            // Шаблон раскрывается в несколько слов, из которых достаточно любого, в режиме BOOLEAN это OR
+            throw std::invalid_argument("wildcards are not supported in ALL_WORDS mode");
+        }
+        result = FindAllDocumentsWithAllWords(policy, query, document_predicate);
+    }
+    else {
+        result = FindAllDocumentsBoolean(policy, ParseBooleanQuery(raw_query), document_predicate);
+    }
+    return result;
+}
+
+template <typename ScoringPolicy>
+template <typename ExecutionPolicy, typename DocumentPredicate>
+SearchPage BasicSearchServer<ScoringPolicy>::FindDocumentsPage(ExecutionPolicy policy, const std::string_view raw_query, QueryMode mode, size_t page_size,
+    const std::optional<SearchCursor>& after, DocumentPredicate document_predicate) const {
+    if (page_size == 0) {
+        throw std::invalid_argument("page size must be positive");
+    }
+    return SelectPageDocuments(FindMatchedDocuments(policy, raw_query, mode, document_predicate), page_size, after);
+}
+
+template <typename ScoringPolicy>
+template <typename ExecutionPolicy>
+SearchPage BasicSearchServer<ScoringPolicy>::FindDocumentsPage(ExecutionPolicy policy, const std::string_view raw_query, QueryMode mode, size_t page_size,
+    const std::optional<SearchCursor>& after) const {
+    return FindDocumentsPage(policy, raw_query, mode, page_size, after, std::cref(GetStatusDocuments(DocumentStatus::ACTUAL)));
+}
+
+template <typename ScoringPolicy>
+template <typename ExecutionPolicy>
+std::vector<Document> BasicSearchServer<ScoringPolicy>::FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query, QueryMode mode, DocumentStatus status) const {
+    return FindTopDocuments(
+        policy,
+        raw_query,
+        mode,
+        std::cref(GetStatusDocuments(status))
+    );
+}
+
+template <typename ScoringPolicy>
+template <typename ExecutionPolicy>
+std::vector<Document> BasicSearchServer<ScoringPolicy>::FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query, QueryMode mode) const {
+    return FindTopDocuments(policy, raw_query, mode, DocumentStatus::ACTUAL);
+}
+
+template <typename ScoringPolicy>
+template <typename ExecutionPolicy>
+std::vector<Document> BasicSearchServer<ScoringPolicy>::FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query, const DocumentFilter& filter) const {
+    const DocumentBitmap documents = CompileFilter(filter);
+    return FindTopDocuments(policy, raw_query, std::cref(documents));
+}
+
+template <typename ScoringPolicy>
+template <typename ExecutionPolicy>
+std::vector<Document> BasicSearchServer<ScoringPolicy>::FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query, QueryMode mode, const DocumentFilter& filter) const {
+    const DocumentBitmap documents = CompileFilter(filter);
+    return FindTopDocuments(policy, raw_query, mode, std::cref(documents));
 }
 
 // Find documents with certain status
+template <typename ScoringPolicy>
 template <typename ExecutionPolicy>
-std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query, DocumentStatus status) const {
-    //     ,    
+std::vector<Document> BasicSearchServer<ScoringPolicy>::FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query, DocumentStatus status) const {
+    // Если задана последовательная политика исполнения, запускаем обычную версию функции
     return FindTopDocuments(
         policy,
         raw_query,
-        [status](int document_id, DocumentStatus document_status, int rating) {
-            return document_status == status;
-        }
+        std::cref(GetStatusDocuments(status))
     );
 }
 
 // Find documents with status = ACTUAL
+template <typename ScoringPolicy>
 template <typename ExecutionPolicy>
-std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query) const {
-    return SearchServer::FindTopDocuments(
+std::vector<Document> BasicSearchServer<ScoringPolicy>::FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query) const {
+    return FindTopDocuments(
         policy,
         raw_query,
-        [](int document_id, DocumentStatus status, int rating) {
-            return status == DocumentStatus::ACTUAL;
-        }
+        std::cref(GetStatusDocuments(DocumentStatus::ACTUAL))
     );
 }
 
+template <typename ScoringPolicy>
+template <typename ExecutionPolicy, typename DocumentIdIterator>
+std::vector<std::pair<int, MatchedWords>> BasicSearchServer<ScoringPolicy>::MatchDocuments(ExecutionPolicy policy, const std::string_view raw_query,
+    DocumentIdIterator first, DocumentIdIterator last) const {
+    std::vector<int> document_ids(first, last);
+    std::sort(document_ids.begin(), document_ids.end());
+    document_ids.erase(std::unique(document_ids.begin(), document_ids.end()), document_ids.end());
+
+    std::vector<const DocumentData*> documents(document_ids.size());
+    std::transform(document_ids.begin(), document_ids.end(), documents.begin(),
+        [this](int document_id) {
+            return &GetDocumentData(document_id);
+        });
+
+    const Query query = ParseQuery(raw_query);
+
+    std::vector<std::pair<int, MatchedWords>> result(document_ids.size());
+    std::transform(policy, document_ids.begin(), document_ids.end(), documents.begin(), result.begin(),
+        [this, &query](int document_id, const DocumentData* document_data) {
+            return std::pair{ document_id, MatchQuery(query, document_id, *document_data) };
+        });
+    return result;
+}
+
+template <typename ScoringPolicy>
+template <typename ExecutionPolicy>
+std::vector<std::pair<int, MatchedWords>> BasicSearchServer<ScoringPolicy>::MatchDocuments(ExecutionPolicy policy, const std::string_view raw_query) const {
+    return MatchDocuments(policy, raw_query, document_ids_.begin(), document_ids_.end());
+}
+
+template <typename ScoringPolicy>
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(std::execution::sequenced_policy, const SearchServer::Query& query, DocumentPredicate document_predicate) const {
-    std::map<int, double> document_to_relevance;
-    
-    for (const std::string_view word : query.plus_words) {
-        if (SearchServer::word_to_document_freqs_.count(std::string(word)) == 0) {
-            continue;
+bool BasicSearchServer<ScoringPolicy>::IsDocumentAllowed(const DocumentPredicate& document_predicate, int document_id) const {
+    if constexpr (std::is_convertible_v<const DocumentPredicate&, const DocumentBitmap&>) {
+        const DocumentBitmap& documents = document_predicate;
+        return documents.Contains(document_id);
+    }
+    else {
+        const auto& document_data = documents_.at(document_id);
+        return document_predicate(document_id, document_data.status, document_data.rating);
+    }
+}
+
+template <typename ScoringPolicy>
+template <typename DocumentPredicate>
+void BasicSearchServer<ScoringPolicy>::FindAllDocuments(QueryContext& context, DocumentPredicate document_predicate) const {
+    NullQueryProfiler profiler;
+    FindAllDocuments(context, document_predicate, profiler);
+}
+
+template <typename ScoringPolicy>
+template <typename DocumentPredicate, typename Profiler>
+void BasicSearchServer<ScoringPolicy>::FindAllDocuments(QueryContext& context, DocumentPredicate document_predicate, Profiler& profiler) const {
+    LATENCY_TIMER(LatencyOperation::FIND_ALL_DOCUMENTS);
+    ALLOCATION_SCOPE(LatencyOperation::FIND_ALL_DOCUMENTS);
+    profiler.SetQuery(context.query_.plus_words, context.query_.minus_words);
+    profiler.StartPhase();
+    // Вместо map<int, double> релевантность копится в векторе пар [document_id, relevance],
+    // затем вектор сортируется по id и вклады одного документа складываются
+    auto& document_to_relevance = context.document_to_relevance_;
+    document_to_relevance.clear();
+
+    auto add_word = [this, &context, &document_to_relevance, &document_predicate, &profiler](std::string_view word, double weight) {
+        const auto word_it = word_to_document_freqs_.find(word);
+        if (word_it == word_to_document_freqs_.end() || word_it->second.empty()) {
+            return;
         }
 
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(std::string(word));
-        for (const auto& [document_id, term_freq] : SearchServer::word_to_document_freqs_.at(std::string(word))) {
-            const auto& document_data = SearchServer::documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+        // Политика ранжирования известна на этапе компиляции, оценка вхождения встраивается в цикл
+        const WordScorer scorer = GetWordScorer(word, word_it->second, weight, context.term_statistics_);
+        const size_t accumulated_count = document_to_relevance.size();
+        for (const Posting& posting : word_it->second) {
+            if (IsDocumentAllowed(document_predicate, posting.document_id)) {
+                document_to_relevance.push_back({ posting.document_id, scorer(posting) });
             }
         }
+        profiler.AddPlusWord(word, weight, word_it->second.size(), document_to_relevance.size() - accumulated_count);
+    };
+    for (const std::string_view word : context.query_.plus_words) {
+        add_word(word, 1.0);
     }
-    
-    for (const std::string_view word : query.minus_words) {
-        if (SearchServer::word_to_document_freqs_.count(std::string(word)) == 0) {
+    for (const auto& [word, weight] : context.query_.weighted_words) {
+        add_word(word, weight);
+    }
+
+    for (const Phrase& phrase : context.query_.phrases) {
+        const ScoredDocuments phrase_documents = FindPhraseDocuments(phrase, context.term_statistics_);
+        for (const auto& [document_id, relevance] : phrase_documents) {
+            if (IsDocumentAllowed(document_predicate, document_id)) {
+                document_to_relevance.push_back({ document_id, relevance });
+            }
+        }
+        profiler.AddPhrase(phrase_documents.size());
+    }
+
+    std::sort(document_to_relevance.begin(), document_to_relevance.end());
+    auto relevance_end = document_to_relevance.begin();
+    for (auto it = document_to_relevance.begin(); it != document_to_relevance.end(); ++it) {
+        if (relevance_end != document_to_relevance.begin() && std::prev(relevance_end)->first == it->first) {
+            std::prev(relevance_end)->second += it->second;
+        }
+        else {
+            *relevance_end++ = *it;
+        }
+    }
+    document_to_relevance.erase(relevance_end, document_to_relevance.end());
+    profiler.SetCandidateCount(document_to_relevance.size());
+    profiler.EndPhase(&QueryProfile::scoring_time);
+
+    // Списки документов слова и накопитель отсортированы по id, поэтому минус слова вычёркиваем слиянием
+    profiler.StartPhase();
+    for (const std::string_view word : context.query_.minus_words) {
+        const auto word_it = word_to_document_freqs_.find(word);
+        if (word_it == word_to_document_freqs_.end()) {
             continue;
         }
-        for (const auto [document_id, _] : SearchServer::word_to_document_freqs_.at(std::string(word))) {
-            document_to_relevance.erase(document_id);
+        size_t removed_count = 0;
+        auto relevance_it = document_to_relevance.begin();
+        for (const Posting& posting : word_it->second) {
+            while (relevance_it != document_to_relevance.end() && relevance_it->first < posting.document_id) {
+                ++relevance_it;
+            }
+            if (relevance_it == document_to_relevance.end()) {
+                break;
+            }
+            if (relevance_it->first == posting.document_id) {
+                relevance_it->first = -1; // id документов неотрицательны
+                ++removed_count;
+            }
         }
+        profiler.AddMinusWord(word, word_it->second.size(), removed_count);
     }
-    
-    std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back({ document_id, relevance, SearchServer::documents_.at(document_id).rating });
+    profiler.EndPhase(&QueryProfile::minus_words_time);
+
+    profiler.StartPhase();
+    context.result_.clear();
+    for (const auto& [document_id, relevance] : document_to_relevance) {
+        if (document_id >= 0) {
+            context.result_.push_back({ document_id, relevance, documents_.at(document_id).rating });
+        }
     }
-    return matched_documents;
+    profiler.EndPhase(&QueryProfile::collect_time);
 }
 
+template <typename ScoringPolicy>
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(std::execution::parallel_policy, const SearchServer::Query& query, DocumentPredicate document_predicate) const {
+std::vector<Document> BasicSearchServer<ScoringPolicy>::FindAllDocuments(std::execution::parallel_policy policy, const Query& query, DocumentPredicate document_predicate) const {
+    NullQueryProfiler profiler;
+    return FindAllDocuments(policy, query, document_predicate, profiler);
+}
+
+template <typename ScoringPolicy>
+template <typename DocumentPredicate, typename Profiler>
+std::vector<Document> BasicSearchServer<ScoringPolicy>::FindAllDocuments(std::execution::parallel_policy, const Query& query, DocumentPredicate document_predicate, Profiler& profiler) const {
+    LATENCY_TIMER(LatencyOperation::FIND_ALL_DOCUMENTS);
+    ALLOCATION_SCOPE(LatencyOperation::FIND_ALL_DOCUMENTS);
     const int BUCKET_COUNT = 10;       
     
     ConcurrentMap<int, double> document_to_relevance_concurrent(BUCKET_COUNT);
+    profiler.SetQuery(query.plus_words, query.minus_words);
+    profiler.StartPhase();
+
+    auto add_word = [this, &document_to_relevance_concurrent, &document_predicate, &profiler](std::string_view word, double weight) {
+        const auto word_it = word_to_document_freqs_.find(word);
+        if (word_it == word_to_document_freqs_.end() || word_it->second.empty()) {
+            return;
+        }
+
+        const WordScorer scorer = GetWordScorer(word_it->second, weight);
+
+        size_t accepted_count = 0;
+        for (const Posting& posting : word_it->second) {
+            if (IsDocumentAllowed(document_predicate, posting.document_id)) {
+                document_to_relevance_concurrent[posting.document_id].ref_to_value += scorer(posting);
+                ++accepted_count;
+            }
+        }
+        profiler.AddPlusWord(word, weight, word_it->second.size(), accepted_count);
+    };
 
-    //      
+    // Для каждого из плюс слов 
     for_each(std::execution::par,
         query.plus_words.begin(),
         query.plus_words.end(),
-        [this, &document_to_relevance_concurrent, &document_predicate](std::string_view word) {
-            if (SearchServer::word_to_document_freqs_.count(std::string(word)) == 0) {
-                return;
-            }
-
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(std::string(word));
+        [&add_word](std::string_view word) {
+            add_word(word, 1.0);
+        }
+    );
+    // Похожие слова нечёткого поиска
+    for_each(std::execution::par,
+        query.weighted_words.begin(),
+        query.weighted_words.end(),
+        [&add_word](const std::pair<std::string_view, double>& word) {
+            add_word(word.first, word.second);
+        }
+    );
 
-            for (const auto& [document_id, term_freq] : SearchServer::word_to_document_freqs_.at(std::string(word))) {
-                const auto& document_data = SearchServer::documents_.at(document_id);
-                if (document_predicate(document_id, document_data.status, document_data.rating)) {                    
-                    document_to_relevance_concurrent[document_id].ref_to_value += term_freq * inverse_document_freq;
+    // Фразы
+    for_each(std::execution::par,
+        query.phrases.begin(),
+        query.phrases.end(),
+        [this, &document_to_relevance_concurrent, &document_predicate, &profiler](const Phrase& phrase) {
+            const ScoredDocuments phrase_documents = FindPhraseDocuments(phrase);
+            for (const auto& [document_id, relevance] : phrase_documents) {
+                if (IsDocumentAllowed(document_predicate, document_id)) {
+                    document_to_relevance_concurrent[document_id].ref_to_value += relevance;
                 }
             }
+            profiler.AddPhrase(phrase_documents.size());
         }
     );
+    profiler.EndPhase(&QueryProfile::scoring_time);
       
-    //      
+    // Для каждого из минус слов 
+    profiler.StartPhase();
     for_each(std::execution::par,
         query.minus_words.begin(),
         query.minus_words.end(),
-        [this, &document_to_relevance_concurrent](std::string_view word) {
-            if (SearchServer::word_to_document_freqs_.count(std::string(word)) == 0) {
+        [this, &document_to_relevance_concurrent, &profiler](std::string_view word) {
+            const auto word_it = word_to_document_freqs_.find(word);
+            if (word_it == word_to_document_freqs_.end()) {
                 return;
             }
-            for (const auto& [document_id, _] : SearchServer::word_to_document_freqs_.at(std::string(word))) {
-                document_to_relevance_concurrent[document_id].ref_to_bucket.erase(document_id);
+            size_t removed_count = 0;
+            for (const Posting& posting : word_it->second) {
+                removed_count += document_to_relevance_concurrent.Erase(posting.document_id);
             }
+            profiler.AddMinusWord(word, word_it->second.size(), removed_count);
         }
     );
+    profiler.EndPhase(&QueryProfile::minus_words_time);
 
-    //        
+    // Соеденяем обратно словари полученные в результате параллельной обработки
+    profiler.StartPhase();
     std::map<int, double> document_to_relevance = move(document_to_relevance_concurrent.BuildOrdinaryMap());
+    profiler.SetCandidateCountAfterMinusWords(document_to_relevance.size());
 
     std::vector<Document> matched_documents;
     for (const auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back({ document_id, relevance, SearchServer::documents_.at(document_id).rating });
+        matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
+    }
+    profiler.EndPhase(&QueryProfile::collect_time);
+
+    return matched_documents;
+}
+
+template <typename ScoringPolicy>
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> BasicSearchServer<ScoringPolicy>::FindAllDocumentsWithAllWords(ExecutionPolicy policy, const Query& query, DocumentPredicate document_predicate) const {
+    LATENCY_TIMER(LatencyOperation::FIND_ALL_DOCUMENTS);
+    ALLOCATION_SCOPE(LatencyOperation::FIND_ALL_DOCUMENTS);
+    // Слова фраз тоже должны быть в документе, позиции проверяются только для пересечения
+    std::vector<std::string_view> words = query.plus_words;
+    for (const Phrase& phrase : query.phrases) {
+        words.insert(words.end(), phrase.words.begin(), phrase.words.end());
+    }
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+
+    std::vector<const PostingList*> plus_lists;
+    for (const std::string_view word : words) {
+        const auto word_it = word_to_document_freqs_.find(word);
+        // Слово не встречается ни в одном документе - пересечение пусто
+        if (word_it == word_to_document_freqs_.end() || word_it->second.empty()) {
+            return {};
+        }
+        plus_lists.push_back(&word_it->second);
+    }
+    if (plus_lists.empty()) {
+        return {};
+    }
+
+    // От самого редкого слова к самому частому
+    std::sort(plus_lists.begin(), plus_lists.end(),
+        [](const PostingList* lhs, const PostingList* rhs) {
+            return lhs->size() < rhs->size();
+        });
+
+    std::vector<WordScorer> word_scorers;
+    for (const PostingList* posting_list : plus_lists) {
+        word_scorers.push_back(GetWordScorer(*posting_list));
+    }
+
+    std::vector<const PostingList*> minus_lists;
+    for (const std::string_view word : query.minus_words) {
+        const auto word_it = word_to_document_freqs_.find(word);
+        if (word_it != word_to_document_freqs_.end() && !word_it->second.empty()) {
+            minus_lists.push_back(&word_it->second);
+        }
     }
 
+    const PostingList& shortest_list = *plus_lists.front();
+    size_t part_count = 1;
+    if constexpr (!std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
+        const int PARTS_PER_THREAD = 4;
+        part_count = std::clamp<size_t>(std::thread::hardware_concurrency() * PARTS_PER_THREAD, 1, shortest_list.size());
+    }
+
+    std::vector<std::vector<Document>> part_results(part_count);
+    std::vector<size_t> parts(part_count);
+    std::iota(parts.begin(), parts.end(), 0);
+    std::for_each(policy,
+        parts.begin(), parts.end(),
+        [&](size_t part) {
+            IntersectPostingLists(
+                shortest_list.begin() + part * shortest_list.size() / part_count,
+                shortest_list.begin() + (part + 1) * shortest_list.size() / part_count,
+                plus_lists, word_scorers, minus_lists, query.phrases, document_predicate, part_results[part]);
+        }
+    );
+
+    std::vector<Document> matched_documents;
+    for (const std::vector<Document>& part_result : part_results) {
+        matched_documents.insert(matched_documents.end(), part_result.begin(), part_result.end());
+    }
     return matched_documents;
 }
 
+template <typename ScoringPolicy>
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> BasicSearchServer<ScoringPolicy>::FindAllDocumentsBoolean(ExecutionPolicy policy, const QueryNode& query, DocumentPredicate document_predicate) const {
+    LATENCY_TIMER(LatencyOperation::FIND_ALL_DOCUMENTS);
+    ALLOCATION_SCOPE(LatencyOperation::FIND_ALL_DOCUMENTS);
+    const std::optional<QueryPlanNode> plan = BuildQueryPlan(query);
+    if (!plan) {
+        return {};
+    }
+
+    // Предикат проверяется только для документов, прошедших весь план
+    std::vector<Document> matched_documents;
+    for (const auto& [document_id, relevance] : EvaluateQueryPlan(policy, *plan)) {
+        if (IsDocumentAllowed(document_predicate, document_id)) {
+            matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
+        }
+    }
+    return matched_documents;
+}
+
+template <typename ScoringPolicy>
+template <typename ExecutionPolicy>
+typename BasicSearchServer<ScoringPolicy>::ScoredDocuments BasicSearchServer<ScoringPolicy>::EvaluateQueryPlan(ExecutionPolicy policy, const QueryPlanNode& node) const {
+    if (node.type == QueryNode::Type::TERM) {
+        ScoredDocuments result;
+        if (node.postings != nullptr) {
+            result.reserve(node.postings->size());
+            for (const Posting& posting : *node.postings) {
+                result.push_back({ posting.document_id, node.scorer(posting) });
+            }
+        }
+        return result;
+    }
+
+    if (node.children.empty() || node.cost == 0) {
+        return {};
+    }
+
+    if (node.type == QueryNode::Type::AND && node.document_at_a_time) {
+        const ScoredDocuments candidates = EvaluateQueryPlan(policy, node.children.front());
+        // Операция transform не должна менять входной диапазон, поэтому релевантность остальных частей
+        // пишется в отдельный массив; nullopt - кандидат не прошёл проверку
+        std::vector<std::optional<double>> added_relevance(candidates.size());
+        std::transform(policy,
+            candidates.begin(), candidates.end(),
+            added_relevance.begin(),
+            [&node](const std::pair<int, double>& candidate) -> std::optional<double> {
+                double relevance = 0.0;
+                for (size_t i = 1; i < node.children.size(); ++i) {
+                    if (!ProbeQueryPlan(node.children[i], candidate.first, relevance)) {
+                        return std::nullopt;
+                    }
+                }
+                for (const QueryPlanNode& excluded : node.excluded) {
+                    double unused = 0.0;
+                    if (ProbeQueryPlan(excluded, candidate.first, unused)) {
+                        return std::nullopt;
+                    }
+                }
+                return relevance;
+            });
+
+        ScoredDocuments result;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            if (added_relevance[i]) {
+                result.push_back({ candidates[i].first, candidates[i].second + *added_relevance[i] });
+            }
+        }
+        return result;
+    }
+
+    // term-at-a-time: дочерние части вычисляются целиком (независимо друг от друга) и сливаются
+    std::vector<ScoredDocuments> parts(node.children.size());
+    std::transform(policy,
+        node.children.begin(), node.children.end(),
+        parts.begin(),
+        [this, policy](const QueryPlanNode& child) {
+            return EvaluateQueryPlan(policy, child);
+        });
+
+    ScoredDocuments result = std::move(parts.front());
+    for (size_t i = 1; i < parts.size(); ++i) {
+        result = node.type == QueryNode::Type::AND
+            ? IntersectScoredDocuments(result, parts[i])
+            : UniteScoredDocuments(result, parts[i]);
+    }
+
+    for (const QueryPlanNode& excluded : node.excluded) {
+        if (excluded.cost < result.size()) {
+            SubtractScoredDocuments(result, EvaluateQueryPlan(policy, excluded));
+        }
+        else {
+            result.erase(std::remove_if(result.begin(), result.end(),
+                [&excluded](const std::pair<int, double>& document) {
+                    double unused = 0.0;
+                    return ProbeQueryPlan(excluded, document.first, unused);
+                }), result.end());
+        }
+    }
+    return result;
+}
+
+template <typename ScoringPolicy>
+template <typename DocumentPredicate>
+void BasicSearchServer<ScoringPolicy>::IntersectPostingLists(PostingList::const_iterator first, PostingList::const_iterator last,
+    const std::vector<const PostingList*>& plus_lists, const std::vector<WordScorer>& word_scorers,
+    const std::vector<const PostingList*>& minus_lists, const std::vector<Phrase>& phrases,
+    DocumentPredicate document_predicate, std::vector<Document>& matched_documents) const {
+    if (first == last) {
+        return;
+    }
+
+    // Курсоры остальных списков начинаются с первого id своей части ведущего списка
+    std::vector<PostingList::const_iterator> cursors;
+    for (const PostingList* posting_list : plus_lists) {
+        cursors.push_back(posting_list->LowerBound(first->document_id));
+    }
+    std::vector<PostingList::const_iterator> minus_cursors;
+    for (const PostingList* posting_list : minus_lists) {
+        minus_cursors.push_back(posting_list->LowerBound(first->document_id));
+    }
+
+    auto& lead = cursors.front();
+    lead = first;
+    while (lead != last) {
+        int candidate_id = lead->document_id;
+        bool in_all_lists = true;
+        for (size_t i = 1; i < cursors.size(); ++i) {
+            cursors[i] = GallopLowerBound(cursors[i], plus_lists[i]->end(), candidate_id);
+            if (cursors[i] == plus_lists[i]->end()) {
+                return; // в одном из списков документы закончились
+            }
+            if (cursors[i]->document_id != candidate_id) {
+                // Перепрыгиваем в ведущем списке сразу к следующему возможному кандидату
+                candidate_id = cursors[i]->document_id;
+                in_all_lists = false;
+                break;
+            }
+        }
+        if (!in_all_lists) {
+            lead = GallopLowerBound(lead, last, candidate_id);
+            continue;
+        }
+
+        bool has_minus_word = false;
+        for (size_t i = 0; i < minus_cursors.size() && !has_minus_word; ++i) {
+            minus_cursors[i] = GallopLowerBound(minus_cursors[i], minus_lists[i]->end(), candidate_id);
+            has_minus_word = minus_cursors[i] != minus_lists[i]->end() && minus_cursors[i]->document_id == candidate_id;
+        }
+
+        if (!has_minus_word && IsDocumentAllowed(document_predicate, candidate_id)
+            && std::all_of(phrases.begin(), phrases.end(), [this, candidate_id](const Phrase& phrase) {
+                return MatchesPhrase(phrase, candidate_id);
+            })) {
+            double relevance = 0.0;
+            for (size_t i = 0; i < cursors.size(); ++i) {
+                relevance += word_scorers[i](*cursors[i]);
+            }
+            matched_documents.push_back({ candidate_id, relevance, documents_.at(candidate_id).rating });
+        }
+        ++lead;
+    }
+}
+
+using SearchServer = BasicSearchServer<TfIdfScoring>;
+using Bm25SearchServer = BasicSearchServer<Bm25Scoring>;
+
+// Нешаблонные методы определены в search_server.cpp для этих политик
+extern template class BasicSearchServer<TfIdfScoring>;
+extern template class BasicSearchServer<Bm25Scoring>;
+
 //---------------------------------------------------------------------
-//--------------     SearchServer--------------
+//--------------Внешние функции для работы с SearchServer--------------
 void PrintDocument(const Document& document);
 
-void PrintMatchDocumentResult(int document_id, const std::vector<std::string>& words, DocumentStatus status);
+void PrintMatchDocumentResult(int document_id, const std::vector<std::string_view>& words, DocumentStatus status);
 
 void AddDocument(SearchServer& search_server,
     int document_id,
@@ -0,0 +1,558 @@
+#include "search_service.h"
+#include "replication.h"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+using namespace std;
+
+// Соединение: буферы ввода и вывода и разобранные, но ещё не выполненные запросы
+struct SearchService::Connection {
+    uint64_t id = 0;
+    int socket = -1;
+    string input;
+    string output;
+    size_t output_offset = 0;
+    vector<Request> requests;
+    bool busy = false;        // пачка соединения выполняется рабочим потоком
+    bool peer_closed = false; // клиент закрыл соединение на запись
+    uint32_t events = 0;      // события epoll, на которые подписан сокет
+};
+
+// Пачка запросов одного соединения и закодированные ответы на них
+struct SearchService::Batch {
+    uint64_t connection_id = 0;
+    vector<Request> requests;
+    string output;
+};
+
+#ifdef __linux__
+
+namespace {
+    [[noreturn]] void ThrowSystemError(const string& what) {
+        throw runtime_error(what + ": "s + strerror(errno));
+    }
+
+    // Метка события eventfd в epoll, сокеты соединений помечаются своими дескрипторами
+    const uint64_t WAKEUP_TAG = ~uint64_t(0);
+    const uint64_t LISTEN_TAG = ~uint64_t(0) - 1;
+}
+
+SearchService::SearchService(SearchServer& search_server, const SearchServiceOptions& options)
+    : search_server_(search_server)
+    , options_(options)
+    , server_mutex_(options.server_mutex != nullptr ? *options.server_mutex : own_server_mutex_)
+    , read_only_(options.read_only) {
+    if (options_.worker_count == 0) {
+        options_.worker_count = max(1u, thread::hardware_concurrency());
+    }
+    epoll_ = epoll_create1(EPOLL_CLOEXEC);
+    wakeup_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_ < 0 || wakeup_ < 0) {
+        ThrowSystemError("epoll"s);
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = WAKEUP_TAG;
+    epoll_ctl(epoll_, EPOLL_CTL_ADD, wakeup_, &event);
+    try {
+        Listen();
+    }
+    catch (...) {
+        if (listen_socket_ >= 0) {
+            close(listen_socket_);
+        }
+        close(epoll_);
+        close(wakeup_);
+        throw;
+    }
+    for (size_t i = 0; i < options_.worker_count; ++i) {
+        workers_.emplace_back([this]() {
+            RunWorker();
+        });
+    }
+}
+
+SearchService::~SearchService() {
+    Stop();
+    if (loop_thread_.joinable()) {
+        loop_thread_.join();
+    }
+    {
+        lock_guard guard(jobs_mutex_);
+        workers_stopping_ = true;
+    }
+    jobs_ready_.notify_all();
+    for (thread& worker : workers_) {
+        worker.join();
+    }
+    for (const auto& [id, connection] : connections_) {
+        close(connection->socket);
+    }
+    close(listen_socket_);
+    close(epoll_);
+    close(wakeup_);
+    if (!options_.unix_path.empty()) {
+        unlink(options_.unix_path.c_str());
+    }
+}
+
+void SearchService::Listen() {
+    if (!options_.unix_path.empty()) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (options_.unix_path.size() >= sizeof(address.sun_path)) {
+            throw invalid_argument("unix socket path is too long");
+        }
+        memcpy(address.sun_path, options_.unix_path.c_str(), options_.unix_path.size() + 1);
+        unlink(options_.unix_path.c_str());
+        listen_socket_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listen_socket_ < 0 || ::bind(listen_socket_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+            ThrowSystemError("bind "s + options_.unix_path);
+        }
+    }
+    else {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(options_.port);
+        const string& host = options_.host == "localhost"s ? "127.0.0.1"s : options_.host;
+        if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) {
+            throw invalid_argument("invalid IPv4 address "s + options_.host);
+        }
+        listen_socket_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        const int enable = 1;
+        if (listen_socket_ >= 0) {
+            setsockopt(listen_socket_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+        }
+        if (listen_socket_ < 0 || ::bind(listen_socket_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+            ThrowSystemError("bind "s + options_.host + ":"s + to_string(options_.port));
+        }
+        socklen_t length = sizeof(address);
+        getsockname(listen_socket_, reinterpret_cast<sockaddr*>(&address), &length);
+        port_ = ntohs(address.sin_port);
+    }
+    if (listen(listen_socket_, SOMAXCONN) != 0) {
+        ThrowSystemError("listen"s);
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = LISTEN_TAG;
+    epoll_ctl(epoll_, EPOLL_CTL_ADD, listen_socket_, &event);
+}
+
+void SearchService::Run() {
+    const int MAX_EVENTS = 256;
+    epoll_event events[MAX_EVENTS];
+    while (!stopping_.load()) {
+        const int count = epoll_wait(epoll_, events, MAX_EVENTS, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError("epoll_wait"s);
+        }
+        for (int i = 0; i < count; ++i) {
+            const uint64_t tag = events[i].data.u64;
+            if (tag == WAKEUP_TAG) {
+                uint64_t value;
+                while (read(wakeup_, &value, sizeof(value)) > 0) {
+                }
+                CollectDone();
+                continue;
+            }
+            if (tag == LISTEN_TAG) {
+                Accept();
+                continue;
+            }
+            // Соединение могло быть закрыто обработкой предыдущего события
+            const auto it = connections_.find(tag);
+            if (it == connections_.end()) {
+                continue;
+            }
+            Connection& connection = *it->second;
+            // EPOLLHUP и EPOLLERR приходят независимо от подписки: ответы уже некому доставить
+            if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                CloseConnection(tag);
+                continue;
+            }
+            if (events[i].events & EPOLLIN) {
+                ReadFrom(connection);
+            }
+            if (connections_.count(tag) > 0 && (events[i].events & EPOLLOUT)) {
+                WriteTo(connection);
+            }
+        }
+    }
+}
+
+void SearchService::Start() {
+    loop_thread_ = thread([this]() {
+        Run();
+    });
+}
+
+void SearchService::Stop() {
+    stopping_.store(true);
+    Wakeup();
+}
+
+void SearchService::Wakeup() {
+    const uint64_t value = 1;
+    [[maybe_unused]] const ssize_t written = write(wakeup_, &value, sizeof(value));
+}
+
+void SearchService::Accept() {
+    while (true) {
+        const int socket_fd = accept4(listen_socket_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (socket_fd < 0) {
+            return;
+        }
+        const int enable = 1;
+        setsockopt(socket_fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+        auto connection = make_unique<Connection>();
+        connection->id = next_connection_id_++;
+        connection->socket = socket_fd;
+        connection->events = EPOLLIN;
+        epoll_event event{};
+        event.events = connection->events;
+        event.data.u64 = connection->id;
+        epoll_ctl(epoll_, EPOLL_CTL_ADD, socket_fd, &event);
+        connections_.emplace(connection->id, move(connection));
+        connection_count_.fetch_add(1, memory_order_relaxed);
+    }
+}
+
+void SearchService::ReadFrom(Connection& connection) {
+    const uint64_t connection_id = connection.id;
+    char buffer[64 * 1024];
+    // Остальное остаётся в сокете до возобновления чтения (UpdateEvents после выполнения пачки)
+    while (!connection.peer_closed && !IsReadingPaused(connection)) {
+        const ssize_t received = recv(connection.socket, buffer, sizeof(buffer), 0);
+        if (received > 0) {
+            connection.input.append(buffer, static_cast<size_t>(received));
+            if (!ParseRequests(connection)) {
+                return;
+            }
+            continue;
+        }
+        if (received == 0) {
+            connection.peer_closed = true;
+        }
+        else if (errno == EINTR) {
+            continue;
+        }
+        else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            CloseConnection(connection_id);
+            return;
+        }
+        break;
+    }
+
+    Dispatch(connection);
+    if (connections_.count(connection_id) > 0) {
+        UpdateEvents(connection);
+    }
+}
+
+bool SearchService::ParseRequests(Connection& connection) {
+    try {
+        // Сверх предела очереди кадры остаются во вводе до выполнения текущей пачки
+        size_t offset = 0;
+        string_view payload;
+        while (connection.requests.size() < options_.max_pending_requests) {
+            const size_t frame_size = ExtractFrame(string_view(connection.input).substr(offset), payload, options_.max_frame_size);
+            if (frame_size == 0) {
+                break;
+            }
+            connection.requests.push_back(DecodeRequest(payload));
+            offset += frame_size;
+        }
+        connection.input.erase(0, offset);
+    }
+    catch (const invalid_argument&) {
+        protocol_error_count_.fetch_add(1, memory_order_relaxed);
+        CloseConnection(connection.id);
+        return false;
+    }
+    return true;
+}
+
+bool SearchService::IsReadingPaused(const Connection& connection) const {
+    return connection.requests.size() >= options_.max_pending_requests
+        || connection.output.size() - connection.output_offset >= options_.max_pending_output;
+}
+
+void SearchService::Dispatch(Connection& connection) {
+    if (connection.busy || connection.requests.empty()) {
+        if (connection.peer_closed && !connection.busy && connection.output_offset == connection.output.size()) {
+            CloseConnection(connection.id);
+        }
+        return;
+    }
+    auto batch = make_unique<Batch>();
+    batch->connection_id = connection.id;
+    batch->requests = move(connection.requests);
+    connection.requests.clear();
+    connection.busy = true;
+    {
+        lock_guard guard(jobs_mutex_);
+        jobs_.push_back(move(batch));
+    }
+    jobs_ready_.notify_one();
+}
+
+void SearchService::CollectDone() {
+    vector<unique_ptr<Batch>> done;
+    {
+        lock_guard guard(done_mutex_);
+        done.swap(done_);
+    }
+    for (unique_ptr<Batch>& batch : done) {
+        const auto it = connections_.find(batch->connection_id);
+        if (it == connections_.end()) {
+            continue;
+        }
+        Connection& connection = *it->second;
+        connection.busy = false;
+        connection.output += batch->output;
+        // Очередь соединения разобрана: следующая пачка берёт кадры, оставшиеся во вводе,
+        // и чтение сокета возобновляется
+        if (!ParseRequests(connection)) {
+            continue;
+        }
+        WriteTo(connection);
+        if (connections_.count(batch->connection_id) == 0) {
+            continue;
+        }
+        Dispatch(connection);
+        if (connections_.count(batch->connection_id) > 0) {
+            UpdateEvents(connection);
+        }
+    }
+}
+
+void SearchService::WriteTo(Connection& connection) {
+    while (connection.output_offset < connection.output.size()) {
+        const ssize_t written = send(connection.socket, connection.output.data() + connection.output_offset,
+            connection.output.size() - connection.output_offset, MSG_NOSIGNAL);
+        if (written > 0) {
+            connection.output_offset += static_cast<size_t>(written);
+            continue;
+        }
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        CloseConnection(connection.id);
+        return;
+    }
+    if (connection.output_offset == connection.output.size()) {
+        connection.output.clear();
+        connection.output_offset = 0;
+        if (connection.peer_closed && !connection.busy && connection.requests.empty()) {
+            CloseConnection(connection.id);
+            return;
+        }
+    }
+    UpdateEvents(connection);
+}
+
+void SearchService::UpdateEvents(Connection& connection) {
+    // Закрытое клиентом соединение больше не читается, иначе событие EPOLLIN повторялось бы
+    const bool reading = !connection.peer_closed && !IsReadingPaused(connection);
+    const bool writing = connection.output_offset < connection.output.size();
+    const uint32_t events = (reading ? EPOLLIN : 0) | (writing ? EPOLLOUT : 0);
+    if (events == connection.events) {
+        return;
+    }
+    connection.events = events;
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = connection.id;
+    epoll_ctl(epoll_, EPOLL_CTL_MOD, connection.socket, &event);
+}
+
+void SearchService::CloseConnection(uint64_t connection_id) {
+    const auto it = connections_.find(connection_id);
+    if (it == connections_.end()) {
+        return;
+    }
+    epoll_ctl(epoll_, EPOLL_CTL_DEL, it->second->socket, nullptr);
+    close(it->second->socket);
+    // Результат выполняющейся пачки будет отброшен в CollectDone
+    connections_.erase(it);
+}
+
+#else
+
+SearchService::SearchService(SearchServer& search_server, const SearchServiceOptions& options)
+    : search_server_(search_server)
+    , options_(options)
+    , server_mutex_(own_server_mutex_)
+    , read_only_(true) {
+    throw runtime_error("search service is supported only on Linux");
+}
+
+SearchService::~SearchService() {
+}
+
+void SearchService::Run() {
+}
+
+void SearchService::Start() {
+}
+
+void SearchService::Stop() {
+}
+
+void SearchService::Wakeup() {
+}
+
+#endif
+
+uint16_t SearchService::GetPort() const {
+    return port_;
+}
+
+SearchService::Stats SearchService::GetStats() const {
+    Stats stats;
+    stats.connections = connection_count_.load(memory_order_relaxed);
+    stats.requests = request_count_.load(memory_order_relaxed);
+    stats.batches = batch_count_.load(memory_order_relaxed);
+    stats.protocol_errors = protocol_error_count_.load(memory_order_relaxed);
+    return stats;
+}
+
+void SearchService::SetReadOnly(bool read_only) {
+    read_only_.store(read_only);
+}
+
+//---------------------------- Рабочие потоки ----------------------------
+
+void SearchService::RunWorker() {
+    while (true) {
+        unique_ptr<Batch> batch;
+        {
+            unique_lock lock(jobs_mutex_);
+            jobs_ready_.wait(lock, [this]() {
+                return !jobs_.empty() || workers_stopping_;
+            });
+            if (jobs_.empty()) {
+                return;
+            }
+            batch = move(jobs_.front());
+            jobs_.pop_front();
+        }
+        Execute(*batch);
+        {
+            lock_guard guard(done_mutex_);
+            done_.push_back(move(batch));
+        }
+        Wakeup();
+    }
+}
+
+void SearchService::Execute(Batch& batch) {
+    for (const Request& request : batch.requests) {
+        EncodeResponse(ExecuteRequest(request), request.type, batch.output);
+    }
+    request_count_.fetch_add(batch.requests.size(), memory_order_relaxed);
+    batch_count_.fetch_add(1, memory_order_relaxed);
+}
+
+Response SearchService::ExecuteRequest(const Request& request) {
+    // Буферы поиска рабочего потока
+    thread_local SearchServer::QueryContext context;
+    Response response;
+    response.request_id = request.request_id;
+    try {
+        switch (request.type) {
+        case RequestType::ADD_DOCUMENT:
+        case RequestType::REMOVE_DOCUMENT: {
+            if (read_only_.load()) {
+                throw invalid_argument("server is a read-only replica");
+            }
+            unique_lock lock(server_mutex_);
+            if (request.type == RequestType::ADD_DOCUMENT) {
+                search_server_.AddDocument(request.document_id, request.text, request.status, request.ratings);
+            }
+            else {
+                search_server_.RemoveDocument(request.document_id);
+            }
+            // Запись в журнал под той же блокировкой: порядок журнала совпадает с порядком изменений
+            if (options_.replication_log != nullptr) {
+                options_.replication_log->Append(request);
+            }
+            break;
+        }
+        case RequestType::FIND_TOP_DOCUMENTS: {
+            shared_lock lock(server_mutex_);
+            response.documents = request.mode == QueryMode::ANY_WORD
+                ? search_server_.FindTopDocuments(context, request.text, request.status)
+                : search_server_.FindTopDocuments(execution::seq, request.text, request.mode, request.status);
+            break;
+        }
+        case RequestType::MATCH_DOCUMENT: {
+            shared_lock lock(server_mutex_);
+            const auto [words, status] = search_server_.MatchDocument(execution::seq, request.text, request.document_id);
+            response.words.assign(words.begin(), words.end());
+            response.document_status = status;
+            break;
+        }
+        case RequestType::GET_TERM_STATISTICS: {
+            shared_lock lock(server_mutex_);
+            response.term_statistics = search_server_.GetTermStatistics(request.text);
+            break;
+        }
+        case RequestType::FIND_TOP_DOCUMENTS_WITH_STATISTICS: {
+            shared_lock lock(server_mutex_);
+            response.documents = search_server_.FindTopDocuments(context, request.text, request.status, request.term_statistics);
+            break;
+        }
+        case RequestType::FETCH_LOG: {
+            if (options_.replication_log == nullptr) {
+                throw invalid_argument("replication is disabled");
+            }
+            // Половина предельного размера кадра оставляет запас на заголовки ответа и неточность оценки размера записей
+            const optional<uint64_t> last_sequence = options_.replication_log->Read(request.sequence, request.max_count, response.mutations,
+                options_.max_frame_size / 2);
+            if (!last_sequence) {
+                throw out_of_range("replication log does not contain requested records");
+            }
+            response.sequence = *last_sequence;
+            break;
+        }
+        case RequestType::FETCH_SNAPSHOT: {
+            if (options_.replication_log == nullptr) {
+                throw invalid_argument("replication is disabled");
+            }
+            ReplicationSnapshot snapshot = options_.replication_log->GetSnapshot(request.document_id, request.max_count,
+                options_.max_frame_size / 2);
+            response.sequence = snapshot.sequence;
+            response.mutations = move(snapshot.documents);
+            break;
+        }
+        }
+    }
+    catch (const exception& e) {
+        response.status = ResponseStatus::ERROR;
+        response.error = e.what();
+    }
+    return response;
+}
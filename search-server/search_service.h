@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "search_server.h"
+#include "search_protocol.h"
+
+class ReplicationLog;
+
+struct SearchServiceOptions {
+    std::string host = "127.0.0.1"s;
+    uint16_t port = 0;              // 0 - свободный порт, см. GetPort
+    std::string unix_path;          // если задан, сервис слушает Unix-сокет вместо TCP
+    size_t worker_count = 0;        // 0 - по кол-ву аппаратных потоков
+    uint32_t max_frame_size = MAX_FRAME_SIZE;
+    // Соединение не читается, пока у него столько разобранных, но не выполненных запросов
+    // или столько байт неотправленных ответов: клиент с длинным конвейером не раздувает память сервиса
+    size_t max_pending_requests = 1024;
+    size_t max_pending_output = 8 * 1024 * 1024;
+    // Репликация: журнал, в который записываются изменения, и из которого реплики забирают записи
+    // и снимок (FETCH_LOG, FETCH_SNAPSHOT); nullptr - репликация недоступна
+    ReplicationLog* replication_log = nullptr;
+    // Блокировка сервера, общая с другим писателем (SearchReplica); nullptr - своя
+    std::shared_mutex* server_mutex = nullptr;
+    // Добавление и удаление по сети отклоняются (реплика)
+    bool read_only = false;
+};
+
+// Сетевой доступ к SearchServer по протоколу search_protocol.h (только Linux).
+// Один поток ведёт цикл событий epoll: принимает соединения, читает и пишет неблокирующие сокеты
+// и разбирает кадры. Выполнение запросов передаётся пулу рабочих потоков пачками: все разобранные
+// запросы соединения выполняются одним заданием по порядку, поэтому ответы приходят в порядке
+// запросов, а соединения обрабатываются параллельно. Поиск и матчинг выполняются под разделяемой
+// блокировкой сервера, добавление и удаление - под исключительной.
+// Некорректный кадр закрывает соединение, ошибка выполнения запроса возвращается ответом ERROR
+class SearchService {
+public:
+    SearchService(SearchServer& search_server, const SearchServiceOptions& options = SearchServiceOptions());
+    ~SearchService();
+
+    SearchService(const SearchService&) = delete;
+    SearchService& operator=(const SearchService&) = delete;
+
+    // Порт, который слушает сервис (0 для Unix-сокета)
+    uint16_t GetPort() const;
+
+    // Цикл событий в текущем потоке до вызова Stop
+    void Run();
+    // Цикл событий в отдельном потоке
+    void Start();
+    // Может вызываться из любого потока, в том числе из обработчика сигнала через флаг
+    void Stop();
+
+    struct Stats {
+        uint64_t connections = 0;
+        uint64_t requests = 0;
+        uint64_t batches = 0;
+        uint64_t protocol_errors = 0;
+    };
+    Stats GetStats() const;
+
+    // Переключение реплики в первичный сервер и обратно
+    void SetReadOnly(bool read_only);
+
+private:
+    struct Connection;
+    struct Batch;
+
+    SearchServer& search_server_;
+    SearchServiceOptions options_;
+    std::shared_mutex own_server_mutex_;
+    std::shared_mutex& server_mutex_;
+    std::atomic<bool> read_only_;
+
+    int listen_socket_ = -1;
+    int epoll_ = -1;
+    int wakeup_ = -1; // eventfd: завершённые пачки и остановка
+    uint16_t port_ = 0;
+    std::atomic<bool> stopping_{ false };
+    std::thread loop_thread_;
+
+    uint64_t next_connection_id_ = 1;
+    std::map<uint64_t, std::unique_ptr<Connection>> connections_; // только поток цикла событий
+
+    // Очередь заданий рабочих потоков и очередь выполненных пачек для цикла событий
+    std::mutex jobs_mutex_;
+    std::condition_variable jobs_ready_;
+    std::deque<std::unique_ptr<Batch>> jobs_;
+    bool workers_stopping_ = false;
+    std::vector<std::thread> workers_;
+    std::mutex done_mutex_;
+    std::vector<std::unique_ptr<Batch>> done_;
+
+    std::atomic<uint64_t> connection_count_{ 0 };
+    std::atomic<uint64_t> request_count_{ 0 };
+    std::atomic<uint64_t> batch_count_{ 0 };
+    std::atomic<uint64_t> protocol_error_count_{ 0 };
+
+    void Listen();
+    void Accept();
+    void ReadFrom(Connection& connection);
+    // Разбирает полные кадры ввода. Некорректный кадр закрывает соединение, тогда возвращает false
+    bool ParseRequests(Connection& connection);
+    bool IsReadingPaused(const Connection& connection) const;
+    void WriteTo(Connection& connection);
+    void Dispatch(Connection& connection);
+    void CollectDone();
+    void UpdateEvents(Connection& connection);
+    void CloseConnection(uint64_t connection_id);
+    void Wakeup();
+
+    void RunWorker();
+    void Execute(Batch& batch);
+    Response ExecuteRequest(const Request& request);
+};
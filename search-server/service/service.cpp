@@ -0,0 +1,250 @@
+// Сетевой поисковый сервер: SearchServer за SearchService (epoll, двоичный протокол search_protocol.h).
+// Слушает TCP-порт или Unix-сокет, работает до SIGINT/SIGTERM. Индекс можно заполнить
+// сгенерированным корпусом (--documents), стоп-слова тогда берутся из генератора.
+// С --shard I/N сервер хранит только документы корпуса с id % N == I и служит шардом
+// для распределённого поиска (aggregator/aggregator.cpp).
+// Репликация: первичный сервер с --replication-log N ведёт журнал изменений (последние N записей),
+// реплика с --replica-of ADDRESS только читает, а документы получает снимком и журналом первичного.
+// Реплике нужны те же стоп-слова: --stop-words или --documents (документы тогда не генерируются).
+// Раз в секунду реплика печатает применённую запись и отставание.
+// С --latency-metrics on сервер собирает гистограммы задержек операций (LatencyMetrics)
+// и печатает перцентили при завершении.
+//
+// Сборка из каталога search-server (только Linux):
+//
+//  g++ -std=c++17 -O2 service/service.cpp $(ls *.cpp | grep -v '^main.cpp$') -o search_service -ltbb -lpthread
+//
+// Пример запуска:
+//
+//  ./search_service --port 7070 --workers 8 --documents 100000
+//  ./search_service --unix /tmp/search.sock --stop-words "и в на"
+//  ./search_service --port 7071 --documents 100000 --shard 0/2
+//  ./search_service --port 7070 --documents 100000 --replication-log 1000000
+//  ./search_service --port 7080 --documents 100000 --replica-of :7070
+//  ./search_service --port 7070 --documents 100000 --latency-metrics on
+
+#include "../search_service.h"
+#include "../replication.h"
+#include "../corpus_generator.h"
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <optional>
+#include <shared_mutex>
+#include <thread>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    struct ServiceConfig {
+        SearchServiceOptions options;
+        string stop_words;
+        int document_count = 0; // документов сгенерированного корпуса
+        uint32_t seed = 42;
+        int shard_index = 0;
+        int shard_count = 1;
+        size_t replication_log_size = 0; // 0 - без журнала
+        optional<ServiceAddress> primary; // адрес первичного сервера для реплики
+        bool latency_metrics = false;
+    };
+
+    // Добавляет в сервер только документы своего шарда. Генератор проходит весь корпус,
+    // поэтому шарды с одинаковым seed вместе содержат тот же корпус, что и один сервер.
+    // Первичный сервер записывает добавления и в журнал репликации
+    struct ShardWriter {
+        SearchServer& search_server;
+        int shard_index;
+        int shard_count;
+        ReplicationLog* replication_log;
+
+        void AddDocument(int document_id, const string& document, DocumentStatus status, const vector<int>& ratings) {
+            if (document_id % shard_count != shard_index) {
+                return;
+            }
+            search_server.AddDocument(document_id, document, status, ratings);
+            if (replication_log != nullptr) {
+                Request addition;
+                addition.type = RequestType::ADD_DOCUMENT;
+                addition.document_id = document_id;
+                addition.status = status;
+                addition.ratings = ratings;
+                addition.text = document;
+                replication_log->Append(move(addition));
+            }
+        }
+    };
+
+    SearchService* running_service = nullptr;
+    atomic<bool> stop_requested = false;
+
+    void HandleSignal(int) {
+        // Stop только записывает флаг и eventfd, это допустимо в обработчике сигнала
+        stop_requested.store(true);
+        if (running_service != nullptr) {
+            running_service->Stop();
+        }
+    }
+
+    void PrintUsage() {
+        cerr << "Usage: search_service [--host ADDRESS] [--port N] [--unix PATH] [--workers N]"s
+            << " [--stop-words \"WORDS\"] [--documents N] [--seed N] [--shard INDEX/COUNT]"s
+            << " [--replication-log N] [--replica-of ADDRESS] [--latency-metrics on|off]"s << endl;
+    }
+
+    ServiceConfig ParseArguments(int argc, char* argv[]) {
+        ServiceConfig config;
+        for (int i = 1; i < argc; ++i) {
+            const string_view argument = argv[i];
+            if (i + 1 >= argc) {
+                throw invalid_argument("missing value for "s + string(argument));
+            }
+            const string value = argv[++i];
+            if (argument == "--host"sv) {
+                config.options.host = value;
+            }
+            else if (argument == "--port"sv) {
+                const int port = stoi(value);
+                if (port < 0 || port > 65535) {
+                    throw invalid_argument("invalid port "s + value);
+                }
+                config.options.port = static_cast<uint16_t>(port);
+            }
+            else if (argument == "--unix"sv) {
+                config.options.unix_path = value;
+            }
+            else if (argument == "--workers"sv) {
+                config.options.worker_count = stoul(value);
+            }
+            else if (argument == "--stop-words"sv) {
+                config.stop_words = value;
+            }
+            else if (argument == "--documents"sv) {
+                config.document_count = stoi(value);
+            }
+            else if (argument == "--seed"sv) {
+                config.seed = static_cast<uint32_t>(stoul(value));
+            }
+            else if (argument == "--shard"sv) {
+                const size_t slash = value.find('/');
+                if (slash == string::npos) {
+                    throw invalid_argument("shard must be INDEX/COUNT"s);
+                }
+                config.shard_index = stoi(value.substr(0, slash));
+                config.shard_count = stoi(value.substr(slash + 1));
+                if (config.shard_count <= 0 || config.shard_index < 0 || config.shard_index >= config.shard_count) {
+                    throw invalid_argument("invalid shard "s + value);
+                }
+            }
+            else if (argument == "--replication-log"sv) {
+                config.replication_log_size = stoul(value);
+            }
+            else if (argument == "--replica-of"sv) {
+                config.primary = ParseServiceAddress(value);
+            }
+            else if (argument == "--latency-metrics"sv) {
+                if (value != "on"sv && value != "off"sv) {
+                    throw invalid_argument("--latency-metrics must be on or off"s);
+                }
+                config.latency_metrics = value == "on"sv;
+            }
+            else {
+                throw invalid_argument("unknown argument "s + string(argument));
+            }
+        }
+        if (config.document_count < 0) {
+            throw invalid_argument("document count must not be negative"s);
+        }
+        return config;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    ServiceConfig config;
+    try {
+        config = ParseArguments(argc, argv);
+    }
+    catch (const exception& e) {
+        cerr << e.what() << endl;
+        PrintUsage();
+        return 1;
+    }
+
+    try {
+        CorpusConfig corpus_config;
+        corpus_config.seed = config.seed;
+        CorpusGenerator corpus(corpus_config);
+        SearchServer search_server = config.document_count > 0
+            ? SearchServer(corpus.GetStopWords())
+            : SearchServer(config.stop_words);
+        // Реплика тоже ведёт журнал: к ней можно подключить свои реплики
+        optional<ReplicationLog> replication_log;
+        if (config.replication_log_size > 0 || config.primary) {
+            replication_log.emplace(config.replication_log_size > 0 ? config.replication_log_size : 1'000'000);
+            config.options.replication_log = &*replication_log;
+        }
+        if (config.document_count > 0 && !config.primary) {
+            cerr << "Indexing "s << config.document_count << " documents..."s << endl;
+            ShardWriter writer{ search_server, config.shard_index, config.shard_count, config.options.replication_log };
+            corpus.AddDocuments(writer, 0, config.document_count);
+        }
+
+        shared_mutex server_mutex;
+        optional<SearchReplica> replica;
+        if (config.primary) {
+            config.options.server_mutex = &server_mutex;
+            config.options.read_only = true;
+            SearchReplicaOptions replica_options;
+            replica_options.primary = *config.primary;
+            replica_options.replication_log = config.options.replication_log;
+            replica_options.max_frame_size = config.options.max_frame_size;
+            replica.emplace(search_server, server_mutex, replica_options);
+        }
+
+        // Индексирование сгенерированного корпуса не замеряется, только обслуживание
+        LatencyMetrics::SetEnabled(config.latency_metrics);
+        SearchService service(search_server, config.options);
+        running_service = &service;
+        signal(SIGINT, HandleSignal);
+        signal(SIGTERM, HandleSignal);
+        if (config.options.unix_path.empty()) {
+            cerr << "Listening on "s << config.options.host << ':' << service.GetPort() << endl;
+        }
+        else {
+            cerr << "Listening on "s << config.options.unix_path << endl;
+        }
+        if (!replica) {
+            service.Run();
+        }
+        else {
+            replica->Start();
+            service.Start();
+            while (!stop_requested.load()) {
+                this_thread::sleep_for(chrono::seconds(1));
+                const SearchReplica::Lag lag = replica->GetLag();
+                cerr << "Replica applied "s << replica->GetAppliedSequence() << ", lag "s << lag.records << " records, "s
+                    << chrono::duration_cast<chrono::milliseconds>(lag.time).count() << " ms"s << endl;
+            }
+            replica->Stop();
+        }
+        running_service = nullptr;
+
+        const SearchService::Stats stats = service.GetStats();
+        cerr << "Served "s << stats.requests << " requests in "s << stats.batches << " batches over "s
+            << stats.connections << " connections, protocol errors: "s << stats.protocol_errors << endl;
+        if (config.latency_metrics) {
+            cerr << "Operation latency, ns:"s << endl;
+            LatencyMetrics::PrintSummary(cerr);
+        }
+    }
+    catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
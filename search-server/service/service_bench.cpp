@@ -0,0 +1,220 @@
+// Нагрузка на сетевой поисковый сервер (search_service): несколько соединений, в каждом
+// до --pipeline запросов в полёте. Задержка запроса - от отправки до получения ответа.
+// Выводит в JSON пропускную способность всего прогона и на соединение, перцентили задержки.
+// С --address ADDR[,ADDR...] соединения распределяются по серверам по кругу: так измеряется
+// масштабирование чтения первичным сервером и его репликами.
+//
+// Сборка из каталога search-server (только Linux):
+//
+//  g++ -std=c++17 -O2 service/service_bench.cpp $(ls *.cpp | grep -v '^main.cpp$') -o search_service_bench -ltbb -lpthread
+//
+// Пример запуска против ./search_service --port 7070 --documents 100000:
+//
+//  ./search_service_bench --port 7070 --connections 64 --pipeline 16 --duration 10
+//  ./search_service_bench --address :7070,:7080,:7081 --connections 48 --duration 10
+
+#include "../search_client.h"
+#include "../corpus_generator.h"
+#include "../latency_histogram.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    using Clock = chrono::steady_clock;
+
+    struct BenchConfig {
+        vector<ServiceAddress> addresses;
+        int connections = 16;
+        int pipeline = 8;       // запросов в полёте на соединение
+        double duration = 10.0; // секунд
+        uint32_t seed = 42;
+        size_t query_count = 10'000;
+    };
+
+    struct ConnectionStats {
+        LatencyHistogram latencies;
+        uint64_t requests = 0;
+        uint64_t errors = 0;
+    };
+
+    // Соединение держит pipeline запросов в полёте: после каждого ответа отправляется следующий запрос
+    void RunConnection(const BenchConfig& config, const ServiceAddress& address, const vector<string>& queries,
+        size_t first_query, Clock::time_point deadline, ConnectionStats& stats) {
+        SearchClient client = SearchClient::Connect(address);
+        deque<Clock::time_point> send_times;
+        size_t next_query = first_query;
+        auto send = [&]() {
+            Request request;
+            request.type = RequestType::FIND_TOP_DOCUMENTS;
+            request.text = queries[next_query++ % queries.size()];
+            client.Send(move(request));
+            send_times.push_back(Clock::now());
+        };
+        for (int i = 0; i < config.pipeline; ++i) {
+            send();
+        }
+        client.Flush();
+        while (!send_times.empty()) {
+            const Response response = client.Receive();
+            stats.latencies.Record(Clock::now() - send_times.front());
+            send_times.pop_front();
+            ++stats.requests;
+            if (response.status != ResponseStatus::OK) {
+                ++stats.errors;
+            }
+            if (Clock::now() < deadline) {
+                send();
+                client.Flush();
+            }
+        }
+    }
+
+    void PrintUsage() {
+        cerr << "Usage: search_service_bench [--host ADDRESS] [--port N] [--unix PATH] [--address ADDR[,ADDR...]]"s
+            << " [--connections N] [--pipeline N] [--duration SECONDS] [--seed N] [--queries N]"s << endl;
+    }
+
+    BenchConfig ParseArguments(int argc, char* argv[]) {
+        BenchConfig config;
+        ServiceAddress single_address;
+        for (int i = 1; i < argc; ++i) {
+            const string_view argument = argv[i];
+            if (i + 1 >= argc) {
+                throw invalid_argument("missing value for "s + string(argument));
+            }
+            const string value = argv[++i];
+            if (argument == "--host"sv) {
+                single_address.host = value;
+            }
+            else if (argument == "--port"sv) {
+                single_address.port = static_cast<uint16_t>(stoi(value));
+            }
+            else if (argument == "--unix"sv) {
+                single_address.unix_path = value;
+            }
+            else if (argument == "--address"sv) {
+                for (size_t begin = 0; begin <= value.size();) {
+                    const size_t end = min(value.find(',', begin), value.size());
+                    config.addresses.push_back(ParseServiceAddress(string_view(value).substr(begin, end - begin)));
+                    begin = end + 1;
+                }
+            }
+            else if (argument == "--connections"sv) {
+                config.connections = stoi(value);
+            }
+            else if (argument == "--pipeline"sv) {
+                config.pipeline = stoi(value);
+            }
+            else if (argument == "--duration"sv) {
+                config.duration = stod(value);
+            }
+            else if (argument == "--seed"sv) {
+                config.seed = static_cast<uint32_t>(stoul(value));
+            }
+            else if (argument == "--queries"sv) {
+                config.query_count = stoul(value);
+            }
+            else {
+                throw invalid_argument("unknown argument "s + string(argument));
+            }
+        }
+        if (config.connections <= 0 || config.pipeline <= 0 || config.duration <= 0 || config.query_count == 0) {
+            throw invalid_argument("counts and duration must be positive"s);
+        }
+        if (config.addresses.empty()) {
+            if (single_address.unix_path.empty() && single_address.port == 0) {
+                throw invalid_argument("either --port, --unix or --address is required"s);
+            }
+            config.addresses.push_back(single_address);
+        }
+        return config;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    BenchConfig config;
+    try {
+        config = ParseArguments(argc, argv);
+    }
+    catch (const exception& e) {
+        cerr << e.what() << endl;
+        PrintUsage();
+        return 1;
+    }
+
+    // Запросы генерируются по тому же корпусу, что и у search_service --documents с тем же --seed
+    CorpusConfig corpus_config;
+    corpus_config.seed = config.seed;
+    CorpusGenerator corpus(corpus_config);
+    QueryLogConfig log_config;
+    log_config.seed = config.seed + 1;
+    QueryLogGenerator query_log(corpus, log_config);
+    vector<string> queries(config.query_count);
+    for (string& query : queries) {
+        query_log.NextQuery(query);
+    }
+
+    vector<ConnectionStats> stats(config.connections);
+    atomic<int> failed_connections = 0;
+    const auto start = Clock::now();
+    const auto deadline = start + chrono::duration_cast<Clock::duration>(chrono::duration<double>(config.duration));
+    vector<thread> threads;
+    for (int i = 0; i < config.connections; ++i) {
+        threads.emplace_back([&, i]() {
+            try {
+                RunConnection(config, config.addresses[i % config.addresses.size()], queries,
+                    i * queries.size() / config.connections, deadline, stats[i]);
+            }
+            catch (const exception& e) {
+                cerr << "connection "s << i << ": "s << e.what() << endl;
+                ++failed_connections;
+            }
+        });
+    }
+    for (thread& connection_thread : threads) {
+        connection_thread.join();
+    }
+    const double seconds = chrono::duration<double>(Clock::now() - start).count();
+
+    ConnectionStats total;
+    double min_connection_rps = 0.0;
+    for (size_t i = 0; i < stats.size(); ++i) {
+        total.latencies.Merge(stats[i].latencies);
+        total.requests += stats[i].requests;
+        total.errors += stats[i].errors;
+        const double rps = stats[i].requests / seconds;
+        min_connection_rps = i == 0 ? rps : min(min_connection_rps, rps);
+    }
+
+    cout << "{\n"s;
+    cout << "  \"config\": {\"servers\": "s << config.addresses.size()
+        << ", \"connections\": "s << config.connections
+        << ", \"pipeline\": "s << config.pipeline
+        << ", \"duration\": "s << config.duration << "},\n"s;
+    cout << fixed << setprecision(2);
+    cout << "  \"requests\": "s << total.requests << ",\n"s;
+    cout << "  \"errors\": "s << total.errors << ",\n"s;
+    cout << "  \"failed_connections\": "s << failed_connections.load() << ",\n"s;
+    cout << "  \"requests_per_second\": "s << total.requests / seconds << ",\n"s;
+    cout << "  \"per_connection_requests_per_second\": {\"mean\": "s << total.requests / seconds / config.connections
+        << ", \"min\": "s << min_connection_rps << "},\n"s;
+    cout.unsetf(ios_base::floatfield);
+    cout << "  \"latency_ns\": {\"p50\": "s << total.latencies.GetPercentile(50).count()
+        << ", \"p99\": "s << total.latencies.GetPercentile(99).count()
+        << ", \"p999\": "s << total.latencies.GetPercentile(99.9).count()
+        << ", \"max\": "s << total.latencies.GetMax().count() << "}\n"s;
+    cout << "}\n"s;
+    return failed_connections.load() == 0 ? 0 : 1;
+}
@@ -1,24 +1,80 @@
 #include "string_processing.h"
 
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define STRING_PROCESSING_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
 using namespace std;
 
-vector<string_view> SplitIntoWords(string_view str) {
-    if (str.empty()) return { basic_string_view("") };
+namespace {
+    // Все разделители и управляющие символы имеют коды не больше пробела
+    bool IsSeparatorOrControl(char c) {
+        return static_cast<unsigned char>(c) <= static_cast<unsigned char>(' ');
+    }
 
-    vector<string_view> result = {};
-    const int64_t pos_end = str.npos;
+    bool IsAsciiSpace(char c) {
+        return c == ' ' || (c >= '\t' && c <= '\r');
+    }
 
-    while (!str.empty()) {
-        //  
-        int64_t space = str.find(' ', 0);
+#ifdef STRING_PROCESSING_SSE2
+    int CountTrailingZeros(unsigned mask) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctz(mask);
+#endif
+    }
+#endif
 
-        result.push_back(str.substr(0, space));
+    // Находит первый символ с кодом не больше пробела (конец слова)
+    const char* FindSeparator(const char* pos, const char* end) {
+#ifdef STRING_PROCESSING_SSE2
+        const __m128i space = _mm_set1_epi8(' ');
+        while (end - pos >= 16) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+            // min(c, ' ') == c  <=>  c <= ' ' (сравнение беззнаковое)
+            const unsigned mask = static_cast<unsigned>(
+                _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(chunk, space), chunk)));
+            if (mask != 0) {
+                return pos + CountTrailingZeros(mask);
+            }
+            pos += 16;
+        }
+#endif
+        while (pos != end && !IsSeparatorOrControl(*pos)) {
+            ++pos;
+        }
+        return pos;
+    }
 
-        if (space == pos_end) {
-            break;
+    // Пропускает пробельные символы, на управляющем символе выбрасывает исключение
+    const char* SkipSeparators(const char* pos, const char* end) {
+        for (; pos != end && IsSeparatorOrControl(*pos); ++pos) {
+            if (!IsAsciiSpace(*pos)) {
+                throw invalid_argument("contains invalid characters");
+            }
         }
-        str.remove_prefix(++space);
+        return pos;
     }
+}
 
+void WordTokenizer::Iterator::FindWord(const char* pos) {
+    word_begin_ = SkipSeparators(pos, end_);
+    word_end_ = FindSeparator(word_begin_, end_);
+}
+
+vector<string_view> SplitIntoWords(string_view str) {
+    vector<string_view> result;
+    for (const string_view word : WordTokenizer(str)) {
+        result.push_back(word);
+    }
     return result;
-}
\ No newline at end of file
+}
@@ -1,7 +1,88 @@
 #pragma once
 
+#include <cstddef>
+#include <iterator>
 #include <vector>
 #include <string>
+#include <string_view>
 
-//       
-std::vector<std::string_view> SplitIntoWords(std::string_view str);
\ No newline at end of file
+// Разбиение строки на слова по пробельным символам ASCII (' ', '\t', '\n', '\v', '\f', '\r') без выделения памяти.
+// Поиск разделителей идёт блоками по 16 байт (SSE2), в том же проходе проверяются управляющие символы:
+// символ с кодом от 0 до 31, не являющийся пробельным, приводит к исключению invalid_argument
+class WordTokenizer {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string_view*;
+        using reference = std::string_view;
+
+        Iterator() = default;
+
+        std::string_view operator*() const {
+            return { word_begin_, static_cast<size_t>(word_end_ - word_begin_) };
+        }
+
+        Iterator& operator++() {
+            FindWord(word_end_);
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator result = *this;
+            ++*this;
+            return result;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return word_begin_ == other.word_begin_;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        friend class WordTokenizer;
+
+        Iterator(const char* begin, const char* end)
+            : end_(end) {
+            FindWord(begin);
+        }
+
+        // Пропускает разделители начиная с pos и находит границы следующего слова
+        void FindWord(const char* pos);
+
+        const char* word_begin_ = nullptr;
+        const char* word_end_ = nullptr;
+        const char* end_ = nullptr;
+    };
+
+    explicit WordTokenizer(std::string_view text)
+        : text_(text) {
+    }
+
+    Iterator begin() const {
+        return { text_.data(), text_.data() + text_.size() };
+    }
+
+    Iterator end() const {
+        return { text_.data() + text_.size(), text_.data() + text_.size() };
+    }
+
+private:
+    std::string_view text_;
+};
+
+// Вызывает callback для каждого слова строки, не выделяя память
+template <typename Callback>
+void ForEachWord(std::string_view text, Callback callback) {
+    for (const std::string_view word : WordTokenizer(text)) {
+        callback(word);
+    }
+}
+
+// Разделение строки на отдельные слова, пустая строка не содержит слов
+std::vector<std::string_view> SplitIntoWords(std::string_view str);
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+// Генерация случайных слов, документов и запросов для нагрузочных тестов и бенчмарков.
+// При одинаковом состоянии генератора результат одинаков, поэтому данные воспроизводятся по seed
+
+inline std::string GenerateWord(std::mt19937& generator, int max_length) {
+    const int length = std::uniform_int_distribution(1, max_length)(generator);
+    std::string word;
+    word.reserve(length);
+    for (int i = 0; i < length; ++i) {
+        word.push_back(std::uniform_int_distribution(short('a'), short('z'))(generator));
+    }
+    return word;
+}
+
+// Словарь из не больше word_count случайных слов, упорядоченный и без повторов
+inline std::vector<std::string> GenerateDictionary(std::mt19937& generator, int word_count, int max_length) {
+    std::vector<std::string> words;
+    words.reserve(word_count);
+    for (int i = 0; i < word_count; ++i) {
+        words.push_back(GenerateWord(generator, max_length));
+    }
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    return words;
+}
+
+// Запрос (или текст документа) из word_count слов словаря, каждое слово с вероятностью minus_prob - минус слово
+inline std::string GenerateQuery(std::mt19937& generator, const std::vector<std::string>& dictionary, int word_count, double minus_prob = 0) {
+    std::string query;
+    for (int i = 0; i < word_count; ++i) {
+        if (!query.empty()) {
+            query.push_back(' ');
+        }
+        if (std::uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
+            query.push_back('-');
+        }
+        query += dictionary[std::uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
+    }
+    return query;
+}
+
+inline std::vector<std::string> GenerateQueries(std::mt19937& generator, const std::vector<std::string>& dictionary, int query_count, int word_count) {
+    std::vector<std::string> queries;
+    queries.reserve(query_count);
+    for (int i = 0; i < query_count; ++i) {
+        queries.push_back(GenerateQuery(generator, dictionary, word_count));
+    }
+    return queries;
+}
+
+// Запросы случайной длины от 1 до max_word_count слов
+inline std::vector<std::string> GenerateRandomLengthQueries(std::mt19937& generator, const std::vector<std::string>& dictionary,
+    int query_count, int max_word_count) {
+    std::vector<std::string> queries;
+    queries.reserve(query_count);
+    for (int i = 0; i < query_count; ++i) {
+        const int word_count = std::uniform_int_distribution(1, max_word_count)(generator);
+        queries.push_back(GenerateQuery(generator, dictionary, word_count));
+    }
+    return queries;
+}
@@ -4,18 +4,35 @@
 #include <vector>
 #include <set>
 #include <map>
+#include <sstream>
+#include <thread>
 
 #include "search_server.h"
 #include "process_queries.h"
-
-//#include "match_documents_test.h"
-//#include "remove_documents_test.h"
+#include "allocation_counter.h"
+#include "paginator.h"
+#include "corpus_generator.h"
+#include "perf_counters.h"
+#include "async_query_processor.h"
+#include "search_service.h"
+#include "search_client.h"
+#include "search_aggregator.h"
+#include "replication.h"
+
+#ifdef __linux__
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "match_documents_test.h"
+#include "remove_documents_test.h"
 #include "finding_documents_test.h"
 
-//       2 
+// Потом убрать это и переделать на 2 файла
 using namespace std;
 //-----------------------------------------
-//   
+// Макросы для тестирования
 //-----------------------------------------
 template <typename Key, typename Value>
 ostream& operator<<(ostream& out, const pair<Key, Value>& container) {
@@ -109,28 +126,28 @@ void RunTestImpl(TestFunc func, const string& func_name) {
 #define RUN_TEST(func) RunTestImpl((func), #func)
 
 //--------------------------------------------------------------
-//---------      ----------
+//--------- Начало модульных тестов поисковой системы ----------
 
-//  :     ,
-//     -   ,
-//           id     
+// Тест проверяет: работоспособность конструкторов с различными параметрами,
+// что поисковая система исключает стоп-слова при добавлении документов,
+// а также выдаёт ошибки при попытке добавить документ с совпадающим id или если он меньше нуля
 void TestAddingDocumentsStopWordsExcludingStopWords() {
     const int doc_id = 42;
     const string content = "cat in the city"s;
     const vector<int> ratings = { 0 };
 
-    //      id    id
+    // Попытаемся добавить документ с отрицательным id или с дублирующимся id
     {
         SearchServer server;
         server.AddDocument(doc_id, content, DocumentStatus::ACTUAL, ratings);
-        //        
+        // Повторно пытаемся добавить документ и должны отловить исключение
         try {
             server.AddDocument(doc_id, content, DocumentStatus::ACTUAL, ratings);
         }
         catch (const exception& e) {
             ASSERT_EQUAL(e.what(), "document_id already exist or below zero"s);
         }
-        //      id
+        // Пытаемся добавить документ с отрицательным id
         try {
             server.AddDocument(doc_id, content, DocumentStatus::ACTUAL, ratings);
         }
@@ -138,8 +155,8 @@ void TestAddingDocumentsStopWordsExcludingStopWords() {
             ASSERT_EQUAL(e.what(), "document_id already exist or below zero"s);
         }
     }
-    // ,   ,     -,
-    //   
+    // Убеждаемся, что поиск слова, не входящего в список стоп-слов,
+    // находит нужный документ
     {
         SearchServer server;
 
@@ -149,8 +166,8 @@ void TestAddingDocumentsStopWordsExcludingStopWords() {
         ASSERT_EQUAL(result[0].id, doc_id);
     }
 
-    //  ,     ,    -,
-    //   
+    // Затем убеждаемся, что поиск этого же слова, входящего в список стоп-слов,
+    // возвращает пустой результат
     {
         SearchServer server;
 
@@ -161,10 +178,58 @@ void TestAddingDocumentsStopWordsExcludingStopWords() {
     }
 }
 
-//     ,          
+// Тест проверяет разбиение строки на слова: все пробельные символы ASCII являются разделителями,
+// пустые слова не возвращаются, управляющие символы приводят к исключению
+void TestWordTokenizer() {
+    ASSERT(SplitIntoWords(""s).empty());
+    ASSERT(SplitIntoWords("  \t\n "s).empty());
+    {
+        const vector<string_view> expected = { "cat"sv, "in"sv, "the"sv, "city"sv };
+        ASSERT_EQUAL(SplitIntoWords("  cat\tin  the\r\ncity "s), expected);
+    }
+    // Длинные слова проверяются блоками по 16 байт
+    {
+        const string text = "abcdefghijklmnopqrstuvwxyz0123456789 abcdefghijklmnop\vq"s;
+        const vector<string_view> expected = { "abcdefghijklmnopqrstuvwxyz0123456789"sv, "abcdefghijklmnop"sv, "q"sv };
+        ASSERT_EQUAL(SplitIntoWords(text), expected);
+    }
+    // Символы с кодами больше 127 являются частью слова
+    {
+        const string text = "\xC0\xC1\xC2 \xFF\xFE\xFD\xFC\xFB\xFA\xF9\xF8\xF7\xF6\xF5\xF4\xF3\xF2\xF1\xF0\xEF"s;
+        ASSERT_EQUAL(SplitIntoWords(text).size(), 2u);
+        ASSERT_EQUAL(SplitIntoWords(text)[1].size(), 17u);
+    }
+    // Обход без выделения памяти
+    {
+        int word_count = 0;
+        ForEachWord("funny pet and nasty rat"sv, [&word_count](string_view) { ++word_count; });
+        ASSERT_EQUAL(word_count, 5);
+    }
+    // Управляющий символ внутри длинного слова
+    try {
+        SplitIntoWords("funny pet and nasty rat with very long \x01tail"s);
+        ASSERT_HINT(false, "exception expected"s);
+    }
+    catch (const invalid_argument& e) {
+        ASSERT_EQUAL(e.what(), "contains invalid characters"s);
+    }
+    // Документ со спецсимволом не добавляется и не портит индекс
+    {
+        SearchServer server;
+        try {
+            server.AddDocument(1, "cat in\x02 the city"s, DocumentStatus::ACTUAL, { 1 });
+        }
+        catch (const invalid_argument&) {
+        }
+        ASSERT_EQUAL(server.GetDocumentCount(), 0);
+        ASSERT(server.FindTopDocuments("cat"s).empty());
+    }
+}
+
+// Тест проверяет поддержку минус слов, документы содержащие минус слова в поиске не включаются в результат
 void TestExludeDocumentsWithMinusWordsFromResults() {
     const vector<int> ratings = { 0 };
-    //             
+    //Проверяем что в случае поиска документа с минус словом он не попадёт в результаты
     {
         SearchServer server;
 
@@ -172,11 +237,11 @@ void TestExludeDocumentsWithMinusWordsFromResults() {
         server.AddDocument(42, "cat in the city"s, DocumentStatus::ACTUAL, ratings);
         server.AddDocument(14, "dog outside the city"s, DocumentStatus::ACTUAL, ratings);
         vector<Document> result = server.FindTopDocuments("city -cat"s);
-        //            
+        //убеждаемся что в результатах есть только один документ в котором нет минус слова
         ASSERT_EQUAL(result.size(), 1u);
     }
 
-    //           
+    //Проверяем если в запросе будут только стоп слова то результат будет пустой
     {
         SearchServer server;
 
@@ -187,31 +252,31 @@ void TestExludeDocumentsWithMinusWordsFromResults() {
     }
 }
 
-//    .
-//              ,
-//   .        - ,
-//     .
+// Тест проверяет Матчинг документов.
+// При матчинге документа по поисковому запросу должны быть возвращены все слова из поискового запроса,
+// присутствующие в документе.Если есть соответствие хотя бы по одному минус - слову,
+// должен возвращаться пустой список слов.
 void TestMatchDocuments() {
     const int doc_id = 42;
     const string content = "cat in the city"s;
     const vector<int> ratings = { 1, 2, 3 };
     string query = "cat dog outside the";
-    //    MatchDocument   
+    //Проверка того что функция MatchDocument находит совпадающие слова
     {
         SearchServer server;
         server.AddDocument(doc_id, content, DocumentStatus::ACTUAL, ratings);
 
         vector<string_view> result_matched_words;
         DocumentStatus status_matched_document_status;
-        // ,         MatchDocument
+        //Распаковываем кортеж, который изменяется по ссылке в результате выполнения функции MatchDocument
 
         tie(result_matched_words, status_matched_document_status) = server.MatchDocument(query, doc_id);
 
-        //     cat  the               
+        //Поисковый запрос должен вернуть результат cat и the так как они присутствуют в указанном документе        
         vector<string_view> expected_result = { "cat", "the" };
         ASSERT_EQUAL(result_matched_words, expected_result);
     }
-    //       
+    //Проверка исключения документа если там присутствует минус слово
     query = "cat dog -city outside the";
     {
         SearchServer server;
@@ -219,14 +284,14 @@ void TestMatchDocuments() {
 
         vector<string_view> result_matched_words;
         DocumentStatus status_matched_document_status;
-        // ,         MatchDocument
+        //Распаковываем кортеж, который изменяется по ссылке в результате выполнения функции MatchDocument
 
         tie(result_matched_words, status_matched_document_status) = server.MatchDocument(query, doc_id);
 
-        //             city
+        //Поисковый запрос должен вернуть пустую строку так как в запросе присутвует минус слово city
         ASSERT(result_matched_words.empty());
     }
-    //       
+    //Если совпадающих слов нет должен возвращаться пустой вектор
     query = "dog inside box";
     {
         SearchServer server;
@@ -234,36 +299,36 @@ void TestMatchDocuments() {
 
         vector<string_view> result_matched_words;
         DocumentStatus status_matched_document_status;
-        // ,         MatchDocument        
+        //Распаковываем кортеж, который изменяется по ссылке в результате выполнения функции MatchDocument        
         tie(result_matched_words, status_matched_document_status) = server.MatchDocument(query, doc_id);
 
-        //             city        
+        //Поисковый запрос должен вернуть пустую строку так как в запросе присутвует минус слово city        
         ASSERT(result_matched_words.empty());
     }
 }
 
-//       
+// Проверяет работу многопоточной версии функции матчинга документов
 void TestMatchDocumentsInPar() {
     const int doc_id = 42;
     const string content = "cat in the city"s;
     const vector<int> ratings = { 1, 2, 3 };
     string query = "cat dog outside the";
-    //    MatchDocument   
+    //Проверка того что функция MatchDocument находит совпадающие слова
     {
         SearchServer server;
         server.AddDocument(doc_id, content, DocumentStatus::ACTUAL, ratings);
 
         vector<string_view> result_matched_words;
         DocumentStatus status_matched_document_status;
-        // ,         MatchDocument
+        //Распаковываем кортеж, который изменяется по ссылке в результате выполнения функции MatchDocument
 
         tie(result_matched_words, status_matched_document_status) = server.MatchDocument(execution::par, query, doc_id);
 
-        //     cat  the               
+        //Поисковый запрос должен вернуть результат cat и the так как они присутствуют в указанном документе        
         vector<string_view> expected_result = { "cat", "the" };
         ASSERT_EQUAL((result_matched_words), expected_result);
     }
-    //       
+    //Проверка исключения документа если там присутствует минус слово
     query = "cat dog -city outside the";
     {
         SearchServer server;
@@ -271,14 +336,14 @@ void TestMatchDocumentsInPar() {
 
         vector<string_view> result_matched_words;
         DocumentStatus status_matched_document_status;
-        // ,         MatchDocument
+        //Распаковываем кортеж, который изменяется по ссылке в результате выполнения функции MatchDocument
 
         tie(result_matched_words, status_matched_document_status) = server.MatchDocument(execution::par, query, doc_id);
 
-        //             city
+        //Поисковый запрос должен вернуть пустую строку так как в запросе присутвует минус слово city
         ASSERT(result_matched_words.empty());
     }
-    //       
+    //Если совпадающих слов нет должен возвращаться пустой вектор
     query = "dog inside box";
     {
         SearchServer server;
@@ -286,26 +351,75 @@ void TestMatchDocumentsInPar() {
 
         vector<string_view> result_matched_words;
         DocumentStatus status_matched_document_status;
-        // ,         MatchDocument        
+        //Распаковываем кортеж, который изменяется по ссылке в результате выполнения функции MatchDocument        
         tie(result_matched_words, status_matched_document_status) = server.MatchDocument(query, doc_id);
 
-        //             city        
+        //Поисковый запрос должен вернуть пустую строку так как в запросе присутвует минус слово city        
         ASSERT(result_matched_words.empty());
     }
 }
 
-//           
+// Проверяет матчинг одного запроса с набором документов: результат упорядочен по id
+// и совпадает с матчингом каждого документа по отдельности
+void TestMatchDocumentsBulk() {
+    SearchServer search_server("and with"s);
+    AddDocument(search_server, 5, "nasty rat with curly hair"s, DocumentStatus::BANNED, { 1, 2 });
+    AddDocument(search_server, 1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    AddDocument(search_server, 3, "funny pet and not very nasty rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+    AddDocument(search_server, 2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+    AddDocument(search_server, 4, "pet with rat and rat and rat"s, DocumentStatus::IRRELEVANT, { 1, 2 });
+
+    const string query = "curly nasty rat -not rat"s;
+    const auto result = search_server.MatchDocuments(execution::par, query);
+    ASSERT_EQUAL(result.size(), 5u);
+    for (size_t i = 0; i < result.size(); ++i) {
+        ASSERT_EQUAL(result[i].first, static_cast<int>(i) + 1);
+        const auto [words, status] = search_server.MatchDocument(query, result[i].first);
+        ASSERT_EQUAL(get<0>(result[i].second), words);
+        ASSERT(get<1>(result[i].second) == status);
+    }
+    {
+        const vector<string_view> expected = { "curly"sv, "nasty"sv, "rat"sv };
+        ASSERT_EQUAL(get<0>(result[4].second), expected);
+        ASSERT(get<1>(result[4].second) == DocumentStatus::BANNED);
+    }
+    // документ 3 содержит минус слово
+    ASSERT(get<0>(result[2].second).empty());
+
+    // Набор документов, порядок и повторы id не важны
+    const vector<int> ids = { 4, 2, 4 };
+    const auto partial_result = search_server.MatchDocuments(execution::seq, query, ids.begin(), ids.end());
+    ASSERT_EQUAL(partial_result.size(), 2u);
+    ASSERT_EQUAL(partial_result[0].first, 2);
+    ASSERT_EQUAL(partial_result[1].first, 4);
+    {
+        const vector<string_view> expected = { "rat"sv };
+        ASSERT_EQUAL(get<0>(partial_result[1].second), expected);
+    }
+
+    // Несуществующий документ
+    try {
+        const vector<int> wrong_ids = { 1, 42 };
+        search_server.MatchDocuments(execution::par, query, wrong_ids.begin(), wrong_ids.end());
+        ASSERT_HINT(false, "exception expected"s);
+    }
+    catch (const out_of_range& e) {
+        ASSERT_EQUAL(e.what(), "no document with this id"s);
+    }
+}
+
+// Проверяет работу исключений при вводе неподходящих симовло в запросе функции ЬфесрВщсгьуте
 void TestMatchDocumentsThrowExecptions() {
     string query = "cat dog out\nside the";
     const int doc_id = 42;
-    //    MatchDocument       
+    //Проверка того что функция MatchDocument выбрасывает исклюсение при наличие спецсимволов в запросе
     {
         SearchServer server;
         server.AddDocument(doc_id, "cat in the city"s, DocumentStatus::ACTUAL, { 0 });
 
         vector<string_view> result_matched_words;
         DocumentStatus status_matched_document_status;
-        // ,         MatchDocument
+        //Распаковываем кортеж, который изменяется по ссылке в результате выполнения функции MatchDocument
         
         try {
             tie(result_matched_words, status_matched_document_status) = server.MatchDocument(execution::par, query, doc_id);
@@ -315,14 +429,14 @@ void TestMatchDocumentsThrowExecptions() {
         }
     }    
 
-    //    MatchDocument      
+    //Проверка того что функция MatchDocument выбрасывает исклюсение при поиске несуществующего документа
     {
         SearchServer server;
         server.AddDocument(doc_id, "cat in the city"s, DocumentStatus::ACTUAL, { 0 });
 
         vector<string_view> result_matched_words;
         DocumentStatus status_matched_document_status;
-        // ,         MatchDocument
+        //Распаковываем кортеж, который изменяется по ссылке в результате выполнения функции MatchDocument
 
         try {
             tie(result_matched_words, status_matched_document_status) = server.MatchDocument(execution::par, query, doc_id + 1);
@@ -332,15 +446,15 @@ void TestMatchDocumentsThrowExecptions() {
         }
     }
 
-    //    MatchDocument          
-    //   
+    //Проверка того что функция MatchDocument выбрасывает исклюсение при наличие в запросе двух минусов подряд передсловом
+    // или отдельного минуса
     {
         SearchServer server;
         server.AddDocument(doc_id, "cat in the city"s, DocumentStatus::ACTUAL, { 0 });
 
         vector<string_view> result_matched_words;
         DocumentStatus status_matched_document_status;
-        // ,         MatchDocument
+        //Распаковываем кортеж, который изменяется по ссылке в результате выполнения функции MatchDocument
 
         try {
             tie(result_matched_words, status_matched_document_status) = server.MatchDocument(execution::par, "cat in - the city"s, doc_id);
@@ -358,20 +472,772 @@ void TestMatchDocumentsThrowExecptions() {
     }
 }
 
-//     .      
-//     .
+// Тест проверяет поиск в режиме ALL_WORDS: в результат попадают только документы со всеми плюс словами,
+// релевантность совпадает с обычным поиском, последовательная и параллельная версии дают одинаковый результат
+void TestFindTopDocumentsWithAllWords() {
+    SearchServer search_server("and with"s);
+    AddDocument(search_server, 1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    AddDocument(search_server, 2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+    AddDocument(search_server, 3, "funny pet and not very nasty rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+    AddDocument(search_server, 4, "pet with rat and rat and rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+    AddDocument(search_server, 5, "nasty rat with curly hair"s, DocumentStatus::BANNED, { 1, 2 });
+
+    {
+        const auto result = search_server.FindTopDocuments(execution::seq, "nasty pet rat"s, QueryMode::ALL_WORDS);
+        ASSERT_EQUAL(result.size(), 2u);
+        const auto expected = search_server.FindTopDocuments(execution::seq, "nasty pet rat"s);
+        for (const Document& document : result) {
+            ASSERT(document.id == 1 || document.id == 3);
+            const auto it = find_if(expected.begin(), expected.end(), [&document](const Document& other) {
+                return other.id == document.id;
+            });
+            ASSERT(it != expected.end());
+            ASSERT(abs(it->relevance - document.relevance) < RELEVANCE_PRECISION);
+        }
+    }
+    // Минус слова и статус
+    {
+        const auto result = search_server.FindTopDocuments(execution::par, "nasty pet rat -not"s, QueryMode::ALL_WORDS);
+        ASSERT_EQUAL(result.size(), 1u);
+        ASSERT_EQUAL(result[0].id, 1);
+    }
+    ASSERT_EQUAL(search_server.FindTopDocuments(execution::par, "curly rat"s, QueryMode::ALL_WORDS, DocumentStatus::BANNED).size(), 1u);
+    ASSERT(search_server.FindTopDocuments(execution::par, "curly rat"s, QueryMode::ALL_WORDS).empty());
+    // Слово, которого нет в документах
+    ASSERT(search_server.FindTopDocuments(execution::seq, "funny dog"s, QueryMode::ALL_WORDS).empty());
+    // ANY_WORD совпадает с обычным поиском
+    ASSERT_EQUAL(search_server.FindTopDocuments(execution::seq, "funny dog"s, QueryMode::ANY_WORD).size(), 3u);
+
+    // Сравнение с полным перебором на большом наборе документов
+    {
+        mt19937 generator(42);
+        SearchServer big_server;
+        for (int id = 0; id < 3000; ++id) {
+            string text;
+            for (int i = 0; i < 20; ++i) {
+                text += "w"s + to_string(uniform_int_distribution(0, i % 2 ? 10 : 200)(generator)) + " "s;
+            }
+            big_server.AddDocument(id, text, DocumentStatus::ACTUAL, { id % 7 });
+        }
+        for (const string& query : { "w1 w2"s, "w3 w150 w7"s, "w5 w6 -w7"s, "w180 w190"s }) {
+            const vector<string_view> query_words = SplitIntoWords(query);
+            set<int> expected_ids;
+            for (const int id : big_server) {
+                const auto [words, status] = big_server.MatchDocument(query, id);
+                const auto plus_count = count_if(query_words.begin(), query_words.end(), [](string_view word) {
+                    return word[0] != '-';
+                });
+                if (static_cast<int>(words.size()) == plus_count) {
+                    expected_ids.insert(id);
+                }
+            }
+            auto predicate = [](int document_id, DocumentStatus status, int rating) {
+                return true;
+            };
+            // Все документы без ограничения MAX_RESULT_DOCUMENT_COUNT получаем через предикат по id
+            for (const int id : expected_ids) {
+                auto only_id = [id](int document_id, DocumentStatus status, int rating) {
+                    return document_id == id;
+                };
+                ASSERT_EQUAL(big_server.FindTopDocuments(execution::seq, query, QueryMode::ALL_WORDS, only_id).size(), 1u);
+            }
+            const auto seq_result = big_server.FindTopDocuments(execution::seq, query, QueryMode::ALL_WORDS, predicate);
+            const auto par_result = big_server.FindTopDocuments(execution::par, query, QueryMode::ALL_WORDS, predicate);
+            ASSERT_EQUAL(seq_result.size(), min<size_t>(expected_ids.size(), MAX_RESULT_DOCUMENT_COUNT));
+            ASSERT_EQUAL(par_result.size(), seq_result.size());
+            for (size_t i = 0; i < seq_result.size(); ++i) {
+                ASSERT(expected_ids.count(seq_result[i].id));
+                ASSERT(abs(seq_result[i].relevance - par_result[i].relevance) < RELEVANCE_PRECISION);
+            }
+        }
+    }
+}
+
+void TestBooleanQuery() {
+    SearchServer search_server("and with"s);
+    AddDocument(search_server, 1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    AddDocument(search_server, 2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+    AddDocument(search_server, 3, "funny pet and not very nasty rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+    AddDocument(search_server, 4, "pet with rat and rat and rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+    AddDocument(search_server, 5, "nasty rat with curly hair"s, DocumentStatus::BANNED, { 1, 2 });
+
+    auto find_ids = [&search_server](const string& query) {
+        set<int> ids;
+        for (const Document& document : search_server.FindTopDocuments(execution::seq, query, QueryMode::BOOLEAN)) {
+            ids.insert(document.id);
+        }
+        return ids;
+    };
+
+    // Обычный запрос без операторов даёт тот же результат, что и ANY_WORD
+    for (const string& query : { "funny rat"s, "curly -funny"s, "nasty pet -not"s, "with and"s }) {
+        const auto expected = search_server.FindTopDocuments(execution::seq, query);
+        const auto result = search_server.FindTopDocuments(execution::seq, query, QueryMode::BOOLEAN);
+        ASSERT_EQUAL(result.size(), expected.size());
+        for (size_t i = 0; i < result.size(); ++i) {
+            ASSERT_EQUAL(result[i].id, expected[i].id);
+            ASSERT(abs(result[i].relevance - expected[i].relevance) < RELEVANCE_PRECISION);
+        }
+    }
+    // AND, OR, NOT и скобки
+    ASSERT(find_ids("funny AND nasty"s) == set<int>({ 1, 3 }));
+    ASSERT(find_ids("funny AND nasty AND NOT not"s) == set<int>({ 1 }));
+    ASSERT(find_ids("curly OR (nasty AND -very)"s) == set<int>({ 1, 2 }));
+    ASSERT(find_ids("pet AND (curly OR very)"s) == set<int>({ 2, 3 }));
+    ASSERT(find_ids("(funny OR rat) AND NOT (nasty OR curly)"s) == set<int>({ 4 }));
+    ASSERT(find_ids("rat AND (NOT funny)"s) == set<int>({ 4 }));
+    ASSERT(find_ids("curly OR hair"s) == set<int>({ 2 }));
+    // Двойное отрицание равно самому слову
+    ASSERT(find_ids("funny NOT NOT nasty"s) == set<int>({ 1, 3 }));
+    ASSERT(find_ids("funny AND NOT NOT nasty"s) == set<int>({ 1, 3 }));
+    ASSERT(find_ids("funny -(-nasty)"s) == set<int>({ 1, 3 }));
+    ASSERT(find_ids("NOT NOT curly"s) == set<int>({ 2 }));
+    // Стоп-слова и отсутствующие слова
+    ASSERT(find_ids("pet AND with"s) == set<int>({ 1, 2, 3, 4 }));
+    ASSERT(find_ids("pet AND dog"s).empty());
+    ASSERT(find_ids("-pet"s).empty());
+    // Статус
+    ASSERT_EQUAL(search_server.FindTopDocuments(execution::par, "curly AND nasty"s, QueryMode::BOOLEAN, DocumentStatus::BANNED).size(), 1u);
+    // Релевантность по AND складывается из релевантности слов
+    {
+        const auto result = search_server.FindTopDocuments(execution::seq, "(funny AND nasty) OR curly"s, QueryMode::BOOLEAN);
+        const auto expected = search_server.FindTopDocuments(execution::seq, "funny nasty"s);
+        ASSERT_EQUAL(result.size(), 3u);
+        for (const Document& document : result) {
+            if (document.id == 2) {
+                continue;
+            }
+            const auto it = find_if(expected.begin(), expected.end(), [&document](const Document& other) {
+                return other.id == document.id;
+            });
+            ASSERT(it != expected.end());
+            ASSERT(abs(it->relevance - document.relevance) < RELEVANCE_PRECISION);
+        }
+    }
+    // Ошибки синтаксиса
+    for (const string& query : { "(funny"s, "funny)"s, "funny AND"s, "OR rat"s, "funny - rat"s, "--rat"s, "NOT"s, "()"s, "\"funny nasty\" OR curly"s, "-\"rat\""s }) {
+        try {
+            search_server.FindTopDocuments(execution::seq, query, QueryMode::BOOLEAN);
+            ASSERT_HINT(false, "invalid_argument expected for "s + query);
+        }
+        catch (const invalid_argument&) {
+        }
+    }
+
+    // seq и par дают одинаковый результат на большом наборе документов
+    {
+        mt19937 generator(7);
+        SearchServer big_server;
+        for (int id = 0; id < 3000; ++id) {
+            string text;
+            for (int i = 0; i < 20; ++i) {
+                text += "w"s + to_string(uniform_int_distribution(0, i % 2 ? 10 : 200)(generator)) + " "s;
+            }
+            big_server.AddDocument(id, text, DocumentStatus::ACTUAL, { id % 7 });
+        }
+        auto predicate = [](int document_id, DocumentStatus status, int rating) {
+            return true;
+        };
+        for (const string& query : { "w1 AND w2"s, "w150 AND (w3 OR w4) AND NOT w5"s, "(w1 AND w180) OR (w2 AND -w3)"s }) {
+            const auto seq_result = big_server.FindTopDocuments(execution::seq, query, QueryMode::BOOLEAN, predicate);
+            const auto par_result = big_server.FindTopDocuments(execution::par, query, QueryMode::BOOLEAN, predicate);
+            ASSERT(!seq_result.empty());
+            ASSERT_EQUAL(par_result.size(), seq_result.size());
+            for (size_t i = 0; i < seq_result.size(); ++i) {
+                ASSERT_EQUAL(seq_result[i].id, par_result[i].id);
+                ASSERT(abs(seq_result[i].relevance - par_result[i].relevance) < RELEVANCE_PRECISION);
+            }
+        }
+        // Каждый найденный документ удовлетворяет запросу
+        for (const Document& document : big_server.FindTopDocuments(execution::seq, "w150 AND (w3 OR w4) AND NOT w5"s, QueryMode::BOOLEAN, predicate)) {
+            const auto [words, status] = big_server.MatchDocument("w150 w3 w4 w5"s, document.id);
+            ASSERT(find(words.begin(), words.end(), "w150"sv) != words.end());
+            ASSERT(find(words.begin(), words.end(), "w3"sv) != words.end() || find(words.begin(), words.end(), "w4"sv) != words.end());
+            ASSERT(find(words.begin(), words.end(), "w5"sv) == words.end());
+        }
+    }
+}
+
+void TestPhraseQuery() {
+    SearchServer search_server("and with"s);
+    search_server.EnablePositionalIndex();
+    AddDocument(search_server, 1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    AddDocument(search_server, 2, "nasty pet with funny hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+    AddDocument(search_server, 3, "funny pet funny pet nasty"s, DocumentStatus::ACTUAL, { 1, 2 });
+    AddDocument(search_server, 4, "pet funny rat and funny"s, DocumentStatus::ACTUAL, { 1, 2 });
+    AddDocument(search_server, 5, "funny pet with curly hair"s, DocumentStatus::BANNED, { 1, 2 });
+    ASSERT(search_server.HasPositionalIndex());
+    ASSERT(search_server.GetPositionalIndexMemory() > 0);
+
+    auto find_ids = [&search_server](const string& query, QueryMode mode) {
+        set<int> ids;
+        for (const Document& document : search_server.FindTopDocuments(execution::seq, query, mode)) {
+            ids.insert(document.id);
+        }
+        return ids;
+    };
+
+    ASSERT(find_ids("\"funny pet\""s, QueryMode::ANY_WORD) == set<int>({ 1, 3 }));
+    ASSERT(find_ids("\"pet funny\""s, QueryMode::ANY_WORD) == set<int>({ 3, 4 }));
+    // Стоп-слово внутри фразы занимает позицию
+    ASSERT(find_ids("\"pet and nasty\""s, QueryMode::ANY_WORD) == set<int>({ 1 }));
+    ASSERT(find_ids("\"pet nasty\""s, QueryMode::ANY_WORD) == set<int>({ 3 }));
+    // Фраза и обычные слова
+    ASSERT(find_ids("\"funny pet\" hair -nasty"s, QueryMode::ANY_WORD).empty());
+    ASSERT(find_ids("\"rat and funny\" hair"s, QueryMode::ANY_WORD) == set<int>({ 2, 4 }));
+    ASSERT(find_ids("\"funny pet\" nasty"s, QueryMode::ALL_WORDS) == set<int>({ 1, 3 }));
+    ASSERT(find_ids("\"funny pet\" rat"s, QueryMode::ALL_WORDS) == set<int>({ 1 }));
+    // Фраза из одного слова - обычное слово
+    ASSERT(find_ids("\"hair\""s, QueryMode::ANY_WORD) == set<int>({ 2 }));
+    // Статус и параллельная версия
+    ASSERT_EQUAL(search_server.FindTopDocuments(execution::par, "\"funny pet\""s, DocumentStatus::BANNED).size(), 1u);
+    ASSERT_EQUAL(search_server.FindTopDocuments(execution::par, "\"funny pet\""s).size(), 2u);
+
+    // Релевантность фразы складывается из релевантности её слов
+    {
+        const auto result = search_server.FindTopDocuments("\"pet and nasty\""s);
+        const auto expected = search_server.FindTopDocuments("pet nasty"s);
+        ASSERT_EQUAL(result.size(), 1u);
+        const auto it = find_if(expected.begin(), expected.end(), [](const Document& document) {
+            return document.id == 1;
+        });
+        ASSERT(it != expected.end());
+        ASSERT(abs(it->relevance - result[0].relevance) < RELEVANCE_PRECISION);
+    }
+    // Матчинг
+    {
+        const auto [words, status] = search_server.MatchDocument("\"funny pet\" rat"s, 1);
+        ASSERT_EQUAL(words.size(), 3u);
+        const auto [other_words, other_status] = search_server.MatchDocument("\"funny pet\" rat"s, 4);
+        ASSERT_EQUAL(other_words.size(), 1u);
+        ASSERT_EQUAL(other_words[0], "rat"s);
+    }
+    // Удаление документа убирает и его позиции
+    search_server.RemoveDocument(3);
+    ASSERT(find_ids("\"pet funny\""s, QueryMode::ANY_WORD) == set<int>({ 4 }));
+    ASSERT(find_ids("\"funny pet\""s, QueryMode::ANY_WORD) == set<int>({ 1 }));
+
+    // Ошибки
+    for (const string& query : { "\"funny pet"s, "-\"funny pet\""s }) {
+        try {
+            search_server.FindTopDocuments(query);
+            ASSERT_HINT(false, "invalid_argument expected for "s + query);
+        }
+        catch (const invalid_argument&) {
+        }
+    }
+    {
+        SearchServer server;
+        AddDocument(server, 1, "funny pet"s, DocumentStatus::ACTUAL, { 1 });
+        ASSERT(!server.HasPositionalIndex());
+        ASSERT_EQUAL(server.GetPositionalIndexMemory(), 0u);
+        try {
+            server.FindTopDocuments("\"funny pet\""s);
+            ASSERT_HINT(false, "exception expected"s);
+        }
+        catch (const invalid_argument&) {
+        }
+        try {
+            server.EnablePositionalIndex();
+            ASSERT_HINT(false, "exception expected"s);
+        }
+        catch (const logic_error&) {
+        }
+    }
+}
+
+void TestWildcardQuery() {
+    SearchServer search_server("and with"s);
+    AddDocument(search_server, 1, "cat catalog dog"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    AddDocument(search_server, 2, "category doggy"s, DocumentStatus::ACTUAL, { 1, 2 });
+    AddDocument(search_server, 3, "cart dot"s, DocumentStatus::ACTUAL, { 1, 2 });
+    AddDocument(search_server, 4, "mouse and cat"s, DocumentStatus::ACTUAL, { 1, 2 });
+    AddDocument(search_server, 5, "catapult"s, DocumentStatus::BANNED, { 1, 2 });
+
+    auto find_ids = [&search_server](const string& query, QueryMode mode) {
+        set<int> ids;
+        for (const Document& document : search_server.FindTopDocuments(execution::seq, query, mode)) {
+            ids.insert(document.id);
+        }
+        return ids;
+    };
+
+    ASSERT(find_ids("cat*"s, QueryMode::ANY_WORD) == set<int>({ 1, 2, 4 }));
+    ASSERT(find_ids("ca*"s, QueryMode::ANY_WORD) == set<int>({ 1, 2, 3, 4 }));
+    ASSERT(find_ids("c*t"s, QueryMode::ANY_WORD) == set<int>({ 1, 3, 4 }));
+    ASSERT(find_ids("do*y"s, QueryMode::ANY_WORD) == set<int>({ 2 }));
+    ASSERT(find_ids("cat* -dog*"s, QueryMode::ANY_WORD) == set<int>({ 4 }));
+    ASSERT(find_ids("bird*"s, QueryMode::ANY_WORD).empty());
+    ASSERT(find_ids("cat* AND do*"s, QueryMode::BOOLEAN) == set<int>({ 1, 2 }));
+    ASSERT(find_ids("ca* AND NOT cat"s, QueryMode::BOOLEAN) == set<int>({ 2, 3 }));
+    ASSERT(find_ids("bird* OR mouse"s, QueryMode::BOOLEAN) == set<int>({ 4 }));
+    ASSERT_EQUAL(search_server.FindTopDocuments(execution::par, "catap*"s, DocumentStatus::BANNED).size(), 1u);
+
+    // Релевантность - сумма TF-IDF слов, в которые раскрылся шаблон
+    {
+        const auto result = search_server.FindTopDocuments("cat*"s);
+        const auto expected = search_server.FindTopDocuments("cat catalog category"s);
+        ASSERT_EQUAL(result.size(), expected.size());
+        for (size_t i = 0; i < result.size(); ++i) {
+            ASSERT_EQUAL(result[i].id, expected[i].id);
+            ASSERT(abs(result[i].relevance - expected[i].relevance) < RELEVANCE_PRECISION);
+        }
+    }
+    {
+        const auto [words, status] = search_server.MatchDocument("cat*"s, 1);
+        ASSERT_EQUAL(words.size(), 2u);
+    }
+
+    for (const auto& [query, mode] : { pair{ "*at"s, QueryMode::ANY_WORD }, pair{ "cat*"s, QueryMode::ALL_WORDS } }) {
+        try {
+            search_server.FindTopDocuments(execution::seq, query, mode);
+            ASSERT_HINT(false, "invalid_argument expected for "s + query);
+        }
+        catch (const invalid_argument&) {
+        }
+    }
+
+    // Кол-во раскрытий ограничено, остаются самые частые слова
+    {
+        SearchServer server;
+        for (int id = 0; id < MAX_WILDCARD_EXPANSIONS * 2; ++id) {
+            server.AddDocument(id, "word"s + to_string(id) + " word0"s, DocumentStatus::ACTUAL, { 1 });
+        }
+        const auto [words, status] = server.MatchDocument("word*"s, 0);
+        ASSERT_EQUAL(words.size(), 1u);
+        ASSERT_EQUAL(words[0], "word0"s);
+        ASSERT_EQUAL(server.FindTopDocuments("word*"s, [](int document_id, DocumentStatus status, int rating) {
+            return document_id % 2 == 1;
+        }).size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    }
+}
+
+void TestFuzzyQuery() {
+    // Автомат совпадает с расстоянием Левенштейна, посчитанным по полной таблице
+    {
+        auto levenshtein_distance = [](const string& lhs, const string& rhs) {
+            vector<vector<int>> table(lhs.size() + 1, vector<int>(rhs.size() + 1));
+            for (size_t i = 0; i <= lhs.size(); ++i) {
+                for (size_t j = 0; j <= rhs.size(); ++j) {
+                    if (i == 0 || j == 0) {
+                        table[i][j] = static_cast<int>(i + j);
+                    }
+                    else {
+                        table[i][j] = min({ table[i - 1][j] + 1, table[i][j - 1] + 1, table[i - 1][j - 1] + (lhs[i - 1] == rhs[j - 1] ? 0 : 1) });
+                    }
+                }
+            }
+            return table[lhs.size()][rhs.size()];
+        };
+        mt19937 generator(3);
+        auto random_word = [&generator]() {
+            string word(uniform_int_distribution(0, 7)(generator), ' ');
+            for (char& c : word) {
+                c = static_cast<char>('a' + uniform_int_distribution(0, 2)(generator));
+            }
+            return word;
+        };
+        for (int i = 0; i < 2000; ++i) {
+            const string word = random_word();
+            const string other = random_word();
+            const int max_distance = 1 + i % 2;
+            const LevenshteinAutomaton automaton(word, max_distance);
+            LevenshteinAutomaton::State state = automaton.Start();
+            LevenshteinAutomaton::State next;
+            for (const char c : other) {
+                automaton.Step(state, c, next);
+                swap(state, next);
+            }
+            const int distance = levenshtein_distance(word, other);
+            ASSERT_EQUAL(automaton.IsMatch(state), distance <= max_distance);
+            if (distance <= max_distance) {
+                ASSERT_EQUAL(automaton.GetDistance(state), distance);
+            }
+        }
+    }
+
+    SearchServer search_server("and with"s);
+    AddDocument(search_server, 1, "white cat with fancy collar"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    AddDocument(search_server, 2, "fluffy kitten and dog"s, DocumentStatus::ACTUAL, { 1, 2 });
+    AddDocument(search_server, 3, "groomed dog expressive eyes"s, DocumentStatus::ACTUAL, { 1, 2 });
+    AddDocument(search_server, 4, "groomed starling"s, DocumentStatus::BANNED, { 1, 2 });
+
+    auto find_ids = [&search_server](const string& query, QueryMode mode) {
+        set<int> ids;
+        for (const Document& document : search_server.FindTopDocuments(execution::seq, query, mode)) {
+            ids.insert(document.id);
+        }
+        return ids;
+    };
+
+    // Опечатки
+    ASSERT(find_ids("fluffi"s, QueryMode::ANY_WORD).empty());
+    ASSERT(find_ids("fluffi"s, QueryMode::FUZZY) == set<int>({ 2 }));
+    ASSERT(find_ids("kiten"s, QueryMode::FUZZY) == set<int>({ 2 }));
+    ASSERT(find_ids("expresive colar"s, QueryMode::FUZZY) == set<int>({ 1, 3 }));
+    ASSERT(find_ids("gromed -dog"s, QueryMode::FUZZY).empty());
+    // Короткие слова не расширяются, слишком далёкие слова не находятся
+    ASSERT(find_ids("dg"s, QueryMode::FUZZY).empty());
+    ASSERT(find_ids("fancier"s, QueryMode::FUZZY).empty());
+    ASSERT_EQUAL(search_server.FindTopDocuments(execution::par, "starlinj"s, QueryMode::FUZZY, DocumentStatus::BANNED).size(), 1u);
+
+    // Точное совпадение релевантнее похожего слова
+    {
+        SearchServer server;
+        AddDocument(server, 1, "kitten"s, DocumentStatus::ACTUAL, { 1 });
+        AddDocument(server, 2, "mitten"s, DocumentStatus::ACTUAL, { 1 });
+        AddDocument(server, 3, "sitting"s, DocumentStatus::ACTUAL, { 1 });
+        AddDocument(server, 4, "dog"s, DocumentStatus::ACTUAL, { 1 });
+        const auto result = server.FindTopDocuments(execution::seq, "kitten"s, QueryMode::FUZZY);
+        ASSERT_EQUAL(result.size(), 2u);
+        ASSERT_EQUAL(result[0].id, 1);
+        ASSERT_EQUAL(result[1].id, 2);
+        ASSERT(abs(result[1].relevance - result[0].relevance * FUZZY_DISTANCE_PENALTY) < RELEVANCE_PRECISION);
+
+        const auto par_result = server.FindTopDocuments(execution::par, "kitten"s, QueryMode::FUZZY);
+        ASSERT_EQUAL(par_result.size(), 2u);
+        ASSERT(abs(par_result[1].relevance - result[1].relevance) < RELEVANCE_PRECISION);
+        // Длинное слово допускает 2 правки: "sitting" тоже находится
+        ASSERT(server.FindTopDocuments(execution::seq, "sitten"s, QueryMode::FUZZY).size() == 3u);
+    }
+}
+
+void TestBm25Scoring() {
+    const vector<string> texts = { "white cat and fancy collar"s, "fluffy cat fluffy tail"s, "groomed dog expressive eyes"s, "cat"s };
+    Bm25SearchServer search_server("and"s);
+    SearchServer tf_idf_server("and"s);
+    for (size_t i = 0; i < texts.size(); ++i) {
+        search_server.AddDocument(i, texts[i], DocumentStatus::ACTUAL, { 1 });
+        tf_idf_server.AddDocument(i, texts[i], DocumentStatus::ACTUAL, { 1 });
+    }
+
+    // idf * f * (k1 + 1) / (f + k1 * (1 - b + b * |D| / avgdl))
+    const double average_length = (4 + 4 + 4 + 1) / 4.0;
+    auto bm25 = [average_length](double word_count, double document_length, int document_freq) {
+        const double inverse_document_freq = log(1.0 + (4 - document_freq + 0.5) / (document_freq + 0.5));
+        const double k1 = Bm25Scoring::K1;
+        const double b = Bm25Scoring::B;
+        return inverse_document_freq * word_count * (k1 + 1.0) / (word_count + k1 * (1.0 - b + b * document_length / average_length));
+    };
+
+    {
+        const auto result = search_server.FindTopDocuments("cat fluffy"s);
+        ASSERT_EQUAL(result.size(), 3u);
+        ASSERT_EQUAL(result[0].id, 1);
+        ASSERT(abs(result[0].relevance - (bm25(1, 4, 3) + bm25(2, 4, 1))) < RELEVANCE_PRECISION);
+        // Короткий документ с тем же словом выше длинного
+        ASSERT_EQUAL(result[1].id, 3);
+        ASSERT(abs(result[1].relevance - bm25(1, 1, 3)) < RELEVANCE_PRECISION);
+        ASSERT_EQUAL(result[2].id, 0);
+        ASSERT(abs(result[2].relevance - bm25(1, 4, 3)) < RELEVANCE_PRECISION);
+    }
+    // Все пути поиска используют одну и ту же политику
+    {
+        const auto expected = search_server.FindTopDocuments("cat fluffy"s);
+        const auto par_result = search_server.FindTopDocuments(execution::par, "cat fluffy"s);
+        const auto boolean_result = search_server.FindTopDocuments(execution::seq, "cat OR fluffy"s, QueryMode::BOOLEAN);
+        ASSERT_EQUAL(par_result.size(), expected.size());
+        ASSERT_EQUAL(boolean_result.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT(abs(par_result[i].relevance - expected[i].relevance) < RELEVANCE_PRECISION);
+            ASSERT(abs(boolean_result[i].relevance - expected[i].relevance) < RELEVANCE_PRECISION);
+        }
+        const auto all_words_result = search_server.FindTopDocuments(execution::par, "cat fluffy"s, QueryMode::ALL_WORDS);
+        ASSERT_EQUAL(all_words_result.size(), 1u);
+        ASSERT(abs(all_words_result[0].relevance - expected[0].relevance) < RELEVANCE_PRECISION);
+    }
+    // TF-IDF на тех же документах: частое в документе слово важнее длины документа
+    {
+        const auto result = tf_idf_server.FindTopDocuments("cat fluffy"s);
+        ASSERT_EQUAL(result.size(), 3u);
+        ASSERT(abs(result[0].relevance - (0.25 * log(4.0 / 3) + 0.5 * log(4.0))) < RELEVANCE_PRECISION);
+    }
+    // Средняя длина документа пересчитывается при удалении
+    search_server.RemoveDocument(3);
+    {
+        const auto result = search_server.FindTopDocuments("dog"s);
+        ASSERT_EQUAL(result.size(), 1u);
+        const double inverse_document_freq = log(1.0 + (3 - 1 + 0.5) / (1 + 0.5));
+        ASSERT(abs(result[0].relevance - inverse_document_freq) < RELEVANCE_PRECISION);
+    }
+}
+
+void TestDocumentFilter() {
+    // Битовая карта: переход между массивом и битовой картой, операции над множествами
+    {
+        DocumentBitmap even;
+        DocumentBitmap odd;
+        for (int i = 0; i < 10000; ++i) {
+            (i % 2 == 0 ? even : odd).Add(i);
+        }
+        even.Add(70000);
+        ASSERT_EQUAL(even.GetSize(), 5001u);
+        ASSERT(even.Contains(9998) && even.Contains(70000));
+        ASSERT(!even.Contains(9999) && !even.Contains(70002));
+
+        DocumentBitmap intersection = even;
+        intersection &= odd;
+        ASSERT(intersection.IsEmpty());
+
+        DocumentBitmap united = even;
+        united |= odd;
+        ASSERT_EQUAL(united.GetSize(), 10001u);
+        int expected_id = 0;
+        bool ordered = true;
+        united.ForEach([&expected_id, &ordered](int document_id) {
+            ordered = ordered && (document_id == expected_id || (expected_id == 10000 && document_id == 70000));
+            ++expected_id;
+        });
+        ASSERT(ordered);
+
+        // Плотный контейнер возвращается к массиву при удалении элементов
+        for (int i = 0; i < 9000; ++i) {
+            united.Remove(i);
+        }
+        ASSERT_EQUAL(united.GetSize(), 1001u);
+        ASSERT(!united.Contains(100) && united.Contains(9000));
+        united.Remove(70000);
+        united &= even;
+        ASSERT_EQUAL(united.GetSize(), 500u);
+    }
+
+    SearchServer search_server("and in the"s);
+    search_server.AddDocument(0, "white cat and fancy collar"s, DocumentStatus::ACTUAL, { 8, -3 });
+    search_server.AddDocument(1, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    search_server.AddDocument(2, "groomed cat expressive eyes"s, DocumentStatus::BANNED, { 5, -12, 2, 1 });
+    search_server.AddDocument(3, "groomed starling eugene"s, DocumentStatus::IRRELEVANT, { 9 });
+    search_server.AddDocument(4, "cat in the city"s, DocumentStatus::REMOVED, { 1, 2 });
+
+    auto ids = [](const vector<Document>& documents) {
+        set<int> result;
+        for (const Document& document : documents) {
+            result.insert(document.id);
+        }
+        return result;
+    };
+
+    // Пустой фильтр пропускает документы с любым статусом
+    ASSERT_EQUAL(ids(search_server.FindTopDocuments("cat groomed"s, DocumentFilter{})), (set<int>{ 0, 1, 2, 3, 4 }));
+    {
+        DocumentFilter filter;
+        filter.statuses = { DocumentStatus::BANNED, DocumentStatus::REMOVED };
+        ASSERT_EQUAL(ids(search_server.FindTopDocuments("cat"s, filter)), (set<int>{ 2, 4 }));
+        filter.rating_range = { { 0, 1 } };
+        ASSERT_EQUAL(ids(search_server.FindTopDocuments(execution::par, "cat"s, filter)), (set<int>{ 4 }));
+    }
+    {
+        DocumentFilter filter;
+        filter.rating_range = { { 2, 5 } };
+        ASSERT_EQUAL(ids(search_server.FindTopDocuments("cat groomed"s, filter)), (set<int>{ 0, 1 }));
+        filter.document_ids = vector<int>{ 1, 3, 100, -1 };
+        ASSERT_EQUAL(ids(search_server.FindTopDocuments(execution::par, "cat groomed"s, filter)), (set<int>{ 1 }));
+        ASSERT_EQUAL(ids(search_server.FindTopDocuments(execution::seq, "cat AND fluffy"s, QueryMode::BOOLEAN, filter)), (set<int>{ 1 }));
+    }
+    // Скомпилированный фильтр передаётся вместо предиката и учитывает удаление документов
+    {
+        DocumentFilter filter;
+        filter.statuses = { DocumentStatus::ACTUAL };
+        const DocumentBitmap documents = search_server.CompileFilter(filter);
+        ASSERT_EQUAL(documents.GetSize(), 2u);
+        ASSERT_EQUAL(ids(search_server.FindTopDocuments("cat"s, cref(documents))), (set<int>{ 0, 1 }));
+        search_server.RemoveDocument(1);
+        ASSERT_EQUAL(search_server.CompileFilter(filter).GetSize(), 1u);
+        ASSERT_EQUAL(ids(search_server.FindTopDocuments("cat"s)), (set<int>{ 0 }));
+    }
+    // Предикаты-функции работают как прежде
+    ASSERT_EQUAL(ids(search_server.FindTopDocuments("cat groomed"s,
+        [](int document_id, DocumentStatus status, int rating) {
+            return rating > 1;
+        })), (set<int>{ 0, 3 }));
+}
+
+void TestCursorPagination() {
+    SearchServer search_server("and"s);
+    // Одинаковые документы с одинаковым рейтингом различаются только id
+    const vector<string> texts = { "cat"s, "cat dog"s, "cat cat dog"s, "dog bird"s, "cat bird fish"s };
+    for (int id = 0; id < 23; ++id) {
+        search_server.AddDocument(id, texts[id % texts.size()], DocumentStatus::ACTUAL, { id % 3 });
+    }
+    search_server.AddDocument(100, "cat cat"s, DocumentStatus::BANNED, { 5 });
+
+    const SearchPage full = search_server.FindDocumentsPage("cat bird"s, 100);
+    ASSERT_EQUAL(full.documents.size(), 23u);
+    ASSERT(!full.next_cursor);
+
+    // Страницы по курсору складываются в полную выдачу без пропусков и повторов
+    vector<int> paged_ids;
+    size_t page_count = 0;
+    optional<SearchCursor> cursor;
+    do {
+        const SearchPage page = search_server.FindDocumentsPage("cat bird"s, 5, cursor);
+        const SearchPage par_page = search_server.FindDocumentsPage(execution::par, "cat bird"s, QueryMode::ANY_WORD, 5, cursor);
+        ASSERT_EQUAL(page.documents.size(), par_page.documents.size());
+        for (size_t i = 0; i < page.documents.size(); ++i) {
+            ASSERT_EQUAL(page.documents[i].id, par_page.documents[i].id);
+            paged_ids.push_back(page.documents[i].id);
+        }
+        if (page_count == 0) {
+            const auto top = search_server.FindTopDocuments("cat bird"s);
+            for (size_t i = 0; i < top.size(); ++i) {
+                ASSERT_EQUAL(top[i].id, page.documents[i].id);
+            }
+        }
+        cursor = page.next_cursor;
+        ++page_count;
+    } while (cursor);
+    ASSERT_EQUAL(page_count, 5u);
+    ASSERT_EQUAL(paged_ids.size(), full.documents.size());
+    for (size_t i = 0; i < paged_ids.size(); ++i) {
+        ASSERT_EQUAL(paged_ids[i], full.documents[i].id);
+    }
+
+    // Ленивый обход страниц
+    {
+        vector<int> lazy_ids;
+        size_t lazy_page_count = 0;
+        for (const auto page : PaginateSearch(search_server, "cat bird"s, 5)) {
+            ++lazy_page_count;
+            for (const Document& document : page) {
+                lazy_ids.push_back(document.id);
+            }
+        }
+        ASSERT_EQUAL(lazy_page_count, 5u);
+        ASSERT(lazy_ids == paged_ids);
+
+        size_t empty_page_count = 0;
+        for ([[maybe_unused]] const auto page : PaginateSearch(search_server, "parrot"s, 5)) {
+            ++empty_page_count;
+        }
+        ASSERT_EQUAL(empty_page_count, 0u);
+    }
+
+    // Режимы и предикаты
+    {
+        const SearchPage page = search_server.FindDocumentsPage(execution::seq, "cat AND dog"s, QueryMode::BOOLEAN, 3, nullopt,
+            [](int document_id, DocumentStatus status, int rating) {
+                return rating != 1;
+            });
+        ASSERT_EQUAL(page.documents.size(), 3u);
+        ASSERT(page.next_cursor);
+        const SearchPage next_page = search_server.FindDocumentsPage(execution::seq, "cat AND dog"s, QueryMode::BOOLEAN, 3, page.next_cursor,
+            [](int document_id, DocumentStatus status, int rating) {
+                return rating != 1;
+            });
+        ASSERT(!next_page.next_cursor);
+        for (const Document& document : next_page.documents) {
+            ASSERT(document.rating != 1);
+        }
+    }
+
+    // Релевантности соседних документов различаются меньше RELEVANCE_PRECISION, а крайних - больше:
+    // при любом размере страницы выдача по курсору совпадает с полной, без пропусков и повторов
+    {
+        SearchServer chained_server;
+        string text = "cat"s;
+        for (int length = 1; length < 1300; ++length) {
+            text += " x"s;
+        }
+        for (int id = 0; id < 8; ++id) {
+            // Документ длиннее - релевантность меньше, но рейтинг выше
+            text += " x"s;
+            chained_server.AddDocument(id, text, DocumentStatus::ACTUAL, { id });
+            chained_server.AddDocument(100 + id, "dog"s, DocumentStatus::ACTUAL, { id });
+        }
+        const vector<Document> chained = chained_server.FindDocumentsPage("cat"s, 100).documents;
+        ASSERT_EQUAL(chained.size(), 8u);
+        ASSERT(chained.front().relevance - chained.back().relevance > RELEVANCE_PRECISION);
+        for (size_t page_size = 1; page_size <= chained.size(); ++page_size) {
+            vector<int> chained_ids;
+            optional<SearchCursor> chained_cursor;
+            do {
+                const SearchPage page = chained_server.FindDocumentsPage("cat"s, page_size, chained_cursor);
+                for (const Document& document : page.documents) {
+                    chained_ids.push_back(document.id);
+                }
+                chained_cursor = page.next_cursor;
+            } while (chained_cursor);
+            ASSERT_EQUAL(chained_ids.size(), chained.size());
+            for (size_t i = 0; i < chained.size(); ++i) {
+                ASSERT_EQUAL(chained_ids[i], chained[i].id);
+            }
+        }
+    }
+
+    try {
+        search_server.FindDocumentsPage("cat"s, 0);
+        ASSERT_HINT(false, "page size must be positive"s);
+    }
+    catch (const invalid_argument&) {
+    }
+}
+
+void TestQueryProfile() {
+    SearchServer search_server("and with"s);
+    search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+    search_server.AddDocument(3, "funny pet and not very nasty rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+    search_server.AddDocument(4, "pet with rat and rat and rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+    search_server.AddDocument(5, "nasty rat with curly hair"s, DocumentStatus::BANNED, { 1, 2 });
+
+    const string query = "curly pet -nasty"s;
+    for (const bool parallel : { false, true }) {
+        QueryProfile profile;
+        const vector<Document> result = parallel
+            ? search_server.FindTopDocuments(execution::par, query, profile)
+            : search_server.FindTopDocuments(execution::seq, query, profile);
+        const vector<Document> expected = search_server.FindTopDocuments(query);
+        ASSERT_EQUAL(result.size(), expected.size());
+        for (size_t i = 0; i < result.size(); ++i) {
+            ASSERT_EQUAL(result[i].id, expected[i].id);
+        }
+
+        ASSERT((profile.plus_words == vector<string>{ "curly"s, "pet"s }));
+        ASSERT((profile.minus_words == vector<string>{ "nasty"s }));
+        ASSERT_EQUAL(profile.plus_word_postings.size(), 2u);
+        size_t accepted_count = 0;
+        for (const auto& word : profile.plus_word_postings) {
+            ASSERT_EQUAL(word.posting_count, word.word == "curly"s ? 2u : 4u);
+            accepted_count += word.accepted_count;
+        }
+        // Документ 5 с curly не проходит фильтр по статусу
+        ASSERT_EQUAL(accepted_count, 5u);
+        ASSERT_EQUAL(profile.minus_word_postings.size(), 1u);
+        ASSERT_EQUAL(profile.minus_word_postings[0].posting_count, 3u);
+        ASSERT_EQUAL(profile.postings_visited, 2u + 4u + 3u);
+        ASSERT_EQUAL(profile.predicate_calls, 2u + 4u);
+        ASSERT_EQUAL(profile.candidate_count, 4u);
+        ASSERT_EQUAL(profile.removed_by_minus_words, 2u);
+        ASSERT_EQUAL(profile.result_count, 2u);
+
+        if (parallel) {
+            ASSERT(!profile.threads.empty());
+            size_t thread_postings = 0;
+            for (const auto& work : profile.threads) {
+                thread_postings += work.postings_visited;
+            }
+            ASSERT_EQUAL(thread_postings, profile.postings_visited);
+        }
+
+        ostringstream explain;
+        explain << profile;
+        ASSERT(explain.str().find("removed by minus words: 2"s) != string::npos);
+    }
+}
+
+// Сортировка найденных документов по релевантности.Возвращаемые при поиске документов результаты должны быть
+// отсортированы в порядке убывания релевантности.
 void TestSortingByRelevance() {
     string query = "two four";
     {
         SearchServer server;
-        //  4      
+        // Добавим 4 документа с разной релевантностью в разнобой
         server.AddDocument(41, "one two three four five"s, DocumentStatus::ACTUAL, { 0 });
         server.AddDocument(34, "two four"s, DocumentStatus::ACTUAL, { 0 });
         server.AddDocument(62, "one two four five"s, DocumentStatus::ACTUAL, { 0 });
         server.AddDocument(7, "three four five"s, DocumentStatus::ACTUAL, { 0 });
 
         vector<Document> result = server.FindTopDocuments(query);
-        //                
+        // Проверим что каждующая последующая релевантность меньше предыдущей         
         for (int i = 1; i < (result.size()); ++i) {
             double previous_relevance = result[i - 1].relevance;
             ASSERT((result[i].relevance < previous_relevance));
@@ -379,27 +1245,27 @@ void TestSortingByRelevance() {
     }
 
     query = "-two one six";
-    //           
+    // Добавим минус слово в запрос и убедимся что останется два документа
     {
         SearchServer server;
 
-        //  4      
+        // Добавим 4 документа с разной релевантностью в разнобой
         server.AddDocument(41, "one two three four five"s, DocumentStatus::ACTUAL, { 0 });
         server.AddDocument(34, "one four"s, DocumentStatus::ACTUAL, { 0 });
         server.AddDocument(62, "one two four five"s, DocumentStatus::ACTUAL, { 0 });
         server.AddDocument(7, "three four five six"s, DocumentStatus::ACTUAL, { 0 });
-        // -                  
+        // Из-за стоп слова в запросе должны уйти из результата два документа        
         vector<Document> result = server.FindTopDocuments(query);
 
         ASSERT_EQUAL(result.size(), 2u);
-        //                
+        // Проверим что каждующая последующая релевантность меньше предыдущей         
         for (int i = 1; i < (result.size()); ++i) {
             double previous_relevance = result[i - 1].relevance;
             ASSERT((result[i].relevance < previous_relevance));
         }
     }
 }
-//         int
+//Функция для расчёта среднего арифметического для вектора целых чисел int
 int Average_vector_int(vector<int> input_vector) {
     if (input_vector.empty()) return 0;
     int result = 0;
@@ -410,21 +1276,21 @@ int Average_vector_int(vector<int> input_vector) {
     return result /= input_vector.size();
 }
 
-//   .
-//        .
+// Вычисление рейтинга документов.
+// Рейтинг добавленного документа равен среднему арифметическому оценок документа.
 void TestRatingCalculation() {
 
     string query = "two four";
     {
         SearchServer server;
-        // 3    , ,  
+        //Добавим 3 документа с нулевым рейтингом, положительным, отрицательным 
         vector<vector<int>> ratings_for_adding = {
             {50,  -90},
             {100, 0, -100},
             {-10, 60, 0, -30},
             {1000, 2000, -2700}
         };
-        //  ,   ,  ((-10) + 60 + 0 + (-30))/4
+        //Рассчитаем получившиеся рейтинги, как среднее арифметическое, например ((-10) + 60 + 0 + (-30))/4
         vector<int> expected_result_rating;
         for (vector<int> each_document_rating : ratings_for_adding) {
             expected_result_rating.push_back(Average_vector_int(each_document_rating));
@@ -435,7 +1301,7 @@ void TestRatingCalculation() {
         server.AddDocument(41, "one two three four five"s, DocumentStatus::ACTUAL, ratings_for_adding[2]);
         server.AddDocument(7, "three four five"s, DocumentStatus::ACTUAL, ratings_for_adding[3]);
 
-        //              
+        //Так как последовательность ввиду релевантности мы знаем        
         vector<Document> result = server.FindTopDocuments(query);
         vector<int> expected_result_id = { 34, 62, 41, 7 };
 
@@ -446,7 +1312,7 @@ void TestRatingCalculation() {
     }
 }
 
-//      ,  .
+// Фильтрация результатов поиска с использованием предиката, задаваемого пользователем.
 void TestFilterWithPredicate() {
     string query = "two four";
     SearchServer server;
@@ -455,37 +1321,37 @@ void TestFilterWithPredicate() {
     server.AddDocument(62, "one two four five"s, DocumentStatus::ACTUAL, { 0 });
     server.AddDocument(41, "one two three four five"s, DocumentStatus::ACTUAL, { 5 });
     server.AddDocument(7, "three four five"s, DocumentStatus::ACTUAL, { 100 });
-    //    = 34
+    //Находим документ с ид = 34
     vector<Document> result = server.FindTopDocuments(query,
         [](int document_id, DocumentStatus status, int rating) {
             return document_id == 34;
         }
     );
-    //    
+    //Такой документ должен быть один
     ASSERT_EQUAL(result.size(), 1u);
     ASSERT_EQUAL(result[0].id, 34u);
 
-    // s c   0
+    //Находим документs c рейтингом больше 0
     result = server.FindTopDocuments(query,
         [](int document_id, DocumentStatus status, int rating) {
             return rating > 0;
         }
     );
-    //    2
+    //Таких документов должно быть 2
     ASSERT_EQUAL(result.size(), 2u);
     ASSERT_EQUAL(result[0].id, 41u);
     ASSERT_EQUAL(result[1].id, 7u);
 
-    // s c  
+    //Находим документs c четным рейтингом
     result = server.FindTopDocuments(query,
         [](int document_id, DocumentStatus status, int rating) {
             return document_id % 2 == 0;
         }
     );
-    //    2
+    //Таких документов должно быть 2
     ASSERT_EQUAL(result.size(), 2u);
 
-    //   
+    //Попробуем найти несуществующий документ
     result = server.FindTopDocuments(query,
         [](int document_id, DocumentStatus status, int rating) {
             return document_id == 4;
@@ -493,7 +1359,7 @@ void TestFilterWithPredicate() {
     );
     ASSERT(result.empty());
 
-    //    
+    //Попробуем найти по двум условиям
     result = server.FindTopDocuments(query,
         [](int document_id, DocumentStatus status, int rating) {
             return (document_id == 34) && (rating == -20);
@@ -503,18 +1369,18 @@ void TestFilterWithPredicate() {
     ASSERT_EQUAL(result.size(), 1u);
 }
 
-//  ,   
+//Тест поиска документов, имеющих заданный статус
 void TestSearchByStatus() {
     SearchServer server;
     string query = "two four";
-    // 6 : 2   ACTUAL, 1 - IRRELEVANT, 0 - REMOVED, 2 - BANNED 
+    //Добавим 6 документов: 2 в категории ACTUAL, 1 - IRRELEVANT, 0 - REMOVED, 2 - BANNED 
     server.AddDocument(34, "two four"s, DocumentStatus::ACTUAL, { 0 });
     server.AddDocument(62, "one two four five"s, DocumentStatus::ACTUAL, { 0 });
     server.AddDocument(41, "one two three four five"s, DocumentStatus::BANNED, { 0 });
     server.AddDocument(7, "three four five"s, DocumentStatus::BANNED, { 0 });
     server.AddDocument(43, "one two three four five"s, DocumentStatus::IRRELEVANT, { 0 });
 
-    // -     
+    //Найдём кол-во документов и сравним с ожидаемым
     vector<Document> result = server.FindTopDocuments(query, DocumentStatus::ACTUAL);
     ASSERT_EQUAL(result.size(), 2u);
 
@@ -527,16 +1393,16 @@ void TestSearchByStatus() {
     result = server.FindTopDocuments(query, DocumentStatus::BANNED);
     ASSERT_EQUAL(result.size(), 2u);
 
-    //           
+    //Проверим что если нет совпадений со строкой запроса то результата не будет
     query = "three";
     result = server.FindTopDocuments(query, DocumentStatus::ACTUAL);
     ASSERT_EQUAL(result.size(), 0u);
 }
 
-//      .
+// Тест корректного вычисление релевантности найденных документов.
 void TestRelevanceCalculating() {
     SearchServer server;
-    // 3 
+    //Добавим 3 документа
     string query = "two four";
     vector<string> adding_documents_data = {
         "one two three four five six"s,
@@ -547,42 +1413,42 @@ void TestRelevanceCalculating() {
     server.AddDocument(41, adding_documents_data[0], DocumentStatus::ACTUAL, { 0 });
     server.AddDocument(34, adding_documents_data[1], DocumentStatus::ACTUAL, { 0 });
     server.AddDocument(15, adding_documents_data[2], DocumentStatus::ACTUAL, { 0 });
-    //    
-    vector<double> expected_relevance; //    
+    //Рассчитаем релевантность для добавленных документов
+    vector<double> expected_relevance; //Релевантность для каждого добавлнного документа
     {
-        // IDF  
-        //      ,   
-        //   
+        //Рассчитаем IDF слов запроса
+        //Количество всех документов делят на количество тех, где встречается слово
+        //к результату применяют лографим
         map<string, double> expected_IDF;
-        //   two(   2  3 ):
+        //Для слова запроса two(оно встречается в 2 из 3 документах):
         expected_IDF["two"] = log(3 / 2.0);
-        //   four(   ):
+        //Для слова запроса four(встречается в каждом документе):
         expected_IDF["four"] = log(3 / 3.0);
 
-        //TF     
-        //       ,      .
-        //..    "one two three four five six"  "four"  1   TF = 1 / 6
+        //TF каждого слова запроса в документе
+        //Для конкретного слова и конкретного документа это доля, которую данное слово занимает среди всех.
+        //Т.е. если в документе "one two three four five six" слово "four" встречается 1 раз то TF = 1 / 6
 
-        //   TF-IDF
+        //Для первого документа TF-IDF
         expected_relevance.push_back((1 / 6.0) * expected_IDF["two"] + (1 / 6.0) * expected_IDF["four"]);
-        //   TF-IDF
+        //Для второго документа TF-IDF
         expected_relevance.push_back((2 / 4.0) * expected_IDF["two"] + (1 / 4.0) * expected_IDF["four"]);
-        //   TF-IDF
+        //Для третьего документа TF-IDF
         expected_relevance.push_back((0 / 3.0) * expected_IDF["two"] + (1 / 3.0) * expected_IDF["four"]);
 
-        //  
+        //Отсортируем полученный результат
         sort(expected_relevance.begin(), expected_relevance.end(), greater<double>());
     }
 
     vector<Document> result = server.FindTopDocuments(query, DocumentStatus::ACTUAL);
 
-    //        0.001
+    //сравним полученные значения с расчтёными с погрешностью в 0.001
     for (int i = 0; i < result.size(); ++i) {        
         ASSERT(abs(result[i].relevance - expected_relevance[i]) <= 0.001);
     }
 }
 
-//    
+// Проверяем корректность удаления документа
 void TestDeletetingDocument() {
     SearchServer search_server("and with"s);
 
@@ -597,49 +1463,143 @@ void TestDeletetingDocument() {
     AddDocument(search_server, 9, "nasty rat with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
 
     int doc_count = search_server.GetDocumentCount();
-    ASSERT_EQUAL(doc_count, 9); // -     9
+    ASSERT_EQUAL(doc_count, 9); // Кол-во документов должно быть равно 9
 
-    //   id 5
+    //удаляем документ с id 5
     search_server.RemoveDocument(5);
 
     doc_count = search_server.GetDocumentCount();
-    ASSERT_EQUAL(doc_count, 8); // -     8
+    ASSERT_EQUAL(doc_count, 8); // Кол-во документов должно быть равно 8
 
-    //     id=5   
+    //Проверям что по зпросу с id=5 не находится ничего
     auto result = search_server.GetWordFrequencies(5);
     ASSERT(result.empty());
 }
 
-//      
-//       ,    -  
+// Тест проверяет работу удаления дубликатов документов
+// дубликатом считается документ с одинаковым набором слов, неважно в каком кол-ве данные слова
 void TestDeleteDuplicates() {
     SearchServer search_server("and with"s);
 
     AddDocument(search_server, 1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
     AddDocument(search_server, 2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
-    //   2,  
+    // дубликат документа 2, будет удалён
     AddDocument(search_server, 3, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
-    //    -,  
+    // отличие только в стоп-словах, считаем дубликатом
     AddDocument(search_server, 4, "funny pet and curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
-    //    ,    1
+    // множество слов такое же, считаем дубликатом документа 1
     AddDocument(search_server, 5, "funny funny pet and nasty nasty rat"s, DocumentStatus::ACTUAL, { 1, 2 });
-    //   ,   
+    // добавились новые слова, дубликатом не является
     AddDocument(search_server, 6, "funny pet and not very nasty rat"s, DocumentStatus::ACTUAL, { 1, 2 });
-    //    ,   id 6,    ,  
+    // множество слов такое же, как в id 6, несмотря на другой порядок, считаем дубликатом
     AddDocument(search_server, 7, "very nasty rat and not very funny pet"s, DocumentStatus::ACTUAL, { 1, 2 });
-    //    ,   
+    // есть не все слова, не является дубликатом
     AddDocument(search_server, 8, "pet with rat and rat and rat"s, DocumentStatus::ACTUAL, { 1, 2 });
-    //    ,   
+    // слова из разных документов, не является дубликатом
     AddDocument(search_server, 9, "nasty rat with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
 
-    //    -  9
+    // До удаления дубликатов кол-во документов 9
     ASSERT_EQUAL(search_server.GetDocumentCount(), 9);
     RemoveDuplicates(search_server);
-    //      5 
+    // После удаления дубликатов должно остаться 5 документов
     ASSERT_EQUAL(search_server.GetDocumentCount(), 5);
 }
 
-//     ProcessQueries
+// Тест проверяет поиск и удаление почти-дубликатов (отличающихся одним-двумя словами)
+void TestNearDuplicates() {
+    SearchServer search_server("and with"s);
+
+    AddDocument(search_server, 1, "funny pet and nasty rat with curly hair in the big city"s, DocumentStatus::ACTUAL, { 1 });
+    // отличается одним словом от документа 1
+    AddDocument(search_server, 2, "funny pet and nasty rat with curly hair in the small city"s, DocumentStatus::ACTUAL, { 1 });
+    // точный дубликат документа 1 по множеству слов
+    AddDocument(search_server, 3, "funny funny pet and nasty rat with curly hair in the big city"s, DocumentStatus::ACTUAL, { 1 });
+    // совсем другой документ
+    AddDocument(search_server, 4, "very old dog sleeps under warm blanket"s, DocumentStatus::ACTUAL, { 1 });
+
+    // Сходство документов 1 и 2: 9 общих слов из 11
+    ASSERT(abs(ComputeJaccardSimilarity(search_server.GetWordFrequencies(1), search_server.GetWordFrequencies(2)) - 9.0 / 11) < 1e-9);
+
+    {
+        const vector<pair<int, int>> expected = { {1, 2}, {1, 3}, {2, 3} };
+        ASSERT_EQUAL(FindNearDuplicates(search_server, 0.8), expected);
+    }
+    {
+        // С порогом 1 остаются только точные дубликаты
+        const vector<pair<int, int>> expected = { {1, 3} };
+        ASSERT_EQUAL(FindNearDuplicates(search_server, 1.0), expected);
+    }
+
+    // Индекс сигнатур обновляется инкрементально при добавлении документов
+    MinHashIndex index(0.8);
+    ASSERT_EQUAL(FindNearDuplicates(search_server, index).size(), 3u);
+    ASSERT_EQUAL(index.GetDocumentCount(), 4u);
+    AddDocument(search_server, 5, "very old dog sleeps under the warm blanket"s, DocumentStatus::ACTUAL, { 1 });
+    ASSERT_EQUAL(FindNearDuplicates(search_server, index).size(), 4u);
+    ASSERT_EQUAL(index.GetDocumentCount(), 5u);
+
+    RemoveNearDuplicates(search_server, index);
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 2);
+    ASSERT_EQUAL(index.GetDocumentCount(), 2u);
+    ASSERT(FindNearDuplicates(search_server, index).empty());
+
+    // Документ, удалённый и добавленный заново под тем же id между обновлениями индекса,
+    // получает новую сигнатуру
+    // Документ, заменённый под тем же id, получает новый номер добавления
+    const uint64_t old_version = search_server.GetDocumentVersion(4);
+    ASSERT(old_version > 0);
+    search_server.RemoveDocument(4);
+    ASSERT_EQUAL(search_server.GetDocumentVersion(4), 0u);
+    AddDocument(search_server, 4, "funny pet and nasty rat with curly hair in the big city"s, DocumentStatus::ACTUAL, { 1 });
+    ASSERT(search_server.GetDocumentVersion(4) > old_version);
+    const vector<pair<int, int>> expected = { {1, 4} };
+    ASSERT_EQUAL(FindNearDuplicates(search_server, 0.8), expected);
+    ASSERT_EQUAL(FindNearDuplicates(search_server, index), expected);
+    ASSERT_EQUAL(index.GetDocumentCount(), 2u);
+}
+
+// Тест проверяет поиск через переиспользуемый контекст запроса: результаты совпадают с обычным поиском,
+// а после первого запроса повторные запросы не выделяют память
+void TestQueryContextWithoutAllocations() {
+    SearchServer search_server("and with"s);
+    AddDocument(search_server, 1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    AddDocument(search_server, 2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+    AddDocument(search_server, 3, "funny pet and not very nasty rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+    AddDocument(search_server, 4, "pet with rat and rat and rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+    AddDocument(search_server, 5, "nasty rat with curly hair"s, DocumentStatus::BANNED, { 1, 2 });
+    AddDocument(search_server, 6, "very long word antidisestablishmentarianism"s, DocumentStatus::ACTUAL, { 1, 2 });
+
+    const vector<string> queries = {
+        "nasty rat -not"s,
+        "not very funny nasty pet"s,
+        "curly hair -funny"s,
+        "antidisestablishmentarianism -pseudopseudohypoparathyroidism"s
+    };
+
+    SearchServer::QueryContext context;
+    for (const string& query : queries) {
+        const vector<Document> expected = search_server.FindTopDocuments(execution::par, query);
+        const vector<Document>& result = search_server.FindTopDocuments(context, query);
+        ASSERT_EQUAL(result.size(), expected.size());
+        for (size_t i = 0; i < result.size(); ++i) {
+            ASSERT_EQUAL(result[i].id, expected[i].id);
+            ASSERT(abs(result[i].relevance - expected[i].relevance) < RELEVANCE_PRECISION);
+        }
+    }
+
+    AllocationCounter counter;
+    for (int i = 0; i < 10; ++i) {
+        for (const string& query : queries) {
+            search_server.FindTopDocuments(context, query);
+            search_server.FindTopDocuments(context, query, DocumentStatus::BANNED);
+        }
+    }
+    // Значение читаем до ASSERT_EQUAL: макрос сам создаёт строки для сообщения
+    const size_t allocation_count = counter.GetAllocationCount();
+    ASSERT_EQUAL(allocation_count, 0u);
+}
+
+// Тест проверят работу функции ProcessQueries
 void TestParallelSearchQueries() {
     SearchServer search_server("and with"s);
     int id = 0;
@@ -656,9 +1616,9 @@ void TestParallelSearchQueries() {
     }
 
     const vector<string> queries = {
-        "nasty rat -not"s, //     3 
-        "not very funny nasty pet"s, // 5 
-        "curly hair"s // 2 
+        "nasty rat -not"s, // Для данного запроса найдётся 3 документ
+        "not very funny nasty pet"s, // 5 документов
+        "curly hair"s // 2 документа
     };
     auto result = ProcessQueries(search_server, queries);
 
@@ -667,7 +1627,7 @@ void TestParallelSearchQueries() {
     ASSERT_EQUAL(result[2].size(), 2);
 }
 
-//     ProcessQueriesJoined
+// Тест проверят работу функции ProcessQueriesJoined
 void TestParallelSearchQueriesJoined() {
     SearchServer search_server("and with"s);
 
@@ -694,15 +1654,1110 @@ void TestParallelSearchQueriesJoined() {
     }
 }
 
-//  TestSearchServer      
+void TestRequestStatistics() {
+    using namespace std::chrono;
+    const RequestStatistics::Clock::time_point start(seconds(1000));
+    {
+        RequestStatistics statistics(seconds(10));
+        statistics.Record(5, microseconds(100), start);
+        statistics.Record(0, microseconds(200), start + milliseconds(500));
+        statistics.Record(1, microseconds(1000), start + seconds(3));
+
+        const auto snapshot = statistics.GetSnapshot(start + seconds(3));
+        ASSERT_EQUAL(snapshot.GetRequestCount(), 3u);
+        ASSERT_EQUAL(snapshot.GetEmptyResultCount(), 1u);
+        ASSERT(abs(snapshot.GetQueriesPerSecond() - 0.3) < 1e-9);
+        // Перцентили с точностью до интервала гистограммы
+        ASSERT(snapshot.GetLatencyPercentile(50) >= microseconds(200) && snapshot.GetLatencyPercentile(50) < microseconds(250));
+        ASSERT(snapshot.GetLatencyPercentile(100) >= microseconds(1000) && snapshot.GetLatencyPercentile(100) < microseconds(1250));
+
+        // Окно скользит: запросы первой секунды выходят из него
+        ASSERT_EQUAL(statistics.GetSnapshot(start + seconds(11)).GetRequestCount(), 1u);
+        // Корзина первой секунды переиспользуется через круг
+        statistics.Record(3, microseconds(10), start + seconds(11));
+        const auto next_snapshot = statistics.GetSnapshot(start + seconds(11));
+        ASSERT_EQUAL(next_snapshot.GetRequestCount(), 2u);
+        ASSERT_EQUAL(next_snapshot.GetEmptyResultCount(), 0u);
+        ASSERT_EQUAL(statistics.GetSnapshot(start + seconds(30)).GetRequestCount(), 0u);
+    }
+    // Ровный поток 10 запросов в секунду: окно в 2 секунды и половина текущей секунды дают те же 10
+    {
+        RequestStatistics statistics(seconds(2));
+        for (int i = 0; i < 45; ++i) {
+            statistics.Record(1, microseconds(10), start + milliseconds(100 * i));
+        }
+        const auto snapshot = statistics.GetSnapshot(start + milliseconds(4500));
+        ASSERT_EQUAL(snapshot.GetRequestCount(), 25u);
+        ASSERT(abs(snapshot.GetQueriesPerSecond() - 10.0) < 1e-9);
+        // Ровно на границе секунды в окне только полные секунды
+        for (int i = 45; i < 50; ++i) {
+            statistics.Record(1, microseconds(10), start + milliseconds(100 * i));
+        }
+        ASSERT(abs(statistics.GetSnapshot(start + seconds(5)).GetQueriesPerSecond() - 10.0) < 1e-9);
+    }
+    // Запись из нескольких потоков
+    {
+        RequestStatistics statistics(seconds(60));
+        vector<thread> threads;
+        for (int thread_index = 0; thread_index < 4; ++thread_index) {
+            threads.emplace_back([&statistics, start]() {
+                for (int i = 0; i < 1000; ++i) {
+                    statistics.Record(i % 10, microseconds(i), start + milliseconds(i));
+                }
+            });
+        }
+        for (thread& worker : threads) {
+            worker.join();
+        }
+        const auto snapshot = statistics.GetSnapshot(start + seconds(1));
+        ASSERT_EQUAL(snapshot.GetRequestCount(), 4000u);
+        ASSERT_EQUAL(snapshot.GetEmptyResultCount(), 400u);
+    }
+    // Статистика из рабочих потоков ProcessQueries
+    {
+        SearchServer search_server("and with"s);
+        search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+        search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+        RequestStatistics statistics;
+        const vector<string> queries = { "nasty rat"s, "parrot"s, "curly hair"s, "big parrot"s, "pet"s };
+        const auto result = ProcessQueries(search_server, queries, statistics);
+        ASSERT_EQUAL(result[0].size(), 1u);
+        const auto snapshot = statistics.GetSnapshot();
+        ASSERT_EQUAL(snapshot.GetRequestCount(), 5u);
+        ASSERT_EQUAL(snapshot.GetEmptyResultCount(), 2u);
+    }
+}
+
+void TestLatencyHistogram() {
+    using namespace std::chrono;
+    {
+        LatencyHistogram histogram;
+        for (uint64_t value = 1; value <= 10000; ++value) {
+            histogram.RecordValue(value);
+        }
+        ASSERT_EQUAL(histogram.GetCount(), 10000u);
+        ASSERT_EQUAL(histogram.GetMax().count(), 10000);
+        // Погрешность перцентиля - не больше ширины интервала (1/32 значения)
+        for (const double percentile : { 50.0, 99.0, 99.9 }) {
+            const double expected = percentile * 100;
+            const double actual = static_cast<double>(histogram.GetPercentile(percentile).count());
+            ASSERT(actual >= expected && actual <= expected * (1.0 + 1.0 / LatencyHistogram::SUB_BIN_COUNT));
+        }
+        ASSERT_EQUAL(histogram.GetPercentile(100).count(), 10000);
+        // Малые значения хранятся точно
+        LatencyHistogram small;
+        small.Record(nanoseconds(7));
+        small.Record(nanoseconds(7));
+        small.Record(nanoseconds(40));
+        ASSERT_EQUAL(small.GetPercentile(50).count(), 7);
+
+        histogram.Merge(small);
+        ASSERT_EQUAL(histogram.GetCount(), 10003u);
+        ASSERT_EQUAL(LatencyHistogram::GetBin(LatencyHistogram::MAX_VALUE * 2), LatencyHistogram::BIN_COUNT - 1);
+    }
+
+    // Сбор выключен по умолчанию
+    ASSERT(!LatencyMetrics::IsEnabled());
+    LatencyMetrics::SetEnabled(true);
+    LatencyMetrics::Reset();
+    {
+        SearchServer search_server("and with"s);
+        search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+        search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+        search_server.FindTopDocuments("nasty rat"s);
+        search_server.FindTopDocuments(execution::par, "curly AND hair"s, QueryMode::BOOLEAN);
+        search_server.MatchDocument("funny pet"s, 1);
+        search_server.RemoveDocument(2);
+
+        ASSERT_EQUAL(LatencyMetrics::GetSnapshot(LatencyOperation::ADD_DOCUMENT).GetCount(), 2u);
+        ASSERT_EQUAL(LatencyMetrics::GetSnapshot(LatencyOperation::REMOVE_DOCUMENT).GetCount(), 1u);
+        ASSERT_EQUAL(LatencyMetrics::GetSnapshot(LatencyOperation::FIND_ALL_DOCUMENTS).GetCount(), 2u);
+        ASSERT_EQUAL(LatencyMetrics::GetSnapshot(LatencyOperation::SELECT_TOP_DOCUMENTS).GetCount(), 2u);
+        ASSERT_EQUAL(LatencyMetrics::GetSnapshot(LatencyOperation::MATCH_DOCUMENT).GetCount(), 1u);
+        ASSERT(LatencyMetrics::GetSnapshot(LatencyOperation::PARSE_QUERY).GetCount() >= 1u);
+
+        // Выключенный сбор не записывает замеры
+        LatencyMetrics::SetEnabled(false);
+        search_server.AddDocument(3, "pet"s, DocumentStatus::ACTUAL, { 1 });
+        LatencyMetrics::SetEnabled(true);
+        ASSERT_EQUAL(LatencyMetrics::GetSnapshot(LatencyOperation::ADD_DOCUMENT).GetCount(), 2u);
+    }
+    // Гистограммы потоков складываются, в том числе после завершения потоков
+    {
+        vector<thread> threads;
+        for (int thread_index = 0; thread_index < 4; ++thread_index) {
+            threads.emplace_back([]() {
+                for (int i = 1; i <= 100; ++i) {
+                    LatencyMetrics::Record(LatencyOperation::MATCH_DOCUMENT, microseconds(i));
+                }
+            });
+        }
+        for (thread& worker : threads) {
+            worker.join();
+        }
+        const LatencyHistogram histogram = LatencyMetrics::GetSnapshot(LatencyOperation::MATCH_DOCUMENT);
+        ASSERT_EQUAL(histogram.GetCount(), 401u);
+        ASSERT(histogram.GetMax() >= microseconds(100));
+
+        ostringstream summary;
+        LatencyMetrics::PrintSummary(summary);
+        ASSERT(summary.str().find("match_document"s) != string::npos);
+    }
+    LatencyMetrics::Reset();
+    ASSERT_EQUAL(LatencyMetrics::GetSnapshot(LatencyOperation::MATCH_DOCUMENT).GetCount(), 0u);
+    LatencyMetrics::SetEnabled(false);
+}
+
+void TestCorpusGenerator() {
+    // Частоты рангов соответствуют закону Ципфа
+    {
+        const ZipfDistribution zipf(1000, 1.0);
+        mt19937_64 generator(1);
+        vector<int> frequencies(zipf.GetSize() + 1);
+        const int sample_count = 200000;
+        for (int i = 0; i < sample_count; ++i) {
+            const uint64_t rank = zipf(generator);
+            ASSERT(rank >= 1 && rank <= zipf.GetSize());
+            ++frequencies[rank];
+        }
+        double harmonic = 0.0;
+        for (int rank = 1; rank <= 1000; ++rank) {
+            harmonic += 1.0 / rank;
+        }
+        ASSERT(abs(frequencies[1] / static_cast<double>(sample_count) - 1.0 / harmonic) < 0.01);
+        ASSERT(abs(frequencies[1] / static_cast<double>(frequencies[2]) - 2.0) < 0.15);
+        ASSERT(abs(frequencies[1] / static_cast<double>(frequencies[10]) - 10.0) < 1.5);
+    }
+    // Слова разных рангов различны, частые слова короче
+    {
+        set<string> words;
+        for (uint64_t rank = 1; rank <= 1000; ++rank) {
+            string word;
+            CorpusGenerator::AppendWord(rank, word);
+            words.insert(word);
+        }
+        ASSERT_EQUAL(words.size(), 1000u);
+        string word;
+        CorpusGenerator::AppendWord(27, word);
+        ASSERT_EQUAL(word, "aa"s);
+    }
+
+    CorpusConfig config;
+    config.vocabulary_size = 10000;
+    config.stop_word_count = 20;
+    config.stop_word_ratio = 0.25;
+    config.document_length_mu = 3.5;
+    config.max_document_length = 200;
+    // Один seed - один корпус
+    {
+        CorpusGenerator lhs(config);
+        CorpusGenerator rhs(config);
+        for (int i = 0; i < 10; ++i) {
+            ASSERT_EQUAL(lhs.NextDocument(), rhs.NextDocument());
+        }
+    }
+    // Доля стоп-слов и длины документов соответствуют настройкам
+    {
+        CorpusGenerator corpus(config);
+        const string stop_words_text = corpus.GetStopWords();
+        const vector<string_view> stop_words_list = SplitIntoWords(stop_words_text);
+        ASSERT_EQUAL(stop_words_list.size(), 20u);
+        const set<string_view> stop_words(stop_words_list.begin(), stop_words_list.end());
+        int word_count = 0;
+        int stop_word_count = 0;
+        string text;
+        for (int i = 0; i < 1000; ++i) {
+            corpus.NextDocument(text);
+            const vector<string_view> words = SplitIntoWords(text);
+            ASSERT(static_cast<int>(words.size()) >= config.min_document_length);
+            ASSERT(static_cast<int>(words.size()) <= config.max_document_length);
+            word_count += words.size();
+            stop_word_count += count_if(words.begin(), words.end(), [&stop_words](string_view word) {
+                return stop_words.count(word) > 0;
+            });
+        }
+        ASSERT(abs(stop_word_count / static_cast<double>(word_count) - config.stop_word_ratio) < 0.02);
+    }
+    // Документы добавляются в сервер потоком, запросы журнала повторяются
+    {
+        CorpusGenerator corpus(config);
+        SearchServer search_server(corpus.GetStopWords());
+        corpus.AddDocuments(search_server, 1, 500);
+        ASSERT_EQUAL(search_server.GetDocumentCount(), 500);
+        // Самое частое слово - стоп-слово и не индексируется
+        ASSERT(search_server.FindTopDocuments("a"s).empty());
+
+        QueryLogConfig log_config;
+        log_config.distinct_query_count = 1000;
+        log_config.minus_word_prob = 0.1;
+        QueryLogGenerator query_log(corpus, log_config);
+        map<string, int> query_frequencies;
+        int minus_word_count = 0;
+        for (int i = 0; i < 10000; ++i) {
+            const string query = query_log.NextQuery();
+            ++query_frequencies[query];
+            minus_word_count += count(query.begin(), query.end(), '-');
+            search_server.FindTopDocuments(query);
+        }
+        // Самый популярный запрос из 1000 встречается примерно в 1/H(1000) ~ 13% случаев
+        int max_frequency = 0;
+        for (const auto& [query, frequency] : query_frequencies) {
+            max_frequency = max(max_frequency, frequency);
+        }
+        ASSERT(max_frequency > 1000);
+        ASSERT(query_frequencies.size() < 1000u);
+        ASSERT(minus_word_count > 0);
+
+        string lhs, rhs;
+        query_log.GetQuery(5, lhs);
+        query_log.GetQuery(5, rhs);
+        ASSERT_EQUAL(lhs, rhs);
+    }
+}
+
+void TestPerfCounters() {
+    // Разность показаний: недоступный в одной из выборок счётчик недоступен и равен нулю
+    {
+        PerfSample start;
+        PerfSample end;
+        start.available.fill(true);
+        end.available.fill(true);
+        end.available[static_cast<size_t>(PerfEvent::DTLB_MISSES)] = false;
+        start.values[static_cast<size_t>(PerfEvent::CYCLES)] = 100;
+        end.values[static_cast<size_t>(PerfEvent::CYCLES)] = 350;
+        const PerfSample delta = end - start;
+        ASSERT_EQUAL(delta.Get(PerfEvent::CYCLES), 250u);
+        ASSERT(!delta.IsAvailable(PerfEvent::DTLB_MISSES));
+        ASSERT_EQUAL(delta.Get(PerfEvent::DTLB_MISSES), 0u);
+
+        PerfSample sum = delta;
+        sum += delta;
+        ASSERT_EQUAL(sum.Get(PerfEvent::CYCLES), 500u);
+        ASSERT(sum.IsAnyAvailable());
+    }
+    // Замер работает и там, где счётчики недоступны (например, в контейнере)
+    PerfMetrics::Reset();
+    {
+        SearchServer search_server("and with"s);
+        search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+        search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+        for (int i = 0; i < 10; ++i) {
+            PERF_COUNTERS("find_top_documents"sv);
+            search_server.FindTopDocuments("curly rat"s);
+        }
+        const PerfCounters& counters = PerfCounters::ForCurrentThread();
+        const auto metrics = PerfMetrics::GetSnapshot();
+        ASSERT_EQUAL(metrics.size(), 1u);
+        const PerfMetrics::Totals& totals = metrics.at("find_top_documents"s);
+        ASSERT_EQUAL(totals.calls, 10u);
+        ASSERT_EQUAL(totals.sum.IsAvailable(PerfEvent::INSTRUCTIONS), counters.IsAvailable(PerfEvent::INSTRUCTIONS));
+        if (counters.IsAvailable(PerfEvent::INSTRUCTIONS)) {
+            ASSERT(totals.sum.Get(PerfEvent::INSTRUCTIONS) > 0);
+        }
+
+        ostringstream summary;
+        PerfMetrics::PrintSummary(summary);
+        ASSERT(summary.str().find("find_top_documents"s) != string::npos);
+    }
+    PerfMetrics::Reset();
+    ASSERT(PerfMetrics::GetSnapshot().empty());
+}
+
+void TestAllocationMetrics() {
+    {
+        AllocationCounter counter;
+        vector<int> numbers(1000);
+        const size_t allocation_count = counter.GetAllocationCount();
+        const size_t allocated_bytes = counter.GetAllocatedBytes();
+        ASSERT_EQUAL(allocation_count, 1u);
+        ASSERT_EQUAL(allocated_bytes, 1000 * sizeof(int));
+    }
+
+    SearchServer search_server("and with"s);
+    search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+
+    // Выключенный учёт ничего не записывает
+    AllocationMetrics::Reset();
+    search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+    ASSERT_EQUAL(AllocationMetrics::GetSnapshot(LatencyOperation::ADD_DOCUMENT).calls, 0u);
+
+    AllocationMetrics::SetEnabled(true);
+    search_server.AddDocument(3, "nasty rat with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+    search_server.FindTopDocuments("curly rat"s);
+    SearchServer::QueryContext context;
+    search_server.FindTopDocuments(context, "curly rat"s);
+    AllocationMetrics::Reset();
+    // Поиск через прогретый контекст не выделяет память
+    search_server.FindTopDocuments(context, "curly rat"s);
+    const AllocationStats context_stats = AllocationMetrics::GetSnapshot(LatencyOperation::FIND_ALL_DOCUMENTS);
+    search_server.AddDocument(4, "funny rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+    const AllocationStats add_stats = AllocationMetrics::GetSnapshot(LatencyOperation::ADD_DOCUMENT);
+    AllocationMetrics::SetEnabled(false);
+
+    ASSERT_EQUAL(context_stats.calls, 1u);
+    ASSERT_EQUAL(context_stats.allocations, 0u);
+    ASSERT_EQUAL(add_stats.calls, 1u);
+    ASSERT(add_stats.allocations > 0u);
+    ASSERT(add_stats.bytes > 0u);
+
+    ostringstream summary;
+    AllocationMetrics::PrintSummary(summary);
+    ASSERT(summary.str().find("add_document"s) != string::npos);
+    AllocationMetrics::Reset();
+}
+
+void TestMemoryStats() {
+    SearchServer search_server("and with"s);
+    {
+        const MemoryStats& stats = search_server.GetMemoryStats();
+        ASSERT(stats.stop_words > 0u);
+        ASSERT_EQUAL(stats.GetTotal(), stats.stop_words);
+    }
+    search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+    search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::BANNED, { 3 });
+    const MemoryStats added = search_server.GetMemoryStats();
+    ASSERT(added.dictionary > 0u);
+    ASSERT(added.postings > 0u);
+    ASSERT(added.document_metadata > 0u);
+    ASSERT(added.forward_index > 0u);
+    ASSERT(added.filter_indexes > 0u);
+
+    // Удаление несуществующего документа ничего не меняет
+    search_server.RemoveDocument(100);
+    ASSERT_EQUAL(search_server.GetMemoryStats().GetTotal(), added.GetTotal());
+
+    // Словарь и ёмкость списков вхождений после удаления документов остаются до сжатия
+    search_server.RemoveDocument(1);
+    search_server.RemoveDocument(execution::par, 2);
+    {
+        const MemoryStats& stats = search_server.GetMemoryStats();
+        ASSERT_EQUAL(stats.document_metadata, 0u);
+        ASSERT_EQUAL(stats.forward_index, 0u);
+        ASSERT_EQUAL(stats.dictionary, added.dictionary);
+        ASSERT_EQUAL(stats.postings, added.postings);
+    }
+    search_server.Compact();
+    {
+        const MemoryStats& stats = search_server.GetMemoryStats();
+        ASSERT_EQUAL(stats.dictionary, 0u);
+        ASSERT_EQUAL(stats.postings, 0u);
+        ASSERT_EQUAL(stats.stop_words, added.stop_words);
+    }
+
+    // Повторное добавление тех же документов даёт ту же память словаря и документов
+    search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+    search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::BANNED, { 3 });
+    {
+        const MemoryStats& stats = search_server.GetMemoryStats();
+        ASSERT_EQUAL(stats.dictionary, added.dictionary);
+        ASSERT_EQUAL(stats.document_metadata, added.document_metadata);
+        ASSERT_EQUAL(stats.forward_index, added.forward_index);
+        ASSERT_EQUAL(search_server.FindTopDocuments("curly"s, DocumentStatus::BANNED).size(), 1u);
+    }
+
+    // При превышении лимита сжатие выполняется автоматически
+    search_server.SetMemoryBudget(1);
+    search_server.RemoveDocument(2);
+    {
+        const MemoryStats& stats = search_server.GetMemoryStats();
+        ASSERT(stats.dictionary < added.dictionary);
+        ASSERT(search_server.FindTopDocuments("curly"s, DocumentStatus::BANNED).empty());
+        ASSERT_EQUAL(search_server.FindTopDocuments("funny"s).size(), 1u);
+    }
+
+    ostringstream out;
+    out << search_server.GetMemoryStats();
+    ASSERT(out.str().find("postings"s) != string::npos);
+}
+
+void TestAsyncQueryProcessor() {
+    SearchServer search_server("and with"s);
+    search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+    search_server.AddDocument(3, "nasty rat with curly hair"s, DocumentStatus::BANNED, { 1, 2 });
+    search_server.AddDocument(4, "big dog"s, DocumentStatus::ACTUAL, { 1 });
+
+    const vector<string> queries = { "nasty rat"s, "curly hair"s, "big dog -funny"s, "pet"s, "nasty rat"s, "cat"s };
+    // Результаты совпадают с синхронным поиском, одинаковые запросы в пачке выполняются один раз
+    {
+        RequestStatistics statistics;
+        AsyncQueryOptions options;
+        options.worker_count = 2;
+        options.statistics = &statistics;
+        AsyncQueryProcessor processor(search_server, options);
+        vector<future<vector<Document>>> results;
+        for (int i = 0; i < 20; ++i) {
+            for (const string& query : queries) {
+                results.push_back(processor.SubmitQuery(query));
+            }
+        }
+        for (size_t i = 0; i < results.size(); ++i) {
+            const vector<Document> expected = search_server.FindTopDocuments(queries[i % queries.size()]);
+            const vector<Document> actual = results[i].get();
+            ASSERT_EQUAL(actual.size(), expected.size());
+            for (size_t j = 0; j < actual.size(); ++j) {
+                ASSERT_EQUAL(actual[j].id, expected[j].id);
+            }
+        }
+        const AsyncQueryProcessor::Stats stats = processor.GetStats();
+        ASSERT_EQUAL(stats.submitted, 120u);
+        ASSERT_EQUAL(stats.completed, 120u);
+        ASSERT(stats.batches <= stats.completed);
+        ASSERT_EQUAL(statistics.GetSnapshot().GetRequestCount(), 120u);
+
+        // Фильтр и ошибка разбора запроса
+        ASSERT_EQUAL(processor.SubmitQuery("curly hair"s, DocumentFilter{ { DocumentStatus::BANNED } }).get().size(), 1u);
+        ASSERT_EQUAL(processor.SubmitQuery("curly hair"s, DocumentFilter{}).get().size(), 2u);
+        future<vector<Document>> invalid = processor.SubmitQuery("--rat"s);
+        try {
+            invalid.get();
+            ASSERT_HINT(false, "invalid query must throw"s);
+        }
+        catch (const invalid_argument&) {
+        }
+    }
+    // Функция завершения и отказ при заполненной очереди
+    {
+        AsyncQueryOptions options;
+        options.worker_count = 1;
+        options.queue_capacity = 1;
+        options.max_batch_size = 1;
+        AsyncQueryProcessor processor(search_server, options);
+
+        promise<void> release;
+        shared_future<void> released = release.get_future().share();
+        promise<size_t> first_result;
+        processor.SubmitQuery("nasty rat"s, nullopt, [&](vector<Document> documents, exception_ptr error) {
+            ASSERT(!error);
+            first_result.set_value(documents.size());
+            // Рабочий поток занят, пока тест не заполнит очередь
+            released.wait();
+        });
+        ASSERT_EQUAL(first_result.get_future().get(), 1u);
+
+        auto queued = processor.TrySubmitQuery("curly hair"s);
+        ASSERT(queued.has_value());
+        ASSERT(!processor.TrySubmitQuery("pet"s).has_value());
+        ASSERT_EQUAL(processor.GetStats().rejected, 1u);
+        release.set_value();
+        ASSERT_EQUAL(queued->get().size(), 1u);
+    }
+    // Исключение функции завершения не мешает завершить остальные запросы пачки
+    {
+        AsyncQueryOptions options;
+        options.worker_count = 1;
+        options.max_batch_size = 16;
+        AsyncQueryProcessor processor(search_server, options);
+
+        promise<void> release;
+        shared_future<void> released = release.get_future().share();
+        processor.SubmitQuery("pet"s, nullopt, [&](vector<Document>, exception_ptr) {
+            released.wait();
+        });
+        // Пока рабочий поток занят, запросы копятся в очереди и попадают в одну пачку
+        atomic<int> completed{ 0 };
+        for (int i = 0; i < 4; ++i) {
+            processor.SubmitQuery("nasty rat"s, nullopt, [&completed, i](vector<Document>, exception_ptr) {
+                ++completed;
+                if (i % 2 == 0) {
+                    throw runtime_error("completion failed"s);
+                }
+            });
+        }
+        future<vector<Document>> last = processor.SubmitQuery("curly hair"s);
+        release.set_value();
+        ASSERT_EQUAL(last.get().size(), 1u);
+        ASSERT_EQUAL(completed.load(), 4);
+        ASSERT_EQUAL(processor.GetStats().completion_errors, 2u);
+        ASSERT_EQUAL(processor.SubmitQuery("pet"s).get().size(), 2u);
+
+        // Пустая функция завершения отклоняется до постановки в очередь
+        const uint64_t submitted = processor.GetStats().submitted;
+        try {
+            processor.SubmitQuery("pet"s, nullopt, AsyncQueryProcessor::Completion());
+            ASSERT_HINT(false, "empty completion must throw"s);
+        }
+        catch (const invalid_argument&) {
+        }
+        try {
+            processor.TrySubmitQuery("pet"s, nullopt, AsyncQueryProcessor::Completion());
+            ASSERT_HINT(false, "empty completion must throw"s);
+        }
+        catch (const invalid_argument&) {
+        }
+        ASSERT_EQUAL(processor.GetStats().submitted, submitted);
+    }
+}
+
+void TestSearchService() {
+    // Кодирование запросов и ответов, разбор кадров по частям
+    {
+        Request request;
+        request.type = RequestType::ADD_DOCUMENT;
+        request.request_id = 7;
+        request.document_id = -3;
+        request.status = DocumentStatus::BANNED;
+        request.ratings = { 5, -1 };
+        request.text = "funny pet"s;
+        string buffer;
+        EncodeRequest(request, buffer);
+        EncodeRequest(request, buffer);
+        string_view payload;
+        ASSERT_EQUAL(ExtractFrame(string_view(buffer).substr(0, 10), payload), 0u);
+        const size_t frame_size = ExtractFrame(buffer, payload);
+        ASSERT_EQUAL(frame_size * 2, buffer.size());
+        const Request decoded = DecodeRequest(payload);
+        ASSERT_EQUAL(decoded.request_id, 7u);
+        ASSERT_EQUAL(decoded.document_id, -3);
+        ASSERT(decoded.status == DocumentStatus::BANNED);
+        ASSERT_EQUAL(decoded.ratings, request.ratings);
+        ASSERT_EQUAL(decoded.text, request.text);
+        try {
+            DecodeRequest(payload.substr(0, payload.size() - 1));
+            ASSERT_HINT(false, "truncated request must throw"s);
+        }
+        catch (const invalid_argument&) {
+        }
+
+        Response response;
+        response.request_id = 8;
+        response.documents = { Document(2, 0.5, 4), Document(1, 0.25, -1) };
+        buffer.clear();
+        EncodeResponse(response, RequestType::FIND_TOP_DOCUMENTS, buffer);
+        ExtractFrame(buffer, payload);
+        const Response decoded_response = DecodeResponse(payload, RequestType::FIND_TOP_DOCUMENTS);
+        ASSERT_EQUAL(decoded_response.request_id, 8u);
+        ASSERT_EQUAL(decoded_response.documents.size(), 2u);
+        ASSERT_EQUAL(decoded_response.documents[1].id, 1);
+        ASSERT_EQUAL(decoded_response.documents[1].relevance, 0.25);
+        ASSERT_EQUAL(decoded_response.documents[1].rating, -1);
+    }
+#ifdef __linux__
+    SearchServer search_server("and with"s);
+    search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+
+    auto check_client = [&search_server](SearchClient& client) {
+        client.SetReceiveTimeout(chrono::seconds(10));
+        client.AddDocument(3, "nasty rat with curly hair"s, DocumentStatus::BANNED, { 1, 2 });
+        ASSERT_EQUAL(client.FindTopDocuments("curly hair"s).size(), 1u);
+        ASSERT_EQUAL(client.FindTopDocuments("curly hair"s, QueryMode::ANY_WORD, DocumentStatus::BANNED).size(), 1u);
+        ASSERT_EQUAL(client.FindTopDocuments("funny -rat"s)[0].id, 2);
+        const auto [words, status] = client.MatchDocument("rat curly"s, 3);
+        ASSERT_EQUAL(words, vector<string>({ "curly"s, "rat"s }));
+        ASSERT(status == DocumentStatus::BANNED);
+        // Ошибка выполнения запроса не закрывает соединение
+        try {
+            client.AddDocument(3, "duplicate"s, DocumentStatus::ACTUAL, {});
+            ASSERT_HINT(false, "duplicate id must throw"s);
+        }
+        catch (const invalid_argument&) {
+        }
+        client.RemoveDocument(3);
+        ASSERT_EQUAL(search_server.GetDocumentCount(), 2);
+
+        // Конвейер: ответы приходят в порядке запросов
+        vector<uint32_t> request_ids;
+        for (int i = 0; i < 50; ++i) {
+            Request request;
+            request.type = RequestType::FIND_TOP_DOCUMENTS;
+            request.text = i % 2 == 0 ? "funny"s : "nasty"s;
+            request_ids.push_back(client.Send(move(request)));
+        }
+        ASSERT_EQUAL(client.GetPendingCount(), 50u);
+        for (int i = 0; i < 50; ++i) {
+            const Response response = client.Receive();
+            ASSERT_EQUAL(response.request_id, request_ids[i]);
+            ASSERT_EQUAL(response.documents.size(), i % 2 == 0 ? 2u : 1u);
+        }
+    };
+
+    {
+        SearchServiceOptions options;
+        options.worker_count = 2;
+        SearchService service(search_server, options);
+        service.Start();
+        ASSERT(service.GetPort() != 0);
+        {
+            SearchClient client = SearchClient::ConnectTcp("127.0.0.1"s, service.GetPort());
+            check_client(client);
+        }
+        // Несколько соединений одновременно
+        vector<thread> clients;
+        atomic<int> found = 0;
+        for (int i = 0; i < 4; ++i) {
+            clients.emplace_back([&service, &found]() {
+                SearchClient client = SearchClient::ConnectTcp("localhost"s, service.GetPort());
+                for (int j = 0; j < 20; ++j) {
+                    found += static_cast<int>(client.FindTopDocuments("pet"s).size());
+                }
+            });
+        }
+        for (thread& client : clients) {
+            client.join();
+        }
+        ASSERT_EQUAL(found.load(), 4 * 20 * 2);
+        // Некорректный запрос закрывает соединение
+        {
+            SearchClient client = SearchClient::ConnectTcp("127.0.0.1"s, service.GetPort());
+            client.SetReceiveTimeout(chrono::seconds(10));
+            Request request;
+            request.type = static_cast<RequestType>(99);
+            client.Send(move(request));
+            try {
+                client.Receive();
+                ASSERT_HINT(false, "malformed request must close the connection"s);
+            }
+            catch (const runtime_error&) {
+            }
+        }
+        // Клиент закрыл соединение на запись: ответы на отправленные запросы всё равно приходят
+        {
+            SearchClient client = SearchClient::ConnectTcp("127.0.0.1"s, service.GetPort());
+            client.SetReceiveTimeout(chrono::seconds(10));
+            for (int i = 0; i < 3; ++i) {
+                Request request;
+                request.type = RequestType::FIND_TOP_DOCUMENTS;
+                request.text = "funny"s;
+                client.Send(move(request));
+            }
+            client.Flush();
+            shutdown(client.GetSocket(), SHUT_WR);
+            for (int i = 0; i < 3; ++i) {
+                ASSERT_EQUAL(client.Receive().documents.size(), 2u);
+            }
+        }
+        const SearchService::Stats stats = service.GetStats();
+        ASSERT_EQUAL(stats.connections, 7u);
+        ASSERT_EQUAL(stats.protocol_errors, 1u);
+        ASSERT(stats.batches <= stats.requests);
+    }
+    {
+        SearchServiceOptions options;
+        options.unix_path = "/tmp/search_service_test_"s + to_string(chrono::steady_clock::now().time_since_epoch().count()) + ".sock"s;
+        SearchService service(search_server, options);
+        service.Start();
+        SearchClient client = SearchClient::ConnectUnix(options.unix_path);
+        check_client(client);
+    }
+    // Длинный конвейер при малых пределах очереди: чтение соединения приостанавливается
+    // и возобновляется, все ответы приходят по порядку
+    {
+        SearchServiceOptions options;
+        options.worker_count = 1;
+        options.max_pending_requests = 2;
+        options.max_pending_output = 64;
+        SearchService service(search_server, options);
+        service.Start();
+        SearchClient client = SearchClient::ConnectTcp("127.0.0.1"s, service.GetPort());
+        client.SetReceiveTimeout(chrono::seconds(10));
+        vector<uint32_t> request_ids;
+        for (int i = 0; i < 300; ++i) {
+            Request request;
+            request.type = RequestType::FIND_TOP_DOCUMENTS;
+            request.text = i % 2 == 0 ? "funny"s : "nasty"s;
+            request_ids.push_back(client.Send(move(request)));
+        }
+        for (int i = 0; i < 300; ++i) {
+            const Response response = client.Receive();
+            ASSERT_EQUAL(response.request_id, request_ids[i]);
+            ASSERT_EQUAL(response.documents.size(), i % 2 == 0 ? 2u : 1u);
+        }
+        ASSERT(service.GetStats().batches > 1);
+    }
+#endif
+}
+
+void TestSearchAggregator() {
+    // Коллекция, разбитая на 3 шарда по id, и один сервер со всеми документами
+    CorpusConfig corpus_config;
+    corpus_config.vocabulary_size = 300;
+    corpus_config.document_length_mu = 2.5;
+    corpus_config.stop_word_count = 5;
+    CorpusGenerator corpus(corpus_config);
+    SearchServer full_server(corpus.GetStopWords());
+    vector<SearchServer> shard_servers(3, SearchServer(corpus.GetStopWords()));
+    string text;
+    for (int id = 0; id < 300; ++id) {
+        corpus.NextDocument(text);
+        const vector<int> ratings = { id % 7 - 3 };
+        full_server.AddDocument(id, text, DocumentStatus::ACTUAL, ratings);
+        shard_servers[id % 3].AddDocument(id, text, DocumentStatus::ACTUAL, ratings);
+    }
+    QueryLogConfig log_config;
+    log_config.minus_word_prob = 0.2;
+    QueryLogGenerator query_log(corpus, log_config);
+    vector<string> queries(30);
+    for (string& query : queries) {
+        query_log.NextQuery(query);
+    }
+    auto check_documents = [](const vector<Document>& actual, const vector<Document>& expected) {
+        ASSERT_EQUAL(actual.size(), expected.size());
+        for (size_t i = 0; i < actual.size(); ++i) {
+            ASSERT_EQUAL(actual[i].id, expected[i].id);
+            ASSERT(abs(actual[i].relevance - expected[i].relevance) < RELEVANCE_PRECISION);
+            ASSERT_EQUAL(actual[i].rating, expected[i].rating);
+        }
+    };
+
+    // Ранжирование по сложенной статистике шардов совпадает с ранжированием всей коллекции
+    for (const string& query : queries) {
+        TermStatistics statistics;
+        for (const SearchServer& shard_server : shard_servers) {
+            statistics += shard_server.GetTermStatistics(query);
+        }
+        ASSERT_EQUAL(statistics.collection.document_count, 300);
+        vector<Document> merged;
+        for (const SearchServer& shard_server : shard_servers) {
+            SearchServer::QueryContext context;
+            const vector<Document>& documents = shard_server.FindTopDocuments(context, query, DocumentStatus::ACTUAL, statistics);
+            merged.insert(merged.end(), documents.begin(), documents.end());
+        }
+        sort(merged.begin(), merged.end(), SearchServer::IsRankedBefore);
+        merged.resize(min<size_t>(merged.size(), MAX_RESULT_DOCUMENT_COUNT));
+        check_documents(merged, full_server.FindTopDocuments(query));
+    }
+#ifdef __linux__
+    vector<unique_ptr<SearchService>> services;
+    vector<ServiceAddress> addresses;
+    for (SearchServer& shard_server : shard_servers) {
+        SearchServiceOptions options;
+        options.worker_count = 1;
+        services.push_back(make_unique<SearchService>(shard_server, options));
+        services.back()->Start();
+        addresses.push_back(ParseServiceAddress(":"s + to_string(services.back()->GetPort())));
+    }
+    // Сервер, который принимает соединения (в очередь), но не отвечает
+    const int silent_socket = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in silent_address{};
+    silent_address.sin_family = AF_INET;
+    silent_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_length = sizeof(silent_address);
+    ASSERT(bind(silent_socket, reinterpret_cast<sockaddr*>(&silent_address), sizeof(silent_address)) == 0);
+    ASSERT(listen(silent_socket, 16) == 0);
+    getsockname(silent_socket, reinterpret_cast<sockaddr*>(&silent_address), &address_length);
+    ServiceAddress silent_shard;
+    silent_shard.port = ntohs(silent_address.sin_port);
+    // Сервер с переполненной очередью соединений: подключение к нему не завершается,
+    // ядро отбрасывает запросы на соединение, пока очередь не разберут
+    const int stalled_socket = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in stalled_address = silent_address;
+    stalled_address.sin_port = 0;
+    ASSERT(bind(stalled_socket, reinterpret_cast<sockaddr*>(&stalled_address), sizeof(stalled_address)) == 0);
+    ASSERT(listen(stalled_socket, 0) == 0);
+    getsockname(stalled_socket, reinterpret_cast<sockaddr*>(&stalled_address), &address_length);
+    ServiceAddress stalled_shard;
+    stalled_shard.port = ntohs(stalled_address.sin_port);
+    vector<SearchClient> queued_clients;
+    queued_clients.push_back(SearchClient::Connect(stalled_shard));
+
+    {
+        SearchAggregator aggregator({ { addresses[0] }, { addresses[1] }, { addresses[2] } });
+        for (const string& query : queries) {
+            const AggregatedResult result = aggregator.FindTopDocuments(query);
+            ASSERT(!result.IsPartial());
+            check_documents(result.documents, full_server.FindTopDocuments(query));
+        }
+        try {
+            aggregator.FindTopDocuments("--rat"s);
+            ASSERT_HINT(false, "invalid query must throw"s);
+        }
+        catch (const invalid_argument&) {
+        }
+        ASSERT_EQUAL(aggregator.GetStats().partial_results, 0u);
+    }
+    // Неответивший шард пропускается по таймауту
+    {
+        SearchAggregatorOptions options;
+        options.shard_timeout = chrono::milliseconds(50);
+        options.hedge_delay = chrono::milliseconds(0);
+        SearchAggregator aggregator({ { addresses[0] }, { addresses[1] }, { silent_shard } }, options);
+        const AggregatedResult result = aggregator.FindTopDocuments(queries[0]);
+        ASSERT(result.IsPartial());
+        ASSERT_EQUAL(result.answered_shards, 2u);
+        ASSERT_EQUAL(aggregator.GetStats().shard_timeouts, 1u);
+        ASSERT_EQUAL(aggregator.GetStats().partial_results, 1u);
+    }
+    // Дублирующий запрос ко второй реплике отвечает за неответившую первую
+    {
+        SearchAggregatorOptions options;
+        options.shard_timeout = chrono::seconds(5);
+        options.hedge_delay = chrono::milliseconds(5);
+        SearchAggregator aggregator({ { addresses[0] }, { addresses[1] }, { silent_shard, addresses[2] } }, options);
+        const AggregatedResult result = aggregator.FindTopDocuments(queries[1]);
+        ASSERT(!result.IsPartial());
+        check_documents(result.documents, full_server.FindTopDocuments(queries[1]));
+        const SearchAggregator::Stats stats = aggregator.GetStats();
+        ASSERT(stats.hedge_wins >= 1);
+        ASSERT(stats.hedged_requests >= stats.hedge_wins);
+        ASSERT_EQUAL(stats.shard_timeouts, 0u);
+    }
+    // Зависшее подключение к шарду не задерживает рассылку остальным и не блокирует дублирование
+    {
+        SearchAggregatorOptions options;
+        options.shard_timeout = chrono::milliseconds(50);
+        options.hedge_delay = chrono::milliseconds(0);
+        SearchAggregator aggregator({ { stalled_shard }, { addresses[1] }, { addresses[2] } }, options);
+        const auto start = chrono::steady_clock::now();
+        const AggregatedResult result = aggregator.FindTopDocuments(queries[2]);
+        ASSERT(chrono::steady_clock::now() - start < chrono::milliseconds(500));
+        ASSERT_EQUAL(result.answered_shards, 2u);
+        ASSERT_EQUAL(aggregator.GetStats().shard_timeouts, 1u);
+    }
+    {
+        SearchAggregatorOptions options;
+        options.shard_timeout = chrono::seconds(5);
+        options.hedge_delay = chrono::milliseconds(5);
+        SearchAggregator aggregator({ { stalled_shard, addresses[0] }, { addresses[1] }, { addresses[2] } }, options);
+        const auto start = chrono::steady_clock::now();
+        const AggregatedResult result = aggregator.FindTopDocuments(queries[3]);
+        ASSERT(chrono::steady_clock::now() - start < chrono::milliseconds(500));
+        ASSERT(!result.IsPartial());
+        check_documents(result.documents, full_server.FindTopDocuments(queries[3]));
+        ASSERT(aggregator.GetStats().hedge_wins >= 1);
+    }
+    // Отказ в соединении сразу переводит запрос на другую реплику
+    {
+        ServiceAddress closed_shard;
+        closed_shard.port = stalled_shard.port;
+        queued_clients.clear();
+        close(stalled_socket);
+        SearchAggregatorOptions options;
+        options.shard_timeout = chrono::seconds(5);
+        options.hedge_delay = chrono::seconds(5);
+        SearchAggregator aggregator({ { closed_shard, addresses[0] }, { addresses[1] }, { addresses[2] } }, options);
+        const auto start = chrono::steady_clock::now();
+        const AggregatedResult result = aggregator.FindTopDocuments(queries[4]);
+        ASSERT(chrono::steady_clock::now() - start < chrono::seconds(1));
+        ASSERT(!result.IsPartial());
+        ASSERT(aggregator.GetStats().shard_errors >= 1);
+    }
+    close(silent_socket);
+#endif
+}
+
+void TestReplication() {
+    auto make_addition = [](int document_id, const string& text) {
+        Request addition;
+        addition.type = RequestType::ADD_DOCUMENT;
+        addition.document_id = document_id;
+        addition.text = text;
+        addition.ratings = { document_id };
+        return addition;
+    };
+    auto make_removal = [](int document_id) {
+        Request removal;
+        removal.type = RequestType::REMOVE_DOCUMENT;
+        removal.document_id = document_id;
+        return removal;
+    };
+    {
+        ReplicationLog log(3);
+        ASSERT_EQUAL(log.Append(make_addition(1, "white cat"s)), 1u);
+        ASSERT_EQUAL(log.Append(make_addition(2, "black dog"s)), 2u);
+        ASSERT_EQUAL(log.Append(make_addition(3, "grey parrot"s)), 3u);
+        ASSERT_EQUAL(log.Append(make_removal(2)), 4u);
+        try {
+            Request search;
+            log.Append(search);
+            ASSERT_HINT(false, "only mutations are logged"s);
+        }
+        catch (const invalid_argument&) {
+        }
+        // Хранятся последние 3 записи: после записи 1 читать можно, с начала - уже нет
+        vector<Request> mutations;
+        ASSERT(!log.Read(0, 10, mutations));
+        ASSERT_EQUAL(log.Read(1, 2, mutations).value(), 4u);
+        ASSERT_EQUAL(mutations.size(), 2u);
+        ASSERT_EQUAL(mutations[0].document_id, 2);
+        ASSERT(mutations[1].type == RequestType::ADD_DOCUMENT);
+        mutations.clear();
+        ASSERT_EQUAL(log.Read(4, 10, mutations).value(), 4u);
+        ASSERT(mutations.empty());
+        ASSERT(!log.Read(5, 10, mutations));
+
+        // Снимок - живые документы по страницам
+        const ReplicationSnapshot first_page = log.GetSnapshot(-1, 1);
+        ASSERT_EQUAL(first_page.sequence, 4u);
+        ASSERT_EQUAL(first_page.documents.size(), 1u);
+        ASSERT_EQUAL(first_page.documents[0].document_id, 1);
+        const ReplicationSnapshot second_page = log.GetSnapshot(1, 10);
+        ASSERT_EQUAL(second_page.documents.size(), 1u);
+        ASSERT_EQUAL(second_page.documents[0].text, "grey parrot"s);
+        // Ограничение размера: записи до бюджета байт, но хотя бы одна
+        mutations.clear();
+        ASSERT_EQUAL(log.Read(1, 10, mutations, 1).value(), 4u);
+        ASSERT_EQUAL(mutations.size(), 1u);
+        ASSERT_EQUAL(log.GetSnapshot(-1, 10, 1).documents.size(), 1u);
+        ASSERT_EQUAL(log.GetSnapshot(-1, 10, 100).documents.size(), 2u);
+
+        ReplicationLog replica_log;
+        replica_log.Reset(log.GetSnapshot());
+        ASSERT_EQUAL(replica_log.GetLastSequence(), 4u);
+        ASSERT_EQUAL(replica_log.Append(make_removal(1)), 5u);
+        ASSERT_EQUAL(replica_log.GetSnapshot().documents.size(), 1u);
+    }
+#ifdef __linux__
+    CorpusConfig corpus_config;
+    corpus_config.vocabulary_size = 300;
+    corpus_config.document_length_mu = 2.5;
+    corpus_config.stop_word_count = 5;
+    CorpusGenerator corpus(corpus_config);
+    QueryLogGenerator query_log(corpus, QueryLogConfig());
+    vector<string> queries(20);
+    for (string& query : queries) {
+        query_log.NextQuery(query);
+    }
+    auto check_converged = [&queries](SearchServer& primary, SearchServer& replica, shared_mutex& replica_mutex) {
+        shared_lock lock(replica_mutex);
+        ASSERT_EQUAL(replica.GetDocumentCount(), primary.GetDocumentCount());
+        for (const string& query : queries) {
+            const vector<Document> expected = primary.FindTopDocuments(query);
+            const vector<Document> actual = replica.FindTopDocuments(query);
+            ASSERT_EQUAL(actual.size(), expected.size());
+            for (size_t i = 0; i < actual.size(); ++i) {
+                ASSERT_EQUAL(actual[i].id, expected[i].id);
+                ASSERT(abs(actual[i].relevance - expected[i].relevance) < RELEVANCE_PRECISION);
+            }
+        }
+    };
+
+    // Журнал первичного сервера короче истории: реплика начинает со снимка
+    SearchServer primary_server(corpus.GetStopWords());
+    ReplicationLog primary_log(50);
+    SearchServiceOptions primary_options;
+    primary_options.worker_count = 1;
+    primary_options.replication_log = &primary_log;
+    SearchService primary_service(primary_server, primary_options);
+    primary_service.Start();
+    SearchClient writer = SearchClient::ConnectTcp("127.0.0.1"s, primary_service.GetPort());
+    writer.SetReceiveTimeout(chrono::seconds(10));
+    string text;
+    for (int id = 0; id < 200; ++id) {
+        corpus.NextDocument(text);
+        writer.AddDocument(id, text, DocumentStatus::ACTUAL, { id % 5 });
+    }
+    for (int id = 0; id < 200; id += 7) {
+        writer.RemoveDocument(id);
+    }
+
+    SearchServer replica_server(corpus.GetStopWords());
+    shared_mutex replica_mutex;
+    ReplicationLog replica_log;
+    SearchServiceOptions replica_options;
+    replica_options.worker_count = 1;
+    replica_options.replication_log = &replica_log;
+    replica_options.server_mutex = &replica_mutex;
+    replica_options.read_only = true;
+    SearchService replica_service(replica_server, replica_options);
+    replica_service.Start();
+    SearchReplicaOptions options;
+    options.primary.port = primary_service.GetPort();
+    options.batch_size = 16; // несколько страниц снимка и пачек журнала
+    options.replication_log = &replica_log;
+    SearchReplica replica(replica_server, replica_mutex, options);
+    replica.Start();
+    ASSERT(replica.WaitForSequence(primary_log.GetLastSequence(), chrono::seconds(10)));
+    ASSERT_EQUAL(replica.GetStats().snapshots, 1u);
+    check_converged(primary_server, replica_server, replica_mutex);
+
+    // Новые изменения приходят журналом
+    for (int id = 200; id < 230; ++id) {
+        corpus.NextDocument(text);
+        writer.AddDocument(id, text, DocumentStatus::ACTUAL, { 1 });
+    }
+    writer.RemoveDocument(1);
+    ASSERT(replica.WaitForSequence(primary_log.GetLastSequence(), chrono::seconds(10)));
+    ASSERT_EQUAL(replica.GetStats().snapshots, 1u);
+    ASSERT_EQUAL(replica.GetStats().errors, 0u);
+    ASSERT_EQUAL(replica.GetLag().records, 0u);
+    check_converged(primary_server, replica_server, replica_mutex);
+
+    // Реплика обслуживает поиск и отклоняет изменения
+    SearchClient reader = SearchClient::ConnectTcp("127.0.0.1"s, replica_service.GetPort());
+    reader.SetReceiveTimeout(chrono::seconds(10));
+    ASSERT_EQUAL(reader.FindTopDocuments(queries[0]).size(), primary_server.FindTopDocuments(queries[0]).size());
+    try {
+        reader.RemoveDocument(2);
+        ASSERT_HINT(false, "replica must reject writes"s);
+    }
+    catch (const invalid_argument&) {
+    }
+
+    // Переключение: реплика становится первичным сервером и продолжает журнал
+    replica.Stop();
+    replica_service.SetReadOnly(false);
+    reader.RemoveDocument(2);
+    ASSERT_EQUAL(replica_log.GetLastSequence(), primary_log.GetLastSequence() + 1);
+    {
+        shared_lock lock(replica_mutex);
+        ASSERT_EQUAL(replica_server.GetDocumentCount(), primary_server.GetDocumentCount() - 1);
+    }
+
+    // Пачка больших документов больше предельного кадра: ответы делятся по размеру, реплика догоняет
+    {
+        SearchServer large_primary_server;
+        ReplicationLog large_primary_log;
+        SearchServiceOptions large_primary_options;
+        large_primary_options.worker_count = 1;
+        large_primary_options.max_frame_size = 64 * 1024;
+        large_primary_options.replication_log = &large_primary_log;
+        SearchService large_primary_service(large_primary_server, large_primary_options);
+        large_primary_service.Start();
+        SearchClient large_writer = SearchClient::ConnectTcp("127.0.0.1"s, large_primary_service.GetPort());
+        large_writer.SetReceiveTimeout(chrono::seconds(10));
+        auto make_large_text = [](int id) {
+            string large_text = "word"s + to_string(id);
+            while (large_text.size() < 20 * 1024) {
+                large_text += " filler"s;
+            }
+            return large_text;
+        };
+        for (int id = 0; id < 20; ++id) {
+            large_writer.AddDocument(id, make_large_text(id), DocumentStatus::ACTUAL, { id });
+        }
+
+        SearchServer large_replica_server;
+        shared_mutex large_replica_mutex;
+        SearchReplicaOptions large_options;
+        large_options.primary.port = large_primary_service.GetPort();
+        large_options.max_frame_size = large_primary_options.max_frame_size;
+        SearchReplica large_replica(large_replica_server, large_replica_mutex, large_options);
+        large_replica.Start();
+        ASSERT(large_replica.WaitForSequence(large_primary_log.GetLastSequence(), chrono::seconds(10)));
+        for (int id = 20; id < 40; ++id) {
+            large_writer.AddDocument(id, make_large_text(id), DocumentStatus::ACTUAL, { id });
+        }
+        ASSERT(large_replica.WaitForSequence(large_primary_log.GetLastSequence(), chrono::seconds(10)));
+        ASSERT_EQUAL(large_replica.GetStats().errors, 0u);
+        ASSERT_EQUAL(large_replica.GetStats().snapshots, 1u);
+        shared_lock lock(large_replica_mutex);
+        ASSERT_EQUAL(large_replica_server.GetDocumentCount(), 40);
+        ASSERT_EQUAL(large_replica_server.FindTopDocuments("word37"s).size(), 1u);
+    }
+#endif
+}
+
+// Функция TestSearchServer является точкой входа для запуска тестов
 void TestSearchServer() {
+    RUN_TEST(TestWordTokenizer);
     RUN_TEST(TestAddingDocumentsStopWordsExcludingStopWords);
     RUN_TEST(TestExludeDocumentsWithMinusWordsFromResults);
 
     RUN_TEST(TestMatchDocuments);
     RUN_TEST(TestMatchDocumentsInPar);
+    RUN_TEST(TestMatchDocumentsBulk);
     RUN_TEST(TestMatchDocumentsThrowExecptions);
 
+    RUN_TEST(TestFindTopDocumentsWithAllWords);
+    RUN_TEST(TestBooleanQuery);
+    RUN_TEST(TestPhraseQuery);
+    RUN_TEST(TestWildcardQuery);
+    RUN_TEST(TestFuzzyQuery);
+    RUN_TEST(TestBm25Scoring);
+    RUN_TEST(TestDocumentFilter);
+    RUN_TEST(TestCursorPagination);
+    RUN_TEST(TestQueryProfile);
     RUN_TEST(TestSortingByRelevance);
     RUN_TEST(TestRatingCalculation);
     RUN_TEST(TestFilterWithPredicate);
@@ -710,11 +2765,23 @@ void TestSearchServer() {
     RUN_TEST(TestRelevanceCalculating);
     RUN_TEST(TestDeletetingDocument);
     RUN_TEST(TestDeleteDuplicates);
+    RUN_TEST(TestNearDuplicates);
+    RUN_TEST(TestQueryContextWithoutAllocations);
+    RUN_TEST(TestAllocationMetrics);
+    RUN_TEST(TestMemoryStats);
     RUN_TEST(TestParallelSearchQueries);
     RUN_TEST(TestParallelSearchQueriesJoined);
+    RUN_TEST(TestAsyncQueryProcessor);
+    RUN_TEST(TestSearchService);
+    RUN_TEST(TestSearchAggregator);
+    RUN_TEST(TestReplication);
+    RUN_TEST(TestRequestStatistics);
+    RUN_TEST(TestLatencyHistogram);
+    RUN_TEST(TestCorpusGenerator);
+    RUN_TEST(TestPerfCounters);
 
     //RUN_TEST(TestRemovingDocumentsWithPolicy);
     //RUN_TEST(TestMatchingDocumentsWithPolicy);
     RUN_TEST(TestFindingDocuments);
 }
-//-----------    ------------
\ No newline at end of file
+//-----------Окончание модульных тестов поисковой системы------------
\ No newline at end of file